@@ -0,0 +1,264 @@
+#include <glog/logging.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <common/event.h>
+#include <os/os_functions.h>
+#include <riemann_tcp_connection.h>
+
+/* Syscalls and time spent acking pipelined riemann frames. A client writes
+ * batches of frames and reads back one ack per frame, the server side is a
+ * poll() loop driving riemann_tcp_connection. It compares the coalesced
+ * acks with what riemann_tcp_connection did before, queueing one ack per
+ * frame and writing them when the socket is reported writable.
+ */
+
+namespace {
+
+const size_t k_frames = 1000000;
+
+class counting_os_functions : public os_functions_interface {
+public:
+  ssize_t recv(int fd, void *buf, size_t len, int flags) {
+    syscalls++;
+    return ::recv(fd, buf, len, flags);
+  }
+
+  ssize_t write(int fd, const void *buf, size_t count) {
+    syscalls++;
+    return ::write(fd, buf, count);
+  }
+
+  ssize_t sendmsg(int fd, const struct msghdr *msg, int flags) {
+    syscalls++;
+    return ::sendmsg(fd, msg, flags);
+  }
+
+  size_t syscalls = 0;
+};
+
+counting_os_functions counting_os;
+
+class bench_async_fd : public async_fd {
+public:
+  bench_async_fd(const int fd) : fd_(fd), revents(0), mode_(read) {}
+
+  int fd() const { return fd_; }
+  bool error() const { return false; }
+  void stop() {}
+  bool ready_read() const { return revents & POLLIN; }
+  bool ready_write() const { return revents & POLLOUT; }
+  void set_mode(const mode & m) { mode_ = m; }
+  async_loop & loop() { LOG(FATAL) << "not used"; throw; }
+
+  short events() const {
+    return (mode_ == read || mode_ == readwrite ? POLLIN : 0)
+           | (mode_ == write || mode_ == readwrite ? POLLOUT : 0);
+  }
+
+  int fd_;
+  short revents;
+
+private:
+  mode mode_;
+};
+
+std::vector<char> ok_response() {
+
+  riemann::Msg msg;
+  msg.set_ok(true);
+
+  uint32_t nsize = htonl(msg.ByteSize());
+  std::vector<char> response(sizeof(nsize) + msg.ByteSize());
+
+  memcpy(&response[0], &nsize, sizeof(nsize));
+  msg.SerializeToArray(&response[sizeof(nsize)], msg.ByteSize());
+
+  return response;
+}
+
+/* What riemann_tcp_connection did before */
+class queued_acks_connection {
+public:
+  queued_acks_connection(tcp_connection & conn, raw_msg_fn_t fn)
+    : conn_(conn), fn_(fn), ok_(ok_response()) {}
+
+  void callback(async_fd & async) {
+
+    if (async.ready_read() && conn_.read()) {
+
+      auto & buffer = conn_.r_buffer;
+
+      while (buffer.size() >= 4) {
+
+        uint32_t header;
+        memcpy(&header, buffer.data(), sizeof(header));
+
+        const size_t length = ntohl(header);
+
+        if (buffer.size() < length + 4) {
+          break;
+        }
+
+        conn_.queue_write(&ok_[0], ok_.size());
+
+        auto p = buffer.data() + 4;
+        fn_(std::vector<unsigned char>(p, p + length));
+
+        buffer.consume(length + 4);
+      }
+
+    }
+
+    if (!conn_.close_connection && async.ready_write()
+        && conn_.pending_write())
+    {
+      conn_.write();
+    }
+
+  }
+
+private:
+  tcp_connection & conn_;
+  raw_msg_fn_t fn_;
+  std::vector<char> ok_;
+};
+
+std::vector<unsigned char> frame() {
+
+  riemann::Msg msg;
+  auto e = msg.add_events();
+  e->set_host("host");
+  e->set_service("service");
+  e->set_metric_d(1);
+
+  uint32_t nsize = htonl(msg.ByteSize());
+  std::vector<unsigned char> buffer(sizeof(nsize) + msg.ByteSize());
+
+  memcpy(&buffer[0], &nsize, sizeof(nsize));
+  msg.SerializeToArray(&buffer[sizeof(nsize)], msg.ByteSize());
+
+  return buffer;
+}
+
+template <class Connection>
+void run(const std::string & name, const size_t batch) {
+
+  int sv[2];
+  const int ret = socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv);
+  CHECK(ret == 0);
+
+  const size_t ack_size = ok_response().size();
+
+  std::vector<unsigned char> block;
+  const auto f = frame();
+
+  for (size_t i = 0; i < batch; i++) {
+    block.insert(block.end(), f.begin(), f.end());
+  }
+
+  const size_t batches = k_frames / batch;
+
+  std::thread client([&]()
+  {
+    std::vector<unsigned char> acks(batch * ack_size);
+
+    struct pollfd pfd = {sv[1], 0, 0};
+
+    for (size_t i = 0; i < batches; i++) {
+
+      size_t written = 0;
+      size_t read = 0;
+
+      // Acks are read while writing, so that neither side blocks
+      while (read < acks.size()) {
+
+        pfd.events = POLLIN | (written < block.size() ? POLLOUT : 0);
+        poll(&pfd, 1, -1);
+
+        if (pfd.revents & POLLOUT) {
+          const ssize_t n = ::write(sv[1], &block[written],
+                                    block.size() - written);
+          if (n > 0) {
+            written += n;
+          }
+        }
+
+        if (pfd.revents & POLLIN) {
+          const ssize_t n = ::read(sv[1], &acks[read], acks.size() - read);
+          if (n > 0) {
+            read += n;
+          }
+        }
+      }
+    }
+  });
+
+  tcp_connection conn(sv[0]);
+
+  size_t received = 0;
+
+  Connection rconn(conn, [&](std::vector<unsigned char>) { received++; });
+
+  bench_async_fd async(sv[0]);
+
+  counting_os.syscalls = 0;
+  size_t polls = 0;
+
+  auto start = std::chrono::high_resolution_clock::now();
+
+  while (received < batches * batch || conn.pending_write()) {
+
+    // What the pool sets after each callback
+    async.set_mode(conn.pending_write() ? async_fd::readwrite
+                                        : async_fd::read);
+
+    struct pollfd pfd = {sv[0], async.events(), 0};
+    poll(&pfd, 1, -1);
+    polls++;
+
+    async.revents = pfd.revents;
+    rconn.callback(async);
+
+    CHECK(!conn.close_connection);
+  }
+
+  auto end = std::chrono::high_resolution_clock::now();
+
+  client.join();
+
+  close(sv[0]);
+  close(sv[1]);
+
+  const double secs = std::chrono::duration<double>(end - start).count();
+  const double frames = batches * batch;
+
+  std::cout << name << "  batch: " << batch
+            << "  " << (counting_os.syscalls + polls) / frames
+            << " syscalls/frame"
+            << "  " << frames / secs / 1e6 << " M frames/s"
+            << std::endl;
+}
+
+}
+
+os_functions g_os_functions(counting_os);
+
+int main(int, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  for (const size_t batch : {1, 16, 256}) {
+    run<queued_acks_connection>("queued acks   ", batch);
+    run<riemann_tcp_connection>("coalesced acks", batch);
+  }
+
+  return 0;
+}
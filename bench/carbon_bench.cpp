@@ -0,0 +1,109 @@
+#include <glog/logging.h>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <carbon_parser.h>
+
+/* Graphite plaintext lines turned into riemann events per second.
+ * carbon_parser is compared with a straightforward parser that splits
+ * lines with std::getline() and reads their fields with an istringstream.
+ *
+ * usage: carbon_bench
+ */
+
+namespace {
+
+const size_t k_lines = 2000000;
+const size_t k_lines_per_read = 512;
+
+std::string make_data() {
+
+  std::string data;
+
+  for (size_t i = 0; i < k_lines_per_read; i++) {
+    data += "host" + std::to_string(i % 64) + ".cpu.core"
+            + std::to_string(i % 8) + ".user "
+            + std::to_string(i * 0.25) + " 1400000000\n";
+  }
+
+  return data;
+}
+
+/* Parses as simply as possible */
+void naive_parse(const std::string & data, riemann::Msg & msg) {
+
+  std::istringstream lines(data);
+  std::string line;
+
+  while (std::getline(lines, line)) {
+
+    std::istringstream fields(line);
+    std::string path;
+    double value;
+    int64_t timestamp;
+
+    if (!(fields >> path >> value >> timestamp)) {
+      continue;
+    }
+
+    const auto dot = path.find('.');
+
+    auto event = msg.add_events();
+
+    if (dot == std::string::npos) {
+      event->set_service(path);
+    } else {
+      event->set_host(path.substr(0, dot));
+      event->set_service(path.substr(dot + 1));
+    }
+
+    event->set_metric_d(value);
+    event->set_time(timestamp);
+  }
+}
+
+template <class Fn>
+void run(const std::string & name, Fn fn) {
+
+  const std::string data = make_data();
+  riemann::Msg msg;
+  size_t events = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  for (size_t lines = 0; lines < k_lines; lines += k_lines_per_read) {
+    fn(data, msg);
+    events += msg.events_size();
+    msg.Clear();
+  }
+
+  auto t1 = std::chrono::steady_clock::now();
+
+  CHECK(events == k_lines);
+
+  const double secs = std::chrono::duration<double>(t1 - t0).count();
+
+  std::cout << name
+            << "  " << events / secs / 1e6 << " M lines/s"
+            << "  " << secs / events * 1e9 << " ns/line"
+            << std::endl;
+}
+
+}
+
+int main(int, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  run("istringstream", naive_parse);
+
+  carbon_parser parser(1);
+
+  run("carbon_parser", [&](const std::string & data, riemann::Msg & msg)
+      {
+        parser.parse(data.data(), data.size(), false, msg);
+      });
+
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <glog/logging.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include <pool/executor_thread_pool.h>
+#include <instrumentation/instrumentation.h>
+
+/* Compares the executor with and without work stealing. Tasks simulate
+ * messages of skewed sizes: most are small, a few are very large, as when
+ * some clients send big batches of events.
+ */
+
+namespace {
+
+const size_t k_threads = 4;
+const size_t k_producers = 2;
+const size_t k_tasks = 200000;
+const size_t k_small_cost = 20;
+const size_t k_large_cost = 20000;
+const double k_large_ratio = 0.005;
+
+std::atomic<uint64_t> sink(0);
+
+void burn(const size_t units) {
+
+  uint64_t x = units;
+
+  for (size_t i = 0; i < units * 50; i++) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+
+  sink += x;
+}
+
+double run(const bool work_stealing, const std::vector<size_t> & costs) {
+
+  config conf = config();
+  conf.executor_pool_size = k_threads;
+  conf.executor_partition = "none";
+  conf.executor_work_stealing = work_stealing;
+  conf.executor_pin_threads = false;
+  conf.executor_max_pool_size = 0;
+  conf.ingest_high_watermark_mb = 0;
+  conf.ingest_low_watermark_mb = 0;
+
+  instrumentation::instrumentation instr(conf);
+
+  executor_thread_pool pool(instr, conf);
+
+  std::atomic<size_t> done(0);
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> producers;
+
+  for (size_t p = 0; p < k_producers; p++) {
+
+    producers.emplace_back([&, p]()
+    {
+      for (size_t i = p; i < costs.size(); i += k_producers) {
+        const auto cost = costs[i];
+        pool.add_task([&, cost]() { burn(cost); done++; });
+      }
+    });
+
+  }
+
+  for (auto & t : producers) {
+    t.join();
+  }
+
+  while (done != costs.size()) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+
+  auto elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  pool.stop();
+
+  return elapsed;
+}
+
+}
+
+int main(int, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  std::mt19937 gen(42);
+  std::bernoulli_distribution large(k_large_ratio);
+
+  std::vector<size_t> costs;
+
+  for (size_t i = 0; i < k_tasks; i++) {
+    costs.push_back(large(gen) ? k_large_cost : k_small_cost);
+  }
+
+  for (const bool stealing : {false, true}) {
+
+    const auto elapsed = run(stealing, costs);
+
+    std::cout << (stealing ? "work stealing" : "round robin  ")
+              << "  tasks: " << costs.size()
+              << "  time: " << elapsed << "s"
+              << "  tasks/s: " << static_cast<size_t>(costs.size() / elapsed)
+              << std::endl;
+
+  }
+
+  return 0;
+}
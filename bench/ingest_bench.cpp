@@ -0,0 +1,151 @@
+#include <glog/logging.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <proto.pb.h>
+#include <pool/executor_thread_pool.h>
+#include <instrumentation/instrumentation.h>
+
+/* Ingest latency of a riemann message from the moment a tcp thread has
+ * read it until its events have been processed. It compares processing on
+ * the tcp thread (inline_ingest) with the hop through the executor pool.
+ */
+
+namespace {
+
+const size_t k_loops = 2;
+const size_t k_executor_threads = 2;
+const size_t k_messages_per_loop = 50000;
+const size_t k_events_per_message = 10;
+const auto k_send_interval = std::chrono::microseconds(20);
+
+typedef std::chrono::steady_clock steady_clock;
+
+std::atomic<uint64_t> processed(0);
+
+std::vector<unsigned char> make_raw_msg() {
+
+  riemann::Msg msg;
+
+  for (size_t i = 0; i < k_events_per_message; i++) {
+    auto e = msg.add_events();
+    e->set_host("host-" + std::to_string(i));
+    e->set_service("service");
+    e->set_metric_d(i);
+  }
+
+  std::vector<unsigned char> raw(msg.ByteSize());
+  msg.SerializeToArray(&raw[0], raw.size());
+
+  return raw;
+}
+
+void incoming_event(const std::vector<unsigned char> & raw_msg) {
+
+  riemann::Msg msg;
+  msg.ParseFromArray(&raw_msg[0], raw_msg.size());
+
+  double sum = 0;
+  for (int i = 0; i < msg.events_size(); i++) {
+    sum += msg.events(i).metric_d();
+  }
+
+  processed += static_cast<uint64_t>(sum);
+}
+
+void run(const bool inline_ingest) {
+
+  config conf = config();
+  conf.executor_pool_size = k_executor_threads;
+  conf.executor_partition = "none";
+  conf.executor_work_stealing = true;
+  conf.executor_pin_threads = false;
+  conf.executor_max_pool_size = 0;
+  conf.ingest_high_watermark_mb = 0;
+  conf.ingest_low_watermark_mb = 0;
+
+  instrumentation::instrumentation instr(conf);
+
+  executor_thread_pool pool(instr, conf);
+
+  const auto raw_msg = make_raw_msg();
+  const size_t total = k_loops * k_messages_per_loop;
+
+  std::vector<double> latencies(total, 0);
+  std::atomic<size_t> done(0);
+
+  std::vector<std::thread> loops;
+
+  for (size_t l = 0; l < k_loops; l++) {
+
+    loops.emplace_back([&, l]()
+    {
+      auto next = steady_clock::now();
+
+      for (size_t i = 0; i < k_messages_per_loop; i++) {
+
+        while (steady_clock::now() < next) {}
+        next += k_send_interval;
+
+        const size_t id = l * k_messages_per_loop + i;
+        const auto start = steady_clock::now();
+
+        auto process = [&, id, start](const std::vector<unsigned char> & raw)
+        {
+          incoming_event(raw);
+          latencies[id] = std::chrono::duration<double, std::micro>(
+              steady_clock::now() - start).count();
+          done++;
+        };
+
+        // The tcp pool hands each frame over as a fresh vector
+        std::vector<unsigned char> frame(raw_msg);
+
+        if (inline_ingest) {
+          process(frame);
+        } else {
+          pool.add_task([=]() { process(frame); });
+        }
+
+      }
+    });
+
+  }
+
+  for (auto & t : loops) {
+    t.join();
+  }
+
+  while (done != total) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  pool.stop();
+
+  std::sort(latencies.begin(), latencies.end());
+
+  auto pct = [&](double p) { return latencies[(total - 1) * p]; };
+
+  std::cout << (inline_ingest ? "inline  " : "executor")
+            << "  messages: " << total
+            << "  p50: " << pct(0.5) << "us"
+            << "  p99: " << pct(0.99) << "us"
+            << "  p999: " << pct(0.999) << "us"
+            << "  max: " << latencies.back() << "us"
+            << std::endl;
+}
+
+}
+
+int main(int, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  run(false);
+  run(true);
+
+  return 0;
+}
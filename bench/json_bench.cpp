@@ -0,0 +1,122 @@
+#include <glog/logging.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <json/json.h>
+#include <json_event_parser.h>
+
+/* JSON events turned into riemann events per second. json_event_parser is
+ * compared with reading a document with Json::Reader and setting the event
+ * fields from it, as rule_tester_util does.
+ *
+ * usage: json_bench
+ */
+
+namespace {
+
+const size_t k_events = 1000000;
+const size_t k_events_per_request = 500;
+
+std::string make_body() {
+
+  std::string body = "[";
+
+  for (size_t i = 0; i < k_events_per_request; i++) {
+    body += std::string(i ? "," : "")
+            + "{\"host\":\"host" + std::to_string(i % 64) + ".example.com\","
+            + "\"service\":\"cpu core" + std::to_string(i % 8) + " user\","
+            + "\"state\":\"ok\",\"time\":1400000000,"
+            + "\"metric\":" + std::to_string(i * 0.25) + ","
+            + "\"ttl\":60,\"tags\":[\"production\",\"linux\"],"
+            + "\"datacenter\":\"eu-west\"}";
+  }
+
+  return body + "]";
+}
+
+/* What Json::Reader takes */
+void jsoncpp_parse(const std::string & body, riemann::Msg & msg) {
+
+  Json::Value root;
+  Json::Reader reader;
+
+  const bool parsed = reader.parse(body, root);
+  CHECK(parsed);
+
+  for (const auto & e : root) {
+
+    auto event = msg.add_events();
+
+    for (const auto & m : e.getMemberNames()) {
+
+      const auto & v = e[m];
+
+      if (m == "host") {
+        event->set_host(v.asString());
+      } else if (m == "service") {
+        event->set_service(v.asString());
+      } else if (m == "state") {
+        event->set_state(v.asString());
+      } else if (m == "time") {
+        event->set_time(v.asInt64());
+      } else if (m == "metric") {
+        event->set_metric_d(v.asDouble());
+      } else if (m == "ttl") {
+        event->set_ttl(v.asFloat());
+      } else if (m == "tags") {
+        for (const auto & tag : v) {
+          event->add_tags(tag.asString());
+        }
+      } else {
+        auto attribute = event->add_attributes();
+        attribute->set_key(m);
+        attribute->set_value(v.asString());
+      }
+    }
+  }
+}
+
+template <class Fn>
+void run(const std::string & name, Fn fn) {
+
+  const std::string body = make_body();
+  riemann::Msg msg;
+  size_t events = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  for (; events < k_events; events += k_events_per_request) {
+    fn(body, msg);
+    CHECK(msg.events_size() == int(k_events_per_request));
+    msg.Clear();
+  }
+
+  auto t1 = std::chrono::steady_clock::now();
+
+  const double secs = std::chrono::duration<double>(t1 - t0).count();
+  const double bytes = double(body.size()) * events / k_events_per_request;
+
+  std::cout << name
+            << "  " << events / secs / 1e6 << " M events/s"
+            << "  " << bytes / secs / 1e6 << " MB/s"
+            << std::endl;
+}
+
+}
+
+int main(int, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  run("Json::Reader     ", jsoncpp_parse);
+
+  json_event_parser parser;
+
+  run("json_event_parser", [&](const std::string & body, riemann::Msg & msg)
+      {
+        const bool parsed = parser.parse(body.data(), body.size(), msg);
+        CHECK(parsed);
+      });
+
+  return 0;
+}
@@ -0,0 +1,116 @@
+#include <glog/logging.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <async/async_loop.h>
+
+/* Throughput and cpu time of a pool loop reading from many connections,
+ * with libev or io_uring underneath. The callbacks do one read each, as
+ * tcp_connection does, and a writer thread sends small messages over all of
+ * them. With io_uring the connections are set to receive with multishot
+ * receives, as the riemann ones are.
+ *
+ * usage: loop_bench [libev|io_uring]
+ */
+
+namespace {
+
+const size_t k_connections = 64;
+const size_t k_message_size = 64;
+const size_t k_messages = 1000000;
+const size_t k_read_size = 4096;
+
+typedef std::chrono::steady_clock steady_clock;
+
+double cpu_us(const struct rusage & usage) {
+  return usage.ru_utime.tv_sec * 1e6 + usage.ru_utime.tv_usec
+         + usage.ru_stime.tv_sec * 1e6 + usage.ru_stime.tv_usec;
+}
+
+}
+
+int main(int argc, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  const std::string backend(argc > 1 ? argv[1] : "libev");
+
+  set_async_loop_backend(backend);
+
+  auto events = make_async_events(1, [](async_loop &) {});
+  auto & loop = events->loop(0);
+
+  const size_t total_bytes = k_messages * k_message_size;
+  size_t received = 0;
+  size_t callbacks = 0;
+
+  std::vector<int> writers;
+
+  for (size_t i = 0; i < k_connections; i++) {
+
+    int sv[2];
+    const int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    CHECK(ret == 0);
+
+    writers.push_back(sv[1]);
+
+    loop.add_fd(sv[0], async_fd::read, [&](async_fd & fd)
+    {
+      char buffer[k_read_size];
+
+      const ssize_t n = fd.recv(buffer, sizeof(buffer));
+      CHECK(n > 0);
+
+      callbacks++;
+      received += n;
+
+      if (received == total_bytes) {
+        events->stop_all_loops();
+      }
+    });
+
+    loop.set_fd_recv(sv[0]);
+  }
+
+  struct rusage usage;
+
+  const auto start = steady_clock::now();
+
+  std::thread loop_thread([&]()
+  {
+    events->start_loop(0);
+    getrusage(RUSAGE_THREAD, &usage);
+  });
+
+  const std::string message(k_message_size, 'x');
+
+  for (size_t i = 0; i < k_messages; i++) {
+    const ssize_t n = write(writers[i % k_connections], message.data(),
+                            message.size());
+    CHECK(n == static_cast<ssize_t>(message.size()));
+  }
+
+  loop_thread.join();
+
+  const auto s = std::chrono::duration<double>(
+      steady_clock::now() - start).count();
+
+  std::cout << backend
+            << "  " << k_messages / s / 1e6 << " M messages/s"
+            << "  loop cpu: " << cpu_us(usage) / 1e6 << " s"
+            << "  " << cpu_us(usage) * 1000 / k_messages << " ns/message"
+            << "  messages per callback: "
+            << static_cast<double>(k_messages) / callbacks
+            << std::endl;
+
+  for (auto fd : writers) {
+    close(fd);
+  }
+
+  return 0;
+}
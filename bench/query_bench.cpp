@@ -0,0 +1,99 @@
+#include <glog/logging.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <driver.h>
+#include <query/query_cache.h>
+
+/* Riemann queries compiled per second. Parsing every query, as the
+ * websocket server does, is compared with query_cache, for the handful of
+ * queries a dashboard keeps sending. Each query is matched against a few
+ * events, scanning the index costs the same either way.
+ *
+ * usage: query_bench
+ */
+
+namespace {
+
+const size_t k_queries = 1000000;
+const size_t k_events = 4;
+
+const std::vector<std::string> k_dashboard = {
+  "host = \"web1\" and service = \"cpu\"",
+  "service =~ \"disk%\" and not state = \"ok\"",
+  "(tagged \"prod\" or tagged \"staging\") and metric > 0.9",
+  "state = \"critical\" or state = \"warning\"",
+  "host =~ \"db%\" and (service = \"load\" or service = \"memory\")",
+};
+
+std::vector<Event> make_events() {
+
+  std::vector<Event> events;
+
+  for (size_t i = 0; i < k_events; i++) {
+    Event e;
+    e.set_host("web" + std::to_string(i % 10));
+    e.set_service(i % 2 ? "cpu" : "disk /var");
+    e.set_state(i % 7 ? "ok" : "critical");
+    e.set_metric_d(i / static_cast<double>(k_events));
+    e.add_tag(i % 3 ? "prod" : "dev");
+    events.push_back(e);
+  }
+
+  return events;
+}
+
+query_fn_t compile(const std::string & query) {
+
+  query_context query_ctx;
+  queryparser::driver driver(query_ctx);
+
+  driver.parse_string(query, "query");
+
+  return query_ctx.evaluate();
+}
+
+template <class Fn>
+void run(const std::string & name, Fn get_fn) {
+
+  const auto events = make_events();
+  size_t matches = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < k_queries; i++) {
+
+    auto query_fn = get_fn(k_dashboard[i % k_dashboard.size()]);
+
+    for (const auto & e : events) {
+      matches += query_fn(e);
+    }
+  }
+
+  auto t1 = std::chrono::steady_clock::now();
+
+  const double secs = std::chrono::duration<double>(t1 - t0).count();
+
+  std::cout << name
+            << "  " << k_queries / secs / 1e3 << " K queries/s"
+            << "  " << secs / k_queries * 1e6 << " us/query"
+            << "  matches: " << matches << std::endl;
+}
+
+}
+
+int main(int, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  run("parse every query", compile);
+
+  query_cache cache(1024);
+
+  run("query_cache      ", [&](const std::string & query)
+      {
+        return cache.get(query);
+      });
+
+  return 0;
+}
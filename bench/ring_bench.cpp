@@ -0,0 +1,157 @@
+#include <glog/logging.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <tbb/concurrent_queue.h>
+#include <pool/ring_buffer.h>
+
+/* Throughput of the queues that hand events and tasks between threads. It
+ * compares the rings with the tbb::concurrent_bounded_queue the pools used
+ * before, with one and with several producers, popping one value at a time
+ * and in batches.
+ */
+
+namespace {
+
+const size_t k_values = 2000000;
+const size_t k_capacity = 16384;
+const size_t k_producers = 4;
+const size_t k_batch_size = 64;
+
+typedef std::chrono::steady_clock steady_clock;
+
+struct value_t {
+  uint64_t id;
+  char payload[56];
+};
+
+void report(const std::string & name, const size_t producers,
+            const steady_clock::time_point start)
+{
+  const auto ns = std::chrono::duration<double, std::nano>(
+      steady_clock::now() - start).count();
+
+  std::cout << name << "  producers: " << producers
+            << "  " << ns / k_values << " ns/value"
+            << "  " << k_values / (ns / 1e9) / 1e6 << " M values/s"
+            << std::endl;
+}
+
+template <class Push, class Pop>
+void run(const std::string & name, const size_t producers, Push push,
+         Pop pop)
+{
+  const size_t per_producer = k_values / producers;
+
+  const auto start = steady_clock::now();
+
+  std::vector<std::thread> threads;
+
+  for (size_t p = 0; p < producers; p++) {
+    threads.emplace_back([=]()
+    {
+      for (size_t i = 0; i < per_producer; i++) {
+        while (!push(value_t{i, {}})) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  uint64_t sum = 0;
+
+  for (size_t popped = 0; popped < per_producer * producers; ) {
+
+    const size_t n = pop(sum);
+
+    if (n == 0) {
+      std::this_thread::yield();
+    }
+
+    popped += n;
+  }
+
+  for (auto & t : threads) {
+    t.join();
+  }
+
+  report(name, producers, start);
+
+  CHECK(sum > 0);
+}
+
+void run_tbb(const size_t producers) {
+
+  tbb::concurrent_bounded_queue<value_t> queue;
+  queue.set_capacity(k_capacity);
+
+  run("tbb bounded queue   ", producers,
+      [&](const value_t & v) { return queue.try_push(v); },
+      [&](uint64_t & sum)
+      {
+        value_t v;
+        size_t n = 0;
+
+        // How the pools drained their queues
+        while (!queue.empty()) {
+          if (!queue.try_pop(v)) {
+            continue;
+          }
+          sum += v.id;
+          n++;
+        }
+
+        return n;
+      });
+}
+
+template <class Ring>
+bool push(Ring & ring, const value_t & v) {
+  return ring.try_push(v);
+}
+
+bool push(mpsc_queue<value_t> & queue, const value_t & v) {
+  queue.push(v);
+  return true;
+}
+
+template <class Ring>
+void run_ring(const std::string & name, const size_t producers) {
+
+  Ring ring(k_capacity);
+  std::vector<value_t> values;
+
+  run(name, producers,
+      [&](const value_t & v) { return push(ring, v); },
+      [&](uint64_t & sum)
+      {
+        values.clear();
+        const size_t n = ring.pop_batch(values, k_batch_size);
+
+        for (const auto & v : values) {
+          sum += v.id;
+        }
+
+        return n;
+      });
+}
+
+}
+
+int main(int, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  run_tbb(1);
+  run_ring<spsc_ring<value_t>>("spsc ring           ", 1);
+  run_ring<mpsc_ring<value_t>>("mpsc ring           ", 1);
+  run_ring<mpsc_queue<value_t>>("mpsc queue          ", 1);
+
+  run_tbb(k_producers);
+  run_ring<mpsc_ring<value_t>>("mpsc ring           ", k_producers);
+  run_ring<mpsc_queue<value_t>>("mpsc queue          ", k_producers);
+
+  return 0;
+}
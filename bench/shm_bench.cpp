@@ -0,0 +1,251 @@
+#include <glog/logging.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <common/event.h>
+#include <transport/listen_tcp_socket.h>
+#include <transport/listen_unix_socket.h>
+#include <transport/shm_pool.h>
+#include <transport/shm_producer.h>
+#include <transport/tcp_connection.h>
+
+/* Frames per second and cpu per frame of a producer on the same host
+ * sending riemann messages one at a time, over tcp loopback, a unix socket
+ * and a shm_ring. The tcp and unix socket frames are read with
+ * tcp_connection from a poll() loop, the ring is read by shm_pool.
+ *
+ * usage: shm_bench [libev|io_uring]
+ */
+
+namespace {
+
+const size_t k_frames = 1000000;
+const uint32_t k_port = 25556;
+const std::string k_socket_path = "/tmp/cavalieri_shm_bench.sock";
+const std::string k_shm_path = "/tmp/cavalieri_shm_bench_ring.sock";
+
+double cpu_s(const struct rusage & usage) {
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+std::vector<unsigned char> message() {
+
+  riemann::Msg msg;
+  auto e = msg.add_events();
+  e->set_host("host");
+  e->set_service("service");
+  e->set_metric_d(1);
+
+  std::vector<unsigned char> buffer(msg.ByteSize());
+  msg.SerializeToArray(&buffer[0], buffer.size());
+
+  return buffer;
+}
+
+int connect_tcp() {
+
+  int fd = socket(PF_INET, SOCK_STREAM, 0);
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(k_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  const int ret = connect(fd, (struct sockaddr *) &addr, sizeof(addr));
+  CHECK(ret == 0);
+
+  return fd;
+}
+
+int connect_unix() {
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, k_socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+  const int ret = connect(fd, (struct sockaddr *) &addr, sizeof(addr));
+  CHECK(ret == 0);
+
+  return fd;
+}
+
+/* Reads frames as riemann_tcp_connection does */
+size_t read_stream(const int listen_fd) {
+
+  struct pollfd lfd = {listen_fd, POLLIN, 0};
+  poll(&lfd, 1, -1);
+
+  const int fd = accept(listen_fd, NULL, NULL);
+  CHECK(fd >= 0);
+
+  tcp_connection conn(fd);
+  size_t received = 0;
+
+  while (received < k_frames) {
+
+    struct pollfd pfd = {fd, POLLIN, 0};
+    poll(&pfd, 1, -1);
+
+    if (!conn.read()) {
+      break;
+    }
+
+    auto & buffer = conn.r_buffer;
+
+    while (buffer.size() >= 4) {
+
+      uint32_t header;
+      memcpy(&header, buffer.data(), sizeof(header));
+
+      const size_t length = ntohl(header);
+
+      if (buffer.size() < length + 4) {
+        break;
+      }
+
+      auto p = buffer.data() + 4;
+      std::vector<unsigned char> msg(p, p + length);
+
+      buffer.consume(length + 4);
+      received++;
+    }
+  }
+
+  close(fd);
+
+  return received;
+}
+
+void report(const std::string & name, const size_t frames, const double secs,
+            const double cpu)
+{
+  std::cout << name
+            << "  " << frames / secs / 1e6 << " M frames/s"
+            << "  " << cpu / frames * 1e9 << " ns cpu/frame"
+            << std::endl;
+}
+
+void run_stream(const std::string & name, const int listen_fd,
+                std::function<int()> connect_fn)
+{
+
+  const auto msg = message();
+  std::vector<unsigned char> frame(4 + msg.size());
+  const uint32_t header = htonl(msg.size());
+  memcpy(&frame[0], &header, 4);
+  memcpy(&frame[4], &msg[0], msg.size());
+
+  struct rusage start;
+  getrusage(RUSAGE_SELF, &start);
+  auto t0 = std::chrono::steady_clock::now();
+
+  std::thread producer([&]()
+  {
+    const int fd = connect_fn();
+
+    for (size_t i = 0; i < k_frames; i++) {
+      const ssize_t n = write(fd, &frame[0], frame.size());
+      CHECK(n == ssize_t(frame.size()));
+    }
+
+    close(fd);
+  });
+
+  const size_t received = read_stream(listen_fd);
+
+  producer.join();
+
+  auto t1 = std::chrono::steady_clock::now();
+  struct rusage end;
+  getrusage(RUSAGE_SELF, &end);
+
+  CHECK(received == k_frames);
+
+  report(name, received, std::chrono::duration<double>(t1 - t0).count(),
+         cpu_s(end) - cpu_s(start));
+}
+
+void run_shm() {
+
+  std::atomic<size_t> received(0);
+
+  shm_pool pool(k_shm_path, [&](std::vector<unsigned char>) { received++; },
+                {});
+  pool.start_threads();
+
+  // Lets the pool listen
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  const auto msg = message();
+
+  struct rusage start;
+  getrusage(RUSAGE_SELF, &start);
+  auto t0 = std::chrono::steady_clock::now();
+
+  std::thread producer([&]()
+  {
+    shm_producer producer;
+
+    const bool connected = producer.connect(k_shm_path, 1024 * 1024);
+    CHECK(connected);
+
+    for (size_t i = 0; i < k_frames; i++) {
+      while (!producer.send(&msg[0], msg.size())) {
+        std::this_thread::yield();
+      }
+    }
+
+    while (received < k_frames) {
+      std::this_thread::yield();
+    }
+  });
+
+  producer.join();
+
+  auto t1 = std::chrono::steady_clock::now();
+  struct rusage end;
+  getrusage(RUSAGE_SELF, &end);
+
+  pool.stop_threads();
+  unlink(k_shm_path.c_str());
+
+  report("shm ring     ", received, std::chrono::duration<double>(t1 - t0)
+         .count(), cpu_s(end) - cpu_s(start));
+}
+
+}
+
+int main(int argc, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  set_async_loop_backend(argc > 1 ? argv[1] : "libev");
+
+  const int tcp_fd = create_tcp_listen_socket(k_port);
+  run_stream("tcp loopback ", tcp_fd, connect_tcp);
+  close(tcp_fd);
+
+  const int unix_fd = create_unix_listen_socket(k_socket_path);
+  run_stream("unix socket  ", unix_fd, connect_unix);
+  close(unix_fd);
+  unlink(k_socket_path.c_str());
+
+  run_shm();
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+#include <glog/logging.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <statsd_table.h>
+
+/* Statsd lines ingested per second. statsd_table aggregation is compared
+ * with turning every line into an event, which is what the streams would
+ * otherwise get, and the events each produce are counted.
+ *
+ * usage: statsd_bench
+ */
+
+namespace {
+
+const size_t k_lines = 4000000;
+const size_t k_lines_per_datagram = 20;
+const size_t k_metrics = 1000;
+
+std::vector<std::string> make_datagrams() {
+
+  std::vector<std::string> datagrams;
+  size_t n = 0;
+
+  for (size_t i = 0; i < k_metrics; i++) {
+
+    std::string datagram;
+
+    for (size_t j = 0; j < k_lines_per_datagram; j++, n++) {
+
+      const auto name = "app.service" + std::to_string(n % k_metrics);
+
+      switch (n % 4) {
+        case 0: datagram += name + ".hits:1|c\n"; break;
+        case 1: datagram += name + ".queue:" + std::to_string(n % 50)
+                            + "|g\n"; break;
+        case 2: datagram += name + ".users:u" + std::to_string(n % 300)
+                            + "|s\n"; break;
+        default: datagram += name + ".latency:" + std::to_string(n % 997)
+                             + ".5|ms\n"; break;
+      }
+    }
+
+    datagrams.push_back(datagram);
+  }
+
+  return datagrams;
+}
+
+/* One event per line */
+void to_events(const std::string & datagram, riemann::Msg & msg) {
+
+  const char * p = datagram.data();
+  const char * end = p + datagram.size();
+
+  while (p < end) {
+
+    auto nl = static_cast<const char *>(memchr(p, '\n', end - p));
+    statsd_line line;
+
+    if (parse_statsd_line(p, nl - p, line)) {
+      auto event = msg.add_events();
+      event->set_service(line.name, line.name_size);
+      event->set_metric_d(line.number);
+    }
+
+    p = nl + 1;
+  }
+
+}
+
+template <class Fn>
+void run(const std::string & name, Fn fn) {
+
+  const auto datagrams = make_datagrams();
+  size_t lines = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; lines < k_lines; i++, lines += k_lines_per_datagram) {
+    fn(datagrams[i % datagrams.size()]);
+  }
+
+  auto t1 = std::chrono::steady_clock::now();
+
+  const double secs = std::chrono::duration<double>(t1 - t0).count();
+
+  std::cout << name
+            << "  " << lines / secs / 1e6 << " M lines/s"
+            << "  " << secs / lines * 1e9 << " ns/line";
+}
+
+}
+
+int main(int, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  riemann::Msg msg;
+  size_t events = 0;
+
+  run("event per line", [&](const std::string & datagram)
+      {
+        to_events(datagram, msg);
+        events += msg.events_size();
+        msg.Clear();
+      });
+
+  std::cout << "  events: " << events << std::endl;
+
+  statsd_table table;
+
+  run("statsd_table  ", [&](const std::string & datagram)
+      {
+        table.add(datagram.data(), datagram.size());
+      });
+
+  table.flush(msg, 0, 20, 10, {0, 0.5, 0.95, 0.99, 1});
+
+  std::cout << "  events: " << msg.events_size() << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,205 @@
+#include <glog/logging.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <boost/circular_buffer.hpp>
+#include <transport/tcp_connection.h>
+
+/* Cpu cost of reading riemann frames from a socket and copying each one
+ * out into its message, as riemann_tcp_connection does. It compares
+ * tcp_connection with the circular buffer it used before, which recv()d
+ * into a stack array, copied that into the buffer and linearized it for
+ * every frame. Reported in MB/s per core of the reading thread.
+ */
+
+namespace {
+
+const size_t k_buffer_size = 1024 * (1024 + 512);
+const size_t k_total_bytes = 256 * 1024 * 1024;
+const size_t k_block_size = 1024 * 1024;
+
+/* What tcp_connection did before */
+class circular_connection {
+public:
+  circular_connection(const int fd) : fd_(fd), r_buffer(k_buffer_size) {}
+
+  bool read() {
+
+    unsigned char b[r_buffer.reserve()];
+
+    const ssize_t nread = recv(fd_, &b[0], r_buffer.reserve(), 0);
+
+    if (nread <= 0) {
+      return false;
+    }
+
+    r_buffer.insert(r_buffer.end(), &b[0], &b[0] + nread);
+
+    return true;
+  }
+
+  template <class Fn>
+  void frames(Fn fn) {
+
+    while (r_buffer.size() >= 4) {
+
+      uint32_t header;
+
+      auto p = r_buffer.linearize();
+      std::copy(p, p + 4, reinterpret_cast<unsigned char*>(&header));
+
+      const size_t length = ntohl(header);
+
+      if (r_buffer.size() < length + 4) {
+        return;
+      }
+
+      r_buffer.erase_begin(4);
+
+      std::vector<unsigned char> msg(length);
+
+      p = r_buffer.linearize();
+      std::copy(p, p + length, msg.begin());
+
+      r_buffer.erase_begin(length);
+
+      fn(msg);
+    }
+
+  }
+
+private:
+  int fd_;
+  boost::circular_buffer<unsigned char> r_buffer;
+};
+
+class contiguous_connection {
+public:
+  contiguous_connection(const int fd) : conn_(fd) {}
+
+  bool read() {
+    return conn_.read();
+  }
+
+  template <class Fn>
+  void frames(Fn fn) {
+
+    auto & buffer = conn_.r_buffer;
+
+    while (buffer.size() >= 4) {
+
+      uint32_t header;
+      memcpy(&header, buffer.data(), sizeof(header));
+
+      const size_t length = ntohl(header);
+
+      if (buffer.size() < length + 4) {
+        return;
+      }
+
+      auto p = buffer.data() + 4;
+      std::vector<unsigned char> msg(p, p + length);
+
+      buffer.consume(length + 4);
+
+      fn(msg);
+    }
+
+  }
+
+private:
+  tcp_connection conn_;
+};
+
+double cpu_s(const struct rusage & usage) {
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+template <class Connection>
+void run(const std::string & name, const size_t frame_size) {
+
+  int sv[2];
+  const int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+  CHECK(ret == 0);
+
+  // A block of whole frames, written over and over
+  std::vector<unsigned char> block;
+  const uint32_t header = htonl(frame_size);
+
+  while (block.size() + frame_size + 4 <= std::max(k_block_size,
+                                                   frame_size + 4))
+  {
+    block.insert(block.end(), reinterpret_cast<const unsigned char*>(&header),
+                 reinterpret_cast<const unsigned char*>(&header) + 4);
+    block.resize(block.size() + frame_size, 'x');
+  }
+
+  const size_t blocks = k_total_bytes / block.size() + 1;
+  const size_t frames = blocks * (block.size() / (frame_size + 4));
+
+  std::thread writer([&]()
+  {
+    for (size_t i = 0; i < blocks; i++) {
+      size_t written = 0;
+      while (written < block.size()) {
+        const ssize_t n = write(sv[1], &block[written], block.size() - written);
+        CHECK(n > 0);
+        written += n;
+      }
+    }
+  });
+
+  Connection conn(sv[0]);
+
+  size_t received = 0;
+  size_t bytes = 0;
+
+  struct rusage start;
+  getrusage(RUSAGE_THREAD, &start);
+
+  while (received < frames && conn.read()) {
+    conn.frames([&](const std::vector<unsigned char> & msg)
+                {
+                  received++;
+                  bytes += msg.size();
+                });
+  }
+
+  struct rusage end;
+  getrusage(RUSAGE_THREAD, &end);
+
+  writer.join();
+
+  close(sv[0]);
+  close(sv[1]);
+
+  CHECK(received == frames);
+
+  const double cpu = cpu_s(end) - cpu_s(start);
+
+  std::cout << name << "  frame: " << frame_size << " B"
+            << "  " << bytes / cpu / (1024 * 1024) << " MB/s per core"
+            << std::endl;
+}
+
+}
+
+int main(int, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  for (const size_t frame_size : {64, 1024, 64 * 1024}) {
+    run<circular_connection>("circular buffer  ", frame_size);
+    run<contiguous_connection>("contiguous buffer", frame_size);
+  }
+
+  return 0;
+}
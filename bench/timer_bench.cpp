@@ -0,0 +1,185 @@
+#include <glog/logging.h>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include <async/timer_wheel.h>
+
+/* Cost of the loop timers with 100k periodic tasks, as with a rate() per
+ * by() key. It compares the timer wheel with the priority queue the loops
+ * used before, which removed tasks by rebuilding the queue.
+ */
+
+namespace {
+
+const size_t k_timers = 100000;
+const uint64_t k_interval_ms = 1000;
+const uint64_t k_run_ms = 10000;
+const size_t k_heap_removals = 100;
+const size_t k_namespaces = 10;
+
+typedef std::chrono::steady_clock steady_clock;
+
+uint64_t fired = 0;
+
+double elapsed_ns(const steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+      steady_clock::now() - start).count();
+}
+
+std::string ns(const size_t i) {
+  return "lib" + std::to_string(i % k_namespaces) + ".so";
+}
+
+/* What real_async_loop did before the timer wheel */
+class heap_timers {
+public:
+  void add(const uint64_t id, const std::string & ns, const uint64_t now_ms,
+           const uint64_t delay_ms, const uint64_t interval_ms)
+  {
+    tasks_.push({ns, [](){ fired++; }, id, interval_ms, now_ms + delay_ms});
+  }
+
+  void advance(const uint64_t now_ms) {
+
+    while (!tasks_.empty() && tasks_.top().time_ms <= now_ms) {
+
+      auto task = tasks_.top();
+      tasks_.pop();
+
+      task.fn();
+
+      if (task.interval_ms > 0) {
+        task.time_ms = now_ms + task.interval_ms;
+        tasks_.push(task);
+      }
+
+    }
+  }
+
+  void remove(const std::function<bool(const uint64_t, const std::string &)>
+              & predicate)
+  {
+    queue_t new_tasks;
+
+    while (!tasks_.empty()) {
+
+      auto task = tasks_.top();
+      tasks_.pop();
+
+      if (!predicate(task.id, task.ns)) {
+        new_tasks.push(task);
+      }
+
+    }
+
+    tasks_ = new_tasks;
+  }
+
+private:
+  struct task_t {
+    std::string ns;
+    std::function<void()> fn;
+    uint64_t id;
+    uint64_t interval_ms;
+    uint64_t time_ms;
+  };
+
+  struct task_cmp {
+    bool operator()(const task_t & lhs, const task_t & rhs) const {
+      return lhs.time_ms > rhs.time_ms;
+    }
+  };
+
+  typedef std::priority_queue<task_t, std::vector<task_t>, task_cmp> queue_t;
+
+  queue_t tasks_;
+};
+
+void report(const std::string & name, const std::string & op,
+            const double ns, const size_t ops)
+{
+  std::cout << name << "  " << op << ": " << ns / ops << " ns/op"
+            << std::endl;
+}
+
+template <class T>
+void run(const std::string & name, T & timers,
+         std::function<void(T &, uint64_t, uint64_t)> add,
+         std::function<void(T &, uint64_t)> remove,
+         std::function<void(T &, std::string)> remove_ns,
+         const size_t removals)
+{
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<uint64_t> offset(1, k_interval_ms);
+
+  fired = 0;
+
+  auto start = steady_clock::now();
+
+  for (size_t i = 0; i < k_timers; i++) {
+    add(timers, i, offset(gen));
+  }
+
+  report(name, "add", elapsed_ns(start), k_timers);
+
+  start = steady_clock::now();
+
+  for (uint64_t t = 1; t <= k_run_ms; t++) {
+    timers.advance(t);
+  }
+
+  report(name, "fire", elapsed_ns(start), fired);
+
+  start = steady_clock::now();
+
+  for (size_t i = 0; i < removals; i++) {
+    remove(timers, i);
+  }
+
+  report(name, "remove", elapsed_ns(start), removals);
+
+  start = steady_clock::now();
+
+  remove_ns(timers, ns(0));
+
+  report(name, "remove namespace", elapsed_ns(start), 1);
+}
+
+}
+
+int main(int, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  timer_wheel wheel(0);
+
+  run<timer_wheel>(
+      "timer wheel   ", wheel,
+      [](timer_wheel & w, uint64_t id, uint64_t delay) {
+        w.add(id, ns(id), [](){ fired++; }, 0, delay, k_interval_ms);
+      },
+      [](timer_wheel & w, uint64_t id) { w.remove(id); },
+      [](timer_wheel & w, std::string nm) { w.remove_ns(nm); },
+      k_timers / 2);
+
+  heap_timers heap;
+
+  run<heap_timers>(
+      "priority queue", heap,
+      [](heap_timers & h, uint64_t id, uint64_t delay) {
+        h.add(id, ns(id), 0, delay, k_interval_ms);
+      },
+      [](heap_timers & h, uint64_t id) {
+        h.remove([=](uint64_t i, const std::string &) { return i == id; });
+      },
+      [](heap_timers & h, std::string nm) {
+        h.remove([=](uint64_t, const std::string & n) { return n == nm; });
+      },
+      k_heap_removals);
+
+  return 0;
+}
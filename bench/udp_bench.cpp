@@ -0,0 +1,187 @@
+#include <glog/logging.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <transport/udp_pool.h>
+
+/* Datagrams received per second of reader cpu, and how many were lost.
+ * A sender thread sends small datagrams to a local port in bursts. It
+ * compares udp_pool with what it did before: one recvfrom() into a new
+ * 4096 bytes vector per readiness event, here driven by poll().
+ *
+ * usage: udp_bench [libev|io_uring]
+ */
+
+namespace {
+
+const uint32_t k_port = 25555;
+const size_t k_datagrams = 1000000;
+const size_t k_datagram_size = 128;
+const size_t k_burst = 32;
+
+double cpu_s(const struct rusage & usage) {
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+/* What udp_pool did before */
+void recvfrom_reader(std::atomic<size_t> & received, std::atomic<bool> & stop)
+{
+  int sd = socket(PF_INET, SOCK_DGRAM, 0);
+
+  struct sockaddr_in addr;
+  bzero(&addr, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(k_port);
+  addr.sin_addr.s_addr = INADDR_ANY;
+
+  const int ret = bind(sd, (struct sockaddr*) &addr, sizeof(addr));
+  CHECK(ret == 0);
+
+  while (!stop) {
+
+    struct pollfd pfd = {sd, POLLIN, 0};
+
+    if (poll(&pfd, 1, 10) <= 0) {
+      continue;
+    }
+
+    std::vector<unsigned char> buffer(4096);
+
+    size_t bytes = recvfrom(sd, reinterpret_cast<char*>(&buffer[0]),
+                            buffer.size(), 0, NULL, NULL);
+
+    buffer.resize(bytes);
+
+    received++;
+  }
+
+  close(sd);
+}
+
+/* Sends the datagrams, returns the cpu time it used */
+double send_datagrams() {
+
+  int sd = socket(PF_INET, SOCK_DGRAM, 0);
+
+  struct sockaddr_in addr;
+  bzero(&addr, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(k_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  std::vector<unsigned char> datagram(k_datagram_size, 'x');
+
+  struct iovec iov[k_burst];
+  struct mmsghdr msgs[k_burst];
+  memset(msgs, 0, sizeof(msgs));
+
+  for (size_t i = 0; i < k_burst; i++) {
+    iov[i].iov_base = &datagram[0];
+    iov[i].iov_len = datagram.size();
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    msgs[i].msg_hdr.msg_name = &addr;
+    msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+  }
+
+  struct rusage start;
+  getrusage(RUSAGE_THREAD, &start);
+
+  for (size_t sent = 0; sent < k_datagrams; sent += k_burst) {
+    sendmmsg(sd, msgs, k_burst, 0);
+    std::this_thread::yield();
+  }
+
+  struct rusage end;
+  getrusage(RUSAGE_THREAD, &end);
+
+  close(sd);
+
+  return cpu_s(end) - cpu_s(start);
+}
+
+template <class Reader>
+void run(const std::string & name, Reader reader) {
+
+  std::atomic<size_t> received(0);
+  std::atomic<bool> stop(false);
+
+  struct rusage start;
+  getrusage(RUSAGE_SELF, &start);
+
+  auto finish = reader(received, stop);
+
+  // Lets the readers bind their sockets
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  double sender_cpu = 0;
+  std::thread sender([&]() { sender_cpu = send_datagrams(); });
+  sender.join();
+
+  size_t last;
+
+  do {
+    last = received;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  } while (last != received);
+
+  stop = true;
+  finish();
+
+  struct rusage end;
+  getrusage(RUSAGE_SELF, &end);
+
+  const double reader_cpu = cpu_s(end) - cpu_s(start) - sender_cpu;
+
+  std::cout << name
+            << "  " << received / reader_cpu / 1e6 << " M datagrams/s per core"
+            << "  lost: " << 100.0 * (k_datagrams - received) / k_datagrams
+            << "%" << std::endl;
+}
+
+}
+
+int main(int argc, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  set_async_loop_backend(argc > 1 ? argv[1] : "libev");
+
+  run("recvfrom         ", [](std::atomic<size_t> & received,
+                              std::atomic<bool> & stop)
+  {
+    auto thread = std::make_shared<std::thread>(
+        recvfrom_reader, std::ref(received), std::ref(stop));
+
+    return [=]() { thread->join(); };
+  });
+
+  for (const size_t threads : {1, 2}) {
+
+    run("udp_pool " + std::to_string(threads) + " threads",
+        [=](std::atomic<size_t> & received, std::atomic<bool> &)
+    {
+      auto pool = std::make_shared<udp_pool>(
+          threads, k_port, 4096,
+          [&](udp_buffer_t) { received++; }, hook_fn_t(),
+          [](const size_t, const size_t) {});
+
+      pool->start_threads();
+
+      return [=]() { pool->stop_threads(); };
+    });
+
+  }
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include <glog/logging.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <async/async_loop.h>
+
+/* Producer threads queue tasks for one loop and signal it, as
+ * tcp_pool::add_client and the scheduler do. Reports how many of the
+ * signals woke the loop up and how many were skipped because a wakeup was
+ * already pending.
+ *
+ * usage: wakeup_bench [libev|io_uring]
+ */
+
+namespace {
+
+const size_t k_producers = 4;
+const size_t k_tasks = 1000000;
+
+typedef std::chrono::steady_clock steady_clock;
+
+}
+
+int main(int argc, char **argv) {
+
+  google::InitGoogleLogging(argv[0]);
+
+  const std::string backend(argc > 1 ? argv[1] : "libev");
+
+  set_async_loop_backend(backend);
+
+  std::mutex mutex;
+  std::vector<size_t> queue;
+  size_t drained = 0;
+  size_t drains = 0;
+
+  const size_t total = k_producers * k_tasks;
+
+  std::unique_ptr<async_events_interface> events;
+
+  events = make_async_events(1, [&](async_loop &)
+  {
+    std::vector<size_t> tasks;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.swap(queue);
+    }
+
+    drains++;
+    drained += tasks.size();
+
+    if (drained == total) {
+      events->stop_all_loops();
+    }
+  });
+
+  const auto start = steady_clock::now();
+
+  std::thread loop_thread([&]() { events->start_loop(0); });
+
+  std::vector<std::thread> producers;
+
+  for (size_t i = 0; i < k_producers; i++) {
+    producers.emplace_back([&]()
+    {
+      for (size_t j = 0; j < k_tasks; j++) {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          queue.push_back(j);
+        }
+        events->signal_loop(0);
+      }
+    });
+  }
+
+  for (auto & producer : producers) {
+    producer.join();
+  }
+
+  loop_thread.join();
+
+  const auto s = std::chrono::duration<double>(
+      steady_clock::now() - start).count();
+
+  auto & loop = events->loop(0);
+
+  std::cout << backend
+            << "  " << total / s / 1e6 << " M tasks/s"
+            << "  drains: " << drains
+            << "  wakeups sent: " << loop.wakeups_sent()
+            << "  skipped: " << loop.wakeups_skipped()
+            << "  sent per task: "
+            << static_cast<double>(loop.wakeups_sent()) / total
+            << std::endl;
+
+  return 0;
+}
@@ -4,6 +4,8 @@
 #include <functional>
 #include <memory>
 #include <cstddef>
+#include <cstdint>
+#include <sys/socket.h>
 
 class async_loop;
 
@@ -22,6 +24,12 @@ public:
   virtual bool ready_write() const = 0;
   virtual void set_mode(const mode&) =  0;
   virtual async_loop & loop() = 0;
+  /* Work like recv() and recvmmsg() on the non blocking fd, but take what
+   * the loop received when the fd was set with async_loop::set_fd_recv()
+   * or async_loop::set_fd_recvmsg().
+   */
+  virtual ssize_t recv(void * buf, const size_t len);
+  virtual int recvmmsg(struct mmsghdr * msgs, const unsigned vlen);
 };
 
 typedef std::function<void(async_fd&)> fd_cb_fn_t;
@@ -39,10 +47,28 @@ public:
   virtual void start() = 0;
   virtual void stop() = 0;
   virtual void signal() = 0;
+  /* The signal() calls that woke the loop up, and those that didn't because
+   * a wakeup was already pending.
+   */
+  virtual uint64_t wakeups_sent() const = 0;
+  virtual uint64_t wakeups_skipped() const = 0;
   virtual void add_fd(const int fd, const async_fd::mode mode,
                       fd_cb_fn_t fd_cb_fn) = 0;
   virtual void remove_fd(const int fd) = 0;
   virtual void set_fd_mode(const int fd, const async_fd::mode mode) = 0;
+  /* Has the loop receive from the stream socket fd before its callback
+   * runs, which then reads with async_fd::recv(). Returns false when the
+   * loop doesn't, async_fd::recv() reads from the socket then.
+   */
+  virtual bool set_fd_recv(const int fd) = 0;
+  /* Same for a datagram socket read with async_fd::recvmmsg(), false too
+   * when datagrams of max_size bytes don't fit in the loop buffers.
+   */
+  virtual bool set_fd_recvmsg(const int fd, const size_t max_size) = 0;
+  /* Runs at the end of every loop iteration, before the loop waits for new
+   * events. Must be called from the thread that owns the loop.
+   */
+  virtual void set_iteration_fn(task_cb_fn_t fn) = 0;
 
   virtual timer_id_t add_once_task(
       const std::string lib_namespace, const timer_cb_fn_t, const float t) = 0;
@@ -55,6 +81,20 @@ public:
 
 typedef std::function<void(async_loop&)> async_cb_fn_t;
 
+/* Loop threads keep polling for spin_us after their last event instead of
+ * sleeping. Must be called before loops start.
+ */
+void set_async_loop_spin(const size_t spin_us);
+
+size_t async_loop_spin();
+
+/* Picks what make_async_events() builds the loops on, "libev" or
+ * "io_uring". Must be called before loops are created.
+ */
+void set_async_loop_backend(const std::string & backend);
+
+bool async_loop_uring();
+
 class async_events_interface {
 public:
   virtual void start_loop(size_t loop_id) = 0;
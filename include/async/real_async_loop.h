@@ -2,8 +2,10 @@
 #define CAVALIERI_ASYNC_REAL_ASYNC_LOOP_H
 
 #include <async/async_loop.h>
+#include <async/timer_wheel.h>
 #include <ev++.h>
 #include <vector>
+#include <atomic>
 #include <mutex>
 #include <queue>
 #include <map>
@@ -29,7 +31,7 @@ public:
   async_loop & loop();
 
 private:
-  async_loop & async_loop_;
+  real_async_loop & async_loop_;
   std::unique_ptr<ev::io> io_;
   int fd_;
   bool error_;
@@ -39,6 +41,9 @@ private:
 };
 
 
+/* signal() only wakes the loop up when no other thread has done it since the
+ * async callback last ran, or when it is not polling.
+ */
 class real_async_loop : public async_loop {
 public:
   real_async_loop();
@@ -48,10 +53,16 @@ public:
   void start();
   void stop();
   void signal();
+  uint64_t wakeups_sent() const;
+  uint64_t wakeups_skipped() const;
   void add_fd(const int fd, const async_fd::mode mode,
               fd_cb_fn_t fd_cb_fn);
   void remove_fd(const int fd);
   void set_fd_mode(const int fd, const async_fd::mode mode);
+  bool set_fd_recv(const int fd);
+  bool set_fd_recvmsg(const int fd, const size_t max_size);
+  void set_iteration_fn(task_cb_fn_t fn);
+  void add_activity();
   ev::dynamic_loop & loop();
   timer_id_t add_once_task(
       const std::string lib_namespace, const timer_cb_fn_t, const float t);
@@ -62,46 +73,34 @@ public:
   void remove_task_lib_namespace(const std::string lib_namespace);
 
 private:
-  using sched_task_t =  struct {
-    std::string lib_namespace;
-    task_cb_fn_t task;
-    timer_id_t id;
-    unsigned long interval_ms;
-    unsigned long time_ms;
-  };
-
-  class sched_task_cmp
-  {
-    public:
-      bool operator() (const sched_task_t & lhs, const sched_task_t& rhs) const
-      {
-        return (lhs.time_ms > rhs.time_ms);
-      }
-  };
-
-
   using fd_ctx_t = std::map<int, std::shared_ptr<real_async_fd>>;
 
 private:
   void async_callback(ev::async &, int);
   void timer_callback(ev::timer &, int);
+  void prepare_callback(ev::prepare &, int);
   timer_id_t add_task(
       const std::string, const timer_cb_fn_t, bool, float);
   void sched_next_task();
-  bool remove_task(const std::function<bool(const sched_task_t &)> &);
+  void run_spinning(const size_t spin_us);
 
 private:
-  bool stop_;
+  std::atomic<bool> stop_;
+  std::atomic<bool> pending_;
+  std::atomic<uint64_t> wakeups_sent_;
+  std::atomic<uint64_t> wakeups_skipped_;
+  uint64_t activity_;
   size_t id_;
   async_cb_fn_t async_cb_fn_;
   ev::dynamic_loop loop_;
   ev::async async_;
   ev::timer timer_;
+  ev::prepare prepare_;
+  task_cb_fn_t iteration_fn_;
   fd_ctx_t fds_;
-  std::priority_queue<sched_task_t,
-                      std::vector<sched_task_t>,
-                      sched_task_cmp> tasks_;
+  timer_wheel tasks_;
   uint64_t next_timer_id_;
+  uint64_t next_timer_ms_;
 };
 
 class real_async_events : public async_events_interface {
@@ -0,0 +1,87 @@
+#ifndef CAVALIERI_ASYNC_TIMER_WHEEL_H
+#define CAVALIERI_ASYNC_TIMER_WHEEL_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/* Hierarchical timing wheel with a resolution of one millisecond. Adding,
+ * removing and changing the interval of a timer are O(1), and every timer of
+ * a namespace can be removed without looking at the others.
+ *
+ * Each level has 256 slots. A timer goes to the lowest level whose range
+ * covers its expiration, and when the wheel reaches the slot of a higher
+ * level its timers are moved down.
+ *
+ * It is not thread safe, timers run from advance().
+ */
+class timer_wheel {
+public:
+  typedef std::function<void()> timer_fn_t;
+
+  explicit timer_wheel(const uint64_t now_ms);
+  ~timer_wheel();
+  /* An interval of 0 runs the timer once after delay_ms */
+  void add(const uint64_t id, const std::string & ns, const timer_fn_t fn,
+           const uint64_t now_ms, const uint64_t delay_ms,
+           const uint64_t interval_ms);
+  /* The timer runs interval_ms from now and then every interval_ms */
+  bool set_interval(const uint64_t id, const uint64_t now_ms,
+                    const uint64_t interval_ms);
+  bool remove(const uint64_t id);
+  size_t remove_ns(const std::string & ns);
+  /* Runs the timers that expired up to now_ms */
+  void advance(const uint64_t now_ms);
+  /* Time at which advance() must be called next, only valid when the wheel
+   * is not empty. It may be earlier than the next expiration when timers
+   * have to be moved down a level.
+   */
+  uint64_t next_expiration() const;
+  bool empty() const;
+  size_t size() const;
+
+private:
+  static const size_t k_levels = 6;
+  static const size_t k_slot_bits = 8;
+  static const size_t k_slots = 1 << k_slot_bits;
+  static const size_t k_words = k_slots / 64;
+
+  struct entry_t {
+    uint64_t id;
+    std::string ns;
+    timer_fn_t fn;
+    uint64_t interval_ms;
+    uint64_t expires_ms;
+    size_t level;
+    size_t slot;
+    entry_t * prev;
+    entry_t * next;
+  };
+
+  struct level_t {
+    std::array<entry_t *, k_slots> slots;
+    std::array<uint64_t, k_words> used;
+  };
+
+  void insert(entry_t * entry);
+  void unlink(entry_t * entry);
+  void erase(entry_t * entry);
+  void cascade(const size_t level);
+  void expire(const uint64_t now_ms);
+  bool next_used(const size_t level, const size_t from, size_t & dist) const;
+  bool find_used(const size_t level, const size_t begin, const size_t end,
+                 size_t & slot) const;
+
+private:
+  uint64_t now_ms_;
+  std::array<level_t, k_levels> levels_;
+  std::unordered_map<uint64_t, entry_t *> entries_;
+  std::unordered_map<std::string, std::unordered_set<uint64_t>> namespaces_;
+  entry_t * running_;
+  bool running_removed_;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef CAVALIERI_ASYNC_URING_H
+#define CAVALIERI_ASYNC_URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <linux/io_uring.h>
+
+/* Thin wrapper over the io_uring syscalls, liburing is not needed.
+ *
+ * Submission entries are queued with get_sqe() and handed to the kernel in
+ * one go by submit(), which can also wait for completions. reap() goes over
+ * the completions without a syscall. It is not thread safe.
+ *
+ * The callbacks of reap() can queue entries. Each completion leaves the
+ * ring before its callback runs, and when the kernel refuses entries
+ * because it has completions it could not post, get_sqe() moves the ones
+ * in the ring aside for reap() to go over next.
+ */
+class uring {
+public:
+  uring();
+  ~uring();
+  uring(const uring &) = delete;
+  uring & operator=(const uring &) = delete;
+
+  /* Returns false when the kernel lacks io_uring or a needed feature */
+  bool init(const unsigned entries);
+  /* Submits the queued entries first when the queue is full */
+  struct io_uring_sqe * get_sqe();
+  /* Submits the queued entries and waits until there are min_complete
+   * completions or timeout_ms go by, a negative timeout waits forever.
+   */
+  void submit(const unsigned min_complete, const int64_t timeout_ms);
+
+  template <class Fn>
+  size_t reap(Fn fn) {
+
+    size_t n = 0;
+    struct io_uring_cqe cqe;
+
+    while (next_cqe(cqe)) {
+      fn(cqe);
+      n++;
+    }
+
+    return n;
+  }
+
+private:
+  bool next_cqe(struct io_uring_cqe & cqe);
+  void defer_cqes();
+
+private:
+  int fd_;
+  void * ring_;
+  size_t ring_size_;
+  struct io_uring_sqe * sqes_;
+  size_t sqes_size_;
+  unsigned * sq_tail_;
+  unsigned * sq_array_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  unsigned * cq_head_;
+  unsigned * cq_tail_;
+  unsigned cq_mask_;
+  struct io_uring_cqe * cqes_;
+  unsigned queued_;
+  std::deque<struct io_uring_cqe> deferred_;
+};
+
+/* Buffers the kernel picks from to complete the entries that have
+ * IOSQE_BUFFER_SELECT, it tells which one it took in the completion flags.
+ * A buffer is not picked again until it is provided back.
+ */
+class uring_buffers {
+public:
+  /* All count buffers are provided by the first flush() */
+  uring_buffers(const uint16_t group, const unsigned count, const size_t size);
+
+  uint16_t group() const;
+  size_t size() const;
+  unsigned char * buffer(const uint16_t id);
+  void provide(const uint16_t id);
+  /* Queues an IORING_OP_PROVIDE_BUFFERS with user_data for each run of
+   * consecutive buffers provided since the last flush.
+   */
+  void flush(uring & ring, const uint64_t user_data);
+
+private:
+  uint16_t group_;
+  size_t size_;
+  std::vector<unsigned char> buffers_;
+  std::vector<uint16_t> provided_;
+};
+
+#endif
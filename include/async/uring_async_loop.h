@@ -0,0 +1,184 @@
+#ifndef CAVALIERI_ASYNC_URING_ASYNC_LOOP_H
+#define CAVALIERI_ASYNC_URING_ASYNC_LOOP_H
+
+#include <async/async_loop.h>
+#include <async/timer_wheel.h>
+#include <async/uring.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+class uring_async_loop;
+
+class uring_async_fd : public async_fd {
+public:
+  uring_async_fd(
+      int fd,
+      async_fd::mode initial_mode,
+      uring_async_loop & loop,
+      fd_cb_fn_t fd_cb_fn
+  );
+  ~uring_async_fd();
+  int fd() const;
+  bool error() const;
+  void stop();
+  bool ready_read() const;
+  bool ready_write() const;
+  void set_mode(const mode& mode);
+  async_loop & loop();
+  ssize_t recv(void * buf, const size_t len);
+  int recvmmsg(struct mmsghdr * msgs, const unsigned vlen);
+
+private:
+  friend class uring_async_loop;
+
+  /* Part of a provided buffer the loop received into */
+  struct received_t {
+    uint16_t buffer;
+    uint32_t offset;
+    uint32_t len;
+  };
+
+  bool pending_recv() const;
+
+  uring_async_loop & async_loop_;
+  int fd_;
+  bool error_;
+  bool read_;
+  bool write_;
+  async_fd::mode mode_;
+  /* user_data of the poll in flight, 0 when there is none */
+  uint64_t poll_id_;
+  uint32_t poll_mask_;
+  /* Set with set_fd_recv() or set_fd_recvmsg() */
+  bool recv_;
+  bool recv_msg_;
+  /* user_data of the multishot receive in flight, 0 when there is none */
+  uint64_t recv_id_;
+  bool recv_cancelled_;
+  /* The receive ran out of buffers */
+  bool recv_starved_;
+  bool recv_eof_;
+  int recv_errno_;
+  /* In the list of fds whose callback runs for what they received */
+  bool recv_queued_;
+  std::deque<received_t> received_;
+  fd_cb_fn_t fd_cb_fn_;
+};
+
+/* async_loop on top of io_uring.
+ *
+ * The pools read and write from their callbacks and rely on level triggered
+ * readiness, so each fd has a one shot poll that is armed again once its
+ * callback returns. The new polls, and the ones that are cancelled, are
+ * submitted in one batch with the wait for the next completions. Other
+ * threads wake the loop up through an eventfd read.
+ *
+ * The fds set with set_fd_recv() or set_fd_recvmsg() are not polled for
+ * reads, a multishot receive takes what they get into buffers the loop
+ * provides, until their callback reads it with async_fd::recv() or
+ * async_fd::recvmmsg(). The buffers read are provided back in one batch
+ * with the next submit. Their callback runs while anything received is
+ * left and their mode has read. The receive is cancelled when the mode
+ * loses read, so a paused connection doesn't hold the buffers.
+ */
+class uring_async_loop : public async_loop {
+public:
+  uring_async_loop();
+  ~uring_async_loop();
+  /* Returns false when io_uring is not available */
+  bool init();
+  void set_id(size_t id);
+  void set_async_cb(async_cb_fn_t async_cb);
+  size_t id() const;
+  void start();
+  void stop();
+  void signal();
+  uint64_t wakeups_sent() const;
+  uint64_t wakeups_skipped() const;
+  void add_fd(const int fd, const async_fd::mode mode,
+              fd_cb_fn_t fd_cb_fn);
+  void remove_fd(const int fd);
+  void set_fd_mode(const int fd, const async_fd::mode mode);
+  bool set_fd_recv(const int fd);
+  bool set_fd_recvmsg(const int fd, const size_t max_size);
+  void set_iteration_fn(task_cb_fn_t fn);
+  timer_id_t add_once_task(
+      const std::string lib_namespace, const timer_cb_fn_t, const float t);
+  timer_id_t add_periodic_task(
+      const std::string lib_namespace, const timer_cb_fn_t, const float t);
+  void set_task_interval(const timer_id_t, const float t);
+  bool remove_task(const timer_id_t);
+  void remove_task_lib_namespace(const std::string lib_namespace);
+
+private:
+  using fd_ctx_t = std::map<int, std::shared_ptr<uring_async_fd>>;
+
+private:
+  friend class uring_async_fd;
+
+  uint64_t next_id(const int fd);
+  void update_poll(uring_async_fd & async_fd);
+  void update_recv(uring_async_fd & async_fd);
+  bool set_recv(const int fd, const bool msg);
+  void arm_wakeup();
+  void complete(const struct io_uring_cqe & cqe);
+  void poll_ready(std::shared_ptr<uring_async_fd> async_fd, const int res);
+  void received(uring_async_fd & async_fd, const struct io_uring_cqe & cqe);
+  void queue_recv(uring_async_fd & async_fd);
+  void run_recv();
+  void provide(const uint16_t buffer);
+  void flush_buffers();
+  ssize_t take(uring_async_fd & async_fd, void * buf, const size_t len);
+  int take_msgs(uring_async_fd & async_fd, struct mmsghdr * msgs,
+                const unsigned vlen);
+  void wakeup();
+  int64_t wait_ms() const;
+  void run_tasks();
+  timer_id_t add_task(
+      const std::string, const timer_cb_fn_t, bool, float);
+
+private:
+  std::atomic<bool> stop_;
+  std::atomic<bool> pending_;
+  std::atomic<uint64_t> wakeups_sent_;
+  std::atomic<uint64_t> wakeups_skipped_;
+  uint64_t activity_;
+  size_t id_;
+  async_cb_fn_t async_cb_fn_;
+  /* Set up when the first fd is set to receive, the ring goes away first */
+  std::unique_ptr<uring_buffers> buffers_;
+  bool buffers_provided_;
+  uring ring_;
+  /* What multishot recvmsg() lays out in front of each datagram */
+  struct msghdr recv_msghdr_;
+  std::vector<int> recv_fds_;
+  std::vector<int> starved_fds_;
+  int event_fd_;
+  uint64_t event_buffer_;
+  task_cb_fn_t iteration_fn_;
+  fd_ctx_t fds_;
+  uint32_t next_poll_generation_;
+  timer_wheel tasks_;
+  uint64_t next_timer_id_;
+};
+
+class uring_async_events : public async_events_interface {
+public:
+  uring_async_events(size_t num_loops, async_cb_fn_t cb_fn);
+  /* Returns false when io_uring is not available */
+  bool init();
+  void start_loop(const size_t loop_id);
+  void signal_loop(const size_t loop_id);
+  void stop_all_loops();
+  async_loop & loop(const size_t loop_id);
+
+private:
+  size_t num_loops_;
+  async_cb_fn_t cb_fn_;
+  std::vector<uring_async_loop> loops_;
+};
+
+#endif
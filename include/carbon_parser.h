@@ -0,0 +1,53 @@
+#ifndef CAVALIERI_CARBON_PARSER_H
+#define CAVALIERI_CARBON_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <proto.pb.h>
+
+/* A graphite plaintext line, path points into the parsed data */
+struct carbon_line {
+  const char * path;
+  size_t path_size;
+  double value;
+  int64_t timestamp;
+};
+
+/* Parses "path value timestamp" without its newline. A negative timestamp
+ * means now, which is left to the caller. Returns false when the line is
+ * not valid.
+ */
+bool parse_carbon_line(const char * line, const size_t size,
+                       carbon_line & out);
+
+/* Turns graphite plaintext lines into riemann events, with no allocations
+ * besides the ones of the events.
+ *
+ * The first host_fields dot separated components of the path are the host
+ * of the event and the rest its service. Paths with fewer components keep
+ * the last one as service.
+ */
+class carbon_parser {
+public:
+  explicit carbon_parser(const size_t host_fields);
+
+  /* Adds an event to msg for every valid line in data and returns the
+   * bytes used, up to the last newline. With complete, the last line needs
+   * no newline. Invalid lines are skipped and counted.
+   */
+  size_t parse(const char * data, const size_t size, const bool complete,
+               riemann::Msg & msg);
+
+  /* Invalid lines since the last call */
+  size_t invalid_lines();
+
+private:
+  void add_event(const carbon_line & line, const int64_t now,
+                 riemann::Msg & msg) const;
+
+private:
+  const size_t host_fields_;
+  size_t invalid_lines_;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef CAVALIERI_CARBON_POOL_H
+#define CAVALIERI_CARBON_POOL_H
+
+#include <set>
+#include <transport/tcp_pool.h>
+#include <transport/udp_pool.h>
+#include <instrumentation/instrumentation.h>
+#include <carbon_parser.h>
+
+/* Called in a loop thread with the events of the lines it read, and the
+ * size of those lines. The events can be taken from msg.
+ */
+typedef std::function<void(riemann::Msg &, const size_t)> carbon_events_fn_t;
+
+/* Returns true when connections must stop being read */
+typedef std::function<bool()> carbon_paused_fn_t;
+
+/* Graphite plaintext listener on tcp and udp port, compatible with carbon.
+ *
+ * Every tcp thread accepts its own connections on a SO_REUSEPORT socket,
+ * udp threads are the ones of udp_pool. Each line becomes an event, see
+ * carbon_parser. While paused, tcp connections stop being read and udp
+ * datagrams are dropped.
+ */
+class carbon_pool {
+  public:
+    carbon_pool(size_t thread_num, uint32_t port, size_t host_fields,
+                size_t max_datagram_size, carbon_events_fn_t events_fn,
+                hook_fn_t run_fn, instrumentation::instrumentation & instr);
+    /* Must be set before threads start */
+    void set_paused_fn(carbon_paused_fn_t paused_fn);
+    void start_threads();
+    void stop_threads();
+    ~carbon_pool();
+
+  private:
+    void tcp_run_hook(async_loop & loop);
+    void tcp_ready(async_fd & async, tcp_connection & conn);
+    void udp_read(std::vector<unsigned char> datagram);
+    void resume(async_loop & loop);
+
+  private:
+    const size_t thread_num_;
+    const uint32_t port_;
+    carbon_events_fn_t events_fn_;
+    hook_fn_t run_fn_;
+    carbon_paused_fn_t paused_fn_;
+    instrumentation::update_rate_fn_t invalid_rate_;
+    instrumentation::update_rate_fn_t drop_rate_;
+    std::vector<carbon_parser> parsers_;
+    std::vector<riemann::Msg> msgs_;
+    std::vector<std::set<int>> paused_;
+    tcp_pool tcp_pool_;
+    udp_pool udp_pool_;
+};
+
+#endif
@@ -6,9 +6,44 @@
 struct config {
   uint32_t events_port;
   size_t riemann_tcp_pool_size;
+  std::string unix_socket_path;
+  std::string shm_socket_path;
+  size_t riemann_udp_pool_size;
+  size_t udp_max_datagram_size;
+  bool inline_ingest;
+  size_t inline_ingest_budget_us;
+  size_t ingest_batch_size;
+  bool tcp_pin_threads;
+  size_t tcp_max_frame_kb;
+  bool reuseport_listeners;
+  size_t loop_spin_us;
+  std::string loop_backend;
+  uint32_t carbon_port;
+  size_t carbon_pool_size;
+  size_t carbon_host_fields;
+  uint32_t http_port;
+  size_t http_pool_size;
+  size_t http_max_body_size;
+  uint32_t statsd_port;
+  size_t statsd_pool_size;
+  size_t statsd_flush_interval;
+  std::string statsd_percentiles;
+  size_t query_max_results;
+  size_t query_cache_size;
   uint32_t ws_port;
   size_t ws_pool_size;
   size_t executor_pool_size;
+  std::string executor_partition;
+  bool executor_work_stealing;
+  bool executor_pin_threads;
+  size_t executor_min_pool_size;
+  size_t executor_max_pool_size;
+  size_t executor_scale_interval;
+  size_t executor_scale_up_wait_us;
+  size_t executor_scale_down_wait_us;
+  size_t executor_max_cpu_usage;
+  size_t ingest_high_watermark_mb;
+  size_t ingest_low_watermark_mb;
   uint64_t index_expire_interval;
   std::string rules_directory;
   size_t pagerduty_pool_size;
@@ -0,0 +1,68 @@
+#ifndef CAVALIERI_CORE_INGEST_BATCHER_H
+#define CAVALIERI_CORE_INGEST_BATCHER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <proto.pb.h>
+#include <streams/stream_functions.h>
+#include <pool/executor_thread_pool.h>
+#include <instrumentation/instrumentation.h>
+
+/* Maps an event to the executor shard that owns its key */
+typedef std::function<size_t(const std::string & host,
+                             const std::string & service)> partition_fn_t;
+
+/* Accumulates the messages read by a loop thread and hands them to the
+ * executor pool as one task per destination. A batch is flushed when it
+ * holds max_frames messages or when flush() is called, which loop threads
+ * do at the end of every loop iteration.
+ *
+ * Without a partition function messages are parsed by the executor thread.
+ * With one they are parsed here and their events are split by shard.
+ * Transports that produce events themselves add them already parsed.
+ *
+ * Tasks are added with the size of the messages they hold so the executor
+ * pool can apply backpressure.
+ *
+ * Each instance must only be used by one thread.
+ */
+class ingest_batcher {
+public:
+  ingest_batcher(const size_t max_frames,
+                 streams & streams,
+                 executor_thread_pool & executor_pool,
+                 partition_fn_t partition_fn,
+                 instrumentation::update_latency_fn_t batch_size_fn);
+  void add(std::vector<unsigned char> raw_msg);
+  /* Takes the events in msg, bytes is the size they were read from */
+  void add_events(riemann::Msg & msg, const size_t bytes);
+  void flush();
+
+private:
+  typedef std::vector<std::vector<unsigned char>> frames_t;
+
+  void add_partitioned(const std::vector<unsigned char> & raw_msg);
+  void add_to_shards(riemann::Msg & msg, const size_t bytes);
+  void flush_frames();
+  void flush_events();
+  void flush_shard(const size_t shard);
+
+private:
+  const size_t max_frames_;
+  streams & streams_;
+  executor_thread_pool & executor_pool_;
+  partition_fn_t partition_fn_;
+  instrumentation::update_latency_fn_t batch_size_fn_;
+  std::shared_ptr<frames_t> frames_;
+  size_t frames_bytes_;
+  std::shared_ptr<riemann::Msg> events_;
+  size_t events_frames_;
+  size_t events_bytes_;
+  std::vector<std::shared_ptr<riemann::Msg>> shards_;
+  std::vector<size_t> shard_frames_;
+  std::vector<size_t> shard_bytes_;
+};
+
+#endif
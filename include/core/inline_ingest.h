@@ -0,0 +1,38 @@
+#ifndef CAVALIERI_CORE_INLINE_INGEST_H
+#define CAVALIERI_CORE_INLINE_INGEST_H
+
+#include <chrono>
+#include <vector>
+#include <streams/stream_functions.h>
+#include <pool/executor_thread_pool.h>
+#include <instrumentation/instrumentation.h>
+
+/* Parses raw_msg and runs its events in streams, queries are dropped */
+void incoming_event(const std::vector<unsigned char> & raw_msg,
+                    streams & streams);
+
+/* Runs the streams for the messages read by a loop thread. Once a read
+ * callback has used its time budget, the remaining messages go to the
+ * executor pool and overflow_rate is updated.
+ *
+ * One instance can be shared by many loop threads, the budget is tracked
+ * per thread.
+ */
+class inline_ingest {
+public:
+  inline_ingest(const std::chrono::microseconds budget,
+                streams & streams,
+                executor_thread_pool & executor_pool,
+                instrumentation::update_rate_fn_t overflow_rate);
+  void add(const std::vector<unsigned char> & raw_msg);
+  /* Must be called at the end of every read callback */
+  void done();
+
+private:
+  const std::chrono::microseconds budget_;
+  streams & streams_;
+  executor_thread_pool & executor_pool_;
+  instrumentation::update_rate_fn_t overflow_rate_;
+};
+
+#endif
@@ -9,6 +9,10 @@
 #include <index/real_index.h>
 #include <riemann_tcp_pool.h>
 #include <riemann_udp_pool.h>
+#include <transport/shm_pool.h>
+#include <carbon_pool.h>
+#include <http_pool.h>
+#include <statsd_pool.h>
 #include <websocket/websocket_pool.h>
 #include <pool/executor_thread_pool.h>
 #include <external/real_external.h>
@@ -42,6 +46,10 @@ private:
   std::unique_ptr<real_index> index_;
   std::unique_ptr<riemann_tcp_pool> tcp_server_;
   std::unique_ptr<riemann_udp_pool> udp_server_;
+  std::unique_ptr<shm_pool> shm_server_;
+  std::unique_ptr<carbon_pool> carbon_server_;
+  std::unique_ptr<http_pool> http_server_;
+  std::unique_ptr<statsd_pool> statsd_server_;
   std::unique_ptr<websocket_pool> ws_server_;
 
   std::vector<std::shared_ptr<streams_t>> sh_streams_;
@@ -3,22 +3,77 @@
 
 #include <functional>
 #include <core/real_core.h>
+#include <core/ingest_batcher.h>
+#include <core/inline_ingest.h>
 #include <scheduler/scheduler.h>
 
 void detach_thread(std::function<void()> fn);
 
 std::shared_ptr<core_interface> make_real_core(const config conf);
 
+/* Returns an empty function when events are not partitioned */
+partition_fn_t make_partition_fn(const config & conf);
+
+push_event_fn_t make_push_event_fn(streams & streams,
+                                   executor_thread_pool & executor_pool,
+                                   partition_fn_t partition_fn);
+
+/* Scheduled tasks run in the executor when events are partitioned, and in
+ * the scheduler timer workers otherwise.
+ */
+std::unique_ptr<real_scheduler> make_scheduler(
+    const config & conf,
+    executor_thread_pool & executor_pool,
+    instrumentation::instrumentation & instr);
+
+/* Queries read by tcp connections are answered from index */
 std::unique_ptr<riemann_tcp_pool> init_tcp_server(
     const config & conf,
     main_async_loop_interface & loop,
     streams & streams,
+    real_index & index,
     executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
     instrumentation::instrumentation & instr);
 
 std::unique_ptr<riemann_udp_pool> init_udp_server(
     const config & conf,
-    std::shared_ptr<streams> streams);
+    std::shared_ptr<streams> streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr);
+
+/* Returns null when shm_socket_path is not set */
+std::unique_ptr<shm_pool> init_shm_server(
+    const config & conf,
+    streams & streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr);
+
+/* Returns null when carbon_port is not set */
+std::unique_ptr<carbon_pool> init_carbon_server(
+    const config & conf,
+    streams & streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr);
+
+/* Returns null when http_port is not set */
+std::unique_ptr<http_pool> init_http_server(
+    const config & conf,
+    streams & streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr);
+
+/* Returns null when statsd_port is not set */
+std::unique_ptr<statsd_pool> init_statsd_server(
+    const config & conf,
+    streams & streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr);
 
 std::unique_ptr<websocket_pool> init_ws_server(
     const config & conf,
@@ -26,8 +81,12 @@ std::unique_ptr<websocket_pool> init_ws_server(
     pub_sub & pubsub,
     real_index & index);
 
+void start_autoscaling(const config & conf,
+                       scheduler_interface & sched,
+                       executor_thread_pool & executor_pool);
+
 void start_instrumentation(scheduler_interface & sched,
                            instrumentation::instrumentation & instrumentation,
-                           streams & streams);
+                           push_event_fn_t push_event_fn);
 
 #endif
@@ -0,0 +1,72 @@
+#ifndef CAVALIERI_HTTP_POOL_H
+#define CAVALIERI_HTTP_POOL_H
+
+#include <map>
+#include <transport/tcp_pool.h>
+#include <transport/http_request.h>
+#include <instrumentation/instrumentation.h>
+#include <json_event_parser.h>
+
+/* Called in a loop thread with the events of a request, and the size of
+ * its body. The events can be taken from msg.
+ */
+typedef std::function<void(riemann::Msg &, const size_t)> http_events_fn_t;
+
+/* Returns true when connections must stop being read */
+typedef std::function<bool()> http_paused_fn_t;
+
+/* HTTP/1.1 endpoint for clients that can't speak the riemann protocol.
+ *
+ * Events are sent with POST /events, as JSON or NDJSON, see
+ * json_event_parser. Each request is answered once its events were handed
+ * to events_fn, with {"ok":true,"events":n}, or with {"ok":false,...} and
+ * none of them when the body is not valid. Connections are kept alive and
+ * requests can be pipelined.
+ *
+ * Every thread accepts its own connections on a SO_REUSEPORT socket. While
+ * paused, connections stop being read.
+ */
+class http_pool {
+  public:
+    http_pool(size_t thread_num, uint32_t port, size_t max_body_size,
+              http_events_fn_t events_fn, hook_fn_t run_fn,
+              instrumentation::instrumentation & instr);
+    /* Must be set before threads start */
+    void set_paused_fn(http_paused_fn_t paused_fn);
+    void start_threads();
+    void stop_threads();
+    ~http_pool();
+
+  private:
+    struct http_connection {
+      http_request request;
+      /* The connection closes once the last response is written */
+      bool closing;
+    };
+
+    void run_hook(async_loop & loop);
+    void create_conn(int fd, async_loop & loop, tcp_connection & conn);
+    void tcp_ready(async_fd & async, tcp_connection & conn);
+    void read_requests(const size_t tid, tcp_connection & conn,
+                       http_connection & http_conn);
+    void handle_request(const size_t tid, tcp_connection & conn,
+                        http_connection & http_conn);
+    void resume(async_loop & loop);
+
+  private:
+    const size_t thread_num_;
+    const uint32_t port_;
+    const size_t max_body_size_;
+    http_events_fn_t events_fn_;
+    hook_fn_t run_fn_;
+    http_paused_fn_t paused_fn_;
+    instrumentation::update_rate_fn_t requests_rate_;
+    instrumentation::update_rate_fn_t invalid_rate_;
+    std::vector<json_event_parser> parsers_;
+    std::vector<riemann::Msg> msgs_;
+    std::vector<std::map<int, http_connection>> connections_;
+    std::vector<std::map<int, tcp_connection *>> paused_;
+    tcp_pool tcp_pool_;
+};
+
+#endif
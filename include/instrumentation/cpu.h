@@ -0,0 +1,11 @@
+#ifndef CAVALIERI_INSTRUMENTATION_CPU_H
+#define CAVALIERI_INSTRUMENTATION_CPU_H
+
+#include <cstdint>
+
+/* Jiffies spent by all the host cpus since boot, busy excludes idle and
+ * iowait time.
+ */
+bool host_cpu_times(uint64_t & busy, uint64_t & total);
+
+#endif
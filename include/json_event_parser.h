@@ -0,0 +1,52 @@
+#ifndef CAVALIERI_JSON_EVENT_PARSER_H
+#define CAVALIERI_JSON_EVENT_PARSER_H
+
+#include <string>
+#include <proto.pb.h>
+
+/* Turns JSON events into riemann events straight from the text, without
+ * building a document.
+ *
+ * Takes a JSON array of events, events one after the other as in NDJSON,
+ * or a mix of both. Events are objects with the fields Event::json_str()
+ * writes: host, service, state, description, time, metric, ttl and tags.
+ * Any other field is an attribute, numbers and booleans keep their text.
+ * Null fields are ignored.
+ */
+class json_event_parser {
+public:
+  json_event_parser();
+
+  /* Adds the events in data to msg. Returns false when data is not valid,
+   * leaving the events parsed until then in msg.
+   */
+  bool parse(const char * data, const size_t size, riemann::Msg & msg);
+
+  /* Why the last parse() failed */
+  const std::string & error() const;
+
+private:
+  bool parse_array(riemann::Msg & msg);
+  bool parse_event(riemann::Event & event);
+  bool parse_field(riemann::Event & event, const char * key,
+                   const size_t key_size);
+  bool parse_tags(riemann::Event & event);
+  /* Points s at the unescaped string, in the data when it has no escapes
+   * and in scratch otherwise.
+   */
+  bool parse_string(std::string & scratch, const char * & s, size_t & size);
+  bool scan_number(const char * & s, size_t & size);
+  bool scan_literal(const char * literal, const size_t size);
+  void skip_space();
+  bool fail(const char * what);
+
+private:
+  const char * data_;
+  const char * p_;
+  const char * end_;
+  std::string key_;
+  std::string value_;
+  std::string error_;
+};
+
+#endif
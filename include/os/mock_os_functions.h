@@ -7,9 +7,12 @@
 class mock_os_functions : public os_functions_interface {
 public:
   ssize_t recv(int fd, void *buf, size_t len, int flags);
-  ssize_t write(int fd, void *buf, size_t count);
+  ssize_t write(int fd, const void *buf, size_t count);
+  ssize_t sendmsg(int fd, const struct msghdr *msg, int flags);
 
   std::vector<unsigned char> buffer;
+  /* sendmsg() fails with EAGAIN while set */
+  bool socket_full = false;
 };
 
 #endif
@@ -2,18 +2,21 @@
 #define CAVALIERI_OS_FUNCTIONS_H
 
 #include <sys/types.h>
+#include <sys/socket.h>
 
 class os_functions_interface {
 public:
   virtual ssize_t recv(int fd, void *buf, size_t len, int flags) = 0;
-  virtual ssize_t write(int fd, void *buf, size_t count) = 0;
+  virtual ssize_t write(int fd, const void *buf, size_t count) = 0;
+  virtual ssize_t sendmsg(int fd, const struct msghdr *msg, int flags) = 0;
 };
 
 class os_functions {
 public:
   os_functions(os_functions_interface&);
   ssize_t recv(int fd, void *buf, size_t len, int flags);
-  ssize_t write(int fd, void *buf, size_t count);
+  ssize_t write(int fd, const void *buf, size_t count);
+  ssize_t sendmsg(int fd, const struct msghdr *msg, int flags);
 
 private:
   os_functions_interface & impl_;
@@ -4,33 +4,128 @@
 #include <vector>
 #include <functional>
 #include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <config/config.h>
 #include <instrumentation/instrumentation.h>
-#include <tbb/concurrent_queue.h>
+#include <pool/work_stealing_deque.h>
+#include <pool/ring_buffer.h>
 
 typedef std::function<void()> task_fn_t;
 
+/* Each thread has an inbox where other threads add tasks, and takes them in
+ * batches. Threads park when there is nothing to run. When work stealing
+ * is enabled, a thread moves a batch of tasks from its inbox to its own
+ * deque, and idle threads steal from the deques of busy ones.
+ *
+ * With autoscaling, executor_max_pool_size threads are started but tasks
+ * only go to the first active ones. autoscale() changes how many threads
+ * are active, inactive threads finish their pending tasks and park.
+ */
 class executor_thread_pool {
 public:
   executor_thread_pool(instrumentation::instrumentation & instr,
                        const config & conf);
   void add_task(const task_fn_t & task);
+  /* Tasks added with the same shard are run in order by the same thread.
+   * This only holds when work stealing is disabled, which is always the
+   * case when events are partitioned.
+   */
+  void add_task(const size_t shard, const task_fn_t & task);
+  /* bytes is the size of the data held by the task. Ingestion is paused
+   * when the bytes queued go above the high watermark, until they go back
+   * below the low watermark.
+   */
+  void add_task(const task_fn_t & task, const size_t bytes);
+  void add_task(const size_t shard, const task_fn_t & task,
+                const size_t bytes);
+  bool paused() const;
+  /* Called from an executor thread when ingestion can be resumed */
+  void set_resume_fn(task_fn_t resume_fn);
+  size_t size() const;
+  bool autoscaling() const;
+  size_t active_threads() const;
+  /* Resizes the pool based on the queue wait time and the host cpu usage
+   * since the last call.
+   */
+  void autoscale();
+  /* Blocks until every task added before this call has run, or the pool
+   * is stopped. Only valid when work stealing is disabled.
+   */
+  void sync();
   void stop();
 
-private:
-  void run_tasks(const int i);
-
 private:
   typedef struct {
     task_fn_t fn;
     bool stop;
+    size_t bytes;
+    std::chrono::steady_clock::time_point queued_at;
   } task_t;
 
+  typedef work_stealing_deque<task_t *> deque_t;
+
+  struct worker_t {
+    worker_t(instrumentation::update_gauge_t gauge, const size_t capacity)
+      : inbox(capacity), depth_gauge(gauge), parked(false), wait_us(0),
+        waited_tasks(0) {}
+
+    mpsc_queue<task_t> inbox;
+    /* Tasks popped from the inbox, only used by the owner thread */
+    std::vector<task_t> batch;
+    deque_t deque;
+    instrumentation::update_gauge_t depth_gauge;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<bool> parked;
+    std::atomic<uint64_t> wait_us;
+    std::atomic<uint64_t> waited_tasks;
+  };
+
+  void push_task(const size_t i, task_t task);
+  void run_tasks(const int i);
+  void run_stealing_tasks(const int i);
+  void start_task(const size_t i, const task_t & task);
+  void finish_task(const task_t & task);
+  bool active(const size_t i) const;
+  double host_cpu_usage();
+  bool fill_deque(const size_t i, bool & stop);
+  bool steal_task(const size_t i, task_t * & task);
+  bool work_available(const size_t i) const;
+  void park(const size_t i);
+  void wake(const size_t i);
+  void wake_any(const size_t i);
+
+private:
   instrumentation::update_gauge_t task_guague_;
+  bool partitioned_;
+  bool stealing_;
+  const size_t high_watermark_;
+  const size_t low_watermark_;
+  std::atomic<size_t> queued_bytes_;
+  std::atomic<bool> paused_;
+  task_fn_t resume_fn_;
+  bool autoscale_;
+  size_t min_size_;
+  size_t max_size_;
+  const size_t scale_up_wait_us_;
+  const size_t scale_down_wait_us_;
+  const double max_cpu_usage_;
+  std::atomic<size_t> active_;
+  std::atomic<bool> stopping_;
+  uint64_t cpu_busy_;
+  uint64_t cpu_total_;
+  instrumentation::update_gauge_t size_gauge_;
+  instrumentation::update_gauge_t wait_gauge_;
+  instrumentation::update_rate_fn_t scale_up_rate_;
+  instrumentation::update_rate_fn_t scale_down_rate_;
   std::vector<int> finished_threads_;
   std::vector<std::thread> threads_;
-  size_t next_thread_;
-  std::vector<tbb::concurrent_bounded_queue<task_t>> tasks_;
+  std::atomic<size_t> next_thread_;
+  std::vector<std::unique_ptr<worker_t>> workers_;
 
 };
 
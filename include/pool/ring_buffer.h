@@ -0,0 +1,471 @@
+#ifndef CAVALIERI_POOL_RING_BUFFER_H
+#define CAVALIERI_POOL_RING_BUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Bounded ring buffers to hand values over between threads. The capacity is
+ * rounded up to a power of two and all the slots are allocated upfront.
+ *
+ * spsc_ring has one producer and one consumer, each end writes only its own
+ * index and keeps a cached copy of the other one. mpsc_ring has any number
+ * of producers and one consumer, every slot carries a sequence number that
+ * tells whether it is free or holds a value (Vyukov's bounded queue).
+ *
+ * try_push_batch() pushes all the values or none of them, pop_batch()
+ * appends up to max values to a vector. A failed try_push() leaves its
+ * argument untouched. size() and empty() are approximate when called from
+ * a thread other than the consumer.
+ */
+
+namespace ring_buffer {
+
+const size_t k_cache_line = 64;
+
+inline size_t round_capacity(const size_t capacity) {
+
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+
+  return size;
+}
+
+}
+
+template <class T>
+class spsc_ring {
+public:
+
+  explicit spsc_ring(const size_t capacity = 1024)
+    :
+      capacity_(ring_buffer::round_capacity(capacity)),
+      mask_(capacity_ - 1),
+      slots_(new storage_t[capacity_]),
+      tail_(0),
+      head_cache_(0),
+      head_(0),
+      tail_cache_(0)
+  {
+  }
+
+  spsc_ring(const spsc_ring &) = delete;
+  spsc_ring & operator=(const spsc_ring &) = delete;
+
+  ~spsc_ring() {
+    T value;
+    while (try_pop(value)) {}
+  }
+
+  template <class U>
+  bool try_push(U && value) {
+
+    const size_t t = tail_.load(std::memory_order_relaxed);
+
+    if (!reserve(t, 1)) {
+      return false;
+    }
+
+    new (slot(t)) T(std::forward<U>(value));
+    tail_.store(t + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  template <class It>
+  bool try_push_batch(It first, const size_t n) {
+
+    const size_t t = tail_.load(std::memory_order_relaxed);
+
+    if (!reserve(t, n)) {
+      return false;
+    }
+
+    for (size_t i = 0; i < n; i++, ++first) {
+      new (slot(t + i)) T(*first);
+    }
+
+    tail_.store(t + n, std::memory_order_release);
+
+    return true;
+  }
+
+  bool try_pop(T & value) {
+    return pop(&value, 1, nullptr) == 1;
+  }
+
+  size_t pop_batch(std::vector<T> & values, const size_t max) {
+    return pop(nullptr, max, &values);
+  }
+
+  size_t size() const {
+    const size_t t = tail_.load(std::memory_order_acquire);
+    const size_t h = head_.load(std::memory_order_acquire);
+    return t - h;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type
+          storage_t;
+
+  T * slot(const size_t i) {
+    return reinterpret_cast<T *>(&slots_[i & mask_]);
+  }
+
+  bool reserve(const size_t t, const size_t n) {
+
+    if (t + n - head_cache_ <= capacity_) {
+      return true;
+    }
+
+    head_cache_ = head_.load(std::memory_order_acquire);
+
+    return t + n - head_cache_ <= capacity_;
+  }
+
+  size_t pop(T * value, const size_t max, std::vector<T> * values) {
+
+    const size_t h = head_.load(std::memory_order_relaxed);
+
+    if (h == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+    }
+
+    const size_t n = std::min(tail_cache_ - h, max);
+
+    for (size_t i = 0; i < n; i++) {
+
+      T * p = slot(h + i);
+
+      if (values) {
+        values->push_back(std::move(*p));
+      } else {
+        *value = std::move(*p);
+      }
+
+      p->~T();
+    }
+
+    if (n) {
+      head_.store(h + n, std::memory_order_release);
+    }
+
+    return n;
+  }
+
+private:
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<storage_t[]> slots_;
+
+  // Keep the producer and the consumer on different cache lines
+  std::atomic<size_t> tail_;
+  size_t head_cache_;
+  char tail_padding_[ring_buffer::k_cache_line - 2 * sizeof(size_t)];
+  std::atomic<size_t> head_;
+  size_t tail_cache_;
+  char head_padding_[ring_buffer::k_cache_line - 2 * sizeof(size_t)];
+};
+
+template <class T>
+class mpsc_ring {
+public:
+
+  explicit mpsc_ring(const size_t capacity = 1024)
+    :
+      capacity_(ring_buffer::round_capacity(capacity)),
+      mask_(capacity_ - 1),
+      slots_(new slot_t[capacity_]),
+      tail_(0),
+      head_(0)
+  {
+    for (size_t i = 0; i < capacity_; i++) {
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  mpsc_ring(const mpsc_ring &) = delete;
+  mpsc_ring & operator=(const mpsc_ring &) = delete;
+
+  ~mpsc_ring() {
+    T value;
+    while (try_pop(value)) {}
+  }
+
+  template <class U>
+  bool try_push(U && value) {
+
+    size_t pos;
+
+    if (!reserve(pos, 1)) {
+      return false;
+    }
+
+    publish(pos, std::forward<U>(value));
+
+    return true;
+  }
+
+  template <class It>
+  bool try_push_batch(It first, const size_t n) {
+
+    size_t pos;
+
+    if (n == 0 || n > capacity_ || !reserve(pos, n)) {
+      return false;
+    }
+
+    for (size_t i = 0; i < n; i++, ++first) {
+      publish(pos + i, *first);
+    }
+
+    return true;
+  }
+
+  bool try_pop(T & value) {
+    return pop(&value, 1, nullptr) == 1;
+  }
+
+  size_t pop_batch(std::vector<T> & values, const size_t max) {
+    return pop(nullptr, max, &values);
+  }
+
+  /* Counts the values that are still being written by a producer */
+  size_t size() const {
+    const size_t t = tail_.load(std::memory_order_acquire);
+    const size_t h = head_.load(std::memory_order_acquire);
+    return t > h ? t - h : 0;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type
+          storage_t;
+
+  struct slot_t {
+    std::atomic<size_t> seq;
+    storage_t storage;
+  };
+
+  /* Claims n consecutive slots. A slot is free for position pos when its
+   * sequence is pos, and the consumer frees slots in order, so the last
+   * slot being free means the others are too.
+   */
+  bool reserve(size_t & pos, const size_t n) {
+
+    pos = tail_.load(std::memory_order_relaxed);
+
+    while (true) {
+
+      const size_t last = pos + n - 1;
+      const size_t seq = slots_[last & mask_].seq.load(
+          std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq)
+                            - static_cast<intptr_t>(last);
+
+      if (diff == 0) {
+
+        if (tail_.compare_exchange_weak(pos, pos + n,
+                                        std::memory_order_relaxed))
+        {
+          return true;
+        }
+
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+
+    }
+  }
+
+  template <class U>
+  void publish(const size_t pos, U && value) {
+
+    auto & s = slots_[pos & mask_];
+
+    new (&s.storage) T(std::forward<U>(value));
+    s.seq.store(pos + 1, std::memory_order_release);
+  }
+
+  size_t pop(T * value, const size_t max, std::vector<T> * values) {
+
+    const size_t h = head_.load(std::memory_order_relaxed);
+    size_t n = 0;
+
+    for (; n < max; n++) {
+
+      auto & s = slots_[(h + n) & mask_];
+
+      if (s.seq.load(std::memory_order_acquire) != h + n + 1) {
+        break;
+      }
+
+      T * p = reinterpret_cast<T *>(&s.storage);
+
+      if (values) {
+        values->push_back(std::move(*p));
+      } else {
+        *value = std::move(*p);
+      }
+
+      p->~T();
+
+      s.seq.store(h + n + capacity_, std::memory_order_release);
+    }
+
+    if (n) {
+      head_.store(h + n, std::memory_order_release);
+    }
+
+    return n;
+  }
+
+private:
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<slot_t[]> slots_;
+
+  // Keep the producers and the consumer on different cache lines
+  std::atomic<size_t> tail_;
+  char tail_padding_[ring_buffer::k_cache_line - sizeof(size_t)];
+  std::atomic<size_t> head_;
+  char head_padding_[ring_buffer::k_cache_line - sizeof(size_t)];
+};
+
+/* Unbounded mpsc queue. Values go to a ring and, only when it is full, to a
+ * list guarded by a mutex. Once a value has gone to the list every producer
+ * uses it until the consumer takes the list, and the consumer only takes it
+ * when the ring is empty, so the values of each producer are popped in the
+ * order they were pushed.
+ *
+ * empty() must be called from the consumer.
+ */
+template <class T>
+class mpsc_queue {
+public:
+
+  explicit mpsc_queue(const size_t capacity = 1024)
+    : ring_(capacity), overflowed_(false)
+  {
+  }
+
+  mpsc_queue(const mpsc_queue &) = delete;
+  mpsc_queue & operator=(const mpsc_queue &) = delete;
+
+  template <class U>
+  void push(U && value) {
+
+    if (!overflowed_.load(std::memory_order_acquire)
+        && ring_.try_push(std::forward<U>(value)))
+    {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    overflowed_.store(true, std::memory_order_release);
+    overflow_.emplace_back(std::forward<U>(value));
+  }
+
+  bool try_pop(T & value) {
+
+    if (spill_.empty() && !ring_.try_pop(value) && !take_overflow()) {
+      return false;
+    }
+
+    if (!spill_.empty()) {
+      value = std::move(spill_.front());
+      spill_.pop_front();
+    }
+
+    return true;
+  }
+
+  size_t pop_batch(std::vector<T> & values, const size_t max) {
+
+    size_t n = pop_spill(values, max);
+
+    if (n < max && spill_.empty()) {
+
+      n += ring_.pop_batch(values, max - n);
+
+      if (n < max && take_overflow()) {
+        n += pop_spill(values, max - n);
+      }
+
+    }
+
+    return n;
+  }
+
+  bool empty() const {
+    return spill_.empty() && ring_.empty()
+           && !overflowed_.load(std::memory_order_acquire);
+  }
+
+private:
+
+  /* Moves the overflow list to spill_, which is only used by the consumer
+   * and is popped before the ring.
+   */
+  bool take_overflow() {
+
+    if (!overflowed_.load(std::memory_order_acquire) || !ring_.empty()) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    spill_.swap(overflow_);
+    overflowed_.store(false, std::memory_order_release);
+
+    return !spill_.empty();
+  }
+
+  size_t pop_spill(std::vector<T> & values, const size_t max) {
+
+    size_t n = 0;
+
+    for (; n < max && !spill_.empty(); n++) {
+      values.push_back(std::move(spill_.front()));
+      spill_.pop_front();
+    }
+
+    return n;
+  }
+
+private:
+  mpsc_ring<T> ring_;
+  std::atomic<bool> overflowed_;
+  std::mutex mutex_;
+  std::deque<T> overflow_;
+  std::deque<T> spill_;
+};
+
+#endif
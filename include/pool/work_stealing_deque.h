@@ -0,0 +1,164 @@
+#ifndef CAVALIERI_POOL_WORK_STEALING_DEQUE_H
+#define CAVALIERI_POOL_WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+/* Chase-Lev work stealing deque.
+ *
+ * Only the owner thread can push() and pop(), they work on the bottom end.
+ * Any thread can steal() from the top end. The array grows when full, old
+ * arrays are kept until the deque is destroyed because a thief could still
+ * be reading from them.
+ *
+ * T must be trivially copyable, store pointers for anything else.
+ */
+template <class T>
+class work_stealing_deque {
+public:
+
+  static_assert(std::is_trivially_copyable<T>::value,
+                "work_stealing_deque needs a trivially copyable type");
+
+  explicit work_stealing_deque(const size_t capacity = 1024)
+    : top_(0), bottom_(0)
+  {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+
+    arrays_.emplace_back(new array(size));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+  }
+
+  work_stealing_deque(const work_stealing_deque &) = delete;
+  work_stealing_deque & operator=(const work_stealing_deque &) = delete;
+
+  void push(const T value) {
+
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_acquire);
+
+    array * a = array_.load(std::memory_order_relaxed);
+
+    if (b - t > static_cast<int64_t>(a->size) - 1) {
+      a = grow(a, t, b);
+    }
+
+    a->put(b, value);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+
+  }
+
+  bool pop(T & value) {
+
+    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    array * a = array_.load(std::memory_order_relaxed);
+
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    int64_t t = top_.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    value = a->get(b);
+
+    if (t != b) {
+      return true;
+    }
+
+    // Last element, race against thieves
+    const bool won = top_.compare_exchange_strong(t, t + 1,
+                                                  std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+
+    return won;
+  }
+
+  bool steal(T & value) {
+
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom_.load(std::memory_order_acquire);
+
+    if (t >= b) {
+      return false;
+    }
+
+    array * a = array_.load(std::memory_order_consume);
+    value = a->get(t);
+
+    return top_.compare_exchange_strong(t, t + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed);
+  }
+
+  /* Approximate when called from a thread other than the owner */
+  size_t size() const {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? b - t : 0;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+private:
+
+  struct array {
+
+    explicit array(const size_t n)
+      : size(n), mask(n - 1), slots(new std::atomic<T>[n])
+    {
+    }
+
+    T get(const int64_t i) const {
+      return slots[i & mask].load(std::memory_order_relaxed);
+    }
+
+    void put(const int64_t i, const T value) {
+      slots[i & mask].store(value, std::memory_order_relaxed);
+    }
+
+    const size_t size;
+    const size_t mask;
+    std::unique_ptr<std::atomic<T>[]> slots;
+  };
+
+  array * grow(array * a, const int64_t t, const int64_t b) {
+
+    arrays_.emplace_back(new array(a->size << 1));
+    array * na = arrays_.back().get();
+
+    for (int64_t i = t; i < b; i++) {
+      na->put(i, a->get(i));
+    }
+
+    array_.store(na, std::memory_order_release);
+
+    return na;
+  }
+
+private:
+
+  // Keep thieves and owner on different cache lines
+  std::atomic<int64_t> top_;
+  char padding_[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> bottom_;
+  std::atomic<array *> array_;
+  std::vector<std::unique_ptr<array>> arrays_;
+
+};
+
+#endif
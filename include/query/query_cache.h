@@ -0,0 +1,52 @@
+#ifndef CAVALIERI_QUERY_QUERY_CACHE_H
+#define CAVALIERI_QUERY_QUERY_CACHE_H
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <expression.h>
+
+/* Compiled queries keyed by their string, shared by the threads that
+ * answer queries. Dashboards send the same few queries over and over, a
+ * hit skips the parser.
+ *
+ * Holds at most max_size queries, the least recently used one is dropped
+ * to make room. Long queries are compiled but not kept, clients can send
+ * frames of megabytes. Queries are parsed without the lock, two threads
+ * missing the same query both parse it.
+ */
+class query_cache {
+public:
+  query_cache(const size_t max_size);
+
+  /* Returns an empty function when query doesn't parse */
+  query_fn_t get(const std::string & query);
+
+  size_t size();
+
+private:
+  typedef std::list<std::pair<std::string, query_fn_t>> lru_t;
+
+  /* The map points at the strings in lru_ rather than holding a copy */
+  struct query_hash {
+    size_t operator()(const std::string * query) const {
+      return std::hash<std::string>()(*query);
+    }
+  };
+
+  struct query_equal {
+    bool operator()(const std::string * a, const std::string * b) const {
+      return *a == *b;
+    }
+  };
+
+  const size_t max_size_;
+  std::mutex mutex_;
+  lru_t lru_;
+  std::unordered_map<const std::string *, lru_t::iterator, query_hash,
+                     query_equal> queries_;
+};
+
+#endif
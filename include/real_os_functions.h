@@ -6,7 +6,8 @@
 class real_os_functions : public os_functions_interface {
 public:
   ssize_t recv(int fd, void *buf, size_t len, int flags);
-  ssize_t write(int fd, void *buff, size_t count);
+  ssize_t write(int fd, const void *buff, size_t count);
+  ssize_t sendmsg(int fd, const struct msghdr *msg, int flags);
 };
 
 
@@ -0,0 +1,22 @@
+#ifndef CAVALIERI_RIEMANN_QUERY_H
+#define CAVALIERI_RIEMANN_QUERY_H
+
+#include <vector>
+#include <index/real_index.h>
+#include <query/query_cache.h>
+
+/* Answers a riemann message with a query and returns the frame to write
+ * back to the client, header included.
+ *
+ * The response has the events of the index that match, at most max_results
+ * and no more than fit in max_frame_size, or ok false and an error when
+ * the query doesn't parse.
+ */
+std::vector<char> riemann_query_response(
+    const std::vector<unsigned char> & raw_msg,
+    real_index & index,
+    query_cache & cache,
+    const size_t max_results,
+    const size_t max_frame_size);
+
+#endif
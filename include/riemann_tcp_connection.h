@@ -1,33 +1,67 @@
 #ifndef CAVALIERI_RIEMANN_TCP_CONNECTION_H
 #define CAVALIERI_RIEMANN_TCP_CONNECTION_H
 
+#include <deque>
 #include <functional>
 #include <vector>
 #include <cstddef>
+#include <cstdint>
 #include <transport/tcp_connection.h>
 #include <async/async_loop.h>
 
 typedef std::function<void(std::vector<unsigned char>)> raw_msg_fn_t;
 
+/* Takes a message with a query and the id its response must be added with */
+typedef std::function<void(std::vector<unsigned char>,
+                           const uint64_t query_id)> query_msg_fn_t;
+
 class riemann_tcp_connection {
   public:
     riemann_tcp_connection(
         tcp_connection & tcp_connection_,
         raw_msg_fn_t raw_msg_fn
     );
+    /* Messages with a query go to query_fn instead of raw_msg_fn, and are
+     * answered with add_query_response() rather than acked.
+     */
+    riemann_tcp_connection(
+        tcp_connection & tcp_connection_,
+        raw_msg_fn_t raw_msg_fn,
+        query_msg_fn_t query_fn
+    );
     void callback(async_fd &);
+    /* Responses are written in the order of their queries, each followed
+     * by the acks of the messages read after it. Responses that come early
+     * wait for the ones before. A response is truncated to the events that
+     * fit in what the write buffer has left.
+     */
+    void add_query_response(const uint64_t query_id,
+                            std::vector<char> response);
 
   private:
-    void read_cb();
+    void read_cb(async_fd & async);
     void write_cb();
     void read_header();
     void read_message();
+    void flush_acks();
 
   private:
     tcp_connection & tcp_connection_;
     raw_msg_fn_t raw_msg_fn_;
+    struct pending_query {
+      /* Acks of the messages read after the query */
+      size_t acks;
+      bool answered;
+      std::vector<char> response;
+    };
+
+    query_msg_fn_t query_fn_;
     bool reading_header_;
     size_t protobuf_size_;
+    size_t pending_acks_;
+    /* Id of the first pending query */
+    uint64_t first_query_;
+    std::deque<pending_query> queries_;
 };
 
 #endif
@@ -1,27 +1,86 @@
 #ifndef CAVALIERI_RIEMANN_TCP_POOL
 #define CAVALIERI_RIEMANN_TCP_POOL
 
+#include <mutex>
 #include <transport/tcp_pool.h>
 #include <instrumentation/instrumentation.h>
 #include <riemann_tcp_connection.h>
 
+/* Called in the loop thread after a read callback has passed all its
+ * complete messages to raw_msg_fn.
+ */
+typedef std::function<void()> raw_msg_done_fn_t;
+
+/* Returns true when connections must stop reading */
+typedef std::function<bool()> paused_fn_t;
+
+/* Takes the response frame of a query, can be called from any thread */
+typedef std::function<void(std::vector<char>)> query_reply_fn_t;
+
+/* Called in the loop thread with a message that has a query, which must be
+ * answered through reply_fn.
+ */
+typedef std::function<void(std::vector<unsigned char>,
+                           query_reply_fn_t reply_fn)> raw_query_fn_t;
+
 class riemann_tcp_pool {
   public:
     riemann_tcp_pool(size_t thread_num, raw_msg_fn_t raw_msg_fn,
                      instrumentation::instrumentation & instr);
+    riemann_tcp_pool(size_t thread_num, raw_msg_fn_t raw_msg_fn,
+                     raw_msg_done_fn_t raw_msg_done_fn, hook_fn_t run_fn,
+                     instrumentation::instrumentation & instr);
     void add_client (int fd);
+    void add_listen_fd(const size_t loop_id, const int fd);
+    /* Must be set before any connection is added */
+    void set_paused_fn(paused_fn_t paused_fn);
+    /* Must be set before any connection is added. Without it queries are
+     * passed to raw_msg_fn like any other message */
+    void set_query_fn(raw_query_fn_t query_fn);
+    /* Async. Connections paused by paused_fn start reading again */
+    void resume();
     void stop();
     ~riemann_tcp_pool();
 
   private:
     void create_conn(int fd, async_loop & loop, tcp_connection & conn);
     void data_ready(async_fd & async, tcp_connection & conn);
+    void remove_conn(const size_t loop_id, const int fd);
+    void async_hook(async_loop & loop);
+    void resume_hook(async_loop & loop);
+    void add_query_response(const size_t loop_id, const int fd,
+                            const uint64_t conn_id, const uint64_t query_id,
+                            std::vector<char> response);
+    void write_query_responses(async_loop & loop);
+
+  private:
+    struct query_conn {
+      /* fds are reused, responses for a closed connection are dropped */
+      uint64_t id;
+      tcp_connection * conn;
+    };
+
+    struct query_response {
+      int fd;
+      uint64_t conn_id;
+      uint64_t query_id;
+      std::vector<char> response;
+    };
 
   private:
     tcp_pool tcp_pool_;
     raw_msg_fn_t raw_msg_fn_;
+    raw_msg_done_fn_t raw_msg_done_fn_;
+    paused_fn_t paused_fn_;
     instrumentation::update_gauge_t connection_gauge_;
+    instrumentation::update_gauge_t paused_gauge_;
     std::vector<std::map<int, riemann_tcp_connection>> connections_;
+    std::vector<std::map<int, tcp_connection *>> paused_;
+    raw_query_fn_t query_fn_;
+    std::vector<uint64_t> next_conn_id_;
+    std::vector<std::map<int, query_conn>> query_conns_;
+    std::vector<std::mutex> responses_mutexes_;
+    std::vector<std::vector<query_response>> responses_;
 };
 
 #endif
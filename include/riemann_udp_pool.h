@@ -2,16 +2,24 @@
 #define CAVALIERI_RIEMANN_UDP_POOL
 
 #include <transport/udp_pool.h>
+#include <instrumentation/instrumentation.h>
 
-typedef std::function<void(const std::vector<unsigned char>)> raw_msg_fn_t;
+typedef std::function<void(std::vector<unsigned char>)> raw_msg_fn_t;
 
 class riemann_udp_pool {
   public:
-    riemann_udp_pool(uint32_t port, raw_msg_fn_t raw_msg_fn);
+    riemann_udp_pool(uint32_t port, raw_msg_fn_t raw_msg_fn,
+                     instrumentation::instrumentation & instr);
+    riemann_udp_pool(size_t thread_num, uint32_t port,
+                     size_t max_datagram_size, raw_msg_fn_t raw_msg_fn,
+                     hook_fn_t run_fn,
+                     instrumentation::instrumentation & instr);
     void stop();
     ~riemann_udp_pool();
 
   private:
+    instrumentation::update_rate_fn_t truncated_rate_;
+    instrumentation::update_rate_fn_t overflow_rate_;
     udp_pool udp_pool_;
 };
 
@@ -3,6 +3,6 @@
 
 #include <streams/lib.h>
 
-void load_rules(const std::string file, std::vector<stream_lib> & streams);
+void load_rules(const std::string file, stream_libs & libs);
 
 #endif
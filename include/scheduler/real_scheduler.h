@@ -2,19 +2,52 @@
 #define CAVALIERI_SCHEDULER_REAL_SCHEDULER_H
 
 #include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
 #include <tbb/concurrent_queue.h>
 #include <future>
+#include <thread>
+#include <chrono>
 #include <scheduler/scheduler.h>
 #include <pool/async_thread_pool.h>
+#include <instrumentation/instrumentation.h>
 
 
+/* Used to run task bodies somewhere else than in the scheduler threads. Tasks
+ * dispatched with the same key must run in order.
+ */
+using dispatch_fn_t = std::function<void(const uint64_t key,
+                                         const task_fn_t & task)>;
+
+/* Blocks until all the tasks that have been dispatched so far have run */
+using sync_fn_t = std::function<void()>;
+
+/* Scheduler threads only keep time, task bodies are dispatched to the
+ * executor or, when no dispatch function is given, to a small pool of timer
+ * workers.
+ *
+ * Periodic tasks with the same interval share one timer. On every tick their
+ * callbacks are split in chunks that are dispatched separately, a task always
+ * goes to the same chunk. A chunk that is still running when the next tick
+ * arrives skips that tick. A task that joins a group which is already
+ * ticking skips the next tick, so it first runs a full interval later.
+ *
+ * Tasks added from an executor shard are dispatched back to that shard, as
+ * they may touch its shard-local stream state. Only the rest are spread over
+ * free keys.
+ */
 class real_scheduler : public scheduler_interface {
 public:
-  real_scheduler();
+  real_scheduler(instrumentation::instrumentation & instr);
+  real_scheduler(instrumentation::instrumentation & instr,
+                 dispatch_fn_t dispatch_fn, sync_fn_t sync_fn);
+  ~real_scheduler();
   remove_task_future_t add_periodic_task(task_fn_t task,
                                          float interval) override;
   remove_task_future_t add_once_task(task_fn_t task, float dt) override;
   remove_ns_tasks_future_t remove_ns_tasks(const std::string) override;
+  void sync_dispatched() override;
   time_t unix_time() override;
   void set_time(const time_t t) override;
   void clear() override;
@@ -24,8 +57,10 @@ private:
   void async_callback(async_loop & loop);
   void add_tasks(async_loop & loop);
   void remove_ns_tasks(async_loop & loop);
-  std::future<remove_task_fn_t> add_task(task_fn_t task,
-                                         float interval, bool once);
+  std::future<remove_task_fn_t> add_task(task_fn_t task, float interval,
+                                         bool once, bool dispatch,
+                                         const std::string nm,
+                                         const size_t shard);
 
 private:
   using task_promise_shared_t = std::shared_ptr<std::promise<remove_task_fn_t>>;
@@ -35,7 +70,9 @@ private:
                                   task_cb_fn_t task;
                                   float interval;
                                   bool once;
+                                  bool dispatch;
                                   std::string nm;
+                                  size_t shard;
                                  };
   using promise_queue_t =
    tbb::concurrent_bounded_queue<task_promise_t>;
@@ -53,11 +90,74 @@ private:
 
   using ns_queue_t = tbb::concurrent_bounded_queue<ns_promise_t>;
 
+  struct periodic_task_t {
+    periodic_task_t(task_fn_t task, const std::string nm)
+      : task(task), nm(nm), removed(false), first_tick(0) {}
+
+    task_fn_t task;
+    std::string nm;
+    std::atomic<bool> removed;
+    /* Ticks of its group before this one are skipped */
+    uint64_t first_tick;
+  };
+
+  using periodic_task_shared_t = std::shared_ptr<periodic_task_t>;
+
+  struct periodic_chunk_t {
+    std::mutex mutex;
+    std::vector<periodic_task_shared_t> tasks;
+    std::atomic<bool> running{false};
+    std::atomic<bool> used{false};
+  };
+
+  struct periodic_group_t {
+    periodic_group_t(const size_t chunks, const size_t shards,
+                     const float interval)
+      : chunks(chunks), size(0), shard_chunks(shards), interval(interval),
+        ticks(0) {}
+
+    std::vector<periodic_chunk_t> chunks;
+    std::atomic<size_t> size;
+    std::vector<periodic_chunk_t> shard_chunks;
+    const float interval;
+    std::atomic<uint64_t> ticks;
+  };
+
+  using time_point_t = std::chrono::steady_clock::time_point;
+
+  using work_queue_t = tbb::concurrent_bounded_queue<task_fn_t>;
+
+  void run_periodic_group(periodic_group_t & group);
+  void dispatch_periodic_chunk(const periodic_group_t & group,
+                               periodic_chunk_t & chunk,
+                               const uint64_t key,
+                               const uint64_t tick,
+                               const time_point_t tick_time);
+  void run_periodic_chunk(const periodic_group_t & group,
+                          periodic_chunk_t & chunk,
+                          const uint64_t tick,
+                          const time_point_t tick_time);
+  void start_workers();
+  void run_worker(const size_t i);
+  void stop_workers();
+
 private:
   async_thread_pool threads_;
   std::vector<promise_queue_t> task_promises_;
   std::vector<remove_task_queue_t> remove_tasks_;
   std::vector<ns_queue_t> ns_promises_;
+  dispatch_fn_t dispatch_fn_;
+  sync_fn_t sync_fn_;
+  std::atomic<uint64_t> next_dispatch_key_;
+  /* Set under periodic_mutex_, remove_ns_tasks() fails once stopped */
+  bool stopped_;
+  instrumentation::update_latency_fn_t lateness_fn_;
+  instrumentation::update_rate_fn_t overrun_rate_;
+  std::vector<std::unique_ptr<work_queue_t>> work_queues_;
+  std::vector<std::thread> workers_;
+  std::mutex periodic_mutex_;
+  std::unordered_map<uint64_t, std::unique_ptr<periodic_group_t>>
+    periodic_groups_;
 
 };
 
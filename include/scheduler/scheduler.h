@@ -17,6 +17,8 @@ public:
                                                   float interval) = 0;
   virtual remove_task_future_t add_once_task(task_fn_t task, float dt) = 0;
   virtual remove_ns_tasks_future_t remove_ns_tasks(const std::string nm) = 0;
+  /* Blocks until the task bodies dispatched so far have run */
+  virtual void sync_dispatched() = 0;
   virtual time_t unix_time() = 0;
   virtual void set_time(const time_t t) = 0;
   virtual void clear() = 0;
@@ -0,0 +1,37 @@
+#ifndef CAVALIERI_STATSD_PARSER_H
+#define CAVALIERI_STATSD_PARSER_H
+
+#include <cstddef>
+
+/* A statsd line, name, value and tags point into the parsed data */
+struct statsd_line {
+  enum metric_type {
+    counter,
+    gauge,
+    set,
+    timer
+  };
+
+  const char * name;
+  size_t name_size;
+  metric_type type;
+  /* The value as sent, sets count distinct ones */
+  const char * value;
+  size_t value_size;
+  double number;
+  /* Gauges sent with a sign change the previous value */
+  bool delta;
+  double sample_rate;
+  /* Comma separated, as sent by dogstatsd clients */
+  const char * tags;
+  size_t tags_size;
+};
+
+/* Parses "name:value|type[|@sample_rate][|#tags]" without its newline, type
+ * being c, g, s, or ms, h or d for timers. Returns false when the line is
+ * not valid.
+ */
+bool parse_statsd_line(const char * line, const size_t size,
+                       statsd_line & out);
+
+#endif
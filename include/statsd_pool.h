@@ -0,0 +1,53 @@
+#ifndef CAVALIERI_STATSD_POOL_H
+#define CAVALIERI_STATSD_POOL_H
+
+#include <mutex>
+#include <transport/udp_pool.h>
+#include <instrumentation/instrumentation.h>
+#include <statsd_table.h>
+
+/* Called in a udp thread with the events of a flush. The events can be
+ * taken from msg.
+ */
+typedef std::function<void(riemann::Msg &, const size_t)> statsd_events_fn_t;
+
+/* Statsd listener on a udp port that aggregates metrics instead of passing
+ * every one on.
+ *
+ * Each udp thread adds what it reads to its own statsd_table, with no
+ * locks. Every flush_interval seconds the threads hand their tables over,
+ * and the last one to do so flushes the merged metrics to events_fn.
+ */
+class statsd_pool {
+  public:
+    statsd_pool(size_t thread_num, uint32_t port, size_t max_datagram_size,
+                float flush_interval, std::vector<double> percentiles,
+                statsd_events_fn_t events_fn, hook_fn_t run_fn,
+                instrumentation::instrumentation & instr);
+    void start_threads();
+    void stop_threads();
+    ~statsd_pool();
+
+  private:
+    void run_hook(async_loop & loop);
+    void udp_read(std::vector<unsigned char> datagram);
+    void hand_over(const size_t tid);
+    void flush();
+
+  private:
+    const size_t thread_num_;
+    const float flush_interval_;
+    const std::vector<double> percentiles_;
+    statsd_events_fn_t events_fn_;
+    hook_fn_t run_fn_;
+    instrumentation::update_rate_fn_t invalid_rate_;
+    std::vector<statsd_table> tables_;
+    std::mutex mutex_;
+    statsd_table merged_;
+    std::vector<bool> handed_over_;
+    size_t hand_overs_;
+    riemann::Msg msg_;
+    udp_pool udp_pool_;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef CAVALIERI_STATSD_TABLE_H
+#define CAVALIERI_STATSD_TABLE_H
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <proto.pb.h>
+#include <statsd_parser.h>
+#include <util/quantile_sketch.h>
+
+/* Aggregates statsd metrics between flushes, owned by one thread.
+ *
+ * Metrics are keyed by type, name and tags. Counters add up their values
+ * scaled by the sample rate, gauges keep the last value or add deltas to
+ * it, sets count distinct values by hash and timers go to a
+ * quantile_sketch.
+ *
+ * Gauges stay in the table after a flush, deltas need the value they
+ * change, but are only flushed again once updated.
+ */
+class statsd_table {
+public:
+  statsd_table();
+
+  /* Aggregates the lines in data and returns how many were not valid */
+  size_t add(const char * data, const size_t size);
+  void add(const statsd_line & line);
+
+  /* Takes the metrics of other, which ends up empty */
+  void merge(statsd_table & other);
+
+  /* Adds the events of the metrics updated since the last flush to msg
+   * and forgets all but gauges.
+   *
+   * Counters give "name" with the count of the interval and "name rate"
+   * per second, gauges and sets "name", and timers "name count",
+   * "name mean" and "name <percentile>" for each percentile.
+   */
+  void flush(riemann::Msg & msg, const int64_t time, const float ttl,
+             const float interval, const std::vector<double> & percentiles);
+
+  size_t size() const;
+
+private:
+  struct metric {
+    statsd_line::metric_type type;
+    std::string name;
+    std::string tags;
+    double value;
+    /* Gauges that were set, not only changed */
+    bool absolute;
+    bool updated;
+    std::unordered_set<uint64_t> set;
+    quantile_sketch sketch;
+  };
+
+  typedef std::unordered_map<std::string, metric> metrics_t;
+
+  metric & find(const statsd_line::metric_type type, const char * name,
+                const size_t name_size, const char * tags,
+                const size_t tags_size);
+
+private:
+  metrics_t metrics_;
+  std::string key_;
+};
+
+#endif
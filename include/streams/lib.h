@@ -5,36 +5,98 @@
 #include <memory>
 #include <atomic>
 #include <ctime>
+#include <cstdint>
+#include <string>
 #include <streams/stream_infra.h>
 
 const std::string k_global_ns("global");
 
-/* This thread_local variable is used to track the lib namespace that is using
- * the thread. It is useful to unload the library completely and remove
- * all code that belongs to the library
+/* Each thread tracks the lib namespace that is using it. It is useful to
+ * unload the library completely and remove all code that belongs to the
+ * library.
+ *
+ * Namespaces are interned so the hot path only switches integer ids.
  */
-extern thread_local std::string * thread_ns;
+typedef uint32_t ns_id_t;
 
-void free_thread_ns();
+const ns_id_t k_global_ns_id = 0;
+
+ns_id_t intern_ns(const std::string & ns);
 
 void set_thread_ns(const std::string ns);
 
+void set_thread_ns_id(const ns_id_t ns_id);
+
 void set_thread_global_ns();
 
+ns_id_t get_thread_ns_id();
+
+std::string get_ns_name(const ns_id_t ns_id);
+
 std::string get_thread_ns();
 
-struct stream_lib {
+/* When the executor partitions events by key, every executor thread owns a
+ * shard and all the events for a given key are processed by the same thread.
+ * Stream functions use these to keep unsynchronized per-shard state.
+ */
+const size_t k_no_shard = static_cast<size_t>(-1);
+
+void set_stream_shards(const size_t shards);
+
+size_t stream_shards();
+
+void set_thread_shard(const size_t shard);
+
+size_t get_thread_shard();
+
+/* Event fields the executor partitions by, set along with the shards */
+void set_stream_partition(const std::vector<std::string> & fields);
+
+const std::vector<std::string> & stream_partition();
+
+/* True while initializing streams that only ever see the events of one
+ * partition key, such as the streams a by() on the partition fields creates
+ * for each key. Only those can keep their state per shard.
+ */
+bool partition_scope();
+
+class partition_scope_guard {
+public:
+  partition_scope_guard(const bool scope);
+  ~partition_scope_guard();
+
+private:
+  bool prev_scope_;
+};
+
+/* A loaded version of a rules library */
+struct loaded_lib {
 
   std::string file;
+  ns_id_t ns_id;
   std::time_t last_write_time;
-  void * handle{nullptr};
+  void * handle;
   std::shared_ptr<streams_t> stream;
-  std::atomic<unsigned int> ref_counter{0};
 
-  bool used() const;
-  void set_used(bool);
-  bool inc();
-  void dec();
+};
+
+typedef std::vector<loaded_lib *> lib_list_t;
+
+/* The loaded rules libraries, kept in a dense list so that processing an
+ * event only walks the libraries in use. Readers call load() inside an rcu
+ * read section. The loader publishes a new list and calls rcu_synchronize()
+ * before freeing the previous one and unloading the libraries it dropped.
+ */
+class stream_libs {
+public:
+  stream_libs();
+  ~stream_libs();
+  const lib_list_t & load() const;
+  /* Returns the previous list */
+  const lib_list_t * publish(const lib_list_t & libs);
+
+private:
+  std::atomic<const lib_list_t *> list_;
 
 };
 
@@ -0,0 +1,72 @@
+#ifndef CAVALIERI_STREAMS_NAMED_STATE_H
+#define CAVALIERI_STREAMS_NAMED_STATE_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <typeinfo>
+
+/* State of the stream functions used inside named() is registered under
+ * "<library>/<name>/<index>:<shape>", where index is the position of the
+ * function in the named stream and shape describes the function and its
+ * arguments. When a library is reloaded, the functions of the new version
+ * that have the same key keep using the state of the old version.
+ *
+ * Only state that holds no code from the library can be registered.
+ */
+
+/* Set by the rules loader while a library is being initialized */
+void set_state_lib(const std::string & lib);
+
+std::string state_lib();
+
+/* Stateful functions initialized while the guard is alive are registered
+ * under prefix. An empty prefix disables named state.
+ */
+class state_scope_guard {
+public:
+  state_scope_guard(const std::string & prefix);
+  ~state_scope_guard();
+
+private:
+  std::string prev_prefix_;
+  size_t prev_index_;
+};
+
+/* Returns the key of the next stateful function in the current scope, or
+ * an empty string when there is no scope.
+ */
+std::string next_state_key(const std::string & shape);
+
+/* Scope for the streams that a function such as by() creates for each
+ * child, empty when scope is empty.
+ */
+std::string child_state_scope(const std::string & scope,
+                              const std::string & child);
+
+std::shared_ptr<void> find_or_add_named_state(
+    const std::string & key,
+    std::function<std::shared_ptr<void>()> make_state);
+
+/* Keeps the registered state of lib alive until the next call for the same
+ * library, so the new version can pick it up after the old one is gone.
+ */
+void carry_named_state(const std::string & lib);
+
+template <class T, class... Args>
+std::shared_ptr<T> make_named_state(const std::string & shape,
+                                    const Args &... args)
+{
+  const auto key = next_state_key(shape + ":" + typeid(T).name());
+
+  if (key.empty()) {
+    return std::make_shared<T>(args...);
+  }
+
+  return std::static_pointer_cast<T>(find_or_add_named_state(key, [&]()
+  {
+    return std::static_pointer_cast<void>(std::make_shared<T>(args...));
+  }));
+}
+
+#endif
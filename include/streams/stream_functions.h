@@ -5,6 +5,9 @@
 #include <list>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <boost/variant.hpp>
 #include <common/event.h>
 #include <streams/stream_infra.h>
@@ -90,6 +93,12 @@ streams_t by(const by_keys_t& keys, const streams_t stream);
 
 streams_t by(const by_keys_t& keys);
 
+/* The state of stateful functions in stream is carried over when the
+ * library is reloaded and the new version has a stream with the same name
+ * and shape. Names must be unique within a library.
+ */
+streams_t named(const std::string name, const streams_t stream);
+
 streams_t rate(const int seconds);
 
 streams_t coalesce(fold_fn_t);
@@ -170,19 +179,33 @@ streams_t pagerduty_trigger(const std::string key);
 class streams {
 public:
   streams(const config &, instrumentation::instrumentation &);
+  virtual ~streams();
   void add_stream(streams_t stream);
+  /* Blocks until rules are loaded */
   void reload_rules();
-  void process_message(const riemann::Msg& message);
+  /* Reloads rules in a background thread */
+  void reload_rules_async();
+  virtual void process_message(const riemann::Msg& message);
   void push_event(const Event& e);
   void stop();
 
+private:
+  void reload_loop();
+
 private:
   std::string rules_directory_;
-  std::vector<stream_lib> streams_;
+  stream_libs libs_;
   instrumentation::update_rate_fn_t update_rate_;
   instrumentation::update_latency_fn_t update_latency_;
   instrumentation::update_latency_fn_t update_in_latency_;
+  instrumentation::update_latency_fn_t reload_latency_;
   bool stop_;
+  std::mutex reload_mutex_;
+  std::mutex pending_mutex_;
+  std::condition_variable pending_cond_;
+  bool reload_pending_;
+  bool reload_stop_;
+  std::thread reload_thread_;
 };
 
 #endif
@@ -0,0 +1,37 @@
+#ifndef CAVALIERI_STREAMS_STREAM_FUNCTIONS_SHARD_H
+#define CAVALIERI_STREAMS_STREAM_FUNCTIONS_SHARD_H
+
+#include <streams/stream_functions.h>
+
+/* These functions keep one copy of their state per executor shard and don't
+ * take any lock. They are only safe to use when the executor partitions
+ * events by key, see set_stream_shards(), and only see the events of one
+ * partition key, see partition_scope(). Elsewhere each shard would give a
+ * partial result.
+ */
+
+streams_t by_shard(const by_keys_t & keys, const streams_t stream);
+
+streams_t by_shard(const by_keys_t & keys);
+
+streams_t coalesce_shard(fold_fn_t fold);
+
+streams_t project_shard(const predicates_t predicates, fold_fn_t fold);
+
+streams_t changed_state_shard(std::string initial);
+
+streams_t moving_event_window_shard(size_t n, fold_fn_t fold);
+
+streams_t fixed_event_window_shard(size_t n, fold_fn_t fold);
+
+streams_t moving_time_window_shard(time_t dt, fold_fn_t fold);
+
+streams_t fixed_time_window_shard(time_t dt, fold_fn_t fold);
+
+streams_t stable_shard(time_t dt);
+
+streams_t throttle_shard(size_t n, time_t dt);
+
+streams_t ddt_shard();
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef CAVALIERI_TRANSPORT_BUFFER_POOL_H
+#define CAVALIERI_TRANSPORT_BUFFER_POOL_H
+
+#include <cstddef>
+
+/* Memory for the connection buffers.
+ *
+ * Released buffers are kept by the thread that released them, by size, and
+ * handed out again to the next acquire() of the same size from that thread.
+ * Connections are served by one loop thread, so buffers go back and forth
+ * between its connections without locking.
+ */
+namespace buffer_pool {
+
+unsigned char * acquire(const size_t size);
+void release(unsigned char * buffer, const size_t size);
+
+/* Bytes in buffers acquired and not released, across all threads */
+size_t used_bytes();
+/* Bytes in released buffers kept for reuse, across all threads */
+size_t pooled_bytes();
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef CAVALIERI_TRANSPORT_BYTE_BUFFER_H
+#define CAVALIERI_TRANSPORT_BYTE_BUFFER_H
+
+#include <cstddef>
+
+/* Contiguous byte buffer for socket i/o.
+ *
+ * Data is appended after the readable bytes and consumed from the front, so
+ * readers always see it in one piece and can parse it in place. The space
+ * freed in front is reclaimed by moving the data back to the start, only
+ * when that moves no more bytes than were consumed since.
+ *
+ * Memory comes from buffer_pool and goes back to it whenever the buffer is
+ * empty, so idle connections hold none. It starts at the size the buffer
+ * needed last time it was in use, and doubles when it is full, up to
+ * capacity.
+ */
+class byte_buffer {
+public:
+  explicit byte_buffer(const size_t capacity);
+  byte_buffer(byte_buffer && other);
+  byte_buffer & operator=(byte_buffer && other);
+  byte_buffer(const byte_buffer &) = delete;
+  byte_buffer & operator=(const byte_buffer &) = delete;
+  ~byte_buffer();
+
+  /* Readable bytes */
+  const unsigned char * data() const;
+  size_t size() const;
+  bool empty() const;
+  unsigned char operator[](const size_t i) const;
+
+  size_t capacity() const;
+  /* Free bytes up to capacity, including the consumed ones in front of the
+   * data
+   */
+  size_t reserve() const;
+  /* Bytes currently taken from buffer_pool */
+  size_t allocated() const;
+
+  /* Free space right after the data, where recv() can write. Call
+   * prepare() first to make the most of it.
+   */
+  unsigned char * tail();
+  size_t tail_size() const;
+  void prepare();
+  /* Makes n bytes written to tail() readable */
+  void commit(const size_t n);
+
+  /* Returns false when the bytes don't fit */
+  bool append(const void * src, const size_t n);
+  void consume(const size_t n);
+
+private:
+  void compact();
+  void grow(const size_t min_size);
+  void release();
+
+private:
+  size_t capacity_;
+  unsigned char * buffer_;
+  size_t allocated_;
+  size_t begin_;
+  size_t end_;
+  /* Most bytes needed since the memory was taken, and the size to take
+   * next
+   */
+  size_t high_;
+  size_t next_size_;
+};
+
+#endif
@@ -1,7 +1,6 @@
 #ifndef CAVALIERI_TRANSPORT_CURL_POOL_H
 #define CAVALIERI_TRANSPORT_CURL_POOL_H
 
-#include <tbb/concurrent_queue.h>
 #include <functional>
 #include <queue>
 #include <unordered_map>
@@ -11,6 +10,7 @@
 #include <curl/curl.h>
 #include <common/event.h>
 #include <transport/tcp_pool.h>
+#include <pool/ring_buffer.h>
 
 
 typedef struct {
@@ -54,7 +54,7 @@ class curl_pool {
     void cleanup_conns(const size_t loop_id);
 
   private:
-    typedef tbb::concurrent_bounded_queue<queued_event_t> event_queue_t;
+    typedef mpsc_ring<queued_event_t> event_queue_t;
 
     typedef struct {
       std::shared_ptr<create_socket_cb_t> create_socket_fn;
@@ -0,0 +1,82 @@
+#ifndef CAVALIERI_TRANSPORT_HTTP_REQUEST_H
+#define CAVALIERI_TRANSPORT_HTTP_REQUEST_H
+
+#include <cstddef>
+#include <string>
+
+/* Incremental HTTP/1.1 request reader for endpoints that take whole bodies.
+ *
+ * parse() is fed what arrives on a connection and returns the bytes it
+ * used, it reads one request at a time. The head must arrive whole within
+ * k_max_head_size bytes. Bodies come with a Content-Length or chunked, are
+ * collected in body() and bounded by max_body_size.
+ *
+ * Once done() or failed(), reset() readies it for the next request of the
+ * connection and keeps the memory of the body.
+ */
+class http_request {
+public:
+  static const size_t k_max_head_size = 8192;
+
+  explicit http_request(const size_t max_body_size);
+
+  size_t parse(const char * data, const size_t size);
+
+  bool done() const;
+  /* The request can't be read, the connection must be closed after
+   * answering with status() and error().
+   */
+  bool failed() const;
+  /* Returns true, once, when the client waits for a 100 Continue before it
+   * sends the body.
+   */
+  bool expect_continue();
+
+  const std::string & method() const;
+  /* Without the query string */
+  const std::string & path() const;
+  bool keep_alive() const;
+  const std::string & body() const;
+
+  int status() const;
+  const std::string & error() const;
+
+  void reset();
+
+private:
+  enum state {
+    k_head,
+    k_body,
+    k_chunk_size,
+    k_chunk_data,
+    k_chunk_end,
+    k_trailers,
+    k_done,
+    k_failed
+  };
+
+  bool parse_head(const char * p, const char * end);
+  bool parse_header(const char * name, const size_t name_size,
+                    const char * value, const size_t value_size);
+  /* Returns the bytes used, 0 when the line is not there yet */
+  size_t parse_chunk_size(const char * p, const char * end);
+  size_t parse_trailer(const char * p, const char * end);
+  bool fail(const int status, const char * error);
+
+private:
+  const size_t max_body_size_;
+  state state_;
+  std::string method_;
+  std::string path_;
+  bool keep_alive_;
+  bool expect_continue_;
+  bool chunked_;
+  bool has_length_;
+  size_t remaining_;
+  size_t trailer_size_;
+  std::string body_;
+  int status_;
+  std::string error_;
+};
+
+#endif
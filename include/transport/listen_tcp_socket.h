@@ -1,6 +1,38 @@
 #ifndef CAVALIERI_TRANSPORT_LISTEN_TCP_SOCKET_H
 #define CAVALIERI_TRANSPORT_LISTEN_TCP_SOCKET_H
 
+#include <cstddef>
+
 int create_tcp_listen_socket(int port);
 
+/* Several sockets with reuse_port can listen on the same port, the kernel
+ * balances new connections between them.
+ */
+int create_tcp_listen_socket(int port, bool reuse_port);
+
+/* Makes the kernel prefer this socket, among the ones sharing its port, for
+ * connections handled on cpu modulo the number of cores.
+ */
+bool set_incoming_cpu(int fd, size_t cpu);
+
+/* Gives every thread of pool its own listen socket on port, the kernel
+ * spreads new connections between them. With pin, each socket prefers the
+ * connections handled on the cpu its thread is pinned to.
+ */
+template <class Pool>
+void listen_per_thread(Pool & pool, const size_t thread_num, const int port,
+                       const bool pin)
+{
+  for (size_t i = 0; i < thread_num; i++) {
+
+    const int fd = create_tcp_listen_socket(port, true);
+
+    if (pin) {
+      set_incoming_cpu(fd, i);
+    }
+
+    pool.add_listen_fd(i, fd);
+  }
+}
+
 #endif
@@ -0,0 +1,11 @@
+#ifndef CAVALIERI_TRANSPORT_LISTEN_UNIX_SOCKET_H
+#define CAVALIERI_TRANSPORT_LISTEN_UNIX_SOCKET_H
+
+#include <string>
+
+/* Listens on a unix stream socket at path, replacing any file left there by
+ * a previous run.
+ */
+int create_unix_listen_socket(const std::string & path);
+
+#endif
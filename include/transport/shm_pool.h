@@ -0,0 +1,58 @@
+#ifndef CAVALIERI_TRANSPORT_SHM_POOL_H
+#define CAVALIERI_TRANSPORT_SHM_POOL_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <pool/async_thread_pool.h>
+#include <transport/shm_ring.h>
+
+typedef std::function<void(std::vector<unsigned char>)> shm_read_fn_t;
+
+/* Returns true when rings must stop being read */
+typedef std::function<bool()> shm_paused_fn_t;
+
+/* Reads the shm_rings of local producers, see shm_producer.
+ *
+ * Producers connect to the unix socket at path and send the ring memfd and
+ * an eventfd, the ring is read whenever the eventfd is signaled and until
+ * the producer closes its socket. One thread serves all the rings.
+ */
+class shm_pool {
+  public:
+    shm_pool(const std::string & path, shm_read_fn_t shm_read_fn,
+             hook_fn_t run_fn);
+    /* Must be set before threads start. Paused rings are retried
+     * periodically.
+     */
+    void set_paused_fn(shm_paused_fn_t paused_fn);
+    void start_threads();
+    void stop_threads();
+    virtual ~shm_pool();
+
+  private:
+    struct shm_connection {
+      shm_ring ring;
+      int event_fd;
+      bool retry;
+    };
+
+    void run_hook(async_loop & loop);
+    void accept_callback(async_fd & async);
+    void socket_callback(async_fd & async);
+    void ring_callback(async_fd & async);
+    bool handshake(async_fd & async, shm_connection & conn);
+    void drain(async_loop & loop, const int sock);
+    void close_connection(async_loop & loop, const int sock);
+
+  private:
+    async_thread_pool async_thread_pool_;
+    std::string path_;
+    shm_read_fn_t shm_read_fn_;
+    hook_fn_t run_fn_;
+    shm_paused_fn_t paused_fn_;
+    std::map<int, shm_connection> connections_;
+    std::map<int, int> event_fd_socks_;
+};
+
+#endif
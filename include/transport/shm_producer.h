@@ -0,0 +1,34 @@
+#ifndef CAVALIERI_TRANSPORT_SHM_PRODUCER_H
+#define CAVALIERI_TRANSPORT_SHM_PRODUCER_H
+
+#include <string>
+#include <transport/shm_ring.h>
+
+/* Sends riemann messages to a cavalieri on the same host through a
+ * shm_ring.
+ *
+ * connect() creates the ring and an eventfd and hands them to cavalieri
+ * over the unix socket at path, see the shm_socket_path flag. send() copies
+ * a serialized riemann::Msg into the ring and doesn't block, it returns
+ * false when the ring is full so the caller can retry or drop it.
+ *
+ * Messages are not acked. Each instance must only be used by one thread.
+ */
+class shm_producer {
+public:
+  shm_producer();
+  shm_producer(const shm_producer &) = delete;
+  shm_producer & operator=(const shm_producer &) = delete;
+  ~shm_producer();
+
+  bool connect(const std::string & path, const size_t capacity);
+  bool send(const void * msg, const size_t size);
+  void close();
+
+private:
+  shm_ring ring_;
+  int sock_;
+  int event_fd_;
+};
+
+#endif
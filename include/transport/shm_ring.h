@@ -0,0 +1,122 @@
+#ifndef CAVALIERI_TRANSPORT_SHM_RING_H
+#define CAVALIERI_TRANSPORT_SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* Ring of riemann frames in memory shared by one producer and cavalieri.
+ *
+ * The producer creates the memory with create_memfd() and hands it to
+ * cavalieri over a unix socket, see shm_producer. It holds a header page
+ * followed by capacity bytes of data, capacity being a power of two.
+ *
+ * Frames are laid out as in the tcp protocol, a 4 bytes length in network
+ * order followed by the message, and start at 4 bytes boundaries. When a
+ * frame doesn't fit before the end of the data, a wrap marker is written
+ * instead and the frame goes at the start.
+ *
+ * The consumer announces it is going to sleep before it waits on the
+ * eventfd, and the producer only writes to the eventfd then. Neither side
+ * makes syscalls while the consumer keeps up.
+ */
+struct shm_ring_header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  /* Bytes written by the producer */
+  alignas(64) std::atomic<uint64_t> head;
+  /* Bytes read by the consumer */
+  alignas(64) std::atomic<uint64_t> tail;
+  std::atomic<uint32_t> sleeping;
+};
+
+class shm_ring {
+public:
+  shm_ring();
+  shm_ring(shm_ring && other);
+  shm_ring & operator=(shm_ring && other);
+  shm_ring(const shm_ring &) = delete;
+  shm_ring & operator=(const shm_ring &) = delete;
+  ~shm_ring();
+
+  /* Creates the memory for a ring of at least capacity bytes, sealed so its
+   * size can't change. Returns -1 on error.
+   */
+  static int create_memfd(const size_t capacity);
+
+  /* Maps the ring in memfd. Fails when it isn't sealed against shrinking,
+   * or its size or header are not valid.
+   */
+  bool map(const int memfd);
+
+  size_t capacity() const;
+
+  /* Producer. Returns false when the frame doesn't fit in the free space,
+   * or would not fit in an empty ring.
+   */
+  bool write(const void * data, const size_t size);
+  /* Returns true, once, when the consumer went to sleep and has to be woken
+   * up after a write.
+   */
+  bool wake_consumer();
+
+  /* Consumer. Calls fn(data, size) for up to max_frames frames and returns
+   * how many it read. Sets corrupted() when the producer wrote garbage.
+   */
+  template <class Fn>
+  size_t read(Fn fn, const size_t max_frames);
+  bool empty() const;
+  /* Announces the consumer is going to sleep. Returns false, without
+   * sleeping, when frames were written meanwhile.
+   */
+  bool sleep();
+  bool corrupted() const;
+
+private:
+  void unmap();
+  /* Checks the frame at tail, returns its size in the ring or 0 */
+  size_t frame_at(const uint64_t tail, const uint64_t head,
+                  const unsigned char * & data, size_t & size);
+
+private:
+  shm_ring_header * header_;
+  unsigned char * data_;
+  size_t capacity_;
+  size_t mapped_;
+  bool corrupted_;
+};
+
+template <class Fn>
+size_t shm_ring::read(Fn fn, const size_t max_frames) {
+
+  size_t frames = 0;
+
+  const uint64_t head = header_->head.load(std::memory_order_acquire);
+  uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+
+  while (frames < max_frames && tail != head) {
+
+    const unsigned char * data;
+    size_t size;
+
+    const size_t length = frame_at(tail, head, data, size);
+
+    if (!length) {
+      corrupted_ = true;
+      break;
+    }
+
+    if (data) {
+      fn(data, size);
+      frames++;
+    }
+
+    tail += length;
+    header_->tail.store(tail, std::memory_order_release);
+  }
+
+  return frames;
+}
+
+#endif
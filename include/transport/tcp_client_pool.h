@@ -1,12 +1,12 @@
 #ifndef CAVALIERI_TCP_CLIENT_POOL_H
 #define CAVALIERI_TCP_CLIENT_POOL_H
 
-#include <tbb/concurrent_queue.h>
 #include <functional>
 #include <queue>
 #include <unordered_map>
 #include <transport/tcp_pool.h>
 #include <transport/tcp_connection.h>
+#include <pool/ring_buffer.h>
 #include <common/event.h>
 
 /* This callback is used to translate events into whatever needs to be
@@ -36,7 +36,7 @@ class tcp_client_pool {
     void connect_clients(const size_t loop_id);
 
   private:
-    typedef tbb::concurrent_bounded_queue<Event> event_queue_t;
+    typedef mpsc_ring<Event> event_queue_t;
     typedef std::queue<std::vector<char>> fd_event_queue_t;
     typedef std::pair<tcp_connection &, fd_event_queue_t> fd_conn_data_t;
 
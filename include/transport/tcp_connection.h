@@ -1,8 +1,14 @@
 #ifndef CAVALIERI_TRANSPORT_TCP_CONNECTION_H
 #define CAVALIERI_TRANSPORT_TCP_CONNECTION_H
 
-#include <vector>
-#include <boost/circular_buffer.hpp>
+#include <sys/uio.h>
+#include <transport/byte_buffer.h>
+#include <async/async_loop.h>
+
+/* Buffer capacity of the connections created without one, which bounds the
+ * frames they take. Must be called before connections are created.
+ */
+void set_tcp_buffer_size(const size_t size);
 
 class tcp_connection {
   public:
@@ -10,8 +16,14 @@ class tcp_connection {
     tcp_connection(int socket_fd, size_t buff_size);
 
     bool read();
+    /* Reads with async.recv(), from what the loop received */
+    bool read(async_fd & async);
     bool queue_write(const char *src, size_t length);
     bool write();
+    /* Writes what is queued followed by iov in one syscall, without waiting
+     * for the socket to be writable, and queues what is left.
+     */
+    bool write_vec(const struct iovec * iov, const size_t iovcnt);
     bool pending_write() const;
     bool pending_read() const;
     size_t read_bytes() const;
@@ -19,8 +31,8 @@ class tcp_connection {
     const size_t buff_size;
     int sfd;
     bool close_connection;
-    boost::circular_buffer<unsigned char> r_buffer;
-    boost::circular_buffer<unsigned char> w_buffer;
+    byte_buffer r_buffer;
+    byte_buffer w_buffer;
 
 };
 
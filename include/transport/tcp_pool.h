@@ -54,6 +54,9 @@ class tcp_pool {
     void add_client(const int fd);
     void add_client(const size_t loop_id, int fd);
 
+    /* Async. Connections accepted from listen_fd are owned by loop_id */
+    void add_listen_fd(const size_t loop_id, const int listen_fd);
+
     /* Sync. Must be used for the thread that owns loop_id */
     void add_client_sync(const size_t loop_id, int fd);
     void remove_client_sync(const size_t loop_id, int fd);
@@ -68,7 +71,9 @@ class tcp_pool {
   private:
     void async_hook(async_loop & loop);
     void add_fds(async_loop & loop);
+    void add_fd(async_loop & loop, const int fd);
     void socket_callback(async_fd & async);
+    void accept_callback(async_fd & async);
 
   private:
     typedef std::map<int, tcp_connection> conn_map_t;
@@ -76,6 +81,7 @@ class tcp_pool {
     async_thread_pool async_thread_pool_;
     std::vector<std::mutex> mutexes_;
     std::vector<std::queue<int>> new_fds_;
+    std::vector<std::queue<int>> new_listen_fds_;
     std::vector<conn_map_t> conn_maps_;
     tcp_create_conn_fn_t tcp_create_conn_fn_;
     tcp_ready_fn_t tcp_ready_fn_;
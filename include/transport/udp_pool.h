@@ -1,12 +1,27 @@
 #ifndef CAVALIERI_TRANSPORT_UDP_POOL_H
 #define CAVALIERI_TRANSPORT_UDP_POOL_H
 
+#include <memory>
 #include <vector>
 #include <pool/async_thread_pool.h>
 
 typedef std::vector<unsigned char> udp_buffer_t;
-typedef std::function<void(const udp_buffer_t &)> udp_read_fn_t;
+typedef std::function<void(udp_buffer_t)> udp_read_fn_t;
 
+/* Called from a loop thread after a read that dropped datagrams: truncated
+ * ones were larger than the max datagram size, overflowed ones were dropped
+ * by the kernel because the socket buffer was full.
+ */
+typedef std::function<void(const size_t truncated,
+                           const size_t overflowed)> udp_drop_fn_t;
+
+struct udp_batch;
+
+/* Every thread reads from its own socket bound to port, the kernel spreads
+ * the datagrams between them with SO_REUSEPORT. Datagrams are received in
+ * batches with recvmmsg() into buffers allocated when the thread starts,
+ * or taken from what the loop received when it does, see set_fd_recvmsg().
+ */
 class udp_pool {
   public:
     udp_pool(
@@ -14,6 +29,21 @@ class udp_pool {
         uint32_t port,
         udp_read_fn_t udp_ready_fn_t
     );
+    /* run_fn is called from each thread before its loop starts */
+    udp_pool(
+        size_t thread_num,
+        uint32_t port,
+        udp_read_fn_t udp_ready_fn_t,
+        hook_fn_t run_fn
+    );
+    udp_pool(
+        size_t thread_num,
+        uint32_t port,
+        size_t max_datagram_size,
+        udp_read_fn_t udp_ready_fn_t,
+        hook_fn_t run_fn,
+        udp_drop_fn_t drop_fn
+    );
     void start_threads();
     void stop_threads();
     virtual ~udp_pool();
@@ -25,7 +55,11 @@ class udp_pool {
   private:
     async_thread_pool async_thread_pool_;
     uint32_t port_;
+    size_t max_datagram_size_;
     udp_read_fn_t udp_read_fn_;
+    hook_fn_t run_fn_;
+    udp_drop_fn_t drop_fn_;
+    std::vector<std::unique_ptr<udp_batch>> batches_;
 };
 
 #endif
@@ -0,0 +1,20 @@
+#ifndef CAVALIERI_UTIL_PARSE_NUMBER_H
+#define CAVALIERI_UTIL_PARSE_NUMBER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* Number parsers for text protocols, they take the whole of [p, p + size)
+ * and need no terminating null.
+ */
+
+/* Decimal numbers with up to 19 significant digits and a small exponent
+ * are converted exactly with one multiplication or division, the rest is
+ * left to strtod().
+ */
+bool parse_double(const char * p, const size_t size, double & out);
+
+/* Returns false on overflow */
+bool parse_int64(const char * p, const size_t size, int64_t & out);
+
+#endif
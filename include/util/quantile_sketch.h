@@ -0,0 +1,59 @@
+#ifndef CAVALIERI_UTIL_QUANTILE_SKETCH_H
+#define CAVALIERI_UTIL_QUANTILE_SKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Mergeable quantile sketch with relative error.
+ *
+ * Values are counted in logarithmic buckets, each covering values within
+ * relative_accuracy of its estimate, so quantiles come out within that
+ * error of a value at the right rank whatever the distribution. Memory
+ * grows with the range of the values, not their number, and is capped at
+ * k_max_buckets per sign by merging the buckets closest to zero.
+ */
+class quantile_sketch {
+public:
+  static const size_t k_max_buckets = 2048;
+
+  explicit quantile_sketch(const double relative_accuracy = 0.01);
+
+  void add(const double value, const uint64_t count = 1);
+  /* Both sketches must have the same accuracy */
+  void merge(const quantile_sketch & other);
+
+  /* q in [0, 1]. Returns 0 when empty. */
+  double quantile(const double q) const;
+
+  uint64_t count() const;
+  double sum() const;
+  double min() const;
+  double max() const;
+  bool empty() const;
+  void clear();
+
+private:
+  struct store {
+    std::vector<uint64_t> counts;
+    int offset;
+
+    void add(int index, const uint64_t count);
+  };
+
+  int index(const double value) const;
+  double value(const int index) const;
+
+private:
+  double gamma_;
+  double log_gamma_;
+  store positive_;
+  store negative_;
+  uint64_t zero_count_;
+  uint64_t count_;
+  double sum_;
+  double min_;
+  double max_;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef CAVALIERI_UTIL_RCU_H
+#define CAVALIERI_UTIL_RCU_H
+
+/* Epoch based read-copy-update.
+ *
+ * Readers mark the section where they use shared data with rcu_read_lock()
+ * and rcu_read_unlock(). A writer unpublishes the data and then calls
+ * rcu_synchronize(), which waits until every reader that may have seen it
+ * has left its read section, so it can be freed.
+ *
+ * Each reader only writes to its own slot. When the kernel supports
+ * membarrier the writer issues the memory barrier on behalf of the readers
+ * and the read side needs no fence.
+ */
+
+void rcu_read_lock();
+
+void rcu_read_unlock();
+
+void rcu_synchronize();
+
+class rcu_read_guard {
+public:
+  rcu_read_guard() { rcu_read_lock(); }
+  ~rcu_read_guard() { rcu_read_unlock(); }
+  rcu_read_guard(const rcu_read_guard &) = delete;
+  rcu_read_guard & operator=(const rcu_read_guard &) = delete;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <functional>
 #include <vector>
 #include <list>
+#include <thread>
 #include <boost/variant.hpp>
 
 #define UNUSED_VAR(x) (void)x
@@ -71,5 +72,11 @@ void free_args(int argc, char **argv);
 
 void ld_environment(char **argv, const std::string dir);
 
+/* Pins thread to cpu modulo the number of cores */
+bool set_thread_affinity(std::thread & thread, const size_t cpu);
+
+/* Pins the calling thread */
+bool set_thread_affinity(const size_t cpu);
+
 #endif
 
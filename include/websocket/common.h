@@ -9,4 +9,9 @@ using event_filters_t = std::vector<std::function<void(const Event &)>>;
 
 const size_t k_max_ws_queue_size = 20E4;
 
+/* Events waiting to be filtered or sent are kept in rings whose slots are
+ * allocated upfront, so they are smaller than the per connection queues.
+ */
+const size_t k_ws_ring_size = 16384;
+
 #endif
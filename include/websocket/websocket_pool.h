@@ -2,8 +2,10 @@
 #define CAVALIERI_WEBSOCKET_WEBSOCKET_POOL_H
 
 #include <functional>
+#include <memory>
 #include <queue>
 #include <websocket/worker_pool.h>
+#include <pool/ring_buffer.h>
 #include <transport/tcp_pool.h>
 #include <transport/ws_connection.h>
 #include <pub_sub/pub_sub.h>
@@ -13,6 +15,8 @@ class websocket_pool {
 public:
   websocket_pool(size_t thread_num, pub_sub & pubsub, real_index & index);
   void add_client(const int fd);
+  /* Async. Connections accepted from fd are owned by loop_id */
+  void add_listen_fd(const size_t loop_id, const int fd);
   void stop();
 
 private:
@@ -32,7 +36,7 @@ private:
                       size_t token;
                     };
 
-  using event_queue_t = tbb::concurrent_bounded_queue<event_t>;
+  using event_queue_t = mpsc_ring<event_t>;
 
 private:
   void on_new_cnx(int fd, async_loop & loop, tcp_connection & cnx);
@@ -51,7 +55,7 @@ private:
   tcp_pool tcp_pool_;
   worker_pool worker_pool_;
   std::vector<std::unordered_map<int, fd_ctx_t>> fd_ctxes_;
-  std::vector<event_queue_t> event_queues_;
+  std::vector<std::unique_ptr<event_queue_t>> event_queues_;
 };
 
 #endif
@@ -1,12 +1,20 @@
 #ifndef CAVALIERI_WEBSOCKET_WORKER_POOL_H
 #define CAVALIERI_WEBSOCKET_WORKER_POOL_H
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
-#include <tbb/concurrent_queue.h>
+#include <vector>
+#include <pool/ring_buffer.h>
 #include <websocket/common.h>
 #include <websocket/worker_threads.h>
 
+/* Runs the websocket filters on the events added to the index. Each worker
+ * thread has its own queue, events are spread among them and a worker parks
+ * when its queue is empty.
+ */
 class worker_pool {
 public:
   worker_pool();
@@ -16,21 +24,32 @@ public:
   void stop();
 
 public:
-  using event_t = struct {
-    Event event;
-    bool stop;
-  };
-
-  using event_queue_t = tbb::concurrent_bounded_queue<event_t>;
+  using event_queue_t = mpsc_ring<Event>;
 
   using filters_map_t = std::unordered_map<size_t, event_filters_t>;
 
+private:
+  struct worker_t {
+    worker_t() : queue(k_ws_ring_size), parked(false) {}
+
+    event_queue_t queue;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<bool> parked;
+  };
+
+  void process_events(const size_t i);
+  void park(worker_t & worker);
+  void wake(worker_t & worker);
+
 private:
 
-  bool stop_, has_clients_;
+  std::atomic<bool> stop_;
+  bool has_clients_;
   filters_map_t filters_;
-  event_queue_t event_queue_;
   std::mutex mutex_;
+  std::atomic<size_t> next_worker_;
+  std::vector<std::unique_ptr<worker_t>> workers_;
   worker_threads worker_threads_;
 
 };
@@ -7,7 +7,7 @@
 
 class worker_threads {
 public:
-  using task_t = std::function<void()>;
+  using task_t = std::function<void(const size_t)>;
 
   worker_threads(const size_t threads, const task_t task);
   void stop();
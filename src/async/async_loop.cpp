@@ -0,0 +1,44 @@
+#include <glog/logging.h>
+#include <atomic>
+#include <async/async_loop.h>
+#include <os/os_functions.h>
+
+namespace {
+
+std::atomic<size_t> loop_spin_us(0);
+
+std::atomic<bool> loop_uring(false);
+
+}
+
+ssize_t async_fd::recv(void * buf, const size_t len) {
+  return g_os_functions.recv(fd(), buf, len, 0);
+}
+
+int async_fd::recvmmsg(struct mmsghdr * msgs, const unsigned vlen) {
+  return ::recvmmsg(fd(), msgs, vlen, MSG_DONTWAIT, NULL);
+}
+
+void set_async_loop_spin(const size_t spin_us) {
+  loop_spin_us = spin_us;
+}
+
+size_t async_loop_spin() {
+  return loop_spin_us;
+}
+
+void set_async_loop_backend(const std::string & backend) {
+
+  if (backend == "libev") {
+    loop_uring = false;
+  } else if (backend == "io_uring") {
+    loop_uring = true;
+  } else {
+    LOG(FATAL) << "unknown loop backend: " << backend;
+  }
+
+}
+
+bool async_loop_uring() {
+  return loop_uring;
+}
@@ -1,7 +1,9 @@
 #include <netinet/in.h>
 #include <glog/logging.h>
+#include <algorithm>
 #include <core/core.h>
 #include <async/real_async_loop.h>
+#include <async/uring_async_loop.h>
 
 namespace {
 
@@ -19,11 +21,15 @@ int ev_mode(const async_fd::mode & initial_mode) {
   return  mode;
 }
 
-unsigned long now() {
-   return  std::chrono::system_clock::now().time_since_epoch()
+uint64_t now() {
+   return  std::chrono::steady_clock::now().time_since_epoch()
            / std::chrono::milliseconds(1);
 }
 
+uint64_t to_ms(const float t) {
+  return t > 0 ? static_cast<uint64_t>(t * 1000) : 0;
+}
+
 };
 
 real_async_fd::real_async_fd(
@@ -60,6 +66,7 @@ void real_async_fd::stop() {
 
 void real_async_fd::async_cb(ev::io &, int revents) {
   VLOG(3) << "async_cb() events: " << revents;
+  async_loop_.add_activity();
   error_ = EV_ERROR & revents;
   if (error_)
     VLOG(3) << "EV_ERROR";
@@ -94,12 +101,20 @@ real_async_loop::real_async_loop()
   :
     async_loop(),
     stop_(false),
-    next_timer_id_(0)
+    pending_(false),
+    wakeups_sent_(0),
+    wakeups_skipped_(0),
+    activity_(0),
+    tasks_(now()),
+    next_timer_id_(0),
+    next_timer_ms_(0)
 {
   async_.set(loop_);
   async_.set<real_async_loop, &real_async_loop::async_callback>(this);
   timer_.set(loop_);
   timer_.set<real_async_loop, &real_async_loop::timer_callback>(this);
+  prepare_.set(loop_);
+  prepare_.set<real_async_loop, &real_async_loop::prepare_callback>(this);
 }
 
 void real_async_loop::set_id(size_t id) {
@@ -118,6 +133,8 @@ size_t real_async_loop::id() const {
 void real_async_loop::async_callback(ev::async&, int) {
   if (!stop_) {
     CHECK(async_cb_fn_)  << "async_cb_fn_ not set";
+    // Threads that add work from now on must signal again
+    pending_.exchange(false, std::memory_order_acq_rel);
     async_cb_fn_(*this);
   } else {
     loop_.unloop();
@@ -126,7 +143,59 @@ void real_async_loop::async_callback(ev::async&, int) {
 
 void real_async_loop::start() {
   async_.start();
-  loop_.run();
+
+  const size_t spin_us = async_loop_spin();
+
+  if (spin_us > 0) {
+    run_spinning(spin_us);
+  } else {
+    loop_.run();
+  }
+}
+
+/* While the loop polls, pending_ stays set so other threads don't signal it,
+ * and the async callback is run on every iteration instead.
+ */
+void real_async_loop::run_spinning(const size_t spin_us) {
+
+  CHECK(async_cb_fn_)  << "async_cb_fn_ not set";
+
+  const auto spin = std::chrono::microseconds(spin_us);
+  auto last_activity = std::chrono::steady_clock::now();
+
+  while (!stop_) {
+
+    pending_.store(true, std::memory_order_release);
+
+    const auto activity = activity_;
+
+    loop_.run(ev::NOWAIT);
+
+    if (stop_) {
+      break;
+    }
+
+    async_cb_fn_(*this);
+
+    const auto current_time = std::chrono::steady_clock::now();
+
+    if (activity_ != activity) {
+      last_activity = current_time;
+      continue;
+    }
+
+    if (current_time - last_activity < spin) {
+      continue;
+    }
+
+    // Sleep until there is an event, threads signal the loop again
+    pending_.exchange(false, std::memory_order_acq_rel);
+    async_cb_fn_(*this);
+
+    loop_.run(ev::ONCE);
+
+    last_activity = std::chrono::steady_clock::now();
+  }
 }
 
 void real_async_loop::stop() {
@@ -135,7 +204,24 @@ void real_async_loop::stop() {
 }
 
 void real_async_loop::signal() {
-  async_.send();
+  if (!pending_.exchange(true, std::memory_order_acq_rel)) {
+    wakeups_sent_.fetch_add(1, std::memory_order_relaxed);
+    async_.send();
+  } else {
+    wakeups_skipped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+uint64_t real_async_loop::wakeups_sent() const {
+  return wakeups_sent_.load(std::memory_order_relaxed);
+}
+
+uint64_t real_async_loop::wakeups_skipped() const {
+  return wakeups_skipped_.load(std::memory_order_relaxed);
+}
+
+void real_async_loop::add_activity() {
+  activity_++;
 }
 
 void real_async_loop::add_fd(const int fd, const async_fd::mode mode,
@@ -157,6 +243,26 @@ void real_async_loop::set_fd_mode(const int fd, const async_fd::mode mode) {
   it->second->set_mode(mode);
 }
 
+// libev only tells when the fds are readable
+bool real_async_loop::set_fd_recv(const int) {
+  return false;
+}
+
+bool real_async_loop::set_fd_recvmsg(const int, const size_t) {
+  return false;
+}
+
+void real_async_loop::set_iteration_fn(task_cb_fn_t fn) {
+  iteration_fn_ = fn;
+  prepare_.start();
+}
+
+void real_async_loop::prepare_callback(ev::prepare &, int) {
+  if (iteration_fn_) {
+    iteration_fn_();
+  }
+}
+
 ev::dynamic_loop & real_async_loop::loop() {
   return loop_;
 }
@@ -166,16 +272,17 @@ timer_id_t real_async_loop::add_task(const std::string lib_namespace,
                                      const bool once, const float t)
 {
   const auto timer_id = next_timer_id_++;
-  const unsigned long current_time = now();
-  const unsigned long t_ms = static_cast<unsigned long>(t * 1000);
-  const sched_task_t sched_task{lib_namespace,
-                                [=](){ task(id_); },
-                                {id_, timer_id},
-                                once ? 0 : t_ms,
-                                current_time + t_ms};
-  tasks_.push(sched_task);
+  const auto current_time = now();
+  const auto t_ms = to_ms(t);
+  const auto loop_id = id_;
 
-  sched_next_task();
+  tasks_.add(timer_id, lib_namespace, [=]() { task(loop_id); }, current_time,
+             t_ms, once ? 0 : std::max<uint64_t>(t_ms, 1));
+
+  // The timer only needs to be moved when the new task runs earlier
+  if (!timer_.is_active() || current_time + t_ms < next_timer_ms_) {
+    sched_next_task();
+  }
 
   return {id_, timer_id};
 }
@@ -189,8 +296,8 @@ void real_async_loop::sched_next_task() {
     return;
   }
 
-  unsigned long next_time = tasks_.top().time_ms;
-  unsigned long current_time = now();
+  const auto next_time = tasks_.next_expiration();
+  const auto current_time = now();
 
   VLOG(3) << "next_time: " <<  next_time << " current_time: " << current_time;
 
@@ -203,41 +310,18 @@ void real_async_loop::sched_next_task() {
 
   VLOG(3) << "next: " << next;
 
-  timer_.set<real_async_loop, &real_async_loop::timer_callback>(this);
+  next_timer_ms_ = next_time;
 
+  timer_.stop();
   timer_.start(next);
 }
 
 void real_async_loop::timer_callback(ev::timer &, int) {
   VLOG(3) << "timer_callback()";
 
-  while (!tasks_.empty()) {
-
-    auto task = tasks_.top();
-
-    if (task.time_ms > now()) {
-      break;
-    }
+  add_activity();
 
-    task.task();
-
-    // The task we just run may have removed itself
-    if (tasks_.empty()) {
-      continue;
-    }
-
-    if (tasks_.top().id.timer_id != task.id.timer_id) {
-      continue;
-    }
-
-    tasks_.pop();
-
-    if (task.interval_ms > 0) {
-      task.time_ms = now() + task.interval_ms;
-      tasks_.push(task);
-    }
-
-  }
+  tasks_.advance(now());
 
   sched_next_task();
 
@@ -261,62 +345,34 @@ timer_id_t real_async_loop::add_periodic_task(const std::string lib_namespace,
 
 }
 
-void real_async_loop::set_task_interval(const timer_id_t, const float t) {
-
-  // TODO
-  VLOG(3) << "set_task_interval() t: " << t;
-  return;
-
-}
-
-
-bool real_async_loop::remove_task(
-    const std::function<bool(const sched_task_t &)> & predicate)
+void real_async_loop::set_task_interval(const timer_id_t timer_id,
+                                        const float t)
 {
-  VLOG(3) << "remove_task()";
-
-  std::priority_queue<sched_task_t,
-                      std::vector<sched_task_t>,
-                      sched_task_cmp> new_tasks;
-
-  bool removed = false;
-  while (!tasks_.empty()) {
-    auto task = tasks_.top();
-    tasks_.pop();
+  VLOG(3) << "set_task_interval() t: " << t;
 
-    if (predicate(task)) {
-      removed = false;
-      continue;
-    }
+  const auto current_time = now();
 
-    new_tasks.push(task);
+  if (!tasks_.set_interval(timer_id.timer_id, current_time, to_ms(t))) {
+    return;
   }
 
-  tasks_ = new_tasks;
+  if (!timer_.is_active() || current_time + to_ms(t) < next_timer_ms_) {
+    sched_next_task();
+  }
 
-  return removed;
 }
 
 bool real_async_loop::remove_task(const timer_id_t timer_id) {
-  return remove_task(
-      [=](const sched_task_t & task)
-      {
-        return (task.id.timer_id == timer_id.timer_id);
-      }
-  );
+  VLOG(3) << "remove_task()";
+
+  return tasks_.remove(timer_id.timer_id);
 }
 
 void real_async_loop::remove_task_lib_namespace(const std::string lib_namespace)
 {
   VLOG(3) << "remove task for " << lib_namespace;
 
-  remove_task(
-      [=](const sched_task_t & task)
-      {
-        return (task.lib_namespace == lib_namespace);
-      }
-  );
-
+  tasks_.remove_ns(lib_namespace);
 }
 
 real_async_events::real_async_events(size_t num_loops, async_cb_fn_t cb_fn) :
@@ -352,6 +408,18 @@ async_loop & real_async_events::loop(const size_t loop_id) {
 std::unique_ptr<async_events_interface> make_async_events(size_t threads,
                                                           async_cb_fn_t cb)
 {
+  if (async_loop_uring()) {
+
+    std::unique_ptr<uring_async_events> events(
+        new uring_async_events(threads, cb));
+
+    if (events->init()) {
+      return std::move(events);
+    }
+
+    LOG(WARNING) << "io_uring is not available, falling back to libev";
+  }
+
   return std::move(std::unique_ptr<real_async_events>(
                     new real_async_events(threads, cb)));
 }
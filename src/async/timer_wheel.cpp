@@ -0,0 +1,331 @@
+#include <glog/logging.h>
+#include <algorithm>
+#include <vector>
+#include <async/timer_wheel.h>
+
+namespace {
+
+uint64_t level_shift(const size_t level) {
+  return 8 * level;
+}
+
+}
+
+timer_wheel::timer_wheel(const uint64_t now_ms)
+  :
+    now_ms_(now_ms),
+    levels_(),
+    entries_(),
+    namespaces_(),
+    running_(nullptr),
+    running_removed_(false)
+{
+  for (auto & level : levels_) {
+    level.slots.fill(nullptr);
+    level.used.fill(0);
+  }
+}
+
+timer_wheel::~timer_wheel() {
+  for (auto & kv : entries_) {
+    delete kv.second;
+  }
+}
+
+void timer_wheel::add(const uint64_t id, const std::string & ns,
+                      const timer_fn_t fn, const uint64_t now_ms,
+                      const uint64_t delay_ms, const uint64_t interval_ms)
+{
+  CHECK(entries_.find(id) == entries_.end()) << "duplicated timer id";
+
+  // Nothing to run in between, the wheel can jump forward
+  if (entries_.empty()) {
+    now_ms_ = std::max(now_ms_, now_ms);
+  }
+
+  auto entry = new entry_t{id, ns, fn, interval_ms,
+                           std::max(now_ms + delay_ms, now_ms_ + 1),
+                           0, 0, nullptr, nullptr};
+
+  entries_.insert({id, entry});
+  namespaces_[ns].insert(id);
+
+  insert(entry);
+}
+
+bool timer_wheel::set_interval(const uint64_t id, const uint64_t now_ms,
+                               const uint64_t interval_ms)
+{
+  auto it = entries_.find(id);
+
+  if (it == entries_.end()) {
+    return false;
+  }
+
+  auto entry = it->second;
+
+  entry->interval_ms = std::max<uint64_t>(interval_ms, 1);
+
+  // A running timer is added back by expire() with the new interval
+  if (entry == running_) {
+    return true;
+  }
+
+  unlink(entry);
+  entry->expires_ms = std::max(now_ms + entry->interval_ms, now_ms_ + 1);
+  insert(entry);
+
+  return true;
+}
+
+bool timer_wheel::remove(const uint64_t id) {
+
+  auto it = entries_.find(id);
+
+  if (it == entries_.end()) {
+    return false;
+  }
+
+  auto entry = it->second;
+
+  // It is erased by expire() once it returns
+  if (entry == running_) {
+    running_removed_ = true;
+    return true;
+  }
+
+  unlink(entry);
+  erase(entry);
+
+  return true;
+}
+
+size_t timer_wheel::remove_ns(const std::string & ns) {
+
+  auto it = namespaces_.find(ns);
+
+  if (it == namespaces_.end()) {
+    return 0;
+  }
+
+  const std::vector<uint64_t> ids(begin(it->second), end(it->second));
+
+  for (const auto id : ids) {
+    remove(id);
+  }
+
+  return ids.size();
+}
+
+void timer_wheel::advance(const uint64_t now_ms) {
+
+  while (now_ms_ < now_ms && !entries_.empty()) {
+
+    // Skip the ticks where there is nothing to run or move
+    now_ms_ = std::min(now_ms, next_expiration());
+
+    for (size_t level = k_levels - 1; level > 0; level--) {
+
+      const uint64_t mask = (uint64_t(1) << level_shift(level)) - 1;
+
+      if ((now_ms_ & mask) == 0) {
+        cascade(level);
+      }
+
+    }
+
+    expire(now_ms);
+  }
+
+  if (entries_.empty()) {
+    now_ms_ = std::max(now_ms_, now_ms);
+  }
+}
+
+uint64_t timer_wheel::next_expiration() const {
+
+  uint64_t next = UINT64_MAX;
+
+  for (size_t level = 0; level < k_levels; level++) {
+
+    const auto shift = level_shift(level);
+    const auto pos = now_ms_ >> shift;
+
+    size_t dist;
+
+    if (!next_used(level, pos & (k_slots - 1), dist)) {
+      continue;
+    }
+
+    // Timers of level 0 expire at their slot, the others move down a level
+    next = std::min(next, (pos + dist) << shift);
+  }
+
+  return next;
+}
+
+bool timer_wheel::empty() const {
+  return entries_.empty();
+}
+
+size_t timer_wheel::size() const {
+  return entries_.size();
+}
+
+void timer_wheel::insert(entry_t * entry) {
+
+  const uint64_t delta = entry->expires_ms > now_ms_
+                         ? entry->expires_ms - now_ms_
+                         : 0;
+
+  size_t level = 0;
+
+  while (level < k_levels - 1
+         && delta >= (uint64_t(1) << level_shift(level + 1)))
+  {
+    level++;
+  }
+
+  // Timers beyond the range of the wheel wait in the furthest slot
+  auto expires_ms = entry->expires_ms;
+  const uint64_t range = uint64_t(1) << level_shift(k_levels);
+
+  if (delta >= range) {
+    expires_ms = now_ms_ + range - 1;
+  }
+
+  const size_t slot = (expires_ms >> level_shift(level)) & (k_slots - 1);
+
+  auto & l = levels_[level];
+
+  entry->level = level;
+  entry->slot = slot;
+  entry->prev = nullptr;
+  entry->next = l.slots[slot];
+
+  if (entry->next) {
+    entry->next->prev = entry;
+  }
+
+  l.slots[slot] = entry;
+  l.used[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void timer_wheel::unlink(entry_t * entry) {
+
+  auto & l = levels_[entry->level];
+
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    l.slots[entry->slot] = entry->next;
+  }
+
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  }
+
+  if (!l.slots[entry->slot]) {
+    l.used[entry->slot / 64] &= ~(uint64_t(1) << (entry->slot % 64));
+  }
+
+  entry->prev = entry->next = nullptr;
+}
+
+void timer_wheel::erase(entry_t * entry) {
+
+  auto it = namespaces_.find(entry->ns);
+
+  it->second.erase(entry->id);
+
+  if (it->second.empty()) {
+    namespaces_.erase(it);
+  }
+
+  entries_.erase(entry->id);
+
+  delete entry;
+}
+
+void timer_wheel::cascade(const size_t level) {
+
+  auto & l = levels_[level];
+  const size_t slot = (now_ms_ >> level_shift(level)) & (k_slots - 1);
+
+  auto entry = l.slots[slot];
+
+  l.slots[slot] = nullptr;
+  l.used[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+
+  while (entry) {
+    auto next = entry->next;
+    insert(entry);
+    entry = next;
+  }
+}
+
+void timer_wheel::expire(const uint64_t now_ms) {
+
+  auto & l = levels_[0];
+  const size_t slot = now_ms_ & (k_slots - 1);
+
+  while (auto entry = l.slots[slot]) {
+
+    unlink(entry);
+
+    running_ = entry;
+    running_removed_ = false;
+
+    entry->fn();
+
+    running_ = nullptr;
+
+    if (running_removed_ || entry->interval_ms == 0) {
+      erase(entry);
+      continue;
+    }
+
+    entry->expires_ms = std::max(now_ms, now_ms_) + entry->interval_ms;
+    insert(entry);
+  }
+}
+
+bool timer_wheel::next_used(const size_t level, const size_t from,
+                            size_t & dist) const
+{
+  size_t slot;
+
+  if (find_used(level, from + 1, k_slots, slot)) {
+    dist = slot - from;
+    return true;
+  }
+
+  // Level 0 slots are at most 255 ms away, the current one is empty
+  if (find_used(level, 0, level == 0 ? from : from + 1, slot)) {
+    dist = slot + k_slots - from;
+    return true;
+  }
+
+  return false;
+}
+
+bool timer_wheel::find_used(const size_t level, const size_t begin,
+                            const size_t end, size_t & slot) const
+{
+  const auto & used = levels_[level].used;
+
+  for (size_t i = begin; i < end; ) {
+
+    const size_t word = i / 64;
+    const uint64_t bits = used[word] >> (i % 64);
+
+    if (bits) {
+      slot = i + __builtin_ctzll(bits);
+      return slot < end;
+    }
+
+    i = (word + 1) * 64;
+  }
+
+  return false;
+}
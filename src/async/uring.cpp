@@ -0,0 +1,292 @@
+#include <glog/logging.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <async/uring.h>
+
+namespace {
+
+const unsigned k_cq_factor = 8;
+
+const uint32_t k_required_features = IORING_FEAT_SINGLE_MMAP
+                                     | IORING_FEAT_NODROP
+                                     | IORING_FEAT_EXT_ARG;
+
+int io_uring_setup(const unsigned entries, struct io_uring_params * params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int io_uring_enter(const int fd, const unsigned to_submit,
+                   const unsigned min_complete, const unsigned flags,
+                   void * arg, const size_t arg_size)
+{
+  return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                 arg, arg_size);
+}
+
+}
+
+uring::uring()
+  :
+    fd_(-1),
+    ring_(MAP_FAILED),
+    ring_size_(0),
+    sqes_(static_cast<struct io_uring_sqe *>(MAP_FAILED)),
+    sqes_size_(0),
+    sq_tail_(nullptr),
+    sq_array_(nullptr),
+    sq_mask_(0),
+    sq_entries_(0),
+    cq_head_(nullptr),
+    cq_tail_(nullptr),
+    cq_mask_(0),
+    cqes_(nullptr),
+    queued_(0),
+    deferred_()
+{
+}
+
+uring::~uring() {
+
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_size_);
+  }
+
+  if (ring_ != MAP_FAILED) {
+    munmap(ring_, ring_size_);
+  }
+
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool uring::init(const unsigned entries) {
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * k_cq_factor;
+
+  fd_ = io_uring_setup(entries, &params);
+
+  if (fd_ < 0) {
+    VLOG(1) << "io_uring_setup: " << strerror(errno);
+    return false;
+  }
+
+  if ((params.features & k_required_features) != k_required_features) {
+    VLOG(1) << "io_uring lacks features, has: " << params.features;
+    return false;
+  }
+
+  // Both rings share one mapping with IORING_FEAT_SINGLE_MMAP
+  ring_size_ = std::max(
+      params.sq_off.array + params.sq_entries * sizeof(unsigned),
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+
+  ring_ = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+
+  if (ring_ == MAP_FAILED) {
+    LOG(ERROR) << "failed to map io_uring: " << strerror(errno);
+    return false;
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  sqes_ = static_cast<struct io_uring_sqe *>(
+      mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+
+  if (sqes_ == MAP_FAILED) {
+    LOG(ERROR) << "failed to map io_uring sqes: " << strerror(errno);
+    return false;
+  }
+
+  auto ring = static_cast<char *>(ring_);
+
+  sq_tail_ = reinterpret_cast<unsigned *>(ring + params.sq_off.tail);
+  sq_array_ = reinterpret_cast<unsigned *>(ring + params.sq_off.array);
+  sq_mask_ = *reinterpret_cast<unsigned *>(ring + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+
+  cq_head_ = reinterpret_cast<unsigned *>(ring + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(ring + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned *>(ring + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe *>(ring + params.cq_off.cqes);
+
+  return true;
+}
+
+struct io_uring_sqe * uring::get_sqe() {
+
+  // submit() leaves the entries queued on EBUSY
+  while (queued_ == sq_entries_) {
+
+    submit(0, 0);
+
+    if (queued_ == sq_entries_) {
+      VLOG(3) << "io_uring submission queue is full";
+      defer_cqes();
+    }
+  }
+
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & sq_mask_;
+
+  auto sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+  queued_++;
+
+  return sqe;
+}
+
+/* The deferred completions go first, they are older */
+bool uring::next_cqe(struct io_uring_cqe & cqe) {
+
+  if (!deferred_.empty()) {
+    cqe = deferred_.front();
+    deferred_.pop_front();
+    return true;
+  }
+
+  const unsigned head = *cq_head_;
+
+  if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+
+  cqe = cqes_[head & cq_mask_];
+
+  __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+/* Frees the completion queue so the kernel can post what it holds back */
+void uring::defer_cqes() {
+
+  unsigned head = *cq_head_;
+  const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+  for (; head != tail; head++) {
+    deferred_.push_back(cqes_[head & cq_mask_]);
+  }
+
+  __atomic_store_n(cq_head_, tail, __ATOMIC_RELEASE);
+}
+
+void uring::submit(const unsigned min_complete, const int64_t timeout_ms) {
+
+  // The completions moved aside are ready to be reaped
+  const unsigned wait = deferred_.empty() ? min_complete : 0;
+
+  if (queued_ == 0 && wait == 0) {
+    return;
+  }
+
+  unsigned flags = 0;
+
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+
+  if (wait > 0) {
+
+    flags |= IORING_ENTER_GETEVENTS;
+
+    if (timeout_ms >= 0) {
+      ts.tv_sec = timeout_ms / 1000;
+      ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+      arg.ts = reinterpret_cast<uint64_t>(&ts);
+      flags |= IORING_ENTER_EXT_ARG;
+    }
+
+  }
+
+  const int ret = io_uring_enter(fd_, queued_, wait, flags,
+                                 flags & IORING_ENTER_EXT_ARG ? &arg : nullptr,
+                                 sizeof(arg));
+
+  if (ret >= 0) {
+    queued_ -= std::min<unsigned>(ret, queued_);
+    return;
+  }
+
+  // Nothing was submitted when the wait times out or is interrupted, and
+  // when the completion queue is full
+  if (errno == ETIME || errno == EINTR || errno == EBUSY || errno == EAGAIN) {
+    return;
+  }
+
+  LOG(FATAL) << "io_uring_enter: " << strerror(errno);
+}
+
+uring_buffers::uring_buffers(const uint16_t group, const unsigned count,
+                             const size_t size)
+  :
+    group_(group),
+    size_(size),
+    buffers_(count * size),
+    provided_()
+{
+  for (unsigned i = 0; i < count; i++) {
+    provided_.push_back(i);
+  }
+}
+
+uint16_t uring_buffers::group() const {
+  return group_;
+}
+
+size_t uring_buffers::size() const {
+  return size_;
+}
+
+unsigned char * uring_buffers::buffer(const uint16_t id) {
+  return &buffers_[id * size_];
+}
+
+void uring_buffers::provide(const uint16_t id) {
+  provided_.push_back(id);
+}
+
+void uring_buffers::flush(uring & ring, const uint64_t user_data) {
+
+  // Buffers are mostly taken, and so given back, in order
+  std::sort(provided_.begin(), provided_.end());
+
+  for (size_t i = 0; i < provided_.size();) {
+
+    size_t n = 1;
+
+    while (i + n < provided_.size()
+           && provided_[i + n] == provided_[i] + n) {
+      n++;
+    }
+
+    auto sqe = ring.get_sqe();
+
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = n;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer(provided_[i]));
+    sqe->len = size_;
+    sqe->off = provided_[i];
+    sqe->buf_group = group_;
+    sqe->user_data = user_data;
+
+    i += n;
+  }
+
+  provided_.clear();
+}
@@ -0,0 +1,931 @@
+#include <glog/logging.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <async/uring_async_loop.h>
+
+namespace {
+
+const unsigned k_ring_entries = 256;
+
+// Poll ids carry a generation in the high bits, so they never take these
+const uint64_t k_wakeup_id = 1;
+const uint64_t k_ignore_id = 2;
+const uint64_t k_provide_id = 3;
+
+// Buffers received into, 4 MB for each loop that has fds set to receive
+const uint16_t k_recv_group = 0;
+const unsigned k_recv_buffers = 256;
+const size_t k_recv_buffer_size = 16384;
+// Room for the control messages in front of each datagram
+const size_t k_recv_control_size = 64;
+
+bool has_read(const async_fd::mode & mode) {
+  return mode == async_fd::read || mode == async_fd::readwrite;
+}
+
+uint32_t poll_mask(const async_fd::mode & mode) {
+  switch (mode) {
+    case async_fd::read:
+      return POLLIN;
+    case async_fd::write:
+      return POLLOUT;
+    case async_fd::readwrite:
+      return POLLIN | POLLOUT;
+    default:
+      return 0;
+  }
+}
+
+uint64_t now() {
+   return  std::chrono::steady_clock::now().time_since_epoch()
+           / std::chrono::milliseconds(1);
+}
+
+uint64_t to_ms(const float t) {
+  return t > 0 ? static_cast<uint64_t>(t * 1000) : 0;
+}
+
+}
+
+uring_async_fd::uring_async_fd(
+    int fd,
+    async_fd::mode initial_mode,
+    uring_async_loop & loop,
+    fd_cb_fn_t cb
+) :
+  async_fd(),
+  async_loop_(loop),
+  fd_(fd),
+  error_(false),
+  read_(false),
+  write_(false),
+  mode_(initial_mode),
+  poll_id_(0),
+  poll_mask_(0),
+  recv_(false),
+  recv_msg_(false),
+  recv_id_(0),
+  recv_cancelled_(false),
+  recv_starved_(false),
+  recv_eof_(false),
+  recv_errno_(0),
+  recv_queued_(false),
+  received_(),
+  fd_cb_fn_(cb)
+{
+}
+
+uring_async_fd::~uring_async_fd() {
+  VLOG(3) << "~uring_async_fd() " << fd_;
+  close(fd_);
+}
+
+int uring_async_fd::fd() const {
+  return fd_;
+}
+
+bool uring_async_fd::error() const {
+  return error_;
+}
+
+void uring_async_fd::stop() {
+  async_loop_.remove_fd(fd_);
+}
+
+bool uring_async_fd::ready_read() const {
+  return read_;
+}
+
+bool uring_async_fd::ready_write() const {
+  return write_;
+}
+
+void uring_async_fd::set_mode(const async_fd::mode& mode) {
+  async_loop_.set_fd_mode(fd_, mode);
+}
+
+async_loop& uring_async_fd::loop() {
+  return async_loop_;
+}
+
+ssize_t uring_async_fd::recv(void * buf, const size_t len) {
+
+  if (!recv_) {
+    return async_fd::recv(buf, len);
+  }
+
+  return async_loop_.take(*this, buf, len);
+}
+
+int uring_async_fd::recvmmsg(struct mmsghdr * msgs, const unsigned vlen) {
+
+  if (!recv_) {
+    return async_fd::recvmmsg(msgs, vlen);
+  }
+
+  return async_loop_.take_msgs(*this, msgs, vlen);
+}
+
+bool uring_async_fd::pending_recv() const {
+  return !received_.empty() || recv_eof_ || recv_errno_;
+}
+
+uring_async_loop::uring_async_loop()
+  :
+    async_loop(),
+    stop_(false),
+    pending_(false),
+    wakeups_sent_(0),
+    wakeups_skipped_(0),
+    activity_(0),
+    id_(0),
+    buffers_(),
+    buffers_provided_(false),
+    ring_(),
+    recv_msghdr_(),
+    recv_fds_(),
+    starved_fds_(),
+    event_fd_(-1),
+    event_buffer_(0),
+    next_poll_generation_(1),
+    tasks_(now()),
+    next_timer_id_(0)
+{
+  recv_msghdr_.msg_controllen = k_recv_control_size;
+}
+
+uring_async_loop::~uring_async_loop() {
+
+  // The fds are closed before the ring goes away and cancels their polls
+  fds_.clear();
+
+  if (event_fd_ >= 0) {
+    close(event_fd_);
+  }
+}
+
+bool uring_async_loop::init() {
+
+  event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  if (event_fd_ < 0) {
+    LOG(ERROR) << "eventfd: " << strerror(errno);
+    return false;
+  }
+
+  return ring_.init(k_ring_entries);
+}
+
+void uring_async_loop::set_id(size_t id) {
+  id_ = id;
+}
+
+void uring_async_loop::set_async_cb(async_cb_fn_t async_cb) {
+  async_cb_fn_ = async_cb;
+}
+
+size_t uring_async_loop::id() const {
+  return id_;
+}
+
+/* Same as real_async_loop::run_spinning() when loop_spin_us is set: while
+ * the loop polls, pending_ stays set and the async callback runs on every
+ * iteration.
+ */
+void uring_async_loop::start() {
+
+  CHECK(async_cb_fn_)  << "async_cb_fn_ not set";
+
+  arm_wakeup();
+
+  const auto spin = std::chrono::microseconds(async_loop_spin());
+  auto last_activity = std::chrono::steady_clock::now();
+
+  while (!stop_) {
+
+    if (iteration_fn_) {
+      iteration_fn_();
+    }
+
+    bool spinning = false;
+
+    if (spin.count() > 0) {
+
+      if (std::chrono::steady_clock::now() - last_activity < spin) {
+        spinning = true;
+        pending_.store(true, std::memory_order_release);
+      } else {
+        // Sleep until there is an event, threads signal the loop again
+        pending_.exchange(false, std::memory_order_acq_rel);
+        async_cb_fn_(*this);
+      }
+
+    }
+
+    const auto activity = activity_;
+
+    // Callbacks that left something received run again without waiting
+    const bool poll = spinning || !recv_fds_.empty();
+
+    flush_buffers();
+
+    ring_.submit(poll ? 0 : 1, poll ? 0 : wait_ms());
+    ring_.reap([this](const struct io_uring_cqe & cqe) { complete(cqe); });
+
+    run_recv();
+    run_tasks();
+
+    if (stop_) {
+      break;
+    }
+
+    if (spinning) {
+      async_cb_fn_(*this);
+    }
+
+    if (!spinning || activity_ != activity) {
+      last_activity = std::chrono::steady_clock::now();
+    }
+  }
+}
+
+void uring_async_loop::stop() {
+  stop_ = true;
+  eventfd_write(event_fd_, 1);
+}
+
+void uring_async_loop::signal() {
+  if (!pending_.exchange(true, std::memory_order_acq_rel)) {
+    wakeups_sent_.fetch_add(1, std::memory_order_relaxed);
+    eventfd_write(event_fd_, 1);
+  } else {
+    wakeups_skipped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+uint64_t uring_async_loop::wakeups_sent() const {
+  return wakeups_sent_.load(std::memory_order_relaxed);
+}
+
+uint64_t uring_async_loop::wakeups_skipped() const {
+  return wakeups_skipped_.load(std::memory_order_relaxed);
+}
+
+void uring_async_loop::add_fd(const int fd, const async_fd::mode mode,
+                              fd_cb_fn_t fd_cb_fn)
+{
+  auto it = fds_.insert(
+      {fd, std::make_shared<uring_async_fd>(fd, mode, *this, fd_cb_fn)});
+
+  update_poll(*it.first->second);
+}
+
+void uring_async_loop::remove_fd(const int fd)
+{
+  auto it = fds_.find(fd);
+
+  if (it == fds_.end()) {
+    return;
+  }
+
+  it->second->mode_ = async_fd::none;
+  update_poll(*it->second);
+
+  for (const auto & received : it->second->received_) {
+    provide(received.buffer);
+  }
+
+  fds_.erase(it);
+}
+
+void uring_async_loop::set_fd_mode(const int fd, const async_fd::mode mode) {
+  auto it = fds_.find(fd);
+  it->second->mode_ = mode;
+  update_poll(*it->second);
+
+  if (it->second->pending_recv()) {
+    queue_recv(*it->second);
+  }
+}
+
+bool uring_async_loop::set_fd_recv(const int fd) {
+  return set_recv(fd, false);
+}
+
+bool uring_async_loop::set_fd_recvmsg(const int fd, const size_t max_size) {
+
+  const size_t header = sizeof(struct io_uring_recvmsg_out)
+                        + k_recv_control_size;
+
+  if (max_size + header > k_recv_buffer_size) {
+    VLOG(1) << "datagrams of " << max_size << " bytes are polled";
+    return false;
+  }
+
+  return set_recv(fd, true);
+}
+
+bool uring_async_loop::set_recv(const int fd, const bool msg) {
+
+  auto it = fds_.find(fd);
+
+  if (it == fds_.end()) {
+    return false;
+  }
+
+  if (!buffers_) {
+    buffers_.reset(new uring_buffers(k_recv_group, k_recv_buffers,
+                                     k_recv_buffer_size));
+    flush_buffers();
+  }
+
+  it->second->recv_ = true;
+  it->second->recv_msg_ = msg;
+
+  update_poll(*it->second);
+
+  return true;
+}
+
+void uring_async_loop::set_iteration_fn(task_cb_fn_t fn) {
+  iteration_fn_ = fn;
+}
+
+/* Queues the poll for the current mode of the fd, cancelling the one in
+ * flight when it waits for other events.
+ */
+void uring_async_loop::update_poll(uring_async_fd & async_fd) {
+
+  update_recv(async_fd);
+
+  uint32_t mask = poll_mask(async_fd.mode_);
+
+  // The receive tells when there is something to read
+  if (async_fd.recv_) {
+    mask &= ~POLLIN;
+  }
+
+  if (async_fd.poll_id_ && async_fd.poll_mask_ == mask) {
+    return;
+  }
+
+  if (async_fd.poll_id_) {
+
+    auto sqe = ring_.get_sqe();
+
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = async_fd.poll_id_;
+    sqe->user_data = k_ignore_id;
+
+    async_fd.poll_id_ = 0;
+  }
+
+  if (!mask) {
+    return;
+  }
+
+  const uint64_t poll_id = next_id(async_fd.fd_);
+
+  auto sqe = ring_.get_sqe();
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = async_fd.fd_;
+  sqe->poll32_events = mask;
+  sqe->user_data = poll_id;
+
+  async_fd.poll_id_ = poll_id;
+  async_fd.poll_mask_ = mask;
+}
+
+/* Arms the multishot receive while the mode has read, and cancels it
+ * otherwise. The completions it made before the cancel still count, and the
+ * next one is not armed until its last completion, so what is received
+ * stays in order.
+ */
+void uring_async_loop::update_recv(uring_async_fd & async_fd) {
+
+  if (!async_fd.recv_) {
+    return;
+  }
+
+  const bool recv = has_read(async_fd.mode_) && !async_fd.recv_eof_
+                    && !async_fd.recv_errno_ && !async_fd.recv_starved_;
+
+  if (async_fd.recv_id_) {
+
+    if (!recv && !async_fd.recv_cancelled_) {
+
+      auto sqe = ring_.get_sqe();
+
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = -1;
+      sqe->addr = async_fd.recv_id_;
+      sqe->user_data = k_ignore_id;
+
+      async_fd.recv_cancelled_ = true;
+    }
+
+    return;
+  }
+
+  if (!recv) {
+    return;
+  }
+
+  const uint64_t recv_id = next_id(async_fd.fd_);
+
+  auto sqe = ring_.get_sqe();
+
+  if (async_fd.recv_msg_) {
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->addr = reinterpret_cast<uint64_t>(&recv_msghdr_);
+    sqe->len = 1;
+  } else {
+    sqe->opcode = IORING_OP_RECV;
+  }
+
+  sqe->fd = async_fd.fd_;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = buffers_->group();
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->user_data = recv_id;
+
+  async_fd.recv_id_ = recv_id;
+  async_fd.recv_cancelled_ = false;
+}
+
+uint64_t uring_async_loop::next_id(const int fd) {
+
+  if (next_poll_generation_ == 0) {
+    next_poll_generation_ = 1;
+  }
+
+  return (uint64_t(next_poll_generation_++) << 32) | uint32_t(fd);
+}
+
+void uring_async_loop::arm_wakeup() {
+
+  auto sqe = ring_.get_sqe();
+
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = event_fd_;
+  sqe->addr = reinterpret_cast<uint64_t>(&event_buffer_);
+  sqe->len = sizeof(event_buffer_);
+  sqe->user_data = k_wakeup_id;
+}
+
+void uring_async_loop::complete(const struct io_uring_cqe & cqe) {
+
+  if (cqe.user_data == k_wakeup_id) {
+    wakeup();
+    return;
+  }
+
+  if (cqe.user_data == k_ignore_id) {
+    return;
+  }
+
+  if (cqe.user_data == k_provide_id) {
+    if (cqe.res < 0) {
+      LOG(ERROR) << "failed to provide buffers: " << strerror(-cqe.res);
+    }
+    return;
+  }
+
+  auto it = fds_.find(static_cast<int>(cqe.user_data & 0xffffffff));
+
+  if (it != fds_.end() && it->second->poll_id_ == cqe.user_data) {
+    poll_ready(it->second, cqe.res);
+  } else if (it != fds_.end() && it->second->recv_id_ == cqe.user_data) {
+    received(*it->second, cqe);
+  } else if (cqe.flags & IORING_CQE_F_BUFFER) {
+    // What was received for an fd that is gone
+    provide(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+  }
+
+}
+
+/* Takes the fd by value to keep it alive in case the callback removes it */
+void uring_async_loop::poll_ready(std::shared_ptr<uring_async_fd> async_fd,
+                                  const int res)
+{
+  const int fd = async_fd->fd_;
+
+  async_fd->poll_id_ = 0;
+
+  if (res < 0) {
+
+    VLOG(3) << "poll error: " << strerror(-res);
+
+    async_fd->error_ = true;
+    async_fd->read_ = false;
+    async_fd->write_ = false;
+
+  } else {
+
+    const uint32_t mask = async_fd->poll_mask_;
+    const bool hup = res & (POLLERR | POLLHUP);
+
+    async_fd->error_ = false;
+    async_fd->read_ = (res & POLLIN) || (hup && (mask & POLLIN));
+    async_fd->write_ = (res & POLLOUT) || (hup && (mask & POLLOUT));
+
+  }
+
+  activity_++;
+
+  async_fd->fd_cb_fn_(*async_fd);
+
+  // Like libev, the fd is not polled again after an error until its mode
+  // is set
+  if (async_fd->error_) {
+    return;
+  }
+
+  auto it = fds_.find(fd);
+
+  if (it != fds_.end() && it->second == async_fd) {
+    update_poll(*async_fd);
+  }
+}
+
+void uring_async_loop::received(uring_async_fd & async_fd,
+                                const struct io_uring_cqe & cqe)
+{
+  const int res = cqe.res;
+
+  activity_++;
+
+  if (cqe.flags & IORING_CQE_F_BUFFER) {
+
+    const uint16_t buffer = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+
+    if (res > 0) {
+      async_fd.received_.push_back({buffer, 0, static_cast<uint32_t>(res)});
+    } else {
+      provide(buffer);
+    }
+
+  } else if (res == 0) {
+
+    async_fd.recv_eof_ = true;
+
+  } else if (res == -ENOBUFS) {
+
+    // Armed again once callbacks hand buffers back
+    async_fd.recv_starved_ = true;
+    starved_fds_.push_back(async_fd.fd_);
+
+  } else if ((res == -EINVAL || res == -EOPNOTSUPP)
+             && async_fd.received_.empty()) {
+
+    VLOG(1) << "io_uring lacks multishot receives, polling instead";
+    async_fd.recv_ = false;
+
+  } else if (res != -ECANCELED) {
+
+    async_fd.recv_errno_ = -res;
+
+  }
+
+  if (!(cqe.flags & IORING_CQE_F_MORE)) {
+    async_fd.recv_id_ = 0;
+    async_fd.recv_cancelled_ = false;
+    update_poll(async_fd);
+  }
+
+  if (async_fd.pending_recv()) {
+    queue_recv(async_fd);
+  }
+}
+
+void uring_async_loop::queue_recv(uring_async_fd & async_fd) {
+
+  if (async_fd.recv_queued_ || !has_read(async_fd.mode_)) {
+    return;
+  }
+
+  async_fd.recv_queued_ = true;
+  recv_fds_.push_back(async_fd.fd_);
+}
+
+/* Runs the callbacks of the fds that received something, and arms the
+ * receives that ran out of buffers once the callbacks hand some back.
+ */
+void uring_async_loop::run_recv() {
+
+  std::vector<int> fds;
+  fds.swap(recv_fds_);
+
+  for (const auto fd : fds) {
+
+    auto it = fds_.find(fd);
+
+    if (it == fds_.end()) {
+      continue;
+    }
+
+    // Keep it alive in case the callback removes it
+    auto async_fd = it->second;
+
+    async_fd->recv_queued_ = false;
+
+    if (!async_fd->pending_recv() || !has_read(async_fd->mode_)) {
+      continue;
+    }
+
+    async_fd->error_ = false;
+    async_fd->read_ = true;
+    async_fd->write_ = false;
+
+    activity_++;
+
+    async_fd->fd_cb_fn_(*async_fd);
+
+    it = fds_.find(fd);
+
+    if (it != fds_.end() && it->second == async_fd
+        && async_fd->pending_recv())
+    {
+      queue_recv(*async_fd);
+    }
+  }
+
+  if (!buffers_provided_ || starved_fds_.empty()) {
+    return;
+  }
+
+  buffers_provided_ = false;
+
+  // Ahead of the receives
+  flush_buffers();
+
+  std::vector<int> starved;
+  starved.swap(starved_fds_);
+
+  for (const auto fd : starved) {
+
+    auto it = fds_.find(fd);
+
+    if (it != fds_.end() && it->second->recv_starved_) {
+      it->second->recv_starved_ = false;
+      update_poll(*it->second);
+    }
+  }
+}
+
+void uring_async_loop::provide(const uint16_t buffer) {
+  buffers_->provide(buffer);
+  buffers_provided_ = true;
+}
+
+void uring_async_loop::flush_buffers() {
+  if (buffers_) {
+    buffers_->flush(ring_, k_provide_id);
+  }
+}
+
+ssize_t uring_async_loop::take(uring_async_fd & async_fd, void * buf,
+                               const size_t len)
+{
+  auto dst = static_cast<unsigned char *>(buf);
+  size_t n = 0;
+
+  while (n < len && !async_fd.received_.empty()) {
+
+    auto & received = async_fd.received_.front();
+
+    const size_t bytes = std::min<size_t>(len - n, received.len);
+
+    memcpy(dst + n, buffers_->buffer(received.buffer) + received.offset,
+           bytes);
+
+    n += bytes;
+    received.offset += bytes;
+    received.len -= bytes;
+
+    if (received.len == 0) {
+      provide(received.buffer);
+      async_fd.received_.pop_front();
+    }
+  }
+
+  if (n > 0) {
+    return n;
+  }
+
+  if (async_fd.recv_errno_) {
+    errno = async_fd.recv_errno_;
+    return -1;
+  }
+
+  if (async_fd.recv_eof_) {
+    return 0;
+  }
+
+  errno = EAGAIN;
+  return -1;
+}
+
+/* Each buffer has a datagram, after its io_uring_recvmsg_out and the
+ * room for the name and control messages that recv_msghdr_ asks for.
+ */
+int uring_async_loop::take_msgs(uring_async_fd & async_fd,
+                                struct mmsghdr * msgs, const unsigned vlen)
+{
+  const size_t control_offset = sizeof(struct io_uring_recvmsg_out)
+                                + recv_msghdr_.msg_namelen;
+  const size_t header = control_offset + recv_msghdr_.msg_controllen;
+
+  unsigned n = 0;
+
+  while (n < vlen && !async_fd.received_.empty()) {
+
+    const auto received = async_fd.received_.front();
+    async_fd.received_.pop_front();
+
+    const unsigned char * data = buffers_->buffer(received.buffer);
+
+    struct io_uring_recvmsg_out out;
+    memcpy(&out, data, sizeof(out));
+
+    auto & hdr = msgs[n].msg_hdr;
+
+    const size_t control = std::min<size_t>(out.controllen,
+                                            hdr.msg_controllen);
+
+    if (control > 0) {
+      memcpy(hdr.msg_control, data + control_offset, control);
+    }
+
+    hdr.msg_controllen = control;
+
+    const size_t payload = received.len > header ? received.len - header : 0;
+    const size_t bytes = std::min<size_t>(payload, hdr.msg_iov->iov_len);
+
+    memcpy(hdr.msg_iov->iov_base, data + header, bytes);
+
+    hdr.msg_flags = out.flags;
+
+    if (out.payloadlen > bytes) {
+      hdr.msg_flags |= MSG_TRUNC;
+    }
+
+    msgs[n].msg_len = bytes;
+
+    provide(received.buffer);
+    n++;
+  }
+
+  if (n > 0) {
+    return n;
+  }
+
+  errno = async_fd.recv_errno_ ? async_fd.recv_errno_ : EAGAIN;
+  return -1;
+}
+
+void uring_async_loop::wakeup() {
+
+  arm_wakeup();
+
+  if (stop_) {
+    return;
+  }
+
+  // Threads that add work from now on must signal again
+  pending_.exchange(false, std::memory_order_acq_rel);
+  async_cb_fn_(*this);
+}
+
+int64_t uring_async_loop::wait_ms() const {
+
+  if (tasks_.empty()) {
+    return -1;
+  }
+
+  const auto next_time = tasks_.next_expiration();
+  const auto current_time = now();
+
+  return next_time > current_time ? next_time - current_time : 0;
+}
+
+void uring_async_loop::run_tasks() {
+
+  if (tasks_.empty()) {
+    return;
+  }
+
+  const auto current_time = now();
+
+  if (current_time < tasks_.next_expiration()) {
+    return;
+  }
+
+  activity_++;
+
+  tasks_.advance(current_time);
+}
+
+timer_id_t uring_async_loop::add_task(const std::string lib_namespace,
+                                      const timer_cb_fn_t task,
+                                      const bool once, const float t)
+{
+  const auto timer_id = next_timer_id_++;
+  const auto t_ms = to_ms(t);
+  const auto loop_id = id_;
+
+  // The loop works out how long to wait before each wait
+  tasks_.add(timer_id, lib_namespace, [=]() { task(loop_id); }, now(),
+             t_ms, once ? 0 : std::max<uint64_t>(t_ms, 1));
+
+  return {id_, timer_id};
+}
+
+timer_id_t uring_async_loop::add_once_task(const std::string lib_namespace,
+                                           const timer_cb_fn_t task,
+                                           const float t) {
+  VLOG(3) << "add_once_task() t: " << t;
+
+  return add_task(lib_namespace, task, true, t);
+
+}
+
+timer_id_t uring_async_loop::add_periodic_task(const std::string lib_namespace,
+                                               const timer_cb_fn_t task,
+                                               const float t) {
+  VLOG(3) << "add_periodic_task() t: " << t;
+
+  return add_task(lib_namespace, task, false, t);
+
+}
+
+void uring_async_loop::set_task_interval(const timer_id_t timer_id,
+                                         const float t)
+{
+  VLOG(3) << "set_task_interval() t: " << t;
+
+  tasks_.set_interval(timer_id.timer_id, now(), to_ms(t));
+}
+
+bool uring_async_loop::remove_task(const timer_id_t timer_id) {
+  VLOG(3) << "remove_task()";
+
+  return tasks_.remove(timer_id.timer_id);
+}
+
+void uring_async_loop::remove_task_lib_namespace(
+    const std::string lib_namespace)
+{
+  VLOG(3) << "remove task for " << lib_namespace;
+
+  tasks_.remove_ns(lib_namespace);
+}
+
+uring_async_events::uring_async_events(size_t num_loops,
+                                       async_cb_fn_t cb_fn) :
+  async_events_interface(),
+  num_loops_(num_loops),
+  cb_fn_(cb_fn),
+  loops_(num_loops)
+{
+  for (size_t i = 0; i < num_loops_; i++) {
+    loops_[i].set_id(i);
+    loops_[i].set_async_cb(cb_fn);
+  }
+}
+
+bool uring_async_events::init() {
+
+  for (auto & loop : loops_) {
+    if (!loop.init()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void uring_async_events::start_loop(const size_t loop_id) {
+  loops_[loop_id].start();
+}
+
+void uring_async_events::stop_all_loops() {
+  for (auto & loop: loops_) {
+    loop.stop();
+  }
+}
+
+void uring_async_events::signal_loop(const size_t loop_id) {
+  loops_[loop_id].signal();
+}
+
+async_loop & uring_async_events::loop(const size_t loop_id) {
+  return loops_[loop_id];
+}
@@ -0,0 +1,192 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <carbon_parser.h>
+#include <util/parse_number.h>
+
+namespace {
+
+inline bool is_space(const char c) {
+  return c == ' ' || c == '\t';
+}
+
+inline bool is_digit(const char c) {
+  return c >= '0' && c <= '9';
+}
+
+/* Returns the next token in [p, end) and moves p past it */
+inline bool next_token(const char * & p, const char * end,
+                       const char * & token, size_t & size)
+{
+  while (p < end && is_space(*p)) {
+    p++;
+  }
+
+  token = p;
+
+  while (p < end && !is_space(*p)) {
+    p++;
+  }
+
+  size = p - token;
+
+  return size > 0;
+}
+
+/* Seconds, decimals are dropped */
+bool parse_timestamp(const char * p, const size_t size, int64_t & out) {
+
+  const char * end = p + size;
+
+  bool negative = false;
+
+  if (p < end && *p == '-') {
+    negative = true;
+    p++;
+  }
+
+  const char * digits_start = p;
+  int64_t value = 0;
+
+  for (; p < end && is_digit(*p) && p - digits_start < 18; p++) {
+    value = value * 10 + (*p - '0');
+  }
+
+  if (p == digits_start) {
+    return false;
+  }
+
+  if (p < end && *p == '.') {
+    for (p++; p < end && is_digit(*p); p++);
+  }
+
+  if (p != end) {
+    return false;
+  }
+
+  out = negative ? -value : value;
+
+  return true;
+}
+
+}
+
+bool parse_carbon_line(const char * line, const size_t size,
+                       carbon_line & out)
+{
+
+  const char * p = line;
+  const char * end = line + size;
+
+  const char * token;
+  size_t token_size;
+
+  if (!next_token(p, end, out.path, out.path_size)) {
+    return false;
+  }
+
+  if (!next_token(p, end, token, token_size)
+      || !parse_double(token, token_size, out.value)
+      || !std::isfinite(out.value))
+  {
+    return false;
+  }
+
+  if (!next_token(p, end, token, token_size)
+      || !parse_timestamp(token, token_size, out.timestamp))
+  {
+    return false;
+  }
+
+  // Nothing else but trailing spaces
+  return !next_token(p, end, token, token_size);
+}
+
+carbon_parser::carbon_parser(const size_t host_fields)
+  :
+    host_fields_(host_fields),
+    invalid_lines_(0)
+{
+}
+
+size_t carbon_parser::parse(const char * data, const size_t size,
+                            const bool complete, riemann::Msg & msg)
+{
+
+  const char * p = data;
+  const char * end = data + size;
+
+  int64_t now = -1;
+
+  while (p < end) {
+
+    auto nl = static_cast<const char *>(memchr(p, '\n', end - p));
+
+    if (!nl && !complete) {
+      break;
+    }
+
+    const char * line_end = nl ? nl : end;
+    const char * next = nl ? nl + 1 : end;
+
+    if (line_end > p && line_end[-1] == '\r') {
+      line_end--;
+    }
+
+    if (line_end == p) {
+      p = next;
+      continue;
+    }
+
+    carbon_line line;
+
+    if (!parse_carbon_line(p, line_end - p, line)) {
+      invalid_lines_++;
+      p = next;
+      continue;
+    }
+
+    if (line.timestamp < 0 && now < 0) {
+      now = time(nullptr);
+    }
+
+    add_event(line, now, msg);
+
+    p = next;
+  }
+
+  return p - data;
+}
+
+size_t carbon_parser::invalid_lines() {
+  const size_t lines = invalid_lines_;
+  invalid_lines_ = 0;
+  return lines;
+}
+
+void carbon_parser::add_event(const carbon_line & line, const int64_t now,
+                              riemann::Msg & msg) const
+{
+
+  // Where the host ends, keeping at least one component for the service
+  size_t host_size = 0;
+  size_t fields = 0;
+
+  for (size_t i = 0; i < line.path_size && fields < host_fields_; i++) {
+    if (line.path[i] == '.') {
+      host_size = i;
+      fields++;
+    }
+  }
+
+  auto event = msg.add_events();
+
+  const size_t service_start = host_size ? host_size + 1 : 0;
+
+  event->set_host(line.path, host_size);
+  event->set_service(line.path + service_start,
+                     line.path_size - service_start);
+  event->set_metric_d(line.value);
+  event->set_time(line.timestamp < 0 ? now : line.timestamp);
+}
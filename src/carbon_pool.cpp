@@ -0,0 +1,174 @@
+#include <glog/logging.h>
+#include <carbon_pool.h>
+#include <transport/listen_tcp_socket.h>
+#include <transport/tcp_connection.h>
+
+using namespace std::placeholders;
+
+namespace {
+
+const std::string k_invalid_service = "carbon invalid lines rate";
+const std::string k_invalid_desc = "graphite lines that could not be parsed";
+
+const std::string k_drop_service = "carbon udp dropped messages rate";
+const std::string k_drop_desc = "graphite udp messages dropped because the "
+                                "executor pool is full";
+
+// Interval to check if paused connections can be read again
+const float k_resume_interval = 0.01;
+
+/* Datagrams are passed without their loop, each udp thread keeps its
+ * parser here */
+thread_local std::unique_ptr<carbon_parser> udp_parser;
+thread_local riemann::Msg udp_msg;
+
+}
+
+carbon_pool::carbon_pool(size_t thread_num, uint32_t port, size_t host_fields,
+                         size_t max_datagram_size,
+                         carbon_events_fn_t events_fn, hook_fn_t run_fn,
+                         instrumentation::instrumentation & instr)
+:
+  thread_num_(thread_num),
+  port_(port),
+  events_fn_(events_fn),
+  run_fn_(run_fn),
+  paused_fn_(),
+  invalid_rate_(instr.add_rate(k_invalid_service, k_invalid_desc)),
+  drop_rate_(instr.add_rate(k_drop_service, k_drop_desc)),
+  parsers_(thread_num, carbon_parser(host_fields)),
+  msgs_(thread_num),
+  paused_(thread_num),
+  tcp_pool_(thread_num,
+            std::bind(&carbon_pool::tcp_run_hook, this, _1),
+            {},
+            std::bind(&carbon_pool::tcp_ready, this, _1, _2)),
+  udp_pool_(thread_num, port, max_datagram_size,
+            std::bind(&carbon_pool::udp_read, this, _1),
+            [=](async_loop & loop)
+            {
+              if (run_fn) {
+                run_fn(loop);
+              }
+              udp_parser.reset(new carbon_parser(host_fields));
+            },
+            {})
+{
+}
+
+void carbon_pool::set_paused_fn(carbon_paused_fn_t paused_fn) {
+  paused_fn_ = paused_fn;
+}
+
+void carbon_pool::start_threads() {
+
+  for (size_t i = 0; i < thread_num_; i++) {
+    tcp_pool_.add_listen_fd(i, create_tcp_listen_socket(port_, true));
+  }
+
+  tcp_pool_.start_threads();
+  udp_pool_.start_threads();
+}
+
+void carbon_pool::stop_threads() {
+  tcp_pool_.stop_threads();
+  udp_pool_.stop_threads();
+}
+
+void carbon_pool::tcp_run_hook(async_loop & loop) {
+
+  if (run_fn_) {
+    run_fn_(loop);
+  }
+
+  if (paused_fn_) {
+    loop.add_periodic_task("", [=, &loop](size_t) { resume(loop); },
+                           k_resume_interval);
+  }
+
+}
+
+void carbon_pool::tcp_ready(async_fd & async, tcp_connection & conn) {
+
+  const size_t tid = async.loop().id();
+
+  if (!async.ready_read()) {
+    return;
+  }
+
+  const bool read = conn.read();
+
+  if (!read && !conn.close_connection) {
+    LOG(ERROR) << "carbon line too long, closing connection";
+    conn.close_connection = true;
+    return;
+  }
+
+  auto & buffer = conn.r_buffer;
+  auto & msg = msgs_[tid];
+  auto & parser = parsers_[tid];
+
+  // The last line of a closed connection needs no newline
+  const size_t used = parser.parse(
+      reinterpret_cast<const char *>(buffer.data()), buffer.size(),
+      conn.close_connection, msg);
+
+  buffer.consume(used);
+
+  if (const size_t invalid = parser.invalid_lines()) {
+    invalid_rate_(invalid);
+  }
+
+  if (msg.events_size() > 0) {
+    events_fn_(msg, used);
+    msg.Clear();
+  }
+
+  if (conn.close_connection || !paused_fn_ || !paused_fn_()) {
+    return;
+  }
+
+  async.set_mode(async_fd::none);
+  paused_[tid].insert(async.fd());
+}
+
+void carbon_pool::resume(async_loop & loop) {
+
+  auto & paused = paused_[loop.id()];
+
+  if (paused.empty() || paused_fn_()) {
+    return;
+  }
+
+  for (const auto fd : paused) {
+    loop.set_fd_mode(fd, async_fd::read);
+  }
+
+  paused.clear();
+}
+
+void carbon_pool::udp_read(std::vector<unsigned char> datagram) {
+
+  // Datagrams can't be left in the socket
+  if (paused_fn_ && paused_fn_()) {
+    drop_rate_(1);
+    return;
+  }
+
+  udp_parser->parse(reinterpret_cast<const char *>(&datagram[0]),
+                    datagram.size(), true, udp_msg);
+
+  if (const size_t invalid = udp_parser->invalid_lines()) {
+    invalid_rate_(invalid);
+  }
+
+  if (udp_msg.events_size() > 0) {
+    events_fn_(udp_msg, datagram.size());
+    udp_msg.Clear();
+  }
+
+}
+
+carbon_pool::~carbon_pool() {
+  stop_threads();
+}
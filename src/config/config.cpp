@@ -11,12 +11,140 @@ DEFINE_int32(events_port, 5555, "listening port for incoming riemann events");
 
 DEFINE_int32(riemann_tcp_pool_size, 4, "number of threads for tcp pool");
 
+DEFINE_string(unix_socket_path, "",
+              "unix socket to listen on for riemann tcp clients on the same "
+              "host, empty disables it");
+
+DEFINE_string(shm_socket_path, "",
+              "unix socket where producers on the same host hand their shared "
+              "memory rings over, see shm_producer, empty disables it");
+
+DEFINE_int32(riemann_udp_pool_size, 1,
+             "number of threads for udp pool, each one reads from its own "
+             "SO_REUSEPORT socket");
+
+DEFINE_int32(udp_max_datagram_size, 16384,
+             "largest udp message in bytes, larger ones are dropped");
+
+DEFINE_bool(inline_ingest, false,
+            "process events in the tcp threads that read them, each thread "
+            "accepts its own connections. Ignored when executor_partition "
+            "is set");
+
+DEFINE_int32(inline_ingest_budget_us, 1000,
+             "time a tcp thread can spend processing events from one read "
+             "before it hands the rest to the executor pool");
+
+DEFINE_int32(ingest_batch_size, 16,
+             "max number of messages a loop thread batches into one executor "
+             "task, 1 disables batching");
+
+DEFINE_bool(tcp_pin_threads, false, "pin tcp threads to cores");
+
+DEFINE_int32(tcp_max_frame_kb, 1536,
+             "largest frame in KB a tcp or websocket connection takes, its "
+             "buffers start small and grow up to it");
+
+DEFINE_bool(reuseport_listeners, false,
+            "each riemann tcp and websocket thread listens on its own "
+            "SO_REUSEPORT socket and accepts its own connections, instead of "
+            "the main loop accepting them all");
+
+DEFINE_int32(loop_spin_us, 0,
+             "time in us a loop thread keeps polling after its last event "
+             "before it sleeps, other threads don't wake it up meanwhile, 0 "
+             "disables spinning");
+
+DEFINE_string(loop_backend, "libev",
+              "event loop of the tcp, websocket and client pools: libev or "
+              "io_uring, io_uring falls back to libev when the kernel lacks "
+              "it");
+
+DEFINE_int32(carbon_port, 0,
+             "tcp and udp port to listen on for graphite plaintext lines, 0 "
+             "disables it");
+
+DEFINE_int32(carbon_pool_size, 1,
+             "number of threads for each of the carbon tcp and udp pools");
+
+DEFINE_int32(carbon_host_fields, 1,
+             "leading components of a graphite path that make the host of "
+             "its event, the rest is the service");
+
+DEFINE_int32(http_port, 0,
+             "http port to listen on for JSON events posted to /events, 0 "
+             "disables it");
+
+DEFINE_int32(http_pool_size, 1, "number of http threads");
+
+DEFINE_int32(http_max_body_size, 4 * 1024 * 1024,
+             "largest http request body in bytes");
+
+DEFINE_int32(statsd_port, 0,
+             "udp port to listen on for statsd metrics, 0 disables it");
+
+DEFINE_int32(statsd_pool_size, 1, "number of statsd threads");
+
+DEFINE_int32(statsd_flush_interval, 10,
+             "seconds statsd metrics are aggregated before they are sent "
+             "to the streams as events");
+
+DEFINE_string(statsd_percentiles, "0,0.5,0.95,0.99,1",
+              "comma separated percentiles sent for each statsd timer");
+
+DEFINE_int32(query_max_results, 10000,
+             "most events returned for a riemann tcp query");
+
+DEFINE_int32(query_cache_size, 1024,
+             "number of compiled riemann tcp queries kept for reuse");
+
 DEFINE_int32(ws_port, 5556, "websocket listening port to query index");
 
 DEFINE_int32(ws_pool_size, 4, "number of threads for websocket pool");
 
 DEFINE_int32(executor_pool_size, k_cores, "number of threads for executor pool");
 
+DEFINE_string(executor_partition, "none",
+              "route events to executor threads by key: none, host or "
+              "host_service");
+
+DEFINE_bool(executor_work_stealing, true,
+            "let idle executor threads steal tasks from busy ones, ignored "
+            "when executor_partition is set");
+
+DEFINE_bool(executor_pin_threads, false, "pin executor threads to cores");
+
+DEFINE_int32(executor_min_pool_size, 1,
+             "minimum number of active executor threads when autoscaling");
+
+DEFINE_int32(executor_max_pool_size, 0,
+             "maximum number of active executor threads, the pool grows and "
+             "shrinks between executor_min_pool_size and this size based on "
+             "queue wait time, 0 disables autoscaling, ignored when "
+             "executor_partition is set");
+
+DEFINE_int32(executor_scale_interval, 1,
+             "interval in seconds to resize the executor pool");
+
+DEFINE_int32(executor_scale_up_wait_us, 1000,
+             "add a thread when tasks wait longer than this on average");
+
+DEFINE_int32(executor_scale_down_wait_us, 100,
+             "remove a thread when tasks wait less than this on average");
+
+DEFINE_int32(executor_max_cpu_usage, 90,
+             "do not add threads while the host cpu usage is above this "
+             "percentage");
+
+DEFINE_int32(ingest_high_watermark_mb, 512,
+             "stop reading from tcp connections and drop udp messages when "
+             "the executor pool holds this many MB of incoming messages, 0 "
+             "disables it");
+
+DEFINE_int32(ingest_low_watermark_mb, 256,
+             "resume reading when the executor pool holds less than this "
+             "many MB of incoming messages");
+
 DEFINE_int32(index_expire_interval, 60,
              "interval in seconds to expire events from index");
 
@@ -43,9 +171,44 @@ config create_config() {
 
   conf.events_port = FLAGS_events_port;
   conf.riemann_tcp_pool_size = FLAGS_riemann_tcp_pool_size;
+  conf.unix_socket_path = FLAGS_unix_socket_path;
+  conf.shm_socket_path = FLAGS_shm_socket_path;
+  conf.riemann_udp_pool_size = FLAGS_riemann_udp_pool_size;
+  conf.udp_max_datagram_size = FLAGS_udp_max_datagram_size;
+  conf.inline_ingest = FLAGS_inline_ingest;
+  conf.inline_ingest_budget_us = FLAGS_inline_ingest_budget_us;
+  conf.ingest_batch_size = FLAGS_ingest_batch_size;
+  conf.tcp_pin_threads = FLAGS_tcp_pin_threads;
+  conf.tcp_max_frame_kb = FLAGS_tcp_max_frame_kb;
+  conf.reuseport_listeners = FLAGS_reuseport_listeners;
+  conf.loop_spin_us = FLAGS_loop_spin_us;
+  conf.loop_backend = FLAGS_loop_backend;
+  conf.carbon_port = FLAGS_carbon_port;
+  conf.carbon_pool_size = FLAGS_carbon_pool_size;
+  conf.carbon_host_fields = FLAGS_carbon_host_fields;
+  conf.http_port = FLAGS_http_port;
+  conf.http_pool_size = FLAGS_http_pool_size;
+  conf.http_max_body_size = FLAGS_http_max_body_size;
+  conf.statsd_port = FLAGS_statsd_port;
+  conf.statsd_pool_size = FLAGS_statsd_pool_size;
+  conf.statsd_flush_interval = FLAGS_statsd_flush_interval;
+  conf.statsd_percentiles = FLAGS_statsd_percentiles;
+  conf.query_max_results = FLAGS_query_max_results;
+  conf.query_cache_size = FLAGS_query_cache_size;
   conf.ws_port = FLAGS_ws_port;
   conf.ws_pool_size = FLAGS_ws_pool_size;
   conf.executor_pool_size = FLAGS_executor_pool_size;
+  conf.executor_partition = FLAGS_executor_partition;
+  conf.executor_work_stealing = FLAGS_executor_work_stealing;
+  conf.executor_pin_threads = FLAGS_executor_pin_threads;
+  conf.executor_min_pool_size = FLAGS_executor_min_pool_size;
+  conf.executor_max_pool_size = FLAGS_executor_max_pool_size;
+  conf.executor_scale_interval = FLAGS_executor_scale_interval;
+  conf.executor_scale_up_wait_us = FLAGS_executor_scale_up_wait_us;
+  conf.executor_scale_down_wait_us = FLAGS_executor_scale_down_wait_us;
+  conf.executor_max_cpu_usage = FLAGS_executor_max_cpu_usage;
+  conf.ingest_high_watermark_mb = FLAGS_ingest_high_watermark_mb;
+  conf.ingest_low_watermark_mb = FLAGS_ingest_low_watermark_mb;
   conf.index_expire_interval = FLAGS_index_expire_interval;
   conf.rules_directory = FLAGS_rules_directory;
   conf.pagerduty_pool_size = FLAGS_pagerduty_pool_size;
@@ -64,9 +227,46 @@ void log_config(config conf) {
   VLOG(1) << "config:";
   VLOG(1) << "\tevents_port: " << conf.events_port;
   VLOG(1) << "\trimeann_tcp_pool_size:: " << conf.riemann_tcp_pool_size;
+  VLOG(1) << "\tunix_socket_path: " << conf.unix_socket_path;
+  VLOG(1) << "\tshm_socket_path: " << conf.shm_socket_path;
+  VLOG(1) << "\triemann_udp_pool_size: " << conf.riemann_udp_pool_size;
+  VLOG(1) << "\tudp_max_datagram_size: " << conf.udp_max_datagram_size;
+  VLOG(1) << "\tinline_ingest: " << conf.inline_ingest;
+  VLOG(1) << "\tinline_ingest_budget_us: " << conf.inline_ingest_budget_us;
+  VLOG(1) << "\tingest_batch_size: " << conf.ingest_batch_size;
+  VLOG(1) << "\ttcp_pin_threads: " << conf.tcp_pin_threads;
+  VLOG(1) << "\ttcp_max_frame_kb: " << conf.tcp_max_frame_kb;
+  VLOG(1) << "\treuseport_listeners: " << conf.reuseport_listeners;
+  VLOG(1) << "\tloop_spin_us: " << conf.loop_spin_us;
+  VLOG(1) << "\tloop_backend: " << conf.loop_backend;
+  VLOG(1) << "\tcarbon_port: " << conf.carbon_port;
+  VLOG(1) << "\tcarbon_pool_size: " << conf.carbon_pool_size;
+  VLOG(1) << "\tcarbon_host_fields: " << conf.carbon_host_fields;
+  VLOG(1) << "\thttp_port: " << conf.http_port;
+  VLOG(1) << "\thttp_pool_size: " << conf.http_pool_size;
+  VLOG(1) << "\thttp_max_body_size: " << conf.http_max_body_size;
+  VLOG(1) << "\tstatsd_port: " << conf.statsd_port;
+  VLOG(1) << "\tstatsd_pool_size: " << conf.statsd_pool_size;
+  VLOG(1) << "\tstatsd_flush_interval: " << conf.statsd_flush_interval;
+  VLOG(1) << "\tstatsd_percentiles: " << conf.statsd_percentiles;
+  VLOG(1) << "\tquery_max_results: " << conf.query_max_results;
+  VLOG(1) << "\tquery_cache_size: " << conf.query_cache_size;
   VLOG(1) << "\tws_port: " << conf.ws_port;
   VLOG(1) << "\tws_pool_size: " << conf.ws_pool_size;
   VLOG(1) << "\texecutor_pool_size: " << conf.executor_pool_size;
+  VLOG(1) << "\texecutor_partition: " << conf.executor_partition;
+  VLOG(1) << "\texecutor_work_stealing: " << conf.executor_work_stealing;
+  VLOG(1) << "\texecutor_pin_threads: " << conf.executor_pin_threads;
+  VLOG(1) << "\texecutor_min_pool_size: " << conf.executor_min_pool_size;
+  VLOG(1) << "\texecutor_max_pool_size: " << conf.executor_max_pool_size;
+  VLOG(1) << "\texecutor_scale_interval: " << conf.executor_scale_interval;
+  VLOG(1) << "\texecutor_scale_up_wait_us: "
+          << conf.executor_scale_up_wait_us;
+  VLOG(1) << "\texecutor_scale_down_wait_us: "
+          << conf.executor_scale_down_wait_us;
+  VLOG(1) << "\texecutor_max_cpu_usage: " << conf.executor_max_cpu_usage;
+  VLOG(1) << "\tingest_high_watermark_mb: " << conf.ingest_high_watermark_mb;
+  VLOG(1) << "\tingest_low_watermark_mb: " << conf.ingest_low_watermark_mb;
   VLOG(1) << "\tindex_expire_interval: " << conf.index_expire_interval;
   VLOG(1) << "\trules_directory: " << conf.rules_directory;
   VLOG(1) << "\tpagerduty_pool_size: " << conf.pagerduty_pool_size;
@@ -0,0 +1,234 @@
+#include <glog/logging.h>
+#include <core/ingest_batcher.h>
+
+namespace {
+
+void process_frames(const std::vector<std::vector<unsigned char>> & frames,
+                    streams & streams)
+{
+  riemann::Msg batch;
+  riemann::Msg msg;
+
+  for (const auto & raw_msg : frames) {
+
+    if (!msg.ParseFromArray(raw_msg.data(), raw_msg.size())) {
+      VLOG(2) << "error parsing protobuf payload";
+      continue;
+    }
+
+    if (msg.has_query()) {
+      VLOG(1) << "query messages are only answered over tcp";
+      continue;
+    }
+
+    for (int i = 0; i < msg.events_size(); i++) {
+      batch.add_events()->Swap(msg.mutable_events(i));
+    }
+
+  }
+
+  streams.process_message(batch);
+}
+
+}
+
+ingest_batcher::ingest_batcher(
+    const size_t max_frames,
+    streams & streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::update_latency_fn_t batch_size_fn)
+:
+  max_frames_(max_frames),
+  streams_(streams),
+  executor_pool_(executor_pool),
+  partition_fn_(partition_fn),
+  batch_size_fn_(batch_size_fn),
+  frames_(std::make_shared<frames_t>()),
+  frames_bytes_(0),
+  events_(),
+  events_frames_(0),
+  events_bytes_(0),
+  shards_(executor_pool.size()),
+  shard_frames_(executor_pool.size(), 0),
+  shard_bytes_(executor_pool.size(), 0)
+{
+}
+
+void ingest_batcher::add(std::vector<unsigned char> raw_msg) {
+
+  if (partition_fn_) {
+    add_partitioned(raw_msg);
+    return;
+  }
+
+  frames_bytes_ += raw_msg.size();
+  frames_->emplace_back(std::move(raw_msg));
+
+  if (frames_->size() >= max_frames_) {
+    flush_frames();
+  }
+
+}
+
+void ingest_batcher::add_partitioned(
+    const std::vector<unsigned char> & raw_msg)
+{
+
+  riemann::Msg msg;
+
+  if (!msg.ParseFromArray(raw_msg.data(), raw_msg.size())) {
+    VLOG(2) << "error parsing protobuf payload";
+    return;
+  }
+
+  if (msg.has_query()) {
+    VLOG(1) << "query messages are only answered over tcp";
+    return;
+  }
+
+  add_to_shards(msg, raw_msg.size());
+}
+
+void ingest_batcher::add_events(riemann::Msg & msg, const size_t bytes) {
+
+  if (msg.events_size() == 0) {
+    return;
+  }
+
+  if (partition_fn_) {
+    add_to_shards(msg, bytes);
+    return;
+  }
+
+  if (!events_) {
+    events_ = std::make_shared<riemann::Msg>();
+  }
+
+  for (int i = 0; i < msg.events_size(); i++) {
+    events_->add_events()->Swap(msg.mutable_events(i));
+  }
+
+  events_bytes_ += bytes;
+
+  if (++events_frames_ >= max_frames_) {
+    flush_events();
+  }
+
+}
+
+void ingest_batcher::add_to_shards(riemann::Msg & msg, const size_t bytes) {
+
+  std::vector<bool> touched(shards_.size(), false);
+  size_t touched_shards = 0;
+
+  for (int i = 0; i < msg.events_size(); i++) {
+
+    auto event = msg.mutable_events(i);
+
+    const auto shard = partition_fn_(event->host(), event->service())
+                       % shards_.size();
+
+    if (!shards_[shard]) {
+      shards_[shard] = std::make_shared<riemann::Msg>();
+    }
+
+    shards_[shard]->add_events()->Swap(event);
+
+    if (!touched[shard]) {
+      touched[shard] = true;
+      touched_shards++;
+    }
+
+  }
+
+  for (size_t i = 0; i < shards_.size(); i++) {
+
+    if (!touched[i]) {
+      continue;
+    }
+
+    shard_bytes_[i] += bytes / touched_shards;
+
+    if (++shard_frames_[i] >= max_frames_) {
+      flush_shard(i);
+    }
+
+  }
+
+}
+
+void ingest_batcher::flush() {
+
+  if (!partition_fn_) {
+    flush_frames();
+    flush_events();
+    return;
+  }
+
+  for (size_t i = 0; i < shards_.size(); i++) {
+    flush_shard(i);
+  }
+
+}
+
+void ingest_batcher::flush_frames() {
+
+  if (frames_->empty()) {
+    return;
+  }
+
+  batch_size_fn_(frames_->size());
+
+  auto frames = frames_;
+  auto & streams = streams_;
+
+  executor_pool_.add_task([=, &streams]() { process_frames(*frames, streams); },
+                          frames_bytes_);
+
+  frames_ = std::make_shared<frames_t>();
+  frames_bytes_ = 0;
+  frames_->reserve(max_frames_);
+
+}
+
+void ingest_batcher::flush_events() {
+
+  if (!events_) {
+    return;
+  }
+
+  batch_size_fn_(events_frames_);
+
+  auto msg = events_;
+  auto & streams = streams_;
+
+  executor_pool_.add_task([=, &streams]() { streams.process_message(*msg); },
+                          events_bytes_);
+
+  events_.reset();
+  events_frames_ = 0;
+  events_bytes_ = 0;
+
+}
+
+void ingest_batcher::flush_shard(const size_t shard) {
+
+  if (!shards_[shard]) {
+    return;
+  }
+
+  batch_size_fn_(shard_frames_[shard]);
+
+  auto msg = shards_[shard];
+  auto & streams = streams_;
+
+  executor_pool_.add_task(shard,
+                          [=, &streams]() { streams.process_message(*msg); },
+                          shard_bytes_[shard]);
+
+  shards_[shard].reset();
+  shard_frames_[shard] = 0;
+  shard_bytes_[shard] = 0;
+
+}
@@ -0,0 +1,68 @@
+#include <glog/logging.h>
+#include <core/inline_ingest.h>
+
+namespace {
+
+/* When the current read callback started processing messages inline */
+thread_local bool inline_busy = false;
+thread_local std::chrono::steady_clock::time_point inline_start;
+
+}
+
+void incoming_event(const std::vector<unsigned char> & raw_msg,
+                    streams & streams)
+{
+  riemann::Msg msg;
+
+  if (!msg.ParseFromArray(raw_msg.data(), raw_msg.size())) {
+    VLOG(2) << "error parsing protobuf payload";
+    return;
+  }
+
+  if (msg.has_query()) {
+    VLOG(1) << "query messages are only answered over tcp";
+    return;
+
+  }
+
+  streams.process_message(msg);
+}
+
+inline_ingest::inline_ingest(
+    const std::chrono::microseconds budget,
+    streams & streams,
+    executor_thread_pool & executor_pool,
+    instrumentation::update_rate_fn_t overflow_rate)
+:
+  budget_(budget),
+  streams_(streams),
+  executor_pool_(executor_pool),
+  overflow_rate_(overflow_rate)
+{
+}
+
+void inline_ingest::add(const std::vector<unsigned char> & raw_msg) {
+
+  auto now = std::chrono::steady_clock::now();
+
+  if (!inline_busy) {
+    inline_busy = true;
+    inline_start = now;
+  }
+
+  if (now - inline_start < budget_) {
+    incoming_event(raw_msg, streams_);
+    return;
+  }
+
+  overflow_rate_(1);
+
+  auto & streams = streams_;
+
+  executor_pool_.add_task(
+    [=, &streams]() { incoming_event(raw_msg, streams); }, raw_msg.size());
+}
+
+void inline_ingest::done() {
+  inline_busy = false;
+}
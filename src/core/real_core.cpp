@@ -1,6 +1,7 @@
 #include <glog/logging.h>
 #include <transport/listen_tcp_socket.h>
 #include <transport/curl_pool.h>
+#include <transport/tcp_connection.h>
 #include <rules_loader.h>
 #include <external/real_external.h>
 #include <core/real_core_helper.h>
@@ -20,7 +21,7 @@ real_core::real_core(const config & conf)
 
     main_loop_(make_main_async_loop()),
 
-    scheduler_(new real_scheduler()),
+    scheduler_(make_scheduler(conf, executor_pool_, instrumentation_)),
 
     externals_(new real_external(conf, instrumentation_)),
 
@@ -28,20 +29,41 @@ real_core::real_core(const config & conf)
 
     pubsub_(new pub_sub()),
 
-    index_(new real_index(*pubsub_, [=](e_t e) { streams_->push_event(e); },
+    index_(new real_index(*pubsub_,
+                          make_push_event_fn(*streams_, executor_pool_,
+                                             make_partition_fn(conf)),
                           conf.index_expire_interval, *scheduler_,
                           instrumentation_, detach_thread)),
 
-    tcp_server_(init_tcp_server(conf, *main_loop_, *streams_,
-                executor_pool_, instrumentation_)),
+    tcp_server_(init_tcp_server(conf, *main_loop_, *streams_, *index_,
+                executor_pool_, make_partition_fn(conf), instrumentation_)),
 
-    udp_server_(init_udp_server(conf, streams_)),
+    udp_server_(init_udp_server(conf, streams_, executor_pool_,
+                                make_partition_fn(conf), instrumentation_)),
+
+    shm_server_(init_shm_server(conf, *streams_, executor_pool_,
+                                make_partition_fn(conf), instrumentation_)),
+
+    carbon_server_(init_carbon_server(conf, *streams_, executor_pool_,
+                                      make_partition_fn(conf),
+                                      instrumentation_)),
+
+    http_server_(init_http_server(conf, *streams_, executor_pool_,
+                                  make_partition_fn(conf), instrumentation_)),
+
+    statsd_server_(init_statsd_server(conf, *streams_, executor_pool_,
+                                      make_partition_fn(conf),
+                                      instrumentation_)),
 
     ws_server_(init_ws_server(conf, *main_loop_, *pubsub_, *index_))
 {
 
+  start_autoscaling(conf, *scheduler_, executor_pool_);
+
   if (conf.enable_internal_metrics) {
-    start_instrumentation(*scheduler_, instrumentation_, *streams_);
+    start_instrumentation(*scheduler_, instrumentation_,
+                          make_push_event_fn(*streams_, executor_pool_,
+                                             make_partition_fn(conf)));
   }
 
 }
@@ -58,11 +80,29 @@ void real_core::start() {
 
   VLOG(3) << "Stopping services";
 
+  // A reload in flight needs the scheduler and the executor to finish
+  streams_->stop();
   scheduler_->stop();
   executor_pool_.stop();
-  streams_->stop();
   tcp_server_->stop();
   udp_server_->stop();
+
+  if (shm_server_) {
+    shm_server_->stop_threads();
+  }
+
+  if (carbon_server_) {
+    carbon_server_->stop_threads();
+  }
+
+  if (http_server_) {
+    http_server_->stop_threads();
+  }
+
+  if (statsd_server_) {
+    statsd_server_->stop_threads();
+  }
+
   ws_server_->stop();
   externals_->stop();
 
@@ -87,7 +127,7 @@ real_core::~real_core() {
 
 void real_core::reload_rules() {
   VLOG(3) << "reload_rules()";
-  streams_->reload_rules();
+  streams_->reload_rules_async();
 }
 
 index_interface & real_core::idx() {
@@ -122,11 +162,13 @@ void start_core(int argc, char **argv) {
 
   log_config(conf);
 
+  set_async_loop_spin(conf.loop_spin_us);
+  set_async_loop_backend(conf.loop_backend);
+  set_tcp_buffer_size(conf.tcp_max_frame_kb * 1024);
+
   g_core = make_real_core(conf);
 
   g_core->start();
 
   g_core.reset();
-
-  free_thread_ns();
 }
@@ -2,10 +2,51 @@
 #include <core/real_core_helper.h>
 #include <util/util.h>
 #include <transport/listen_tcp_socket.h>
+#include <transport/listen_unix_socket.h>
+#include <transport/buffer_pool.h>
+#include <riemann_query.h>
+#include <boost/functional/hash.hpp>
+#include <sstream>
 
 namespace {
 
 const float k_snapshot_interval = 5;
+const std::string k_overflow_service = "inline ingest overflow rate";
+const std::string k_overflow_desc = "messages handed to the executor pool";
+
+const std::string k_batch_service = " ingest batch size";
+const std::string k_batch_desc = "distribution of messages per executor task";
+const std::vector<double> k_batch_percentiles = {0.0, .5, .95, .99, 1};
+
+const std::string k_udp_drop_service = "udp dropped messages rate";
+const std::string k_udp_drop_desc = "messages dropped because the executor "
+                                    "pool is full";
+
+const std::string k_buffer_used_service = "connection buffers used kb";
+const std::string k_buffer_used_desc = "memory in KB held by connection "
+                                       "buffers that have data";
+const std::string k_buffer_pooled_service = "connection buffers pooled kb";
+const std::string k_buffer_pooled_desc = "memory in KB kept for reuse by "
+                                         "connection buffers";
+
+/* Batches the messages read by the current loop thread */
+thread_local std::unique_ptr<ingest_batcher> loop_batcher;
+
+/* Clients on the same host can connect to unix_socket_path, the main loop
+ * accepts them.
+ */
+void listen_unix(const config & conf, main_async_loop_interface & loop,
+                 riemann_tcp_pool & tcp_server)
+{
+  if (conf.unix_socket_path.empty()) {
+    return;
+  }
+
+  auto ptr_server = &tcp_server;
+
+  loop.add_tcp_listen_fd(create_unix_listen_socket(conf.unix_socket_path),
+                         [=](int fd) { ptr_server->add_client(fd); });
+}
 
 }
 
@@ -21,46 +62,272 @@ std::shared_ptr<core_interface> make_real_core(const config conf) {
 
 }
 
-inline void incoming_event(const std::vector<unsigned char> & raw_msg,
-                           streams & streams)
+partition_fn_t make_partition_fn(const config & conf) {
+
+  if (conf.executor_partition == "none") {
+    return {};
+  }
+
+  if (conf.executor_partition == "host") {
+
+    return [](const std::string & host, const std::string &)
+    {
+      return std::hash<std::string>()(host);
+    };
+
+  }
+
+  if (conf.executor_partition == "host_service") {
+
+    return [](const std::string & host, const std::string & service)
+    {
+      size_t seed = std::hash<std::string>()(host);
+      boost::hash_combine(seed, service);
+      return seed;
+    };
+
+  }
+
+  LOG(FATAL) << "invalid executor_partition: " << conf.executor_partition;
+
+  return {};
+}
+
+void batch_raw_msg(std::vector<unsigned char> raw_msg) {
+  loop_batcher->add(std::move(raw_msg));
+}
+
+void batch_events(riemann::Msg & msg, const size_t bytes) {
+  loop_batcher->add_events(msg, bytes);
+}
+
+/* Gives every loop thread its own batcher, flushed at the end of each loop
+ * iteration.
+ */
+hook_fn_t make_batcher_hook(const config & conf,
+                            const std::string & transport,
+                            streams & streams,
+                            executor_thread_pool & executor_pool,
+                            partition_fn_t partition_fn,
+                            instrumentation::instrumentation & instr)
 {
-  riemann::Msg msg;
 
-  if (!msg.ParseFromArray(&raw_msg[0], raw_msg.size())) {
-    VLOG(2) << "error parsing protobuf payload";
-    return;
+  const size_t max_frames = std::max<size_t>(conf.ingest_batch_size, 1);
+  const bool pin = conf.tcp_pin_threads && transport == "tcp";
+
+  auto batch_size_fn = instr.add_latency(transport + k_batch_service,
+                                         k_batch_desc, k_batch_percentiles);
+
+  return [=, &streams, &executor_pool](async_loop & loop)
+  {
+    if (pin) {
+      set_thread_affinity(loop.id());
+    }
+
+    loop_batcher.reset(new ingest_batcher(max_frames, streams, executor_pool,
+                                          partition_fn, batch_size_fn));
+
+    loop.set_iteration_fn([]() { loop_batcher->flush(); });
+  };
+
+}
+
+push_event_fn_t make_push_event_fn(streams & streams,
+                                   executor_thread_pool & executor_pool,
+                                   partition_fn_t partition_fn)
+{
+
+  if (!partition_fn) {
+    return [&](const Event & e) { streams.push_event(e); };
   }
 
-  if (msg.has_query()) {
-    VLOG(1) << "query messages are not supported yet";
-    return;
+  return [&, partition_fn](const Event & e)
+  {
+    executor_pool.add_task(partition_fn(e.host(), e.service()),
+                           [=, &streams]() { streams.push_event(e); });
+  };
+
+}
+
+std::unique_ptr<real_scheduler> make_scheduler(
+    const config & conf,
+    executor_thread_pool & executor_pool,
+    instrumentation::instrumentation & instr)
+{
 
+  if (!make_partition_fn(conf)) {
+    return std::unique_ptr<real_scheduler>(new real_scheduler(instr));
   }
 
-  streams.process_message(msg);
+  return std::unique_ptr<real_scheduler>(new real_scheduler(
+      instr,
+      [&](const uint64_t key, const task_fn_t & task)
+      {
+        executor_pool.add_task(key, task);
+      },
+      [&]() { executor_pool.sync(); }
+  ));
+
 }
 
-std::unique_ptr<riemann_tcp_pool> init_tcp_server(
+/* Connections stop being read while the executor pool is above its high
+ * watermark.
+ */
+void set_backpressure(riemann_tcp_pool & tcp_server,
+                      executor_thread_pool & executor_pool)
+{
+
+  tcp_server.set_paused_fn([&]() { return executor_pool.paused(); });
+
+  executor_pool.set_resume_fn([&]() { tcp_server.resume(); });
+
+}
+
+/* Queries are answered in the executor pool, away from the tcp threads,
+ * and their responses written back by the thread of the connection.
+ */
+void set_query_fn(const config & conf,
+                  riemann_tcp_pool & tcp_server,
+                  executor_thread_pool & executor_pool,
+                  real_index & index)
+{
+
+  auto cache = std::make_shared<query_cache>(conf.query_cache_size);
+  const size_t max_results = conf.query_max_results;
+  const size_t max_frame_size = conf.tcp_max_frame_kb * 1024;
+
+  tcp_server.set_query_fn([=, &executor_pool, &index](
+      std::vector<unsigned char> raw_msg, query_reply_fn_t reply_fn)
+  {
+    const size_t bytes = raw_msg.size();
+
+    executor_pool.add_task([=, &index]()
+    {
+      reply_fn(riemann_query_response(raw_msg, index, *cache, max_results,
+                                      max_frame_size));
+    }, bytes);
+  });
+
+}
+
+/* Every tcp thread accepts its own connections and runs the streams for
+ * the messages it reads. Once a read callback has used its time budget, the
+ * remaining messages go to the executor pool.
+ */
+std::unique_ptr<riemann_tcp_pool> init_inline_tcp_server(
     const config & conf,
-    main_async_loop_interface & loop,
     streams & streams,
+    real_index & index,
     executor_thread_pool & executor_pool,
     instrumentation::instrumentation & instr
     )
 {
 
-  auto income_tcp_event = [&](const std::vector<unsigned char> & raw_msg)
+  const std::chrono::microseconds budget(conf.inline_ingest_budget_us);
+
+  auto overflow_rate = instr.add_rate(k_overflow_service, k_overflow_desc);
+
+  auto ingest = std::make_shared<inline_ingest>(budget, streams,
+                                                executor_pool, overflow_rate);
+
+  auto income_tcp_event = [=](const std::vector<unsigned char> & raw_msg)
   {
-    executor_pool.add_task(
-      [=, &streams]() { incoming_event(raw_msg, streams); });
+    ingest->add(raw_msg);
   };
 
+  auto income_tcp_done = [=]() { ingest->done(); };
+
+  hook_fn_t run_fn;
+
+  if (conf.tcp_pin_threads) {
+    run_fn = [](async_loop & loop) { set_thread_affinity(loop.id()); };
+  }
+
+  std::unique_ptr<riemann_tcp_pool> tcp_server(new riemann_tcp_pool(
+      conf.riemann_tcp_pool_size,
+      income_tcp_event,
+      income_tcp_done,
+      run_fn,
+      instr
+  ));
+
+  set_backpressure(*tcp_server, executor_pool);
+
+  set_query_fn(conf, *tcp_server, executor_pool, index);
+
+  listen_per_thread(*tcp_server, conf.riemann_tcp_pool_size, conf.events_port,
+                    conf.tcp_pin_threads);
+
+  return tcp_server;
+}
+
+std::unique_ptr<riemann_tcp_pool> init_tcp_server(
+    const config & conf,
+    main_async_loop_interface & loop,
+    streams & streams,
+    real_index & index,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr
+    )
+{
+
+  if (conf.inline_ingest) {
+
+    if (!partition_fn) {
+      auto tcp_server = init_inline_tcp_server(conf, streams, index,
+                                               executor_pool, instr);
+      listen_unix(conf, loop, *tcp_server);
+      return tcp_server;
+    }
+
+    LOG(WARNING) << "inline_ingest is ignored when executor_partition is set";
+  }
+
+  raw_msg_fn_t income_tcp_event;
+  hook_fn_t run_fn;
+
+  if (partition_fn || conf.ingest_batch_size > 1) {
+
+    income_tcp_event = batch_raw_msg;
+    run_fn = make_batcher_hook(conf, "tcp", streams, executor_pool,
+                               partition_fn, instr);
+
+  } else {
+
+    income_tcp_event = [&](const std::vector<unsigned char> & raw_msg)
+    {
+      executor_pool.add_task(
+        [=, &streams]() { incoming_event(raw_msg, streams); },
+        raw_msg.size());
+    };
+
+    if (conf.tcp_pin_threads) {
+      run_fn = [](async_loop & loop) { set_thread_affinity(loop.id()); };
+    }
+
+  }
+
   std::unique_ptr<riemann_tcp_pool> tcp_server(new riemann_tcp_pool(
       conf.riemann_tcp_pool_size,
       income_tcp_event,
+      {},
+      run_fn,
       instr
   ));
 
+  set_backpressure(*tcp_server, executor_pool);
+
+  set_query_fn(conf, *tcp_server, executor_pool, index);
+
+  listen_unix(conf, loop, *tcp_server);
+
+  if (conf.reuseport_listeners) {
+    listen_per_thread(*tcp_server, conf.riemann_tcp_pool_size,
+                      conf.events_port, conf.tcp_pin_threads);
+    return tcp_server;
+  }
+
   auto ptr_server = tcp_server.get();
 
   loop.add_tcp_listen_fd(create_tcp_listen_socket(conf.events_port),
@@ -71,16 +338,203 @@ std::unique_ptr<riemann_tcp_pool> init_tcp_server(
 
 std::unique_ptr<riemann_udp_pool> init_udp_server(
     const config & conf,
-    std::shared_ptr<streams> streams)
+    std::shared_ptr<streams> streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr)
 {
 
-  auto income_udp_event = [=](const std::vector<unsigned char> raw_msg)
-  {
-    incoming_event(raw_msg, *streams);
-  };
+  auto drop_rate = instr.add_rate(k_udp_drop_service, k_udp_drop_desc);
+
+  raw_msg_fn_t income_udp_event;
+  hook_fn_t run_fn;
+
+  // Datagrams can't be left in the socket, drop them while paused
+  if (partition_fn || conf.ingest_batch_size > 1) {
+
+    income_udp_event = [&, drop_rate](std::vector<unsigned char> raw_msg)
+    {
+      if (executor_pool.paused()) {
+        drop_rate(1);
+        return;
+      }
+
+      batch_raw_msg(std::move(raw_msg));
+    };
+
+    run_fn = make_batcher_hook(conf, "udp", *streams, executor_pool,
+                               partition_fn, instr);
+
+  } else {
+
+    income_udp_event = [&, streams, drop_rate](
+        std::vector<unsigned char> raw_msg)
+    {
+      if (executor_pool.paused()) {
+        drop_rate(1);
+        return;
+      }
+
+      executor_pool.add_task(
+        [=]() { incoming_event(raw_msg, *streams); }, raw_msg.size());
+    };
+
+  }
+
+  return std::unique_ptr<riemann_udp_pool>(new riemann_udp_pool(
+      std::max<size_t>(conf.riemann_udp_pool_size, 1),
+      conf.events_port,
+      conf.udp_max_datagram_size,
+      income_udp_event,
+      run_fn,
+      instr));
+}
+
+std::unique_ptr<shm_pool> init_shm_server(
+    const config & conf,
+    streams & streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr)
+{
+
+  if (conf.shm_socket_path.empty()) {
+    return {};
+  }
+
+  shm_read_fn_t income_shm_event;
+  hook_fn_t run_fn;
+
+  if (partition_fn || conf.ingest_batch_size > 1) {
+
+    income_shm_event = batch_raw_msg;
+    run_fn = make_batcher_hook(conf, "shm", streams, executor_pool,
+                               partition_fn, instr);
+
+  } else {
+
+    income_shm_event = [&](std::vector<unsigned char> raw_msg)
+    {
+      executor_pool.add_task(
+        [=, &streams]() { incoming_event(raw_msg, streams); },
+        raw_msg.size());
+    };
+
+  }
+
+  std::unique_ptr<shm_pool> shm_server(new shm_pool(conf.shm_socket_path,
+                                                    income_shm_event,
+                                                    run_fn));
+
+  // Rings are left full while paused, producers see it and can't write
+  shm_server->set_paused_fn([&]() { return executor_pool.paused(); });
+
+  shm_server->start_threads();
+
+  return shm_server;
+}
+
+std::unique_ptr<carbon_pool> init_carbon_server(
+    const config & conf,
+    streams & streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr)
+{
+
+  if (conf.carbon_port == 0) {
+    return {};
+  }
+
+  // Lines are parsed in the loop threads, their events always go through
+  // a batcher
+  std::unique_ptr<carbon_pool> carbon_server(new carbon_pool(
+      std::max<size_t>(conf.carbon_pool_size, 1),
+      conf.carbon_port,
+      conf.carbon_host_fields,
+      conf.udp_max_datagram_size,
+      batch_events,
+      make_batcher_hook(conf, "carbon", streams, executor_pool, partition_fn,
+                        instr),
+      instr));
+
+  carbon_server->set_paused_fn([&]() { return executor_pool.paused(); });
+
+  carbon_server->start_threads();
+
+  return carbon_server;
+}
+
+std::unique_ptr<http_pool> init_http_server(
+    const config & conf,
+    streams & streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr)
+{
+
+  if (conf.http_port == 0) {
+    return {};
+  }
+
+  std::unique_ptr<http_pool> http_server(new http_pool(
+      std::max<size_t>(conf.http_pool_size, 1),
+      conf.http_port,
+      conf.http_max_body_size,
+      batch_events,
+      make_batcher_hook(conf, "http", streams, executor_pool, partition_fn,
+                        instr),
+      instr));
+
+  http_server->set_paused_fn([&]() { return executor_pool.paused(); });
+
+  http_server->start_threads();
+
+  return http_server;
+}
+
+std::unique_ptr<statsd_pool> init_statsd_server(
+    const config & conf,
+    streams & streams,
+    executor_thread_pool & executor_pool,
+    partition_fn_t partition_fn,
+    instrumentation::instrumentation & instr)
+{
+
+  if (conf.statsd_port == 0) {
+    return {};
+  }
+
+  std::vector<double> percentiles;
+  std::istringstream ss(conf.statsd_percentiles);
 
-  return std::unique_ptr<riemann_udp_pool>(
-      new riemann_udp_pool(conf.events_port, income_udp_event));
+  for (std::string p; std::getline(ss, p, ',');) {
+
+    char * end;
+    const double percentile = strtod(p.c_str(), &end);
+
+    if (p.empty() || *end != '\0' || percentile < 0 || percentile > 1) {
+      LOG(FATAL) << "invalid statsd_percentiles: " << conf.statsd_percentiles;
+    }
+
+    percentiles.push_back(percentile);
+  }
+
+  // A flush hands its events over like any read
+  std::unique_ptr<statsd_pool> statsd_server(new statsd_pool(
+      std::max<size_t>(conf.statsd_pool_size, 1),
+      conf.statsd_port,
+      conf.udp_max_datagram_size,
+      std::max<size_t>(conf.statsd_flush_interval, 1),
+      percentiles,
+      batch_events,
+      make_batcher_hook(conf, "statsd", streams, executor_pool,
+                        partition_fn, instr),
+      instr));
+
+  statsd_server->start_threads();
+
+  return statsd_server;
 }
 
 std::unique_ptr<websocket_pool> init_ws_server(
@@ -93,6 +547,11 @@ std::unique_ptr<websocket_pool> init_ws_server(
   std::unique_ptr<websocket_pool> ws_server(new websocket_pool(
         conf.ws_pool_size, pubsub, index));
 
+  if (conf.reuseport_listeners) {
+    listen_per_thread(*ws_server, conf.ws_pool_size, conf.ws_port, false);
+    return ws_server;
+  }
+
   auto ptr_server = ws_server.get();
 
   loop.add_tcp_listen_fd(create_tcp_listen_socket(conf.ws_port),
@@ -101,21 +560,48 @@ std::unique_ptr<websocket_pool> init_ws_server(
   return ws_server;
 }
 
-void snapshot(instrumentation::instrumentation & inst, streams & streams) {
+void snapshot(instrumentation::instrumentation & inst,
+              const push_event_fn_t & push_event_fn)
+{
 
   for (const auto & event : inst.snapshot()) {
-    streams.push_event(event);
+    push_event_fn(event);
   }
 
 }
 
 
+void start_autoscaling(const config & conf,
+                       scheduler_interface & sched,
+                       executor_thread_pool & executor_pool)
+{
+
+  if (!executor_pool.autoscaling()) {
+    return;
+  }
+
+  sched.add_periodic_task([&]() { executor_pool.autoscale(); },
+                          conf.executor_scale_interval);
+
+}
+
 void start_instrumentation(scheduler_interface & sched,
                            instrumentation::instrumentation & instrumentation,
-                           streams & streams)
+                           push_event_fn_t push_event_fn)
 {
+  auto used_gauge = instrumentation.add_gauge(k_buffer_used_service,
+                                             k_buffer_used_desc);
+  auto pooled_gauge = instrumentation.add_gauge(k_buffer_pooled_service,
+                                               k_buffer_pooled_desc);
+
   sched.add_periodic_task(
-      [&]() { snapshot(instrumentation, streams); },
+      [&, push_event_fn, used_gauge, pooled_gauge]()
+      {
+        used_gauge.update_fn(buffer_pool::used_bytes() / 1024);
+        pooled_gauge.update_fn(buffer_pool::pooled_bytes() / 1024);
+
+        snapshot(instrumentation, push_event_fn);
+      },
       k_snapshot_interval
   );
 }
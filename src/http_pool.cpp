@@ -0,0 +1,292 @@
+#include <glog/logging.h>
+#include <http_pool.h>
+#include <transport/listen_tcp_socket.h>
+#include <transport/tcp_connection.h>
+
+using namespace std::placeholders;
+
+namespace {
+
+const std::string k_events_path = "/events";
+
+const std::string k_requests_service = "http requests rate";
+const std::string k_requests_desc = "http requests received";
+
+const std::string k_invalid_service = "http invalid requests rate";
+const std::string k_invalid_desc = "http requests that could not be read or "
+                                   "had invalid events";
+
+const std::string k_continue = "HTTP/1.1 100 Continue\r\n\r\n";
+
+// Interval to check if paused connections can be read again
+const float k_resume_interval = 0.01;
+
+const char * reason(const int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 417: return "Expectation Failed";
+    case 431: return "Request Header Fields Too Large";
+    case 501: return "Not Implemented";
+    case 505: return "HTTP Version Not Supported";
+    default: return "Error";
+  }
+}
+
+/* Errors are ours and need no escaping */
+std::string error_body(const std::string & error) {
+  return "{\"ok\":false,\"error\":\"" + error + "\"}";
+}
+
+void respond(tcp_connection & conn, const int status, const std::string & body,
+             const bool close)
+{
+
+  std::string response;
+  response.reserve(160 + body.size());
+
+  response += "HTTP/1.1 " + std::to_string(status) + " " + reason(status)
+              + "\r\nContent-Type: application/json\r\nContent-Length: "
+              + std::to_string(body.size()) + "\r\n";
+
+  if (status == 405) {
+    response += "Allow: POST\r\n";
+  }
+
+  if (close) {
+    response += "Connection: close\r\n";
+  }
+
+  response += "\r\n";
+  response += body;
+
+  struct iovec iov = {const_cast<char *>(response.data()), response.size()};
+  conn.write_vec(&iov, 1);
+}
+
+async_fd::mode conn_mode(const tcp_connection & conn, const bool read) {
+
+  if (conn.pending_write()) {
+    return read ? async_fd::readwrite : async_fd::write;
+  }
+
+  return read ? async_fd::read : async_fd::none;
+}
+
+}
+
+http_pool::http_pool(size_t thread_num, uint32_t port, size_t max_body_size,
+                     http_events_fn_t events_fn, hook_fn_t run_fn,
+                     instrumentation::instrumentation & instr)
+:
+  thread_num_(thread_num),
+  port_(port),
+  max_body_size_(max_body_size),
+  events_fn_(events_fn),
+  run_fn_(run_fn),
+  paused_fn_(),
+  requests_rate_(instr.add_rate(k_requests_service, k_requests_desc)),
+  invalid_rate_(instr.add_rate(k_invalid_service, k_invalid_desc)),
+  parsers_(thread_num),
+  msgs_(thread_num),
+  connections_(thread_num),
+  paused_(thread_num),
+  tcp_pool_(thread_num,
+            std::bind(&http_pool::run_hook, this, _1),
+            std::bind(&http_pool::create_conn, this, _1, _2, _3),
+            std::bind(&http_pool::tcp_ready, this, _1, _2))
+{
+}
+
+void http_pool::set_paused_fn(http_paused_fn_t paused_fn) {
+  paused_fn_ = paused_fn;
+}
+
+void http_pool::start_threads() {
+
+  for (size_t i = 0; i < thread_num_; i++) {
+    tcp_pool_.add_listen_fd(i, create_tcp_listen_socket(port_, true));
+  }
+
+  tcp_pool_.start_threads();
+}
+
+void http_pool::stop_threads() {
+  tcp_pool_.stop_threads();
+}
+
+void http_pool::run_hook(async_loop & loop) {
+
+  if (run_fn_) {
+    run_fn_(loop);
+  }
+
+  if (paused_fn_) {
+    loop.add_periodic_task("", [=, &loop](size_t) { resume(loop); },
+                           k_resume_interval);
+  }
+
+}
+
+void http_pool::create_conn(int fd, async_loop & loop, tcp_connection &) {
+  connections_[loop.id()].insert(
+      {fd, http_connection{http_request(max_body_size_), false}});
+}
+
+void http_pool::tcp_ready(async_fd & async, tcp_connection & conn) {
+
+  const size_t tid = async.loop().id();
+
+  auto & connections = connections_[tid];
+
+  auto it = connections.find(async.fd());
+  CHECK(it != connections.end()) << "fd not found";
+
+  auto & http_conn = it->second;
+
+  if (async.ready_write()) {
+    conn.write();
+  }
+
+  if (async.ready_read() && !http_conn.closing && !conn.close_connection) {
+
+    if (conn.read()) {
+      read_requests(tid, conn, http_conn);
+    } else if (!conn.close_connection) {
+      LOG(ERROR) << "http connection buffer is full, closing connection";
+      conn.close_connection = true;
+    }
+
+  }
+
+  if (http_conn.closing && !conn.pending_write()) {
+    conn.close_connection = true;
+  }
+
+  auto & paused = paused_[tid];
+
+  if (conn.close_connection) {
+    paused.erase(async.fd());
+    connections.erase(it);
+    return;
+  }
+
+  const bool read = !http_conn.closing && (!paused_fn_ || !paused_fn_());
+
+  async.set_mode(conn_mode(conn, read));
+
+  if (!read && !http_conn.closing) {
+    paused.insert({async.fd(), &conn});
+  }
+
+}
+
+void http_pool::read_requests(const size_t tid, tcp_connection & conn,
+                              http_connection & http_conn)
+{
+
+  auto & request = http_conn.request;
+  auto & buffer = conn.r_buffer;
+
+  // Pipelined requests are answered in order
+  while (!buffer.empty() && !http_conn.closing) {
+
+    const size_t used = request.parse(
+        reinterpret_cast<const char *>(buffer.data()), buffer.size());
+
+    buffer.consume(used);
+
+    if (request.expect_continue()) {
+      struct iovec iov = {const_cast<char *>(k_continue.data()),
+                          k_continue.size()};
+      conn.write_vec(&iov, 1);
+    }
+
+    if (request.failed()) {
+      VLOG(3) << "invalid http request: " << request.error();
+      requests_rate_(1);
+      invalid_rate_(1);
+      respond(conn, request.status(), error_body(request.error()), true);
+      http_conn.closing = true;
+      return;
+    }
+
+    if (!request.done()) {
+      return;
+    }
+
+    handle_request(tid, conn, http_conn);
+    request.reset();
+  }
+
+}
+
+void http_pool::handle_request(const size_t tid, tcp_connection & conn,
+                               http_connection & http_conn)
+{
+
+  auto & request = http_conn.request;
+  const bool close = !request.keep_alive();
+
+  requests_rate_(1);
+
+  if (close) {
+    http_conn.closing = true;
+  }
+
+  if (request.path() != k_events_path) {
+    invalid_rate_(1);
+    respond(conn, 404, error_body("not found"), close);
+    return;
+  }
+
+  if (request.method() != "POST") {
+    invalid_rate_(1);
+    respond(conn, 405, error_body("method not allowed"), close);
+    return;
+  }
+
+  auto & msg = msgs_[tid];
+  auto & parser = parsers_[tid];
+  const auto & body = request.body();
+
+  // A request is taken whole or not at all
+  if (!parser.parse(body.data(), body.size(), msg)) {
+    msg.Clear();
+    invalid_rate_(1);
+    respond(conn, 400, error_body(parser.error()), close);
+    return;
+  }
+
+  const int events = msg.events_size();
+
+  if (events > 0) {
+    events_fn_(msg, body.size());
+    msg.Clear();
+  }
+
+  respond(conn, 200, "{\"ok\":true,\"events\":" + std::to_string(events) + "}",
+          close);
+}
+
+void http_pool::resume(async_loop & loop) {
+
+  auto & paused = paused_[loop.id()];
+
+  if (paused.empty() || paused_fn_()) {
+    return;
+  }
+
+  for (const auto & p : paused) {
+    loop.set_fd_mode(p.first, conn_mode(*p.second, true));
+  }
+
+  paused.clear();
+}
+
+http_pool::~http_pool() {
+  stop_threads();
+}
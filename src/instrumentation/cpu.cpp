@@ -0,0 +1,24 @@
+#include <fstream>
+#include <string>
+#include <instrumentation/cpu.h>
+
+bool host_cpu_times(uint64_t & busy, uint64_t & total)
+{
+
+  std::ifstream stat_stream("/proc/stat", std::ios_base::in);
+
+  std::string cpu;
+  uint64_t user, nice, system, idle, iowait, irq, softirq, steal;
+
+  stat_stream >> cpu >> user >> nice >> system >> idle >> iowait >> irq
+              >> softirq >> steal;
+
+  if (!stat_stream || cpu != "cpu") {
+    return false;
+  }
+
+  busy = user + nice + system + irq + softirq + steal;
+  total = busy + idle + iowait;
+
+  return true;
+}
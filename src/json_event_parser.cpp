@@ -0,0 +1,549 @@
+#include <cmath>
+#include <cstring>
+#include <json_event_parser.h>
+#include <util/parse_number.h>
+
+namespace {
+
+const uint64_t k_ones = 0x0101010101010101ull;
+const uint64_t k_highs = 0x8080808080808080ull;
+
+inline bool is_space(const char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool is_number_char(const char c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.'
+         || c == 'e' || c == 'E';
+}
+
+inline bool is_special(const unsigned char c) {
+  return c == '"' || c == '\\' || c < 0x20;
+}
+
+/* Sets the high bit of the bytes in w that end a plain run of a string:
+ * quotes, backslashes and control characters. Bytes above a flagged one
+ * may be flagged too, the lowest one is always right.
+ */
+inline uint64_t special_bytes(const uint64_t w) {
+
+  const uint64_t quote = w ^ (k_ones * '"');
+  const uint64_t backslash = w ^ (k_ones * '\\');
+
+  return (((quote - k_ones) & ~quote)
+          | ((backslash - k_ones) & ~backslash)
+          | ((w - k_ones * 0x20) & ~w))
+         & k_highs;
+}
+
+/* Strings are scanned eight bytes at a time */
+const char * find_special(const char * p, const char * end) {
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  for (; end - p >= 8; p += 8) {
+
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+
+    if (const uint64_t special = special_bytes(w)) {
+      return p + (__builtin_ctzll(special) >> 3);
+    }
+  }
+#endif
+
+  for (; p < end; p++) {
+    if (is_special(*p)) {
+      return p;
+    }
+  }
+
+  return end;
+}
+
+bool parse_hex4(const char * p, uint32_t & out) {
+
+  out = 0;
+
+  for (int i = 0; i < 4; i++) {
+
+    const char c = p[i];
+    out <<= 4;
+
+    if (c >= '0' && c <= '9') {
+      out |= c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      out |= c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      out |= c - 'A' + 10;
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void append_utf8(std::string & s, const uint32_t cp) {
+
+  if (cp < 0x80) {
+    s.push_back(cp);
+  } else if (cp < 0x800) {
+    s.push_back(0xc0 | (cp >> 6));
+    s.push_back(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    s.push_back(0xe0 | (cp >> 12));
+    s.push_back(0x80 | ((cp >> 6) & 0x3f));
+    s.push_back(0x80 | (cp & 0x3f));
+  } else {
+    s.push_back(0xf0 | (cp >> 18));
+    s.push_back(0x80 | ((cp >> 12) & 0x3f));
+    s.push_back(0x80 | ((cp >> 6) & 0x3f));
+    s.push_back(0x80 | (cp & 0x3f));
+  }
+}
+
+template <size_t N>
+inline bool key_is(const char * key, const size_t size, const char (&name)[N])
+{
+  return size == N - 1 && memcmp(key, name, N - 1) == 0;
+}
+
+}
+
+json_event_parser::json_event_parser()
+  :
+    data_(nullptr),
+    p_(nullptr),
+    end_(nullptr),
+    key_(),
+    value_(),
+    error_()
+{
+}
+
+bool json_event_parser::parse(const char * data, const size_t size,
+                              riemann::Msg & msg)
+{
+
+  data_ = p_ = data;
+  end_ = data + size;
+  error_.clear();
+
+  skip_space();
+
+  while (p_ < end_) {
+
+    if (*p_ == '{') {
+
+      if (!parse_event(*msg.add_events())) {
+        return false;
+      }
+
+    } else if (*p_ == '[') {
+
+      if (!parse_array(msg)) {
+        return false;
+      }
+
+    } else {
+      return fail("expected an event or an array of events");
+    }
+
+    skip_space();
+  }
+
+  return true;
+}
+
+const std::string & json_event_parser::error() const {
+  return error_;
+}
+
+bool json_event_parser::parse_array(riemann::Msg & msg) {
+
+  p_++;
+  skip_space();
+
+  if (p_ < end_ && *p_ == ']') {
+    p_++;
+    return true;
+  }
+
+  while (true) {
+
+    if (p_ == end_ || *p_ != '{') {
+      return fail("expected an event");
+    }
+
+    if (!parse_event(*msg.add_events())) {
+      return false;
+    }
+
+    skip_space();
+
+    if (p_ < end_ && *p_ == ',') {
+      p_++;
+      skip_space();
+      continue;
+    }
+
+    if (p_ < end_ && *p_ == ']') {
+      p_++;
+      return true;
+    }
+
+    return fail("expected , or ]");
+  }
+}
+
+bool json_event_parser::parse_event(riemann::Event & event) {
+
+  p_++;
+  skip_space();
+
+  if (p_ < end_ && *p_ == '}') {
+    p_++;
+    return true;
+  }
+
+  while (true) {
+
+    if (p_ == end_ || *p_ != '"') {
+      return fail("expected a field name");
+    }
+
+    const char * key;
+    size_t key_size;
+
+    if (!parse_string(key_, key, key_size)) {
+      return false;
+    }
+
+    skip_space();
+
+    if (p_ == end_ || *p_ != ':') {
+      return fail("expected :");
+    }
+
+    p_++;
+    skip_space();
+
+    if (!parse_field(event, key, key_size)) {
+      return false;
+    }
+
+    skip_space();
+
+    if (p_ < end_ && *p_ == ',') {
+      p_++;
+      skip_space();
+      continue;
+    }
+
+    if (p_ < end_ && *p_ == '}') {
+      p_++;
+      return true;
+    }
+
+    return fail("expected , or }");
+  }
+}
+
+bool json_event_parser::parse_field(riemann::Event & event, const char * key,
+                                    const size_t key_size)
+{
+
+  if (p_ == end_) {
+    return fail("expected a value");
+  }
+
+  if (*p_ == 'n') {
+    return scan_literal("null", 4);
+  }
+
+  const char * s;
+  size_t size;
+
+  if (key_is(key, key_size, "host") || key_is(key, key_size, "service")
+      || key_is(key, key_size, "state")
+      || key_is(key, key_size, "description"))
+  {
+
+    if (*p_ != '"') {
+      return fail("expected a string");
+    }
+
+    if (!parse_string(value_, s, size)) {
+      return false;
+    }
+
+    switch (key[0]) {
+      case 'h': event.set_host(s, size); break;
+      case 's': key[1] == 'e' ? event.set_service(s, size)
+                              : event.set_state(s, size); break;
+      default: event.set_description(s, size); break;
+    }
+
+    return true;
+  }
+
+  if (key_is(key, key_size, "time") || key_is(key, key_size, "metric")
+      || key_is(key, key_size, "ttl"))
+  {
+
+    if (!scan_number(s, size)) {
+      return false;
+    }
+
+    int64_t integer;
+    double value;
+
+    const bool is_integer = parse_int64(s, size, integer);
+
+    if (!is_integer && (!parse_double(s, size, value)
+                        || !std::isfinite(value)))
+    {
+      return fail("invalid number");
+    }
+
+    if (key[0] == 'm') {
+      if (is_integer) {
+        event.set_metric_sint64(integer);
+      } else {
+        event.set_metric_d(value);
+      }
+    } else if (key[0] == 't' && key[1] == 'i') {
+      event.set_time(is_integer ? integer : static_cast<int64_t>(value));
+    } else {
+      event.set_ttl(is_integer ? integer : value);
+    }
+
+    return true;
+  }
+
+  if (key_is(key, key_size, "tags")) {
+    return parse_tags(event);
+  }
+
+  // The key may be in key_, which the value doesn't touch
+  if (*p_ == '"') {
+
+    if (!parse_string(value_, s, size)) {
+      return false;
+    }
+
+  } else if (*p_ == 't') {
+
+    s = p_;
+    size = 4;
+
+    if (!scan_literal("true", 4)) {
+      return false;
+    }
+
+  } else if (*p_ == 'f') {
+
+    s = p_;
+    size = 5;
+
+    if (!scan_literal("false", 5)) {
+      return false;
+    }
+
+  } else if (is_number_char(*p_)) {
+
+    if (!scan_number(s, size)) {
+      return false;
+    }
+
+  } else {
+    return fail("attributes must be strings, numbers or booleans");
+  }
+
+  auto attribute = event.add_attributes();
+  attribute->set_key(key, key_size);
+  attribute->set_value(s, size);
+
+  return true;
+}
+
+bool json_event_parser::parse_tags(riemann::Event & event) {
+
+  if (*p_ != '[') {
+    return fail("expected an array of tags");
+  }
+
+  p_++;
+  skip_space();
+
+  if (p_ < end_ && *p_ == ']') {
+    p_++;
+    return true;
+  }
+
+  while (true) {
+
+    if (p_ == end_ || *p_ != '"') {
+      return fail("tags must be strings");
+    }
+
+    const char * s;
+    size_t size;
+
+    if (!parse_string(value_, s, size)) {
+      return false;
+    }
+
+    event.add_tags(s, size);
+
+    skip_space();
+
+    if (p_ < end_ && *p_ == ',') {
+      p_++;
+      skip_space();
+      continue;
+    }
+
+    if (p_ < end_ && *p_ == ']') {
+      p_++;
+      return true;
+    }
+
+    return fail("expected , or ]");
+  }
+}
+
+bool json_event_parser::parse_string(std::string & scratch, const char * & s,
+                                     size_t & size)
+{
+
+  const char * start = ++p_;
+  const char * q = find_special(p_, end_);
+
+  // Most strings have no escapes and are used in place
+  if (q < end_ && *q == '"') {
+    s = start;
+    size = q - start;
+    p_ = q + 1;
+    return true;
+  }
+
+  scratch.assign(start, q - start);
+
+  while (true) {
+
+    p_ = q;
+
+    if (q == end_) {
+      return fail("unterminated string");
+    }
+
+    if (*q == '"') {
+      break;
+    }
+
+    if (*q != '\\') {
+      return fail("control character in string");
+    }
+
+    if (++q == end_) {
+      return fail("unterminated string");
+    }
+
+    switch (*q) {
+      case '"': scratch.push_back('"'); break;
+      case '\\': scratch.push_back('\\'); break;
+      case '/': scratch.push_back('/'); break;
+      case 'b': scratch.push_back('\b'); break;
+      case 'f': scratch.push_back('\f'); break;
+      case 'n': scratch.push_back('\n'); break;
+      case 'r': scratch.push_back('\r'); break;
+      case 't': scratch.push_back('\t'); break;
+      case 'u':
+      {
+        uint32_t cp;
+
+        if (end_ - q < 5 || !parse_hex4(q + 1, cp)) {
+          return fail("invalid unicode escape");
+        }
+
+        q += 4;
+
+        // Characters outside the basic plane come as a surrogate pair
+        if (cp >= 0xd800 && cp <= 0xdbff) {
+
+          uint32_t low;
+
+          if (end_ - q < 7 || q[1] != '\\' || q[2] != 'u'
+              || !parse_hex4(q + 3, low) || low < 0xdc00 || low > 0xdfff)
+          {
+            return fail("invalid unicode escape");
+          }
+
+          cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+          q += 6;
+
+        } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+          return fail("invalid unicode escape");
+        }
+
+        append_utf8(scratch, cp);
+        break;
+      }
+      default:
+        return fail("invalid escape");
+    }
+
+    q++;
+
+    const char * run = q;
+    q = find_special(q, end_);
+    scratch.append(run, q - run);
+  }
+
+  s = scratch.data();
+  size = scratch.size();
+  p_++;
+
+  return true;
+}
+
+bool json_event_parser::scan_number(const char * & s, size_t & size) {
+
+  s = p_;
+
+  while (p_ < end_ && is_number_char(*p_)) {
+    p_++;
+  }
+
+  size = p_ - s;
+
+  if (size == 0) {
+    return fail("expected a number");
+  }
+
+  return true;
+}
+
+bool json_event_parser::scan_literal(const char * literal, const size_t size)
+{
+
+  if (size_t(end_ - p_) < size || memcmp(p_, literal, size) != 0) {
+    return fail("invalid literal");
+  }
+
+  p_ += size;
+
+  return true;
+}
+
+void json_event_parser::skip_space() {
+  while (p_ < end_ && is_space(*p_)) {
+    p_++;
+  }
+}
+
+bool json_event_parser::fail(const char * what) {
+  error_ = std::string(what) + " at byte " + std::to_string(p_ - data_);
+  return false;
+}
@@ -1,5 +1,6 @@
 #include <os/mock_os_functions.h>
 #include <algorithm>
+#include <cerrno>
 
 ssize_t mock_os_functions::recv(int, void *buf, size_t len, int) {
   auto min = std::min(len, buffer.size());
@@ -7,9 +8,27 @@ ssize_t mock_os_functions::recv(int, void *buf, size_t len, int) {
   return min;
 }
 
-ssize_t mock_os_functions::write(int, void *buf, size_t count) {
+ssize_t mock_os_functions::write(int, const void *buf, size_t count) {
   auto min = std::min(count, buffer.capacity());
-  auto pbuf = static_cast<char*>(buf);
+  auto pbuf = static_cast<const char*>(buf);
   buffer.insert(buffer.end(), pbuf, pbuf + min);
   return min;
 }
+
+ssize_t mock_os_functions::sendmsg(int, const struct msghdr *msg, int) {
+
+  if (socket_full) {
+    errno = EAGAIN;
+    return -1;
+  }
+
+  ssize_t n = 0;
+
+  for (size_t i = 0; i < msg->msg_iovlen; i++) {
+    auto pbuf = static_cast<const char*>(msg->msg_iov[i].iov_base);
+    buffer.insert(buffer.end(), pbuf, pbuf + msg->msg_iov[i].iov_len);
+    n += msg->msg_iov[i].iov_len;
+  }
+
+  return n;
+}
@@ -8,6 +8,10 @@ ssize_t os_functions::recv(int fd, void *buf, size_t len, int flags) {
   return impl_.recv(fd, buf, len, flags);
 }
 
-ssize_t os_functions::write(int fd, void *buf, size_t count) {
+ssize_t os_functions::write(int fd, const void *buf, size_t count) {
   return impl_.write(fd, buf, count);
 }
+
+ssize_t os_functions::sendmsg(int fd, const struct msghdr *msg, int flags) {
+  return impl_.sendmsg(fd, msg, flags);
+}
@@ -7,9 +7,15 @@ ssize_t real_os_functions::recv(int fd, void *buf, size_t len, int flags) {
   return ::recv(fd, buf, len, flags);
 }
 
-ssize_t real_os_functions::write(int fd, void *buf, size_t count) {
+ssize_t real_os_functions::write(int fd, const void *buf, size_t count) {
   return ::write(fd, buf, count);
 }
 
+ssize_t real_os_functions::sendmsg(int fd, const struct msghdr *msg,
+                                   int flags)
+{
+  return ::sendmsg(fd, msg, flags);
+}
+
 real_os_functions real_os;
 os_functions g_os_functions(real_os);
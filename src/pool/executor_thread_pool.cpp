@@ -1,13 +1,43 @@
 #include <glog/logging.h>
+#include <future>
+#include <streams/lib.h>
+#include <util/util.h>
+#include <instrumentation/cpu.h>
 #include <pool/executor_thread_pool.h>
 
 namespace {
 
 const std::string k_exec_pool_service = "executor pool queue size";
 const std::string k_exec_pool_desc = "number of pending tasks";
+const std::string k_exec_thread_service = "executor thread queue size ";
+const std::string k_exec_thread_desc = "number of pending tasks in thread";
 const size_t k_stop_attempts = 50;
 const size_t k_stop_interval_check_ms  = 100;
-const size_t k_max_queue_size = 1e+7;
+const size_t k_inbox_capacity = 4096;
+const size_t k_batch_size = 32;
+const size_t k_park_timeout_ms = 10;
+const size_t k_inactive_park_timeout_ms = 1000;
+const size_t k_mb = 1024 * 1024;
+
+const std::string k_pool_size_service = "executor pool active threads";
+const std::string k_pool_size_desc = "number of executor threads taking tasks";
+const std::string k_wait_service = "executor pool queue wait";
+const std::string k_wait_desc = "average time in us tasks wait to run";
+const std::string k_scale_up_service = "executor pool scale up rate";
+const std::string k_scale_up_desc = "threads added by autoscaling";
+const std::string k_scale_down_service = "executor pool scale down rate";
+const std::string k_scale_down_desc = "threads removed by autoscaling";
+
+typedef std::chrono::steady_clock steady_clock;
+
+size_t pool_threads(const config & conf) {
+
+  if (conf.executor_partition != "none") {
+    return conf.executor_pool_size;
+  }
+
+  return std::max(conf.executor_pool_size, conf.executor_max_pool_size);
+}
 
 }
 
@@ -16,30 +46,238 @@ executor_thread_pool::executor_thread_pool(
     const config & conf)
   :
     task_guague_(instr.add_gauge(k_exec_pool_service, k_exec_pool_desc)),
-    finished_threads_(conf.executor_pool_size, 0),
-    next_thread_(0),
-    tasks_(conf.executor_pool_size)
+    partitioned_(conf.executor_partition != "none"),
+    stealing_(conf.executor_work_stealing && !partitioned_),
+    high_watermark_(conf.ingest_high_watermark_mb * k_mb),
+    low_watermark_(conf.ingest_low_watermark_mb * k_mb),
+    queued_bytes_(0),
+    paused_(false),
+    autoscale_(conf.executor_max_pool_size > 0 && !partitioned_),
+    min_size_(std::max<size_t>(conf.executor_min_pool_size, 1)),
+    max_size_(pool_threads(conf)),
+    scale_up_wait_us_(conf.executor_scale_up_wait_us),
+    scale_down_wait_us_(conf.executor_scale_down_wait_us),
+    max_cpu_usage_(conf.executor_max_cpu_usage / 100.0),
+    active_(conf.executor_pool_size),
+    stopping_(false),
+    cpu_busy_(0),
+    cpu_total_(0),
+    size_gauge_(instr.add_gauge(k_pool_size_service, k_pool_size_desc)),
+    wait_gauge_(instr.add_gauge(k_wait_service, k_wait_desc)),
+    scale_up_rate_(instr.add_rate(k_scale_up_service, k_scale_up_desc)),
+    scale_down_rate_(instr.add_rate(k_scale_down_service, k_scale_down_desc)),
+    finished_threads_(pool_threads(conf), 0),
+    next_thread_(0)
 {
 
+  if (partitioned_) {
+    set_stream_shards(conf.executor_pool_size);
+    set_stream_partition(conf.executor_partition == "host"
+                         ? std::vector<std::string>{"host"}
+                         : std::vector<std::string>{"host", "service"});
+  }
+
+  if (autoscale_) {
+
+    min_size_ = std::min(min_size_, max_size_);
+    active_ = std::min(std::max(active_.load(), min_size_), max_size_);
+
+    host_cpu_usage();
+
+  }
+
+  size_gauge_.update_fn(active_);
+
+  for (size_t i = 0; i < max_size_; i++) {
+
+    const auto service = k_exec_thread_service + std::to_string(i);
+
+    workers_.emplace_back(new worker_t(
+          instr.add_gauge(service, k_exec_thread_desc), k_inbox_capacity));
+
+  }
+
   auto run_fn = [=](const int i)
   {
-    run_tasks(i);
+    if (stealing_) {
+      run_stealing_tasks(i);
+    } else {
+      run_tasks(i);
+    }
   };
 
+  for (size_t i = 0; i < max_size_; i++) {
 
-  for (size_t i = 0; i < conf.executor_pool_size; i++) {
-    tasks_[i].set_capacity(k_max_queue_size);
     threads_.push_back(std::move(std::thread(run_fn, i)));
+
+    if (conf.executor_pin_threads) {
+      set_thread_affinity(threads_.back(), i);
+    }
+
   }
 
 }
 
 void executor_thread_pool::add_task(const task_fn_t & task) {
 
-  task_guague_.incr_fn(1);
-  tasks_[next_thread_].push({task, false});
+  add_task(task, 0);
+
+}
+
+void executor_thread_pool::add_task(const size_t shard,
+                                    const task_fn_t & task)
+{
+
+  add_task(shard, task, 0);
+
+}
+
+void executor_thread_pool::add_task(const task_fn_t & task,
+                                    const size_t bytes)
+{
+
+  const auto active = active_.load(std::memory_order_relaxed);
+
+  push_task(next_thread_.fetch_add(1) % active, {task, false, bytes});
+
+}
+
+void executor_thread_pool::add_task(const size_t shard,
+                                    const task_fn_t & task,
+                                    const size_t bytes)
+{
+
+  push_task(shard % workers_.size(), {task, false, bytes});
+
+}
+
+bool executor_thread_pool::paused() const {
+  return paused_.load(std::memory_order_relaxed);
+}
+
+void executor_thread_pool::set_resume_fn(task_fn_t resume_fn) {
+  resume_fn_ = resume_fn;
+}
+
+void executor_thread_pool::push_task(const size_t i, task_t task) {
+
+  if (!task.stop) {
+    task_guague_.incr_fn(1);
+    workers_[i]->depth_gauge.incr_fn(1);
+  }
+
+  if (task.bytes && high_watermark_) {
+
+    auto queued = queued_bytes_.fetch_add(task.bytes) + task.bytes;
+
+    if (queued > high_watermark_ && !paused_.exchange(true)) {
+      LOG(WARNING) << "executor queues are above the high watermark, "
+                   << "pausing ingestion";
+    }
+
+  }
+
+  if (autoscale_) {
+    task.queued_at = steady_clock::now();
+  }
+
+  workers_[i]->inbox.push(std::move(task));
+
+  wake(i);
+
+}
+
+size_t executor_thread_pool::size() const {
+  return workers_.size();
+}
+
+bool executor_thread_pool::autoscaling() const {
+  return autoscale_;
+}
+
+size_t executor_thread_pool::active_threads() const {
+  return active_.load();
+}
+
+void executor_thread_pool::autoscale() {
+
+  if (!autoscale_) {
+    return;
+  }
+
+  uint64_t wait_us = 0;
+  uint64_t tasks = 0;
+
+  for (const auto & w : workers_) {
+    wait_us += w->wait_us.exchange(0);
+    tasks += w->waited_tasks.exchange(0);
+  }
+
+  const uint64_t avg_wait_us = tasks ? wait_us / tasks : 0;
+  const double cpu_usage = host_cpu_usage();
+
+  wait_gauge_.update_fn(avg_wait_us);
+
+  auto active = active_.load();
+
+  if (avg_wait_us > scale_up_wait_us_ && active < max_size_) {
+
+    if (cpu_usage > max_cpu_usage_) {
+      VLOG(1) << "not adding executor threads, host cpu usage: " << cpu_usage;
+      return;
+    }
+
+    active++;
+    scale_up_rate_(1);
+
+  } else if (avg_wait_us < scale_down_wait_us_ && active > min_size_) {
+
+    active--;
+    scale_down_rate_(1);
+
+  } else {
+
+    return;
+
+  }
+
+  VLOG(1) << "resizing executor pool to " << active << " threads, queue wait: "
+          << avg_wait_us << "us cpu usage: " << cpu_usage;
+
+  active_.store(active);
+  size_gauge_.update_fn(active);
 
-  next_thread_ = (next_thread_ + 1) % tasks_.size();
+}
+
+void executor_thread_pool::sync() {
+
+  CHECK(!stealing_) << "sync() needs work stealing to be disabled";
+
+  auto pending = std::make_shared<std::atomic<size_t>>(workers_.size());
+  auto done = std::make_shared<std::promise<void>>();
+  auto future = done->get_future();
+
+  for (size_t i = 0; i < workers_.size(); i++) {
+
+    add_task(i, [=]() {
+
+      if (pending->fetch_sub(1) == 1) {
+        done->set_value();
+      }
+
+    });
+
+  }
+
+  // A stopping pool drops the tasks without running them
+  while (future.wait_for(std::chrono::milliseconds(k_stop_interval_check_ms))
+         != std::future_status::ready)
+  {
+    if (stopping_.load(std::memory_order_relaxed)) {
+      VLOG(3) << "sync() on a stopped executor_thread_pool";
+      return;
+    }
+  }
 
 }
 
@@ -47,9 +285,12 @@ void executor_thread_pool::stop() {
 
   VLOG(3) << "stopping executor_thread_pool";
 
+  // Only the executor threads can pop from their inbox, they drop the
+  // pending tasks once they see stopping_
+  stopping_ = true;
+
   for (size_t i = 0; i < threads_.size(); i++) {
-    tasks_[i].clear();
-    tasks_[i].push({{}, true});
+    push_task(i, {{}, true, 0});
   }
 
   for (size_t attempts = k_stop_attempts; attempts > 0; attempts--) {
@@ -80,19 +321,44 @@ void executor_thread_pool::run_tasks(const int i) {
 
   VLOG(3) << "starting executor thread";
 
-  task_t task;
+  if (partitioned_) {
+    set_thread_shard(i);
+  }
 
-  while (true) {
+  auto & worker = *workers_[i];
 
-    tasks_[i].pop(task);
+  auto & tasks = worker.batch;
+  bool stop = false;
 
-    if (task.stop) {
-      break;
+  while (!stop) {
+
+    tasks.clear();
+
+    if (worker.inbox.pop_batch(tasks, k_batch_size) == 0) {
+      park(i);
+      continue;
     }
 
-    task.fn();
+    for (const auto & task : tasks) {
+
+      if (task.stop) {
+        stop = true;
+        break;
+      }
 
-    task_guague_.decr_fn(1);
+      worker.depth_gauge.decr_fn(1);
+
+      if (stopping_.load(std::memory_order_relaxed)) {
+        continue;
+      }
+
+      start_task(i, task);
+
+      task.fn();
+
+      finish_task(task);
+
+    }
 
   }
 
@@ -101,3 +367,223 @@ void executor_thread_pool::run_tasks(const int i) {
   VLOG(3) << "run_tasks()--";
 
 }
+
+void executor_thread_pool::run_stealing_tasks(const int i) {
+
+  VLOG(3) << "starting work stealing executor thread";
+
+  auto & worker = *workers_[i];
+
+  task_t * task;
+  bool stop = false;
+
+  while (!stop) {
+
+    if (worker.deque.empty() && fill_deque(i, stop)) {
+      wake_any(i);
+    }
+
+    if (worker.deque.pop(task)) {
+      worker.depth_gauge.decr_fn(1);
+    } else if (!steal_task(i, task)) {
+
+      if (!stop) {
+        park(i);
+      }
+
+      continue;
+    }
+
+    if (!stopping_.load(std::memory_order_relaxed)) {
+      start_task(i, *task);
+      task->fn();
+      finish_task(*task);
+    }
+
+    delete task;
+
+  }
+
+  while (worker.deque.pop(task)) {
+    delete task;
+  }
+
+  finished_threads_[i] = 1;
+
+  VLOG(3) << "run_stealing_tasks()--";
+
+}
+
+void executor_thread_pool::start_task(const size_t i, const task_t & task) {
+
+  if (!autoscale_) {
+    return;
+  }
+
+  const auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+      steady_clock::now() - task.queued_at);
+
+  workers_[i]->wait_us.fetch_add(wait.count(), std::memory_order_relaxed);
+  workers_[i]->waited_tasks.fetch_add(1, std::memory_order_relaxed);
+
+}
+
+void executor_thread_pool::finish_task(const task_t & task) {
+
+  task_guague_.decr_fn(1);
+
+  if (!task.bytes || !high_watermark_) {
+    return;
+  }
+
+  auto queued = queued_bytes_.fetch_sub(task.bytes) - task.bytes;
+
+  if (queued < low_watermark_ && paused_.load(std::memory_order_relaxed)
+      && paused_.exchange(false))
+  {
+    LOG(INFO) << "executor queues are below the low watermark, "
+              << "resuming ingestion";
+
+    if (resume_fn_) {
+      resume_fn_();
+    }
+  }
+
+}
+
+/* Moves a batch of tasks from the inbox to the deque, returns true if there
+ * is more than one task left for other threads to steal.
+ */
+bool executor_thread_pool::fill_deque(const size_t i, bool & stop) {
+
+  auto & worker = *workers_[i];
+
+  auto & tasks = worker.batch;
+  size_t n = 0;
+
+  tasks.clear();
+  worker.inbox.pop_batch(tasks, k_batch_size);
+
+  for (auto & task : tasks) {
+
+    if (task.stop) {
+      stop = true;
+      break;
+    }
+
+    worker.deque.push(new task_t(std::move(task)));
+    n++;
+
+  }
+
+  return n > 1;
+}
+
+bool executor_thread_pool::steal_task(const size_t i, task_t * & task) {
+
+  if (!active(i)) {
+    return false;
+  }
+
+  for (size_t j = 1; j < workers_.size(); j++) {
+
+    auto & victim = *workers_[(i + j) % workers_.size()];
+
+    if (victim.deque.steal(task)) {
+      victim.depth_gauge.decr_fn(1);
+      return true;
+    }
+
+  }
+
+  return false;
+}
+
+bool executor_thread_pool::work_available(const size_t i) const {
+
+  if (!workers_[i]->inbox.empty()) {
+    return true;
+  }
+
+  if (!active(i)) {
+    return false;
+  }
+
+  for (const auto & w : workers_) {
+    if (!w->deque.empty()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void executor_thread_pool::park(const size_t i) {
+
+  auto & worker = *workers_[i];
+
+  std::unique_lock<std::mutex> lock(worker.mutex);
+
+  worker.parked.store(true);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  const auto timeout = active(i) ? k_park_timeout_ms
+                                 : k_inactive_park_timeout_ms;
+
+  if (!work_available(i)) {
+    worker.cond.wait_for(lock, std::chrono::milliseconds(timeout));
+  }
+
+  worker.parked.store(false);
+
+}
+
+void executor_thread_pool::wake(const size_t i) {
+
+  auto & worker = *workers_[i];
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (worker.parked.load()) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.cond.notify_one();
+  }
+
+}
+
+void executor_thread_pool::wake_any(const size_t i) {
+
+  for (size_t j = 1; j < workers_.size(); j++) {
+
+    const auto k = (i + j) % workers_.size();
+
+    if (active(k) && workers_[k]->parked.load()) {
+      wake(k);
+      return;
+    }
+
+  }
+
+}
+
+bool executor_thread_pool::active(const size_t i) const {
+  return i < active_.load(std::memory_order_relaxed);
+}
+
+/* Fraction of host cpu time spent busy since the last call */
+double executor_thread_pool::host_cpu_usage() {
+
+  uint64_t busy, total;
+
+  if (!host_cpu_times(busy, total) || total == cpu_total_) {
+    return 0;
+  }
+
+  const double usage = static_cast<double>(busy - cpu_busy_)
+                       / (total - cpu_total_);
+
+  cpu_busy_ = busy;
+  cpu_total_ = total;
+
+  return usage;
+}
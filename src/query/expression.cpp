@@ -1,3 +1,4 @@
+#include <stdexcept>
 #include <boost/variant/get.hpp>
 #include <glog/logging.h>
 #include <expression.h>
@@ -104,7 +105,10 @@ query_fn_t query_field::evaluate() const {
 
 query_fn_t query_field::evaluate_nil() const {
 
-   return [=](const Event & e) { return !e.has_field_set(*field_); };
+   // Copied, the function outlives the query tree
+   const std::string key(*field_);
+
+   return [=](const Event & e) { return !e.has_field_set(key); };
 
 }
 
@@ -212,7 +216,8 @@ query_fn_t query_field::evaluate(const int & value) const {
 
           return compare(std::stoi(e.attr(key)), ival, op);
 
-        } catch (std::invalid_argument &) { }
+        } catch (std::invalid_argument &) {
+        } catch (std::out_of_range &) { }
 
       }
 
@@ -242,7 +247,8 @@ query_fn_t query_field::evaluate(const double & value) const {
 
         try {
           return compare(std::stod(e.attr(key)), ival, op);
-        } catch (std::invalid_argument &) { }
+        } catch (std::invalid_argument &) {
+        } catch (std::out_of_range &) { }
 
       }
 
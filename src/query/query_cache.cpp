@@ -0,0 +1,80 @@
+#include <glog/logging.h>
+#include <driver.h>
+#include <query/query_cache.h>
+
+namespace {
+
+// Longer queries are compiled every time
+const size_t k_max_query_size = 4096;
+
+query_fn_t compile(const std::string & query) {
+
+  query_context query_ctx;
+  queryparser::driver driver(query_ctx);
+
+  if (!driver.parse_string(query, "query")) {
+    VLOG(1) << "failed to parse query: " << query;
+    return {};
+  }
+
+  return query_ctx.evaluate();
+}
+
+}
+
+query_cache::query_cache(const size_t max_size)
+  :
+    max_size_(std::max<size_t>(max_size, 1)),
+    mutex_(),
+    lru_(),
+    queries_()
+{
+}
+
+query_fn_t query_cache::get(const std::string & query) {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = queries_.find(&query);
+
+    if (it != queries_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return it->second->second;
+    }
+  }
+
+  auto query_fn = compile(query);
+
+  // Invalid queries are not kept, they would push out the good ones
+  if (!query_fn) {
+    return {};
+  }
+
+  if (query.size() > k_max_query_size) {
+    return query_fn;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (queries_.find(&query) != queries_.end()) {
+    return query_fn;
+  }
+
+  if (lru_.size() == max_size_) {
+    queries_.erase(&lru_.back().first);
+    lru_.pop_back();
+  }
+
+  lru_.emplace_front(query, query_fn);
+  queries_.insert({&lru_.front().first, lru_.begin()});
+
+  return query_fn;
+}
+
+size_t query_cache::size() {
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return lru_.size();
+}
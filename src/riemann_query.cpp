@@ -0,0 +1,98 @@
+#include <netinet/in.h>
+#include <cstring>
+#include <glog/logging.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <riemann_query.h>
+
+using google::protobuf::io::CodedOutputStream;
+
+namespace {
+
+const size_t k_header_size = sizeof(uint32_t);
+
+std::vector<char> frame(const riemann::Msg & msg) {
+
+  const size_t size = msg.ByteSize();
+  const uint32_t nsize = htonl(size);
+
+  std::vector<char> response(k_header_size + size);
+
+  memcpy(&response[0], &nsize, k_header_size);
+
+  msg.SerializeWithCachedSizesToArray(
+      reinterpret_cast<uint8_t *>(&response[k_header_size]));
+
+  return response;
+}
+
+std::vector<char> error_response(const std::string & error) {
+
+  riemann::Msg msg;
+  msg.set_ok(false);
+  msg.set_error(error);
+
+  return frame(msg);
+}
+
+}
+
+std::vector<char> riemann_query_response(
+    const std::vector<unsigned char> & raw_msg,
+    real_index & index,
+    query_cache & cache,
+    const size_t max_results,
+    const size_t max_frame_size)
+{
+
+  riemann::Msg msg;
+
+  if (!msg.ParseFromArray(raw_msg.data(), raw_msg.size())) {
+    VLOG(2) << "error parsing protobuf payload";
+    return error_response("invalid message");
+  }
+
+  const std::string query(msg.query().string());
+
+  std::vector<Event> events;
+
+  // Runs in the executor, which doesn't catch what clients can trigger
+  try {
+
+    auto query_fn = cache.get(query);
+
+    if (!query_fn) {
+      return error_response("parse error: " + query);
+    }
+
+    events = index.query_index(query_fn, max_results);
+
+  } catch (const std::exception & e) {
+    LOG(ERROR) << "exception running query " << query << " : " << e.what();
+    return error_response("query error: " + query);
+  }
+
+  msg.Clear();
+  msg.set_ok(true);
+
+  // Bytes of the frame so far, each event adds its tag and length
+  size_t bytes = k_header_size + msg.ByteSize();
+
+  for (const auto & e : events) {
+
+    riemann::Event event(e.riemann_event());
+
+    const size_t size = event.ByteSize();
+
+    bytes += 1 + CodedOutputStream::VarintSize32(size) + size;
+
+    if (bytes > max_frame_size) {
+      VLOG(1) << "query response truncated to " << msg.events_size()
+              << " of " << events.size() << " events: " << query;
+      break;
+    }
+
+    msg.add_events()->Swap(&event);
+  }
+
+  return frame(msg);
+}
@@ -3,6 +3,7 @@
 #include <sys/socket.h>
 #include <glog/logging.h>
 #include <algorithm>
+#include <google/protobuf/io/coded_stream.h>
 #include <common/event.h>
 #include <riemann_tcp_connection.h>
 
@@ -26,21 +27,186 @@ std::vector<char>  generate_msg_ok()
 
 const std::vector<char> ok_response(generate_msg_ok());
 
-bool add_ok_response(tcp_connection & connection) {
-  VLOG(3) << "adding ok response with size: " << ok_response.size();
+// Acks sent from one copy of the block, one iovec per block
+const size_t k_ok_block_responses = 256;
 
-  return connection.queue_write(&ok_response[0], ok_response.size());
+std::vector<char> generate_ok_block()
+{
+  std::vector<char> block;
+  block.reserve(ok_response.size() * k_ok_block_responses);
+
+  for (size_t i = 0; i < k_ok_block_responses; i++) {
+    block.insert(block.end(), ok_response.begin(), ok_response.end());
+  }
+
+  return block;
+}
+
+const std::vector<char> ok_block(generate_ok_block());
+
+/* Acks for every message read in one go are sent together, the ones the
+ * socket can't take are queued */
+bool add_ok_responses(tcp_connection & connection, size_t n) {
+  VLOG(3) << "adding " << n << " ok responses with size: "
+          << ok_response.size();
+
+  const size_t k_max_iov = 16;
+  struct iovec iov[k_max_iov];
+
+  while (n > 0) {
+
+    size_t iovcnt = 0;
+
+    for (; iovcnt < k_max_iov && n > 0; iovcnt++) {
+
+      const size_t responses = std::min(n, k_ok_block_responses);
+
+      iov[iovcnt].iov_base = const_cast<char *>(&ok_block[0]);
+      iov[iovcnt].iov_len = responses * ok_response.size();
+
+      n -= responses;
+    }
+
+    if (!connection.write_vec(iov, iovcnt)) {
+      return false;
+    }
+
+  }
+
+  return true;
+}
+
+bool read_varint(const unsigned char * & p, const unsigned char * end,
+                 uint64_t & value)
+{
+  value = 0;
+
+  for (size_t shift = 0; p < end && shift < 64; shift += 7) {
+
+    const unsigned char byte = *p++;
+
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+const uint64_t k_query_field = 5;
+
+/* Looks for the query field of a Msg by skipping over the others, which
+ * is much cheaper than parsing its events in the loop thread.
+ */
+bool has_query(const unsigned char * p, const size_t size) {
+
+  const unsigned char * end = p + size;
+
+  while (p < end) {
+
+    uint64_t key, value;
+
+    if (!read_varint(p, end, key)) {
+      return false;
+    }
+
+    if ((key >> 3) == k_query_field) {
+      return true;
+    }
+
+    size_t skip;
+
+    switch (key & 7) {
+      case 0:
+        if (!read_varint(p, end, value)) {
+          return false;
+        }
+        skip = 0;
+        break;
+      case 1:
+        skip = 8;
+        break;
+      case 2:
+        if (!read_varint(p, end, value)) {
+          return false;
+        }
+        skip = value;
+        break;
+      case 5:
+        skip = 4;
+        break;
+      default:
+        return false;
+    }
+
+    if (skip > static_cast<size_t>(end - p)) {
+      return false;
+    }
+
+    p += skip;
+  }
+
+  return false;
+}
+
+/* Drops events from the end of a query response until the frame takes no
+ * more than max_size bytes. Returns false when not even an empty one fits.
+ */
+bool truncate_response(std::vector<char> & response, const size_t max_size) {
+
+  using google::protobuf::io::CodedOutputStream;
+
+  const size_t header_size = sizeof(uint32_t);
+
+  riemann::Msg msg;
+
+  if (response.size() < header_size
+      || !msg.ParseFromArray(response.data() + header_size,
+                             response.size() - header_size))
+  {
+    return false;
+  }
+
+  size_t bytes = response.size();
+
+  while (bytes > max_size && msg.events_size() > 0) {
+
+    const size_t size = msg.events(msg.events_size() - 1).ByteSize();
+
+    bytes -= 1 + CodedOutputStream::VarintSize32(size) + size;
+
+    msg.mutable_events()->RemoveLast();
+  }
+
+  if (bytes > max_size) {
+    return false;
+  }
+
+  VLOG(1) << "query response truncated to " << msg.events_size()
+          << " events to fit the write buffer";
+
+  const size_t size = msg.ByteSize();
+  const uint32_t nsize = htonl(size);
+
+  response.resize(header_size + size);
+
+  memcpy(response.data(), &nsize, header_size);
+
+  msg.SerializeWithCachedSizesToArray(
+      reinterpret_cast<uint8_t *>(response.data() + header_size));
+
+  return true;
 }
 
 size_t msg_size(tcp_connection & connection) {
 
   uint32_t header;
 
-  auto p = connection.r_buffer.linearize();
-
-  std::copy(p, p + 4, reinterpret_cast<unsigned char*>(&header));
+  memcpy(&header, connection.r_buffer.data(), sizeof(header));
 
-  connection.r_buffer.erase_begin(4);
+  connection.r_buffer.consume(sizeof(header));
 
   return ntohl(header);
 
@@ -52,18 +218,31 @@ size_t msg_size(tcp_connection & connection) {
 riemann_tcp_connection::riemann_tcp_connection(
     tcp_connection & tcp_connection,
     raw_msg_fn_t raw_msg_fn
+) :
+  riemann_tcp_connection(tcp_connection, raw_msg_fn, {})
+{
+}
+
+riemann_tcp_connection::riemann_tcp_connection(
+    tcp_connection & tcp_connection,
+    raw_msg_fn_t raw_msg_fn,
+    query_msg_fn_t query_fn
 ) :
   tcp_connection_(tcp_connection),
   raw_msg_fn_(raw_msg_fn),
+  query_fn_(query_fn),
   reading_header_(true),
-  protobuf_size_(0)
+  protobuf_size_(0),
+  pending_acks_(0),
+  first_query_(0),
+  queries_()
 {
 }
 
 void riemann_tcp_connection::callback(async_fd & async) {
 
   if (async.ready_read()) {
-    read_cb();
+    read_cb(async);
   }
 
   if (tcp_connection_.close_connection) {
@@ -75,9 +254,9 @@ void riemann_tcp_connection::callback(async_fd & async) {
   }
 }
 
-void riemann_tcp_connection::read_cb() {
+void riemann_tcp_connection::read_cb(async_fd & async) {
 
-  if (!tcp_connection_.read()) {
+  if (!tcp_connection_.read(async)) {
 
     return;
 
@@ -99,7 +278,10 @@ void riemann_tcp_connection::read_cb() {
 
     }
 
-  } while (bytes != tcp_connection_.read_bytes());
+  } while (bytes != tcp_connection_.read_bytes()
+           && !tcp_connection_.close_connection);
+
+  flush_acks();
 
 }
 
@@ -140,27 +322,106 @@ void riemann_tcp_connection::read_message() {
     return;
   }
 
-  /* We have a complete message */
+  auto p = tcp_connection_.r_buffer.data();
+
+  std::vector<unsigned char> msg(p, p + protobuf_size_);
+
+  tcp_connection_.r_buffer.consume(protobuf_size_);
+
+  if (query_fn_ && has_query(msg.data(), msg.size())) {
 
-  if (!add_ok_response(tcp_connection_)) {
+    /* The messages before the query are acked first */
+    flush_acks();
+
+    const uint64_t query_id = first_query_ + queries_.size();
+
+    queries_.push_back({0, false, {}});
+
+    query_fn_(std::move(msg), query_id);
+
+  } else {
+
+    /* We have a complete message, acked once the whole read is processed
+     * or once the queries before it are answered */
+
+    if (queries_.empty()) {
+      pending_acks_++;
+    } else {
+      queries_.back().acks++;
+    }
+
+    /* Process message */
+    raw_msg_fn_(std::move(msg));
+  }
+
+  /* State transtion */
+  reading_header_ = true;
+
+ }
+
+void riemann_tcp_connection::flush_acks() {
+
+  if (pending_acks_ == 0 || tcp_connection_.close_connection) {
+    return;
+  }
+
+  const size_t acks = pending_acks_;
+  pending_acks_ = 0;
+
+  if (!add_ok_responses(tcp_connection_, acks)) {
     VLOG(3) << "write buffer is full";
     tcp_connection_.close_connection = true;
+  }
+
+}
+
+void riemann_tcp_connection::add_query_response(
+    const uint64_t query_id,
+    std::vector<char> response)
+{
+
+  if (query_id < first_query_ || query_id - first_query_ >= queries_.size()
+      || tcp_connection_.close_connection)
+  {
     return;
   }
 
+  auto & query = queries_[query_id - first_query_];
+  query.answered = true;
+  query.response = std::move(response);
+
+  while (!queries_.empty() && queries_.front().answered) {
 
-  std::vector<unsigned char> msg(protobuf_size_);
+    auto & front = queries_.front();
 
-  auto p = tcp_connection_.r_buffer.linearize();
+    // The response fits the frame size but maybe not what the write buffer
+    // has left, the socket may take none of it
+    const size_t acks_size = front.acks * ok_response.size();
+    const size_t reserve = tcp_connection_.w_buffer.reserve();
 
-  std::copy(p, p + protobuf_size_, msg.begin());
+    if (front.response.size() + acks_size > reserve
+        && (acks_size > reserve
+            || !truncate_response(front.response, reserve - acks_size)))
+    {
+      VLOG(3) << "write buffer is full";
+      tcp_connection_.close_connection = true;
+      return;
+    }
 
-  tcp_connection_.r_buffer.erase_begin(protobuf_size_);
+    struct iovec iov;
+    iov.iov_base = front.response.data();
+    iov.iov_len = front.response.size();
 
-  /* Process message */
-  raw_msg_fn_(std::move(msg));
+    if (!tcp_connection_.write_vec(&iov, 1)
+        || (front.acks > 0 && !add_ok_responses(tcp_connection_, front.acks)))
+    {
+      VLOG(3) << "write buffer is full";
+      tcp_connection_.close_connection = true;
+      return;
+    }
 
-  /* State transtion */
-  reading_header_ = true;
+    queries_.pop_front();
+    first_query_++;
+  }
 
- }
+}
@@ -27,18 +27,41 @@ async_fd::mode conn_to_mode(const tcp_connection & conn) {
 const std::string k_tcp_service = "tcp connections";
 const std::string k_tcp_desc = "number of tcp connections";
 
+const std::string k_paused_service = "tcp paused connections";
+const std::string k_paused_desc = "number of tcp connections not being read "
+                                  "because the executor pool is full";
+
+}
+
+riemann_tcp_pool::riemann_tcp_pool(size_t thread_num, raw_msg_fn_t raw_msg_fn,
+                                   instrumentation::instrumentation & instr)
+:
+  riemann_tcp_pool(thread_num, raw_msg_fn, {}, {}, instr)
+{
 }
 
 riemann_tcp_pool::riemann_tcp_pool(size_t thread_num, raw_msg_fn_t raw_msg_fn,
+                                   raw_msg_done_fn_t raw_msg_done_fn,
+                                   hook_fn_t run_fn,
                                    instrumentation::instrumentation & instr)
 :
   tcp_pool_(thread_num,
-            {},
+            run_fn,
             std::bind(&riemann_tcp_pool::create_conn, this, _1, _2, _3),
-            std::bind(&riemann_tcp_pool::data_ready, this, _1, _2)),
+            std::bind(&riemann_tcp_pool::data_ready, this, _1, _2),
+            std::bind(&riemann_tcp_pool::async_hook, this, _1)),
   raw_msg_fn_(raw_msg_fn),
+  raw_msg_done_fn_(raw_msg_done_fn),
+  paused_fn_(),
   connection_gauge_(instr.add_gauge(k_tcp_service, k_tcp_desc)),
-  connections_(thread_num)
+  paused_gauge_(instr.add_gauge(k_paused_service, k_paused_desc)),
+  connections_(thread_num),
+  paused_(thread_num),
+  query_fn_(),
+  next_conn_id_(thread_num, 0),
+  query_conns_(thread_num),
+  responses_mutexes_(thread_num),
+  responses_(thread_num)
 {
   tcp_pool_.start_threads();
 }
@@ -47,6 +70,22 @@ void riemann_tcp_pool::add_client(int fd) {
   tcp_pool_.add_client(fd);
 }
 
+void riemann_tcp_pool::add_listen_fd(const size_t loop_id, const int fd) {
+  tcp_pool_.add_listen_fd(loop_id, fd);
+}
+
+void riemann_tcp_pool::set_paused_fn(paused_fn_t paused_fn) {
+  paused_fn_ = paused_fn;
+}
+
+void riemann_tcp_pool::set_query_fn(raw_query_fn_t query_fn) {
+  query_fn_ = query_fn;
+}
+
+void riemann_tcp_pool::resume() {
+  tcp_pool_.signal_threads();
+}
+
 void riemann_tcp_pool::stop() {
   VLOG(3) << "stop()";
 
@@ -59,9 +98,30 @@ void riemann_tcp_pool::create_conn(int fd, async_loop & loop,
 
   auto & fd_conn = connections_[loop.id()];
 
-  fd_conn.insert({fd, riemann_tcp_connection(conn, raw_msg_fn_)});
-
   connection_gauge_.incr_fn(1);
+
+  // The connections read with async_fd::recv()
+  loop.set_fd_recv(fd);
+
+  if (!query_fn_) {
+    fd_conn.insert({fd, riemann_tcp_connection(conn, raw_msg_fn_)});
+    return;
+  }
+
+  const size_t loop_id = loop.id();
+  const uint64_t id = next_conn_id_[loop_id]++;
+
+  query_conns_[loop_id][fd] = {id, &conn};
+
+  auto query_fn = [=](std::vector<unsigned char> msg, const uint64_t query_id)
+  {
+    query_fn_(std::move(msg), [=](std::vector<char> response)
+    {
+      add_query_response(loop_id, fd, id, query_id, std::move(response));
+    });
+  };
+
+  fd_conn.insert({fd, riemann_tcp_connection(conn, raw_msg_fn_, query_fn)});
 }
 
 void riemann_tcp_pool::data_ready(async_fd & async, tcp_connection & tcp_conn) {
@@ -75,11 +135,125 @@ void riemann_tcp_pool::data_ready(async_fd & async, tcp_connection & tcp_conn) {
 
   riemann_conn.callback(async);
 
-  async.set_mode(conn_to_mode(tcp_conn));
+  if (raw_msg_done_fn_) {
+    raw_msg_done_fn_();
+  }
+
+  auto & paused = paused_[async.loop().id()];
 
   if (tcp_conn.close_connection) {
-    fd_conn.erase(it);
-    connection_gauge_.decr_fn(1);
+    remove_conn(async.loop().id(), async.fd());
+    return;
+  }
+
+  if (!paused_fn_ || !paused_fn_()) {
+    async.set_mode(conn_to_mode(tcp_conn));
+    return;
+  }
+
+  // Keep flushing pending writes but stop reading
+  async.set_mode(tcp_conn.pending_write() ? async_fd::write : async_fd::none);
+
+  if (paused.insert({async.fd(), &tcp_conn}).second) {
+    VLOG(3) << "pausing fd: " << async.fd();
+    paused_gauge_.incr_fn(1);
+  }
+
+}
+
+void riemann_tcp_pool::remove_conn(const size_t loop_id, const int fd) {
+
+  connections_[loop_id].erase(fd);
+  connection_gauge_.decr_fn(1);
+
+  query_conns_[loop_id].erase(fd);
+
+  if (paused_[loop_id].erase(fd)) {
+    paused_gauge_.decr_fn(1);
+  }
+
+}
+
+void riemann_tcp_pool::async_hook(async_loop & loop) {
+
+  write_query_responses(loop);
+
+  resume_hook(loop);
+
+}
+
+void riemann_tcp_pool::resume_hook(async_loop & loop) {
+
+  auto & paused = paused_[loop.id()];
+
+  if (paused.empty() || !paused_fn_ || paused_fn_()) {
+    return;
+  }
+
+  for (const auto & p : paused) {
+    VLOG(3) << "resuming fd: " << p.first;
+    loop.set_fd_mode(p.first, conn_to_mode(*p.second));
+  }
+
+  paused_gauge_.decr_fn(paused.size());
+  paused.clear();
+
+}
+
+void riemann_tcp_pool::add_query_response(const size_t loop_id, const int fd,
+                                          const uint64_t conn_id,
+                                          const uint64_t query_id,
+                                          std::vector<char> response)
+{
+
+  {
+    std::lock_guard<std::mutex> lock(responses_mutexes_[loop_id]);
+    responses_[loop_id].push_back({fd, conn_id, query_id,
+                                   std::move(response)});
+  }
+
+  tcp_pool_.signal_thread(loop_id);
+
+}
+
+void riemann_tcp_pool::write_query_responses(async_loop & loop) {
+
+  const size_t loop_id = loop.id();
+
+  std::vector<query_response> responses;
+
+  {
+    std::lock_guard<std::mutex> lock(responses_mutexes_[loop_id]);
+    responses.swap(responses_[loop_id]);
+  }
+
+  auto & query_conns = query_conns_[loop_id];
+  auto & paused = paused_[loop_id];
+
+  for (auto & r : responses) {
+
+    auto it = query_conns.find(r.fd);
+
+    if (it == query_conns.end() || it->second.id != r.conn_id) {
+      VLOG(3) << "dropping query response of a closed connection";
+      continue;
+    }
+
+    auto & conn = *it->second.conn;
+
+    connections_[loop_id].find(r.fd)->second.add_query_response(
+        r.query_id, std::move(r.response));
+
+    if (conn.close_connection) {
+      remove_conn(loop_id, r.fd);
+      tcp_pool_.remove_client_sync(loop_id, r.fd);
+    } else if (paused.find(r.fd) != paused.end()) {
+      loop.set_fd_mode(r.fd, conn.pending_write() ? async_fd::write
+                                                  : async_fd::none);
+    } else {
+      loop.set_fd_mode(r.fd, conn_to_mode(conn));
+    }
+
   }
 
 }
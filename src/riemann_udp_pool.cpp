@@ -1,9 +1,41 @@
 #include <glog/logging.h>
 #include <riemann_udp_pool.h>
 
-riemann_udp_pool::riemann_udp_pool(uint32_t port, raw_msg_fn_t raw_msg_fn)
+namespace {
+
+const size_t k_max_datagram_size = 16384;
+
+const std::string k_truncated_service = "udp truncated messages rate";
+const std::string k_truncated_desc = "messages dropped because they are "
+                                     "larger than udp_max_datagram_size";
+
+const std::string k_overflow_service = "udp overflowed messages rate";
+const std::string k_overflow_desc = "messages dropped by the kernel because "
+                                    "the socket buffer was full";
+
+}
+
+riemann_udp_pool::riemann_udp_pool(uint32_t port, raw_msg_fn_t raw_msg_fn,
+                                   instrumentation::instrumentation & instr)
+  :
+    riemann_udp_pool(1, port, k_max_datagram_size, raw_msg_fn, {}, instr)
+{
+}
+
+riemann_udp_pool::riemann_udp_pool(size_t thread_num, uint32_t port,
+                                   size_t max_datagram_size,
+                                   raw_msg_fn_t raw_msg_fn,
+                                   hook_fn_t run_fn,
+                                   instrumentation::instrumentation & instr)
   :
-    udp_pool_(1, port, raw_msg_fn)
+    truncated_rate_(instr.add_rate(k_truncated_service, k_truncated_desc)),
+    overflow_rate_(instr.add_rate(k_overflow_service, k_overflow_desc)),
+    udp_pool_(thread_num, port, max_datagram_size, raw_msg_fn, run_fn,
+              [=](const size_t truncated, const size_t overflowed)
+              {
+                truncated_rate_(truncated);
+                overflow_rate_(overflowed);
+              })
 {
   udp_pool_.start_threads();
 }
@@ -43,20 +43,18 @@ int main(int argc, char **argv) {
 
   start_core(argc, argv);
 
-  std::vector<stream_lib> streams(100);
-  load_rules(FLAGS_rules_directory, streams);
+  stream_libs libs;
+  load_rules(FLAGS_rules_directory, libs);
 
-  if (!streams[0].used()) {
+  if (libs.load().empty()) {
     LOG(ERROR) << "failed to load rules";
     return -1;
   }
 
   for (const auto & event: events) {
     g_core->sched().set_time(event.time());
-    for (const auto & stream : streams) {
-      if (stream.used()) {
-        push_event(*stream.stream, event);
-      }
+    for (const auto lib : libs.load()) {
+      push_event(*lib->stream, event);
     }
   }
 
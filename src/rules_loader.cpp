@@ -1,11 +1,14 @@
 #include <glog/logging.h>
 #include <unordered_set>
 #include <boost/filesystem.hpp>
+#include <fstream>
 #include <regex>
 #include <dlfcn.h>
 #include <iostream>
 #include <util/util.h>
+#include <util/rcu.h>
 #include <core/core.h>
+#include <streams/named_state.h>
 #include <rules_loader.h>
 
 using namespace boost::filesystem;
@@ -14,18 +17,21 @@ namespace {
 
 const std::string dl_symbol = "rules";
 
-using lib_data = struct {
+/* Number of reloads, used to give every version of a library its own copy
+ * and task namespace.
+ */
+size_t generation = 0;
+
+using so_file_t = struct {
   std::string file;
   std::time_t last_write_time;
-  void * handle;
-  std::shared_ptr<streams_t> stream;
 };
 
-std::vector<lib_data> so_files(std::string dir) {
+std::vector<so_file_t> so_files(std::string dir) {
 
   VLOG(3) << "loading rules";
 
-  std::vector<lib_data> files;
+  std::vector<so_file_t> files;
   std::regex pattern(".*\\.so");
 
   for (directory_iterator iter(dir), end;
@@ -36,23 +42,46 @@ std::vector<lib_data> so_files(std::string dir) {
     if (regex_match(file, pattern))
     {
       VLOG(3) << "library found: " << file;
-      files.push_back({file, last_write_time(iter->path()), nullptr, nullptr});
+      files.push_back({file, last_write_time(iter->path())});
     }
   }
 
   return files;
 }
 
-bool load_library(lib_data & lib) {
+/* dlopen() returns the handle of the loaded library when it is given the
+ * same path again, the new version is loaded from a private copy. The copy
+ * doesn't end in .so so it is never picked up as a rules library.
+ */
+std::string copy_library(const std::string & dir, const std::string & file) {
 
-  void *handle = dlopen(lib.file.c_str(), RTLD_NOW);
+  const std::string path = dir + "/." + file + "." + std::to_string(generation);
 
-  if (!handle) {
-    LOG(ERROR) << "error opening " << lib.file << " " << dlerror();
-    return false;
+  std::ifstream in(dir + "/" + file, std::ios::binary);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+  out << in.rdbuf();
+  out.close();
+
+  if (!in || !out) {
+    LOG(ERROR) << "failed to copy " << file << " to " << path;
+    unlink(path.c_str());
+    return "";
   }
 
-  lib.handle = handle;
+  return path;
+}
+
+loaded_lib * open_library(const std::string & path, const so_file_t & so,
+                          const std::string & ns)
+{
+
+  void *handle = dlopen(path.c_str(), RTLD_NOW);
+
+  if (!handle) {
+    LOG(ERROR) << "error opening " << so.file << " " << dlerror();
+    return nullptr;
+  }
 
   typedef streams_t* (*rules_t)();
 
@@ -61,45 +90,37 @@ bool load_library(lib_data & lib) {
   if (!rules) {
     LOG(ERROR) << "failed to load symbol: " << dl_symbol;
     dlclose(handle);
-    return false;
+    return nullptr;
   }
 
-  VLOG(3) << "loading rules from " << lib.file;
+  VLOG(3) << "loading rules from " << so.file;
 
-  lib.stream = std::shared_ptr<streams_t>(rules());
+  auto lib = new loaded_lib{so.file, intern_ns(ns), so.last_write_time, handle,
+                            nullptr};
 
-  LOG(INFO) << "rules loaded succesfully from " << lib.file;
+  set_thread_ns_id(lib->ns_id);
+  set_state_lib(lib->file);
 
-  return true;
-}
+  lib->stream = std::shared_ptr<streams_t>(rules());
 
-using curr_map_t =
-  std::unordered_map<std::string, std::vector<stream_lib>::iterator>;
+  init_streams(*lib->stream);
 
-curr_map_t make_curr_map(std::vector<stream_lib> & current_libs) {
-  std::unordered_map<std::string, std::vector<stream_lib>::iterator> curr_map;
-  for (auto it = begin(current_libs); it != end(current_libs); it++) {
-    if (it->used()) {
-      curr_map[it->file] = it;
-    }
-  }
-  return curr_map;
-}
+  set_state_lib("");
+  set_thread_global_ns();
 
-bool library_used(const std::string file, const curr_map_t & curr_map) {
-    return (curr_map.find(file) != end(curr_map));
-}
+  LOG(INFO) << "rules loaded succesfully from " << so.file;
 
-bool close_library(stream_lib & lib) {
+  return lib;
+}
 
-  lib.set_used(false);
+/* Must be called once lib is no longer in the published list and readers
+ * have left their rcu read sections.
+ */
+bool close_library(loaded_lib * lib) {
 
-  while (lib.ref_counter.load() != 0) {
-    LOG(INFO) << "ref counter for " << lib.file << " is not zero";
-    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-  }
+  carry_named_state(lib->file);
 
-  auto ns_future = g_core->sched().remove_ns_tasks(lib.file);
+  auto ns_future = g_core->sched().remove_ns_tasks(get_ns_name(lib->ns_id));
 
   if (!ns_future.get()) {
 
@@ -107,106 +128,157 @@ bool close_library(stream_lib & lib) {
     return false;
   }
 
-  if (!dlclose(lib.handle)) {
-
-    LOG(INFO) << lib.file << " unloaded";
-
-    lib.handle = nullptr;
-    return true;
+  // Ticks of the removed tasks may still be running, waiting for them here
+  // keeps the scheduler loops firing the other timers meanwhile
+  g_core->sched().sync_dispatched();
 
-  } else {
+  // The streams hold code from the library
+  lib->stream.reset();
 
-    LOG(ERROR) << "failed to unload " << lib.file;
+  if (dlclose(lib->handle)) {
+    LOG(ERROR) << "failed to unload " << lib->file;
     return false;
-
   }
 
+  LOG(INFO) << lib->file << " unloaded";
+
+  delete lib;
 
+  return true;
 }
 
-void load_library(lib_data & lib, stream_lib & curr_lib) {
+/* Publishes libs and unloads the libraries in dropped once no thread can be
+ * running them.
+ */
+void publish_libs(stream_libs & current_libs, const lib_list_t & libs,
+                  const lib_list_t & dropped)
+{
+  auto old_libs = current_libs.publish(libs);
+
+  // Wait for the threads that may still be running the old list
+  rcu_synchronize();
+
+  delete old_libs;
 
-  if (!load_library(lib)) {
-    LOG(ERROR) << "failed to load";
-    return;
+  for (auto lib : dropped) {
+    close_library(lib);
   }
+}
+
+/* Builds the new version while the old one keeps processing events. It
+ * returns nullptr if the old version must be kept.
+ */
+loaded_lib * reload_library(const std::string & dir, const so_file_t & so,
+                            bool & copy_failed)
+{
 
-  set_thread_ns(lib.file);
+  generation++;
 
-  init_streams(*lib.stream);
+  const auto path = copy_library(dir, so.file);
 
-  set_thread_global_ns();
+  if (path.empty()) {
+    copy_failed = true;
+    return nullptr;
+  }
+
+  auto lib = open_library(path, so,
+                          so.file + "@" + std::to_string(generation));
 
-  curr_lib.file = lib.file;
-  curr_lib.handle = lib.handle;
-  curr_lib.last_write_time = lib.last_write_time;
-  curr_lib.stream = lib.stream;
+  unlink(path.c_str());
 
-  curr_lib.set_used(true);
+  if (!lib) {
+    LOG(ERROR) << "failed to reload " << so.file << ", keeping old version";
+  }
+
+  return lib;
 }
 
-bool available_unsused_element(const std::vector<stream_lib> & current_libs) {
-  for (const auto & lib : current_libs) {
-    if (!lib.used()) {
-      return true;
+loaded_lib * find_lib(const lib_list_t & libs, const std::string & file) {
+
+  for (auto lib : libs) {
+    if (lib->file == file) {
+      return lib;
     }
   }
-  return false;
+
+  return nullptr;
 }
 
 }
 
-void load_rules(const std::string dir, std::vector<stream_lib> & current_libs)
+void load_rules(const std::string dir, stream_libs & current_libs)
 {
   VLOG(3) << "load_rules()++";
 
-  auto curr_map = make_curr_map(current_libs);
+  const auto & old_libs = current_libs.load();
 
-  std::unordered_set<std::string> unused;
-  for (const auto & p : curr_map) {
-    unused.insert(p.first);
-  }
+  lib_list_t libs;
+  lib_list_t dropped;
+  std::vector<so_file_t> reopen;
 
-  for (auto & lib : so_files(dir)) {
-    auto it = unused.find(lib.file);
-    if (it != end(unused)) {
-      unused.erase(it);
-    }
+  std::unordered_set<std::string> files;
 
-    if (library_used(lib.file, curr_map)) {
+  for (auto & so : so_files(dir)) {
 
-      auto & curr_lib = curr_map[lib.file];
+    files.insert(so.file);
 
-      if (curr_lib->last_write_time == lib.last_write_time) {
-        VLOG(3) << lib.file << " didn't change";
-        continue;
-      }
+    auto old_lib = find_lib(old_libs, so.file);
+
+    if (!old_lib) {
 
-      if (!close_library(*curr_lib)) {
-        continue;
+      if (auto lib = open_library(so.file, so, so.file)) {
+        libs.push_back(lib);
       }
 
-      load_library(lib, *curr_lib);
+      continue;
+    }
+
+    if (old_lib->last_write_time == so.last_write_time) {
+      VLOG(3) << so.file << " didn't change";
+      libs.push_back(old_lib);
+      continue;
+    }
+
+    bool copy_failed = false;
+
+    if (auto lib = reload_library(dir, so, copy_failed)) {
+
+      libs.push_back(lib);
+      dropped.push_back(old_lib);
+
+    } else if (copy_failed) {
+
+      LOG(WARNING) << "reloading " << so.file << " without a copy, events "
+                   << "are not processed until it is loaded";
+
+      dropped.push_back(old_lib);
+      reopen.push_back(so);
 
     } else {
 
-      if (!available_unsused_element(current_libs)) {
-        LOG(ERROR) << "run out of lib spots";
-        continue;
-      }
+      libs.push_back(old_lib);
 
-      for (auto & clib : current_libs) {
-        if (!clib.used()) {
-          load_library(lib, clib);
-          break;
-        }
-      }
+    }
+
+  }
+
+  for (auto lib : old_libs) {
+    if (files.find(lib->file) == files.end()) {
+      dropped.push_back(lib);
     }
   }
 
-  for (const auto & libname : unused) {
-    auto & lib = curr_map[libname];
-    close_library(*lib);
+  publish_libs(current_libs, libs, dropped);
+
+  if (!reopen.empty()) {
+
+    for (const auto & so : reopen) {
+      if (auto lib = open_library(so.file, so, so.file)) {
+        libs.push_back(lib);
+      }
+    }
+
+    publish_libs(current_libs, libs, {});
   }
 
   VLOG(3) << "load_rules()--";
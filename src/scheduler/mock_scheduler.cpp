@@ -27,6 +27,8 @@ remove_ns_tasks_future_t mock_scheduler::remove_ns_tasks(const std::string) {
   return {};
 }
 
+void mock_scheduler::sync_dispatched() { }
+
 time_t mock_scheduler::unix_time() {
   return unix_time_;
 }
@@ -1,4 +1,5 @@
 #include <glog/logging.h>
+#include <algorithm>
 #include <streams/lib.h>
 #include <scheduler/real_scheduler.h>
 #include <async/async_loop.h>
@@ -7,30 +8,131 @@
 namespace {
 
 const size_t k_scheduler_threads = 2;
-const size_t k_max_queue_size = 2000;
+
+/* Periodic tasks with the same interval are split in this many chunks, each
+ * one runs as a separate executor task.
+ */
+const size_t k_periodic_chunks = 64;
+
+/* Run task bodies when no dispatch function is given */
+const size_t k_timer_workers = 2;
+
+const std::string k_lateness_service = "scheduler timer lateness";
+const std::string k_lateness_desc = "distribution of time in ms from a timer "
+                                    "expiring until its task starts";
+
+const std::string k_overrun_service = "scheduler task overruns";
+const std::string k_overrun_desc = "periodic tasks still running when they "
+                                   "were due again";
+
+const std::vector<double> k_percentiles = {0.0, .5, .95, .99, 1};
+
+double ms_since(const std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - t).count();
+}
 
 }
 
 using namespace std::placeholders;
 
-real_scheduler::real_scheduler() :
+real_scheduler::real_scheduler(instrumentation::instrumentation & instr)
+  : real_scheduler(instr, {}, {})
+{
+}
+
+real_scheduler::real_scheduler(instrumentation::instrumentation & instr,
+                               dispatch_fn_t dispatch_fn, sync_fn_t sync_fn) :
   threads_(k_scheduler_threads),
   task_promises_(k_scheduler_threads),
   remove_tasks_(k_scheduler_threads),
-  ns_promises_(k_scheduler_threads)
+  ns_promises_(k_scheduler_threads),
+  dispatch_fn_(dispatch_fn),
+  sync_fn_(sync_fn),
+  next_dispatch_key_(0),
+  stopped_(false),
+  lateness_fn_(instr.add_latency(k_lateness_service, k_lateness_desc,
+                                 k_percentiles)),
+  overrun_rate_(instr.add_rate(k_overrun_service, k_overrun_desc))
 {
 
   VLOG(3) << "real_scheduler()";
 
+  if (!dispatch_fn_) {
+    start_workers();
+  }
+
   threads_.set_async_hook(std::bind(&real_scheduler::async_callback, this, _1));
 
-  for (size_t i = 0; i < k_scheduler_threads; i++) {
-    task_promises_[i].set_capacity(k_max_queue_size);
-    remove_tasks_[i].set_capacity(k_max_queue_size);
-    ns_promises_[i].set_capacity(k_max_queue_size);
+  threads_.start_threads();
+}
+
+real_scheduler::~real_scheduler() {
+  stop_workers();
+}
+
+void real_scheduler::start_workers() {
+
+  for (size_t i = 0; i < k_timer_workers; i++) {
+    work_queues_.emplace_back(new work_queue_t());
   }
 
-  threads_.start_threads();
+  for (size_t i = 0; i < k_timer_workers; i++) {
+    workers_.emplace_back(&real_scheduler::run_worker, this, i);
+  }
+
+  dispatch_fn_ = [=](const uint64_t key, const task_fn_t & task)
+  {
+    work_queues_[key % work_queues_.size()]->push(task);
+  };
+
+  sync_fn_ = [=]()
+  {
+    std::vector<std::future<void>> futures;
+
+    for (auto & queue : work_queues_) {
+      auto done = std::make_shared<std::promise<void>>();
+      futures.push_back(done->get_future());
+      queue->push([=]() { done->set_value(); });
+    }
+
+    for (auto & f : futures) {
+      f.wait();
+    }
+  };
+
+}
+
+void real_scheduler::run_worker(const size_t i) {
+
+  while (true) {
+
+    task_fn_t task;
+
+    work_queues_[i]->pop(task);
+
+    // An empty task stops the worker
+    if (!task) {
+      return;
+    }
+
+    task();
+  }
+
+}
+
+void real_scheduler::stop_workers() {
+
+  for (auto & queue : work_queues_) {
+    queue->push({});
+  }
+
+  for (auto & worker : workers_) {
+    worker.join();
+  }
+
+  workers_.clear();
+  work_queues_.clear();
 }
 
 remove_task_future_t real_scheduler::add_periodic_task(task_fn_t task,
@@ -38,7 +140,56 @@ remove_task_future_t real_scheduler::add_periodic_task(task_fn_t task,
 {
   VLOG(1) << "add_periodic_task";
 
-  return add_task(task, interval, false);
+  auto periodic_task = std::make_shared<periodic_task_t>(task,
+                                                         get_thread_ns());
+
+  const auto interval_ms = static_cast<uint64_t>(interval * 1000);
+  const auto shard = get_thread_shard();
+
+  periodic_group_t * group;
+  bool new_group = false;
+
+  {
+    std::lock_guard<std::mutex> lock(periodic_mutex_);
+
+    auto & g = periodic_groups_[interval_ms];
+
+    if (!g) {
+      g.reset(new periodic_group_t(k_periodic_chunks, stream_shards(),
+                                   interval));
+      new_group = true;
+    }
+
+    group = g.get();
+  }
+
+  // Skips the next tick, which may be due any time now
+  if (!new_group) {
+    periodic_task->first_tick = group->ticks + 2;
+  }
+
+  // Tasks of a shard only run along with the other tasks of that shard
+  auto & chunk = (shard != k_no_shard && !group->shard_chunks.empty())
+                 ? group->shard_chunks[shard % group->shard_chunks.size()]
+                 : group->chunks[group->size++ % group->chunks.size()];
+
+  {
+    std::lock_guard<std::mutex> lock(chunk.mutex);
+    chunk.tasks.push_back(periodic_task);
+  }
+
+  chunk.used = true;
+
+  if (new_group) {
+    VLOG(1) << "new timer for periodic tasks every " << interval << "s";
+    add_task([=]() { run_periodic_group(*group); }, interval, false, false,
+             k_global_ns, k_no_shard);
+  }
+
+  std::promise<remove_task_fn_t> promise;
+  promise.set_value([=]() { periodic_task->removed = true; });
+
+  return promise.get_future();
 
 }
 
@@ -46,57 +197,184 @@ remove_task_future_t real_scheduler::add_once_task(task_fn_t task,
                                                     float interval)
 {
 
-  return add_task(task, interval, true);
+  return add_task(task, interval, true, true, get_thread_ns(),
+                  get_thread_shard());
 
 }
 
 std::future<remove_task_fn_t> real_scheduler::add_task(
   const task_fn_t task,
   const float interval,
-  const bool once)
+  const bool once,
+  const bool dispatch,
+  const std::string nm,
+  const size_t shard)
 {
   task_promise_t promise{std::make_shared<std::promise<remove_task_fn_t>>(),
                          task,
                          interval,
                          once,
-                         get_thread_ns()};
+                         dispatch,
+                         nm,
+                         shard};
 
   auto thread_id = threads_.next_thread();
 
-  if (task_promises_[thread_id].try_push(promise)) {
-    threads_.signal_thread(thread_id);
-  } else {
-    LOG(WARNING) << "scheduler task queue is full";
-  }
+  task_promises_[thread_id].push(promise);
+  threads_.signal_thread(thread_id);
 
   return promise.promise->get_future();
 
 }
 
+void real_scheduler::run_periodic_group(periodic_group_t & group) {
+
+  const auto tick_time = std::chrono::steady_clock::now();
+  const auto tick = ++group.ticks;
+  const auto chunks = std::min(group.size.load(), group.chunks.size());
+
+  // Chunks never overlap, so tasks without a shard can take any key
+  for (size_t i = 0; i < chunks; i++) {
+    dispatch_periodic_chunk(group, group.chunks[i],
+                            next_dispatch_key_.fetch_add(1), tick, tick_time);
+  }
+
+  for (size_t i = 0; i < group.shard_chunks.size(); i++) {
+    if (group.shard_chunks[i].used) {
+      dispatch_periodic_chunk(group, group.shard_chunks[i], i, tick,
+                              tick_time);
+    }
+  }
+
+}
+
+void real_scheduler::dispatch_periodic_chunk(const periodic_group_t & group,
+                                             periodic_chunk_t & chunk,
+                                             const uint64_t key,
+                                             const uint64_t tick,
+                                             const time_point_t tick_time)
+{
+
+  if (chunk.running.exchange(true)) {
+    VLOG(1) << "periodic tasks every " << group.interval << "s overrun";
+    overrun_rate_(1);
+    return;
+  }
+
+  dispatch_fn_(key, [&, tick, tick_time]()
+                    { run_periodic_chunk(group, chunk, tick, tick_time); });
+
+}
+
+void real_scheduler::run_periodic_chunk(const periodic_group_t & group,
+                                        periodic_chunk_t & chunk,
+                                        const uint64_t tick,
+                                        const time_point_t tick_time)
+{
+
+  lateness_fn_(ms_since(tick_time));
+
+  std::vector<periodic_task_shared_t> tasks;
+
+  {
+    std::lock_guard<std::mutex> lock(chunk.mutex);
+
+    chunk.tasks.erase(
+        std::remove_if(begin(chunk.tasks), end(chunk.tasks),
+                       [](const periodic_task_shared_t & t)
+                       { return t->removed.load(); }),
+        end(chunk.tasks));
+
+    // Tasks may add new periodic tasks while they run
+    tasks = chunk.tasks;
+  }
+
+  for (const auto & t : tasks) {
+
+    if (t->removed || tick < t->first_tick) {
+      continue;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    try {
+      t->task();
+    } catch(const std::exception & e){
+      LOG(ERROR) << "exception in " << t->nm << " : "  << e.what();
+    }
+
+    const auto elapsed = ms_since(start_time);
+
+    if (elapsed > group.interval * 1000) {
+      LOG(WARNING) << "periodic task in " << t->nm << " took " << elapsed
+                   << " ms, longer than its interval";
+    }
+
+  }
+
+  chunk.running = false;
+
+}
+
 remove_ns_tasks_future_t real_scheduler::remove_ns_tasks(const std::string nm) {
 
   auto rm_promise = std::make_shared<std::promise<bool>>();
-  auto shr_atom = std::make_shared<std::atomic<unsigned int>>(k_scheduler_threads);
   auto ns_future = rm_promise->get_future();
 
-  for (size_t i = 0; i < k_scheduler_threads; i++) {
+  {
+    std::lock_guard<std::mutex> lock(periodic_mutex_);
 
-    if (ns_promises_[i].try_push({rm_promise, shr_atom, nm})) {
+    // Stopped loops would never answer
+    if (stopped_) {
+      rm_promise->set_value(false);
+      return ns_future;
+    }
 
-      threads_.signal_thread(i);
+    auto remove_chunk_tasks = [&](periodic_chunk_t & chunk)
+    {
+      std::lock_guard<std::mutex> chunk_lock(chunk.mutex);
 
-    } else {
+      for (auto & t : chunk.tasks) {
+        if (t->nm == nm) {
+          t->removed = true;
+        }
+      }
+    };
 
-      LOG(ERROR) << "namespace promise queue is full";
-      rm_promise->set_value(false);
+    for (auto & kv : periodic_groups_) {
+
+      for (auto & chunk : kv.second->chunks) {
+        remove_chunk_tasks(chunk);
+      }
+
+      for (auto & chunk : kv.second->shard_chunks) {
+        remove_chunk_tasks(chunk);
+      }
 
     }
 
+    // Loops remove the once tasks, sync_dispatched() waits for running ticks
+    auto shr_atom = std::make_shared<std::atomic<unsigned int>>(
+        k_scheduler_threads);
+
+    for (size_t i = 0; i < k_scheduler_threads; i++) {
+
+      ns_promises_[i].push({rm_promise, shr_atom, nm});
+      threads_.signal_thread(i);
+
+    }
   }
 
   return ns_future;
 }
 
+void real_scheduler::sync_dispatched() {
+
+  VLOG(3) << "waiting for dispatched tasks";
+  sync_fn_();
+
+}
+
 time_t real_scheduler::unix_time() {
   return time(0);
 }
@@ -115,9 +393,9 @@ void real_scheduler::add_tasks(async_loop & loop) {
 
     timer_id_t timer_id;
 
-    std::string nm = get_thread_ns();
+    const auto nm = tp.nm;
 
-    auto timer_task = [=](const size_t)
+    auto run_task = [=]()
      {
       try {
         tp.task();
@@ -126,6 +404,28 @@ void real_scheduler::add_tasks(async_loop & loop) {
       }
     };
 
+    // Back to the shard that added the task, if any
+    const auto dispatch_key = tp.shard != k_no_shard
+                              ? tp.shard
+                              : next_dispatch_key_.fetch_add(1);
+
+    // Only the timers of periodic groups run here, and they just dispatch
+    auto timer_task = [=](const size_t)
+    {
+      if (!tp.dispatch) {
+        tp.task();
+        return;
+      }
+
+      const auto fire_time = std::chrono::steady_clock::now();
+
+      dispatch_fn_(dispatch_key, [=]()
+                   {
+                     lateness_fn_(ms_since(fire_time));
+                     run_task();
+                   });
+    };
+
     VLOG(1) << "add task for nm " << tp.nm;
 
     if (tp.once) {
@@ -170,6 +470,24 @@ void real_scheduler::clear() { }
 void real_scheduler::stop() {
 
   VLOG(3) << "stop scheduler";
+
+  {
+    std::lock_guard<std::mutex> lock(periodic_mutex_);
+    stopped_ = true;
+  }
+
   threads_.stop_threads();
+  stop_workers();
+
+  // Removals the loops didn't get to fail, the first loop left answers
+  ns_promise_t ns_promise;
+
+  for (auto & queue : ns_promises_) {
+    while (queue.try_pop(ns_promise)) {
+      if (ns_promise.loops->exchange(0) != 0) {
+        ns_promise.promise->set_value(false);
+      }
+    }
+  }
 
 }
@@ -0,0 +1,112 @@
+#include <cmath>
+#include <cstring>
+#include <statsd_parser.h>
+#include <util/parse_number.h>
+
+namespace {
+
+template <size_t N>
+inline bool equals(const char * s, const size_t size, const char (&other)[N])
+{
+  return size == N - 1 && memcmp(s, other, N - 1) == 0;
+}
+
+bool parse_type(const char * p, const size_t size,
+                statsd_line::metric_type & type)
+{
+
+  if (equals(p, size, "c")) {
+    type = statsd_line::counter;
+  } else if (equals(p, size, "g")) {
+    type = statsd_line::gauge;
+  } else if (equals(p, size, "s")) {
+    type = statsd_line::set;
+  } else if (equals(p, size, "ms") || equals(p, size, "h")
+             || equals(p, size, "d"))
+  {
+    type = statsd_line::timer;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+}
+
+bool parse_statsd_line(const char * line, const size_t size,
+                       statsd_line & out)
+{
+
+  const char * end = line + size;
+
+  auto pipe = static_cast<const char *>(memchr(line, '|', size));
+
+  if (!pipe) {
+    return false;
+  }
+
+  // Names may have colons, the value doesn't
+  auto colon = static_cast<const char *>(memrchr(line, ':', pipe - line));
+
+  if (!colon || colon == line || colon + 1 == pipe) {
+    return false;
+  }
+
+  out.name = line;
+  out.name_size = colon - line;
+  out.value = colon + 1;
+  out.value_size = pipe - out.value;
+  out.sample_rate = 1;
+  out.tags = nullptr;
+  out.tags_size = 0;
+  out.delta = false;
+
+  const char * type = pipe + 1;
+  auto next = static_cast<const char *>(memchr(type, '|', end - type));
+  const char * type_end = next ? next : end;
+
+  if (!parse_type(type, type_end - type, out.type)) {
+    return false;
+  }
+
+  for (const char * p = next; p; p = next) {
+
+    const char * field = p + 1;
+    next = static_cast<const char *>(memchr(field, '|', end - field));
+    const char * field_end = next ? next : end;
+
+    if (field < field_end && *field == '@') {
+
+      if (!parse_double(field + 1, field_end - field - 1, out.sample_rate)
+          || !(out.sample_rate > 0 && out.sample_rate <= 1))
+      {
+        return false;
+      }
+
+    } else if (field < field_end && *field == '#') {
+
+      out.tags = field + 1;
+      out.tags_size = field_end - field - 1;
+
+    }
+
+    // Other fields, like dogstatsd container ids, are ignored
+  }
+
+  if (out.type == statsd_line::set) {
+    out.number = 0;
+    return true;
+  }
+
+  if (!parse_double(out.value, out.value_size, out.number)
+      || !std::isfinite(out.number))
+  {
+    return false;
+  }
+
+  out.delta = out.type == statsd_line::gauge
+              && (*out.value == '+' || *out.value == '-');
+
+  return true;
+}
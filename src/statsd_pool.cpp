@@ -0,0 +1,117 @@
+#include <glog/logging.h>
+#include <ctime>
+#include <statsd_pool.h>
+
+using namespace std::placeholders;
+
+namespace {
+
+const std::string k_invalid_service = "statsd invalid lines rate";
+const std::string k_invalid_desc = "statsd lines that could not be parsed";
+
+/* Datagrams are passed without their loop, each udp thread keeps its
+ * table here */
+thread_local statsd_table * udp_table;
+
+}
+
+statsd_pool::statsd_pool(size_t thread_num, uint32_t port,
+                         size_t max_datagram_size, float flush_interval,
+                         std::vector<double> percentiles,
+                         statsd_events_fn_t events_fn, hook_fn_t run_fn,
+                         instrumentation::instrumentation & instr)
+:
+  thread_num_(thread_num),
+  flush_interval_(flush_interval),
+  percentiles_(percentiles),
+  events_fn_(events_fn),
+  run_fn_(run_fn),
+  invalid_rate_(instr.add_rate(k_invalid_service, k_invalid_desc)),
+  tables_(thread_num),
+  mutex_(),
+  merged_(),
+  handed_over_(thread_num, false),
+  hand_overs_(0),
+  msg_(),
+  udp_pool_(thread_num, port, max_datagram_size,
+            std::bind(&statsd_pool::udp_read, this, _1),
+            std::bind(&statsd_pool::run_hook, this, _1),
+            {})
+{
+}
+
+void statsd_pool::start_threads() {
+  udp_pool_.start_threads();
+}
+
+void statsd_pool::stop_threads() {
+  udp_pool_.stop_threads();
+}
+
+void statsd_pool::run_hook(async_loop & loop) {
+
+  if (run_fn_) {
+    run_fn_(loop);
+  }
+
+  const size_t tid = loop.id();
+
+  udp_table = &tables_[tid];
+
+  loop.add_periodic_task("", [=](size_t) { hand_over(tid); },
+                         flush_interval_);
+}
+
+void statsd_pool::udp_read(std::vector<unsigned char> datagram) {
+
+  const size_t invalid = udp_table->add(
+      reinterpret_cast<const char *>(&datagram[0]), datagram.size());
+
+  if (invalid) {
+    invalid_rate_(invalid);
+  }
+
+}
+
+/* Runs once per interval in each thread, only here tables are shared */
+void statsd_pool::hand_over(const size_t tid) {
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // A late thread missed the last flush, its metrics go in the next one
+  if (handed_over_[tid]) {
+    flush();
+  }
+
+  merged_.merge(tables_[tid]);
+
+  handed_over_[tid] = true;
+
+  if (++hand_overs_ == thread_num_) {
+    flush();
+  }
+
+}
+
+void statsd_pool::flush() {
+
+  std::fill(begin(handed_over_), end(handed_over_), false);
+  hand_overs_ = 0;
+
+  // Events outlive a missed flush
+  merged_.flush(msg_, time(nullptr), 2 * flush_interval_, flush_interval_,
+                percentiles_);
+
+  VLOG(3) << "statsd flush, events: " << msg_.events_size()
+          << " metrics kept: " << merged_.size();
+
+  if (msg_.events_size() > 0) {
+    events_fn_(msg_, msg_.ByteSize());
+    msg_.Clear();
+  }
+
+}
+
+statsd_pool::~statsd_pool() {
+  stop_threads();
+}
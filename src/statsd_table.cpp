@@ -0,0 +1,248 @@
+#include <cmath>
+#include <cstring>
+#include <statsd_table.h>
+
+namespace {
+
+uint64_t fnv1a(const char * p, const size_t size) {
+
+  uint64_t hash = 0xcbf29ce484222325ull;
+
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ static_cast<unsigned char>(p[i])) * 0x100000001b3ull;
+  }
+
+  return hash;
+}
+
+void add_tags(riemann::Event & event, const std::string & tags) {
+
+  size_t start = 0;
+
+  while (start < tags.size()) {
+
+    size_t end = tags.find(',', start);
+
+    if (end == std::string::npos) {
+      end = tags.size();
+    }
+
+    if (end > start) {
+      event.add_tags(tags.data() + start, end - start);
+    }
+
+    start = end + 1;
+  }
+
+}
+
+}
+
+statsd_table::statsd_table()
+  :
+    metrics_(),
+    key_()
+{
+}
+
+size_t statsd_table::add(const char * data, const size_t size) {
+
+  const char * p = data;
+  const char * end = data + size;
+  size_t invalid = 0;
+
+  while (p < end) {
+
+    auto nl = static_cast<const char *>(memchr(p, '\n', end - p));
+    const char * line_end = nl ? nl : end;
+    const char * next = nl ? nl + 1 : end;
+
+    if (line_end > p && line_end[-1] == '\r') {
+      line_end--;
+    }
+
+    statsd_line line;
+
+    if (line_end > p) {
+      if (parse_statsd_line(p, line_end - p, line)) {
+        add(line);
+      } else {
+        invalid++;
+      }
+    }
+
+    p = next;
+  }
+
+  return invalid;
+}
+
+void statsd_table::add(const statsd_line & line) {
+
+  auto & m = find(line.type, line.name, line.name_size, line.tags,
+                  line.tags_size);
+
+  switch (line.type) {
+
+    case statsd_line::counter:
+      m.value += line.number / line.sample_rate;
+      break;
+
+    case statsd_line::gauge:
+      if (line.delta) {
+        m.value += line.number;
+      } else {
+        m.value = line.number;
+        m.absolute = true;
+      }
+      break;
+
+    case statsd_line::set:
+      m.set.insert(fnv1a(line.value, line.value_size));
+      break;
+
+    case statsd_line::timer:
+      m.sketch.add(line.number,
+                   std::max<uint64_t>(1, std::llround(1 / line.sample_rate)));
+      break;
+  }
+
+  m.updated = true;
+}
+
+void statsd_table::merge(statsd_table & other) {
+
+  if (metrics_.empty()) {
+    metrics_.swap(other.metrics_);
+    return;
+  }
+
+  for (auto & p : other.metrics_) {
+
+    auto it = metrics_.find(p.first);
+
+    if (it == metrics_.end()) {
+      metrics_.insert({p.first, std::move(p.second)});
+      continue;
+    }
+
+    auto & m = it->second;
+    auto & o = p.second;
+
+    switch (m.type) {
+
+      case statsd_line::counter:
+        m.value += o.value;
+        break;
+
+      case statsd_line::gauge:
+        m.value = o.absolute ? o.value : m.value + o.value;
+        m.absolute = m.absolute || o.absolute;
+        break;
+
+      case statsd_line::set:
+        m.set.insert(begin(o.set), end(o.set));
+        break;
+
+      case statsd_line::timer:
+        m.sketch.merge(o.sketch);
+        break;
+    }
+
+    m.updated = m.updated || o.updated;
+  }
+
+  other.metrics_.clear();
+}
+
+void statsd_table::flush(riemann::Msg & msg, const int64_t time,
+                         const float ttl, const float interval,
+                         const std::vector<double> & percentiles)
+{
+
+  for (auto it = metrics_.begin(); it != metrics_.end(); ) {
+
+    auto & m = it->second;
+
+    auto add_event = [&](const std::string & suffix, const double value)
+    {
+      auto event = msg.add_events();
+      event->set_service(suffix.empty() ? m.name : m.name + " " + suffix);
+      event->set_metric_d(value);
+      event->set_time(time);
+      event->set_ttl(ttl);
+      add_tags(*event, m.tags);
+    };
+
+    if (m.updated) {
+
+      switch (m.type) {
+
+        case statsd_line::counter:
+          add_event("", m.value);
+          add_event("rate", m.value / interval);
+          break;
+
+        case statsd_line::gauge:
+          add_event("", m.value);
+          break;
+
+        case statsd_line::set:
+          add_event("", m.set.size());
+          break;
+
+        case statsd_line::timer:
+          add_event("count", m.sketch.count());
+          add_event("mean", m.sketch.sum() / m.sketch.count());
+          for (const auto p : percentiles) {
+            add_event(std::to_string(p), m.sketch.quantile(p));
+          }
+          break;
+      }
+
+    }
+
+    if (m.type == statsd_line::gauge) {
+      m.updated = false;
+      ++it;
+    } else {
+      it = metrics_.erase(it);
+    }
+  }
+
+}
+
+size_t statsd_table::size() const {
+  return metrics_.size();
+}
+
+statsd_table::metric & statsd_table::find(
+    const statsd_line::metric_type type,
+    const char * name,
+    const size_t name_size,
+    const char * tags,
+    const size_t tags_size)
+{
+
+  // Reuses the memory of the key, lookups of known metrics don't allocate
+  key_.assign(1, static_cast<char>('0' + type));
+  key_.append(name, name_size);
+  key_.push_back('#');
+  key_.append(tags ? tags : "", tags_size);
+
+  auto it = metrics_.find(key_);
+
+  if (it != metrics_.end()) {
+    return it->second;
+  }
+
+  metric m;
+  m.type = type;
+  m.name.assign(name, name_size);
+  m.tags.assign(tags ? tags : "", tags_size);
+  m.value = 0;
+  m.absolute = false;
+  m.updated = false;
+
+  return metrics_.insert({key_, std::move(m)}).first->second;
+}
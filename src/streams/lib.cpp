@@ -1,68 +1,122 @@
+#include <mutex>
+#include <unordered_map>
 #include <streams/lib.h>
 
-thread_local std::string * thread_ns = nullptr;
+namespace {
 
-void free_thread_ns() {
-  if (thread_ns != nullptr) {
-    delete thread_ns;
-    thread_ns = nullptr;
+size_t shards = 0;
+
+thread_local size_t thread_shard = k_no_shard;
+
+std::vector<std::string> partition;
+
+thread_local bool thread_partition_scope = false;
+
+thread_local ns_id_t thread_ns_id = k_global_ns_id;
+
+std::mutex ns_mutex;
+std::unordered_map<std::string, ns_id_t> ns_ids{{k_global_ns, k_global_ns_id}};
+std::vector<std::string> ns_names{k_global_ns};
+
+}
+
+ns_id_t intern_ns(const std::string & ns) {
+
+  std::lock_guard<std::mutex> lock(ns_mutex);
+
+  auto it = ns_ids.find(ns);
+
+  if (it != ns_ids.end()) {
+    return it->second;
   }
+
+  const auto ns_id = static_cast<ns_id_t>(ns_names.size());
+
+  ns_ids.insert({ns, ns_id});
+  ns_names.push_back(ns);
+
+  return ns_id;
 }
 
 void set_thread_ns(const std::string ns) {
-  free_thread_ns();
-  thread_ns = new std::string(ns);
+  thread_ns_id = intern_ns(ns);
+}
+
+void set_thread_ns_id(const ns_id_t ns_id) {
+  thread_ns_id = ns_id;
 }
 
 void set_thread_global_ns() {
-  free_thread_ns();
+  thread_ns_id = k_global_ns_id;
 }
 
-std::string get_thread_ns() {
-  if (thread_ns) {
-    return *thread_ns;
-  } else {
+ns_id_t get_thread_ns_id() {
+  return thread_ns_id;
+}
+
+std::string get_ns_name(const ns_id_t ns_id) {
+
+  if (ns_id == k_global_ns_id) {
     return k_global_ns;
   }
+
+  std::lock_guard<std::mutex> lock(ns_mutex);
+
+  return ns_names[ns_id];
 }
 
-bool stream_lib::used() const {
-  return ref_counter.load() & 1;
+std::string get_thread_ns() {
+  return get_ns_name(thread_ns_id);
 }
 
-bool stream_lib::inc() {
-  unsigned int current = ref_counter.load();
-  unsigned int new_val;
+void set_stream_shards(const size_t n) {
+  shards = n;
+}
 
-  do {
+size_t stream_shards() {
+  return shards;
+}
 
-    if (!(current & 1)) {
-      // Stream is not being used. Abort inc
-      return false;
-    }
+void set_thread_shard(const size_t shard) {
+  thread_shard = shard;
+}
 
-   new_val = (((current >> 1) + 1) << 1) | 1;
+size_t get_thread_shard() {
+  return thread_shard;
+}
 
-  } while(!ref_counter.compare_exchange_strong(current, new_val));
+void set_stream_partition(const std::vector<std::string> & fields) {
+  partition = fields;
+}
+
+const std::vector<std::string> & stream_partition() {
+  return partition;
+}
+
+bool partition_scope() {
+  return thread_partition_scope;
+}
 
-  return true;
+partition_scope_guard::partition_scope_guard(const bool scope)
+  : prev_scope_(thread_partition_scope)
+{
+  thread_partition_scope = scope;
 }
 
-void stream_lib::dec() {
-  unsigned int current = ref_counter.load();
-  unsigned int new_val;
+partition_scope_guard::~partition_scope_guard() {
+  thread_partition_scope = prev_scope_;
+}
 
-  do {
+stream_libs::stream_libs() : list_(new lib_list_t()) {}
 
-   new_val = (((current >> 1) - 1) << 1) | (current & 1);
+stream_libs::~stream_libs() {
+  delete list_.load();
+}
 
-  } while(!ref_counter.compare_exchange_strong(current, new_val));
+const lib_list_t & stream_libs::load() const {
+  return *list_.load(std::memory_order_acquire);
 }
 
-void stream_lib::set_used(const bool used) {
-  if (used) {
-    ref_counter |= 1;
-  } else {
-    ref_counter &= ~1;
-  }
+const lib_list_t * stream_libs::publish(const lib_list_t & libs) {
+  return list_.exchange(new lib_list_t(libs), std::memory_order_acq_rel);
 }
@@ -0,0 +1,118 @@
+#include <glog/logging.h>
+#include <mutex>
+#include <unordered_map>
+#include <streams/named_state.h>
+
+namespace {
+
+thread_local std::string thread_state_lib;
+thread_local std::string thread_prefix;
+thread_local size_t thread_index = 0;
+
+std::mutex state_mutex;
+std::unordered_map<std::string, std::weak_ptr<void>> live_states;
+std::unordered_map<std::string, std::shared_ptr<void>> carried_states;
+
+bool has_prefix(const std::string & key, const std::string & prefix) {
+  return key.compare(0, prefix.size(), prefix) == 0;
+}
+
+}
+
+void set_state_lib(const std::string & lib) {
+  thread_state_lib = lib;
+}
+
+std::string state_lib() {
+  return thread_state_lib;
+}
+
+state_scope_guard::state_scope_guard(const std::string & prefix)
+  :
+    prev_prefix_(thread_prefix),
+    prev_index_(thread_index)
+{
+  thread_prefix = prefix;
+  thread_index = 0;
+}
+
+state_scope_guard::~state_scope_guard() {
+  thread_prefix = prev_prefix_;
+  thread_index = prev_index_;
+}
+
+std::string next_state_key(const std::string & shape) {
+
+  if (thread_prefix.empty()) {
+    return "";
+  }
+
+  return thread_prefix + "/" + std::to_string(thread_index++) + ":" + shape;
+}
+
+std::string child_state_scope(const std::string & scope,
+                              const std::string & child)
+{
+  return scope.empty() ? "" : scope + "/" + child;
+}
+
+std::shared_ptr<void> find_or_add_named_state(
+    const std::string & key,
+    std::function<std::shared_ptr<void>()> make_state)
+{
+
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  auto & live = live_states[key];
+
+  if (auto state = live.lock()) {
+    return state;
+  }
+
+  auto it = carried_states.find(key);
+
+  if (it != carried_states.end()) {
+    VLOG(3) << "carrying over state " << key;
+    live = it->second;
+    return it->second;
+  }
+
+  auto state = make_state();
+  live = state;
+
+  return state;
+}
+
+void carry_named_state(const std::string & lib) {
+
+  const auto prefix = lib + "/";
+
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  for (auto it = carried_states.begin(); it != carried_states.end();) {
+    if (has_prefix(it->first, prefix)) {
+      it = carried_states.erase(it);
+    } else {
+      it++;
+    }
+  }
+
+  for (auto it = live_states.begin(); it != live_states.end();) {
+
+    auto state = it->second.lock();
+
+    if (!state) {
+      it = live_states.erase(it);
+      continue;
+    }
+
+    if (has_prefix(it->first, prefix)) {
+      carried_states.insert({it->first, state});
+    }
+
+    it++;
+  }
+
+  VLOG(1) << carried_states.size() << " named states kept for " << lib;
+
+}
@@ -4,17 +4,18 @@
 #include <atomic>
 #include <chrono>
 #include <util/util.h>
+#include <util/rcu.h>
 #include <core/core.h>
 #include <scheduler/scheduler.h>
 #include <predicates/predicates.h>
 #include <rules_loader.h>
 #include <streams/stream_functions_lock.h>
+#include <streams/stream_functions_shard.h>
+#include <streams/named_state.h>
 #include <streams/stream_functions.h>
 
 namespace {
 
-const size_t k_streams = 10;
-
 const std::string k_rate_service = "cavalieri stream rate";
 const std::string k_rate_desc = "events per second in streams";
 
@@ -30,6 +31,10 @@ const std::string k_in_latency_desc = "distribution of processing time "
 
 
 
+const std::string k_reload_service = "rules reload latency";
+const std::string k_reload_desc = "distribution of time in ms to reload "
+                                  "rule libraries";
+
 const std::vector<double> k_percentiles = {0.0, .5, .95, .99, 1};
 
 using namespace std::chrono;
@@ -41,6 +46,47 @@ time_point_t now() {
 
 }
 
+/* Whether every event a by() on keys sends to one child has the same
+ * partition key, and so comes from the same shard.
+ */
+bool partition_keyed(const by_keys_t & keys) {
+
+  const auto & partition = stream_partition();
+
+  if (partition.empty()) {
+    return false;
+  }
+
+  for (const auto & field : partition) {
+    if (std::find(begin(keys), end(keys), field) == end(keys)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* Functions that aggregate events of different partition keys see them
+ * from several shards. The choice is made when the node is initialized,
+ * the shard state is only used inside a partition scope.
+ */
+streams_t shard_or_lock(const streams_t shard_stream,
+                        const streams_t lock_stream)
+{
+
+  if (!stream_shards()) {
+    return lock_stream;
+  }
+
+  return create_stream([=](fwd_new_stream_fn_t fwd_new_stream)
+  {
+    const auto & stream = partition_scope() ? shard_stream : lock_stream;
+
+    return stream.front().on_init(fwd_new_stream);
+  });
+
+}
+
 }
 
 namespace pred = predicates;
@@ -251,7 +297,17 @@ streams_t by(const by_keys_t & keys, const streams_t stream) {
 #ifdef BY_LOCKFREE
   return by_lockfree(keys, stream);
 #else
-  return by_lock(keys, stream);
+  if (!stream_shards()) {
+    return by_lock(keys, stream);
+  }
+
+  return create_stream([=](fwd_new_stream_fn_t fwd_new_stream)
+  {
+    const auto by_stream = partition_scope() || partition_keyed(keys)
+                           ? by_shard(keys, stream) : by_lock(keys, stream);
+
+    return by_stream.front().on_init(fwd_new_stream);
+  });
 #endif
 
 }
@@ -261,13 +317,42 @@ streams_t by(const by_keys_t & keys) {
 #ifdef BY_LOCKFREE
   return by_lockfree(keys, stream);
 #else
-  return by_lock(keys);
+  if (!stream_shards()) {
+    return by_lock(keys);
+  }
+
+  return create_stream([=](fwd_new_stream_fn_t fwd_new_stream)
+  {
+    const auto by_stream = partition_scope() || partition_keyed(keys)
+                           ? by_shard(keys) : by_lock(keys);
+
+    return by_stream.front().on_init(fwd_new_stream);
+  });
 #endif
 
 }
 
 
 
+streams_t named(const std::string name, const streams_t stream) {
+
+  return create_stream(
+    [=]() -> on_event_fn_t
+    {
+      const auto lib = state_lib();
+
+      auto named_stream = std::make_shared<streams_t>(stream);
+
+      {
+        state_scope_guard scope(lib.empty() ? "" : lib + "/" + name);
+        init_streams(*named_stream);
+      }
+
+      return [=](e_t e) { return push_event(*named_stream, e); };
+    });
+
+}
+
 streams_t rate(const int interval) {
 
   return create_stream(
@@ -320,7 +405,7 @@ streams_t coalesce(fold_fn_t fold) {
 #ifdef COALESCE_LOCKFREE
   return coalesce_lockfree(fold);
 #else
-  return coalesce_lock(fold);
+  return shard_or_lock(coalesce_shard(fold), coalesce_lock(fold));
 #endif
 
 }
@@ -330,7 +415,8 @@ streams_t project(const predicates_t predicates, fold_fn_t fold) {
 #ifdef PROJECT_LOCKFREE
   return project_lockfree(predicates, fold);
 #else
-  return project_lock(predicates, fold);
+  return shard_or_lock(project_shard(predicates, fold),
+                       project_lock(predicates, fold));
 #endif
 
 }
@@ -340,7 +426,8 @@ streams_t changed_state_(std::string initial) {
 #ifdef CHANGED_STATE_LOCKFREE
   return changed_state_lockfree(initial);
 #else
-  return changed_state_lock(initial);
+  return shard_or_lock(changed_state_shard(initial),
+                       changed_state_lock(initial));
 #endif
 
 }
@@ -405,7 +492,8 @@ streams_t moving_event_window(size_t n, fold_fn_t fold) {
 #ifdef MOVING_EVENT_WINDOW_LOCKFREE
   return moving_event_window_lockfree(n, fold);
 #else
-  return moving_event_window_lock(n, fold);
+  return shard_or_lock(moving_event_window_shard(n, fold),
+                       moving_event_window_lock(n, fold));
 #endif
 
 }
@@ -415,7 +503,8 @@ streams_t fixed_event_window(size_t n, fold_fn_t fold) {
 #ifdef FIXED_EVENT_WINDOW_LOCKFREE
   return fixed_event_window_lockfree(n, fold);
 #else
-  return fixed_event_window_lock(n, fold);
+  return shard_or_lock(fixed_event_window_shard(n, fold),
+                       fixed_event_window_lock(n, fold));
 #endif
 
 }
@@ -425,7 +514,8 @@ streams_t moving_time_window(time_t dt, fold_fn_t fold) {
 #ifdef MOVING_TIME_WINDOW_LOCKFREE
   return moving_time_window_lockfree(dt, fold);
 #else
-  return moving_time_window_lock(dt, fold);
+  return shard_or_lock(moving_time_window_shard(dt, fold),
+                       moving_time_window_lock(dt, fold));
 #endif
 
 }
@@ -435,7 +525,8 @@ streams_t fixed_time_window(time_t dt, fold_fn_t fold) {
 #ifdef FIXED_TIME_WINDOW_LOCKFREE
   return fixed_time_window_lockfree(dt, fold);
 #else
-  return fixed_time_window_lock(dt, fold);
+  return shard_or_lock(fixed_time_window_shard(dt, fold),
+                       fixed_time_window_lock(dt, fold));
 #endif
 
 }
@@ -445,7 +536,7 @@ streams_t stable(time_t dt) {
 #ifdef STABLE_LOCKFREE
   return stable_lockfree(dt);
 #else
-  return stable_lock(dt);
+  return shard_or_lock(stable_shard(dt), stable_lock(dt));
 #endif
 
 }
@@ -455,7 +546,7 @@ streams_t throttle(size_t n, time_t dt) {
 #ifdef THROTTLE_LOCKFREE
   return throttle_lockfree(n, dt);
 #else
-  return throttle_lock(n, dt);
+  return shard_or_lock(throttle_shard(n, dt), throttle_lock(n, dt));
 #endif
 
 }
@@ -595,7 +686,7 @@ streams_t ddt() {
 #ifdef DDT_LOCKFREE
   return ddt_lockfree();
 #else
-  return ddt_lock();
+  return shard_or_lock(ddt_shard(), ddt_lock());
 #endif
 
 
@@ -740,24 +831,80 @@ streams_t pagerduty_trigger(const std::string key) {
 
 streams::streams(const config & conf, instrumentation::instrumentation & instr)
   : rules_directory_(conf.rules_directory),
-    streams_(k_streams),
     update_rate_(instr.add_rate(k_rate_service, k_latency_desc)),
     update_latency_(instr.add_latency(k_latency_service,
                                       k_latency_desc, k_percentiles)),
     update_in_latency_(instr.add_latency(k_in_latency_service,
                                          k_in_latency_desc, k_percentiles)),
-    stop_(false)
+    reload_latency_(instr.add_latency(k_reload_service, k_reload_desc,
+                                      k_percentiles)),
+    stop_(false),
+    reload_pending_(false),
+    reload_stop_(false)
 {
 
 }
 
+streams::~streams() {
+  stop();
+}
+
 void streams::add_stream(streams_t) {
   VLOG(3) << "add_stream()";
   //streams_.push_back(stream);
 }
 
 void streams::reload_rules() {
- load_rules(rules_directory_, streams_);
+
+  std::lock_guard<std::mutex> lock(reload_mutex_);
+
+  auto start_time = now();
+
+  load_rules(rules_directory_, libs_);
+
+  reload_latency_(duration_cast<microseconds>(now() - start_time).count()
+                  / 1000.0);
+}
+
+void streams::reload_rules_async() {
+
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+
+  if (reload_stop_) {
+    return;
+  }
+
+  // Requests that arrive while a reload is pending are merged into it
+  reload_pending_ = true;
+
+  if (!reload_thread_.joinable()) {
+    reload_thread_ = std::thread(&streams::reload_loop, this);
+  }
+
+  pending_cond_.notify_one();
+}
+
+void streams::reload_loop() {
+
+  while (true) {
+
+    {
+      std::unique_lock<std::mutex> lock(pending_mutex_);
+
+      pending_cond_.wait(lock, [&]() {
+        return reload_pending_ || reload_stop_;
+      });
+
+      if (reload_stop_) {
+        return;
+      }
+
+      reload_pending_ = false;
+    }
+
+    reload_rules();
+  }
+
 }
 
 void streams::process_message(const riemann::Msg& message) {
@@ -768,7 +915,6 @@ void streams::process_message(const riemann::Msg& message) {
 
   update_rate_(message.events_size());
 
-  VLOG(3) << "process message. num of streams " << streams_.size();
   VLOG(3) << "process message. num of events " << message.events_size();
 
   for (int i = 0; i < message.events_size(); i++) {
@@ -780,23 +926,18 @@ void streams::process_message(const riemann::Msg& message) {
   }
 }
 
-void push_stream(stream_lib & stream, const Event & event) {
-
-  if (!stream.inc()) {
-    return;
-  }
+/* Must be called inside an rcu read section */
+void push_stream(const loaded_lib & lib, const Event & event) {
 
-  set_thread_ns(stream.file);
+  set_thread_ns_id(lib.ns_id);
 
   try {
-    ::push_event(*stream.stream, event);
+    ::push_event(*lib.stream, event);
   } catch(const std::exception & e){
-    LOG(ERROR) << "exception in " << stream.file << " : "  << e.what();
+    LOG(ERROR) << "exception in " << lib.file << " : "  << e.what();
   }
 
   set_thread_global_ns();
-
-  stream.dec();
 }
 
 void streams::push_event(const Event& e) {
@@ -805,37 +946,45 @@ void streams::push_event(const Event& e) {
     return;
   }
 
-  for (auto & s: streams_) {
+  rcu_read_guard rcu_guard;
 
-    if (!s.used()) {
-      continue;
-    }
+  const auto & libs = libs_.load();
 
-    if (e.state() == "expired") {
-      ::push_stream(s, e);
-      continue;
+  if (libs.empty()) {
+    return;
+  }
+
+  if (e.state() == "expired") {
+
+    for (const auto lib : libs) {
+      ::push_stream(*lib, e);
     }
 
-    if (e.has_time()) {
+    return;
+  }
 
-      update_in_latency_(difftime(time(0), e.time()));
+  if (!e.has_time()) {
 
-      auto start_time = now();
+    Event ne(e);
+    ne.set_time(g_core->sched().unix_time());
 
-      ::push_stream(s, e);
+    for (const auto lib : libs) {
+      ::push_stream(*lib, ne);
+    }
 
-      update_latency_(duration_cast<microseconds>(now() - start_time).count()
-                      / 1000.0);
+    return;
+  }
 
-    } else {
-      Event ne(e);
-      ne.set_time(g_core->sched().unix_time());
+  update_in_latency_(difftime(time(0), e.time()));
 
-      ::push_stream(s, ne);
-    }
+  auto start_time = now();
 
+  for (const auto lib : libs) {
+    ::push_stream(*lib, e);
   }
 
+  update_latency_(duration_cast<microseconds>(now() - start_time).count()
+                  / 1000.0);
 
 }
 
@@ -844,4 +993,14 @@ void streams::stop() {
   VLOG(3) << "stop stream processing";
 
   stop_ = true;
+
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    reload_stop_ = true;
+    pending_cond_.notify_one();
+  }
+
+  if (reload_thread_.joinable()) {
+    reload_thread_.join();
+  }
 }
@@ -3,6 +3,7 @@
 #include <core/core.h>
 #include <instrumentation/reservoir.h>
 #include <predicates/predicates.h>
+#include <streams/named_state.h>
 #include <streams/stream_functions.h>
 
 namespace pred = predicates;
@@ -16,6 +17,7 @@ typedef struct {
 on_event_fn_t by_lock_(const by_keys_t & keys, const streams_t stream) {
 
   auto streams = std::make_shared<by_t>();
+  const auto scope = next_state_key("by");
 
   return [=](e_t e) -> next_events_t
   {
@@ -36,6 +38,9 @@ on_event_fn_t by_lock_(const by_keys_t & keys, const streams_t stream) {
      if (s.empty()) {
 
        s = stream;
+
+       state_scope_guard guard(child_state_scope(scope, key));
+       partition_scope_guard partition_guard(false);
        init_streams(s);
 
      }
@@ -61,6 +66,7 @@ typedef struct {
 on_event_fn_t by_lock_(const by_keys_t & keys, fwd_new_stream_fn_t fwd_stream) {
 
   auto streams = std::make_shared<by_fwd_t>();
+  const auto scope = next_state_key("by");
 
   return [=](e_t e) -> next_events_t
   {
@@ -80,6 +86,8 @@ on_event_fn_t by_lock_(const by_keys_t & keys, fwd_new_stream_fn_t fwd_stream) {
 
      if (!f) {
 
+       state_scope_guard guard(child_state_scope(scope, key));
+       partition_scope_guard partition_guard(false);
        f = fwd_stream();
 
      }
@@ -113,7 +121,7 @@ typedef struct {
 
 on_event_fn_t coalesce_lock_(fold_fn_t fold) {
 
-  auto coalesce = std::make_shared<coalesce_events_t>();
+  auto coalesce = make_named_state<coalesce_events_t>("coalesce");
 
   return [=](e_t e)
     {
@@ -172,7 +180,8 @@ typedef struct project {
 
 on_event_fn_t project_lock_(const predicates_t predicates, fold_fn_t fold) {
 
-  auto project_events = std::make_shared<project_t>(predicates.size());
+  auto project_events = make_named_state<project_t>(
+      "project:" + std::to_string(predicates.size()), predicates.size());
 
   return [=](e_t e) -> next_events_t {
 
@@ -245,15 +254,15 @@ streams_t project_lock(const predicates_t predicates, fold_fn_t fold) {
 }
 
 
-typedef struct {
+typedef struct state_data {
+  state_data(const std::string & initial) : state(initial) {}
   std::string state;
   std::mutex mutex;
 } state_t;
 
 
 on_event_fn_t changed_state_lock_(std::string initial) {
-  auto prev = std::make_shared<state_t>();
-  prev->state = initial;
+  auto prev = make_named_state<state_t>("changed_state:" + initial, initial);
 
   return [=](e_t e) -> next_events_t {
 
@@ -282,7 +291,8 @@ typedef struct {
 
 on_event_fn_t moving_event_window_lock_(size_t n, fold_fn_t fold) {
 
-  auto window = std::make_shared<moving_event_window_t>();
+  auto window = make_named_state<moving_event_window_t>(
+      "moving_event_window:" + std::to_string(n));
 
   return [=](e_t e)->next_events_t {
 
@@ -316,7 +326,8 @@ typedef struct {
 
 on_event_fn_t fixed_event_window_lock_(size_t n, fold_fn_t fold) {
 
-  auto window = std::make_shared<fixed_event_window_t>();
+  auto window = make_named_state<fixed_event_window_t>(
+      "fixed_event_window:" + std::to_string(n));
 
   return [=](e_t e) -> next_events_t {
 
@@ -370,7 +381,8 @@ typedef struct {
 
 on_event_fn_t moving_time_window_lock_(time_t dt, fold_fn_t fold) {
 
-  auto window = std::make_shared<moving_time_window_t>();
+  auto window = make_named_state<moving_time_window_t>(
+      "moving_time_window:" + std::to_string(dt));
 
   return [=](e_t e) -> next_events_t {
 
@@ -432,7 +444,8 @@ typedef struct {
 
 on_event_fn_t fixed_time_window_lock_(time_t dt, fold_fn_t fold) {
 
-  auto window = std::make_shared<fixed_time_window_t>();
+  auto window = make_named_state<fixed_time_window_t>(
+      "fixed_time_window:" + std::to_string(dt));
 
   return [=](e_t e) -> next_events_t {
 
@@ -505,7 +518,7 @@ typedef struct {
 
 on_event_fn_t stable_lock_(time_t dt) {
 
-  auto stable = std::make_shared<stable_t>();
+  auto stable = make_named_state<stable_t>("stable:" + std::to_string(dt));
 
   return [=](e_t e)->next_events_t
     {
@@ -557,7 +570,8 @@ typedef struct {
 
 on_event_fn_t throttle_lock_(size_t n, time_t dt) {
 
-  auto throttled = std::make_shared<throttle_t>();
+  auto throttled = make_named_state<throttle_t>(
+      "throttle:" + std::to_string(n) + ":" + std::to_string(dt));
 
   return [=](e_t e) mutable -> next_events_t {
 
@@ -629,7 +643,8 @@ streams_t percentiles_lock(time_t interval, std::vector<double> p) {
     [=](fwd_new_stream_fn_t fwd_new_stream) -> on_event_fn_t
     {
 
-      auto percentiles = std::make_shared<percentiles_data_t>(p);
+      auto percentiles = make_named_state<percentiles_data_t>(
+          "percentiles:" + std::to_string(interval), p);
       auto forward = fwd_new_stream();
 
       // Schedule periodic task to report percentiles
@@ -654,7 +669,7 @@ typedef struct {
 } ddt_prev_t;
 
 on_event_fn_t ddt_lock_() {
-  auto prev = std::make_shared<ddt_prev_t>();
+  auto prev = make_named_state<ddt_prev_t>("ddt");
 
   return [=](e_t e) -> next_events_t {
 
@@ -0,0 +1,576 @@
+#include <glog/logging.h>
+#include <util/util.h>
+#include <queue>
+#include <core/core.h>
+#include <predicates/predicates.h>
+#include <streams/named_state.h>
+#include <streams/stream_functions_shard.h>
+
+namespace pred = predicates;
+
+namespace {
+
+template <class T>
+class shard_local {
+public:
+
+  template <class... Args>
+  shard_local(const Args &... args) {
+    for (size_t i = 0; i < stream_shards(); i++) {
+      slots_.emplace_back(new T(args...));
+    }
+  }
+
+  T & local() {
+    const auto shard = get_thread_shard();
+
+    CHECK(shard < slots_.size()) << "shard state used from a non shard thread";
+
+    return *slots_[shard];
+  }
+
+private:
+  std::vector<std::unique_ptr<T>> slots_;
+};
+
+typedef std::unordered_map<std::string, streams_t> by_map_t;
+
+on_event_fn_t by_shard_(const by_keys_t & keys, const streams_t stream) {
+
+  auto streams = std::make_shared<shard_local<by_map_t>>();
+  const auto scope = next_state_key("by");
+
+  return [=](e_t e) -> next_events_t
+  {
+
+     if (keys.empty()) {
+       return {};
+     }
+
+     std::string key;
+     for (const auto & k: keys) {
+       key += e.value_to_str(k) + " ";
+     }
+
+     streams_t & s = streams->local()[key];
+
+     if (s.empty()) {
+
+       s = stream;
+
+       state_scope_guard guard(child_state_scope(scope, key + "@" + std::to_string(get_thread_shard())));
+       partition_scope_guard partition_guard(true);
+       init_streams(s);
+
+     }
+
+     return push_event(s, e);
+
+  };
+
+}
+
+typedef std::unordered_map<std::string, forward_fn_t> by_fwd_map_t;
+
+on_event_fn_t by_shard_(const by_keys_t & keys, fwd_new_stream_fn_t fwd_stream)
+{
+
+  auto streams = std::make_shared<shard_local<by_fwd_map_t>>();
+  const auto scope = next_state_key("by");
+
+  return [=](e_t e) -> next_events_t
+  {
+
+     if (keys.empty()) {
+       return {};
+     }
+
+     std::string key;
+     for (const auto & k: keys) {
+       key += e.value_to_str(k) + " ";
+     }
+
+     forward_fn_t & f = streams->local()[key];
+
+     if (!f) {
+
+       state_scope_guard guard(child_state_scope(scope, key + "@" + std::to_string(get_thread_shard())));
+       partition_scope_guard partition_guard(true);
+       f = fwd_stream();
+
+     }
+
+     f({e});
+
+     return {};
+
+  };
+
+}
+
+typedef std::unordered_map<std::string, Event> coalesce_events_t;
+
+on_event_fn_t coalesce_shard_(fold_fn_t fold) {
+
+  auto coalesce = make_named_state<shard_local<coalesce_events_t>>("coalesce");
+
+  return [=](e_t e)
+    {
+
+      std::vector<Event> events;
+      std::vector<Event> expired_events;
+
+      auto & coalesce_events = coalesce->local();
+
+      coalesce_events[e.host() + " " +  e.service()] = e;
+
+      for (auto it = coalesce_events.begin(); it != coalesce_events.end();) {
+
+        if (pred::expired(it->second)) {
+
+          expired_events.push_back(it->second);
+          it = coalesce_events.erase(it);
+
+        } else {
+
+          events.push_back(it->second);
+          it++;
+
+        }
+      }
+
+      next_events_t next_events;
+
+      if (!expired_events.empty()) {
+        next_events.push_back(fold(expired_events));
+      }
+
+      if (!events.empty()) {
+        next_events.push_back(fold(events));
+      }
+
+      return next_events;
+
+    };
+
+}
+
+typedef std::vector<boost::optional<Event>> project_events_t;
+
+on_event_fn_t project_shard_(const predicates_t predicates, fold_fn_t fold) {
+
+  auto project_events = make_named_state<shard_local<project_events_t>>(
+      "project:" + std::to_string(predicates.size()), predicates.size(),
+      boost::none);
+
+  return [=](e_t e) -> next_events_t {
+
+      int match_index = -1;
+      for (size_t i = 0; i < predicates.size(); i++) {
+        if (predicates[i](e)) {
+          match_index = i;
+          break;
+        }
+      }
+
+      if (match_index == -1) {
+        return {};
+      }
+
+      std::vector<Event> events;
+      std::vector<Event> expired_events;
+
+      auto & curr_events = project_events->local();
+
+      for (int i = 0; i < static_cast<int>(predicates.size()); i++) {
+
+        if (i == match_index) {
+
+          curr_events[i] = e;
+          events.push_back(e);
+
+        } else {
+
+          if (curr_events[i]) {
+
+            if (pred::expired(*curr_events[i])) {
+
+              expired_events.push_back(*curr_events[i]);
+              curr_events[i].reset();
+
+            } else {
+              events.push_back(*curr_events[i]);
+            }
+          }
+
+        }
+
+      }
+
+      next_events_t next_events;
+
+      if (!expired_events.empty()) {
+        next_events.push_back(fold(expired_events));
+      }
+
+      if (!events.empty()) {
+        next_events.push_back(fold(events));
+      }
+
+      return next_events;
+
+    };
+
+}
+
+on_event_fn_t changed_state_shard_(std::string initial) {
+
+  auto prev = make_named_state<shard_local<std::string>>(
+      "changed_state:" + initial, initial);
+
+  return [=](e_t e) -> next_events_t {
+
+      auto & state = prev->local();
+
+      if (state == e.state()) {
+        return {};
+      }
+
+      state = e.state();
+
+      return {e};
+
+    };
+}
+
+on_event_fn_t moving_event_window_shard_(size_t n, fold_fn_t fold) {
+
+  auto window = make_named_state<shard_local<std::list<Event>>>(
+      "moving_event_window:" + std::to_string(n));
+
+  return [=](e_t e) -> next_events_t {
+
+      auto & events = window->local();
+
+      events.push_back(e);
+
+      if (events.size() == (n + 1)) {
+        events.pop_front();
+      }
+
+      return {fold({begin(events), end(events)})};
+
+    };
+}
+
+on_event_fn_t fixed_event_window_shard_(size_t n, fold_fn_t fold) {
+
+  auto window = make_named_state<shard_local<std::vector<Event>>>(
+      "fixed_event_window:" + std::to_string(n));
+
+  return [=](e_t e) -> next_events_t {
+
+      auto & events = window->local();
+
+      events.push_back(e);
+
+      if (events.size() < n) {
+        return {};
+      }
+
+      std::vector<Event> flush;
+      flush.swap(events);
+
+      return {fold(flush)};
+
+   };
+
+}
+
+struct event_time_cmp
+{
+  bool operator() (const Event & lhs, const Event & rhs) const
+  {
+    return (lhs.time() > rhs.time());
+  }
+};
+
+typedef std::priority_queue<Event, std::vector<Event>, event_time_cmp>
+        event_pq_t;
+
+typedef struct {
+  event_pq_t pq;
+  time_t max{0};
+} moving_time_window_t;
+
+on_event_fn_t moving_time_window_shard_(time_t dt, fold_fn_t fold) {
+
+  auto window = make_named_state<shard_local<moving_time_window_t>>(
+      "moving_time_window:" + std::to_string(dt));
+
+  return [=](e_t e) -> next_events_t {
+
+      if (!e.has_time()) {
+        return {};
+      }
+
+      auto & w = window->local();
+
+      if (e.time() > w.max) {
+        w.max = e.time();
+      }
+
+      w.pq.push(e);
+
+      if (w.max >= dt) {
+
+        while (!w.pq.empty() && w.pq.top().time() <= (w.max - dt)) {
+          w.pq.pop();
+        }
+
+      }
+
+      auto pq = w.pq;
+
+      std::vector<Event> events;
+
+      while (!pq.empty()) {
+        events.push_back(pq.top());
+        pq.pop();
+      }
+
+      return {fold(events)};
+
+    };
+}
+
+typedef struct {
+  event_pq_t pq;
+  time_t start{0};
+  time_t max{0};
+  bool started{false};
+} fixed_time_window_t;
+
+on_event_fn_t fixed_time_window_shard_(time_t dt, fold_fn_t fold) {
+
+  auto window = make_named_state<shard_local<fixed_time_window_t>>(
+      "fixed_time_window:" + std::to_string(dt));
+
+  return [=](e_t e) -> next_events_t {
+
+      // Ignore event with no time
+      if (!e.has_time()) {
+        return {};
+      }
+
+      auto & w = window->local();
+
+      if (!w.started) {
+        w.started = true;
+        w.start = e.time();
+        w.pq.push(e);
+        w.max = e.time();
+        return {};
+      }
+
+      // Too old
+      if (e.time() < w.start) {
+        return {};
+      }
+
+      if (e.time() > w.max) {
+        w.max = e.time();
+      }
+
+      time_t next_interval = w.start - (w.start % dt) + dt;
+
+      w.pq.push(e);
+
+      if (w.max < next_interval) {
+        return {};
+      }
+
+      // We can flush a window
+      std::vector<Event> flush;
+
+      while (!w.pq.empty() && w.pq.top().time() < next_interval) {
+        flush.emplace_back(w.pq.top());
+        w.pq.pop();
+      }
+
+      w.start = next_interval;
+
+      if (!flush.empty()) {
+        return {fold(flush)};
+      } else {
+        return {};
+      }
+  };
+
+}
+
+typedef struct {
+  std::string state;
+  std::vector<Event> buffer;
+  time_t start{0};
+} stable_t;
+
+on_event_fn_t stable_shard_(time_t dt) {
+
+  auto stable = make_named_state<shard_local<stable_t>>(
+      "stable:" + std::to_string(dt));
+
+  return [=](e_t e) -> next_events_t
+    {
+
+      auto & s = stable->local();
+
+      if (s.state != e.state()) {
+        s.start = e.time();
+        s.buffer.clear();
+        s.buffer.push_back(e);
+        s.state = e.state();
+        return {};
+      }
+
+      if (e.time() < s.start) {
+        return {};
+      }
+
+      if (s.start + dt > e.time()) {
+        s.buffer.push_back(e);
+        return {};
+      }
+
+      std::vector<Event> flush;
+      flush.swap(s.buffer);
+      flush.push_back(e);
+
+      return flush;
+
+  };
+
+}
+
+typedef struct {
+  size_t forwarded{0};
+  time_t new_interval{0};
+} throttle_t;
+
+on_event_fn_t throttle_shard_(size_t n, time_t dt) {
+
+  auto throttled = make_named_state<shard_local<throttle_t>>(
+      "throttle:" + std::to_string(n) + ":" + std::to_string(dt));
+
+  return [=](e_t e) -> next_events_t {
+
+      auto & t = throttled->local();
+
+      if (t.new_interval < e.time()) {
+        t.new_interval += e.time() + dt;
+        t.forwarded = 0;
+      }
+
+      if (t.forwarded >= n) {
+        return {};
+      }
+
+      t.forwarded++;
+
+      return {e};
+
+    };
+
+}
+
+typedef struct {
+  double metric{0};
+  int64_t time{0};
+  bool initialized{false};
+} ddt_prev_t;
+
+on_event_fn_t ddt_shard_() {
+
+  auto ddt_prev = make_named_state<shard_local<ddt_prev_t>>("ddt");
+
+  return [=](e_t e) -> next_events_t {
+
+      auto & prev = ddt_prev->local();
+
+      auto tmp_metric = prev.metric;
+      auto tmp_time = prev.time;
+
+      prev.metric = e.metric();
+      prev.time =  e.time();
+
+      if (!prev.initialized) {
+        prev.initialized = true;
+        return {};
+      }
+
+      auto dt = e.time() - tmp_time;
+
+      if (dt == 0) {
+        return {};
+      }
+
+      return {e.copy().set_metric((prev.metric - tmp_metric) / dt)};
+
+    };
+}
+
+}
+
+streams_t by_shard(const by_keys_t & keys, const streams_t stream) {
+  return create_stream([=](){ return by_shard_(keys, stream); });
+}
+
+streams_t by_shard(const by_keys_t & keys) {
+  return create_stream(
+      [=](fwd_new_stream_fn_t fwd_stream)
+      {
+
+        return by_shard_(keys, fwd_stream);
+
+      });
+}
+
+streams_t coalesce_shard(fold_fn_t fold) {
+  return create_stream([=](){ return coalesce_shard_(fold); });
+}
+
+streams_t project_shard(const predicates_t predicates, fold_fn_t fold) {
+  return create_stream([=](){ return project_shard_(predicates, fold); });
+}
+
+streams_t changed_state_shard(std::string initial) {
+  return create_stream([=](){ return changed_state_shard_(initial); });
+}
+
+streams_t moving_event_window_shard(size_t n, fold_fn_t fold) {
+  return create_stream([=](){ return moving_event_window_shard_(n, fold); });
+}
+
+streams_t fixed_event_window_shard(size_t n, fold_fn_t fold) {
+  return create_stream([=](){ return fixed_event_window_shard_(n, fold); });
+}
+
+streams_t moving_time_window_shard(time_t dt, fold_fn_t fold) {
+  return create_stream([=](){ return moving_time_window_shard_(dt, fold); });
+}
+
+streams_t fixed_time_window_shard(time_t dt, fold_fn_t fold) {
+  return create_stream([=](){ return fixed_time_window_shard_(dt, fold); });
+}
+
+streams_t stable_shard(time_t dt) {
+  return create_stream([=](){ return stable_shard_(dt); });
+}
+
+streams_t throttle_shard(size_t n, time_t dt) {
+  return create_stream([=](){ return throttle_shard_(n, dt); });
+}
+
+streams_t ddt_shard() {
+  return create_stream(ddt_shard_);
+}
@@ -0,0 +1,98 @@
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+#include <transport/buffer_pool.h>
+
+namespace {
+
+// Memory a thread keeps in released buffers, the rest is freed
+const size_t k_max_pooled_bytes = 32 * 1024 * 1024;
+
+std::atomic<size_t> used(0);
+std::atomic<size_t> pooled(0);
+
+class free_lists {
+public:
+  free_lists() : bytes_(0) {}
+
+  ~free_lists() {
+
+    for (auto & list : lists_) {
+      for (auto buffer : list.second) {
+        delete[] buffer;
+      }
+    }
+
+    pooled -= bytes_;
+  }
+
+  unsigned char * pop(const size_t size) {
+
+    auto it = lists_.find(size);
+
+    if (it == lists_.end() || it->second.empty()) {
+      return nullptr;
+    }
+
+    auto buffer = it->second.back();
+    it->second.pop_back();
+
+    bytes_ -= size;
+    pooled -= size;
+
+    return buffer;
+  }
+
+  bool push(unsigned char * buffer, const size_t size) {
+
+    if (bytes_ + size > k_max_pooled_bytes) {
+      return false;
+    }
+
+    lists_[size].push_back(buffer);
+
+    bytes_ += size;
+    pooled += size;
+
+    return true;
+  }
+
+private:
+  std::unordered_map<size_t, std::vector<unsigned char *>> lists_;
+  size_t bytes_;
+};
+
+thread_local free_lists thread_free_lists;
+
+}
+
+namespace buffer_pool {
+
+unsigned char * acquire(const size_t size) {
+
+  used += size;
+
+  auto buffer = thread_free_lists.pop(size);
+
+  return buffer ? buffer : new unsigned char[size];
+}
+
+void release(unsigned char * buffer, const size_t size) {
+
+  used -= size;
+
+  if (!thread_free_lists.push(buffer, size)) {
+    delete[] buffer;
+  }
+
+}
+
+size_t used_bytes() {
+  return used;
+}
+
+size_t pooled_bytes() {
+  return pooled;
+}
+
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cstring>
+#include <glog/logging.h>
+#include <transport/buffer_pool.h>
+#include <transport/byte_buffer.h>
+
+namespace {
+
+const size_t k_min_size = 4096;
+
+size_t round_size(const size_t size, const size_t capacity) {
+
+  size_t rounded = k_min_size;
+
+  while (rounded < size) {
+    rounded <<= 1;
+  }
+
+  return std::min(rounded, capacity);
+}
+
+}
+
+byte_buffer::byte_buffer(const size_t capacity)
+  :
+    capacity_(capacity),
+    buffer_(nullptr),
+    allocated_(0),
+    begin_(0),
+    end_(0),
+    high_(0),
+    next_size_(round_size(0, capacity))
+{
+}
+
+byte_buffer::byte_buffer(byte_buffer && other)
+  :
+    capacity_(other.capacity_),
+    buffer_(other.buffer_),
+    allocated_(other.allocated_),
+    begin_(other.begin_),
+    end_(other.end_),
+    high_(other.high_),
+    next_size_(other.next_size_)
+{
+  other.buffer_ = nullptr;
+  other.allocated_ = other.begin_ = other.end_ = other.high_ = 0;
+}
+
+byte_buffer & byte_buffer::operator=(byte_buffer && other) {
+
+  if (this == &other) {
+    return *this;
+  }
+
+  if (buffer_) {
+    buffer_pool::release(buffer_, allocated_);
+  }
+
+  capacity_ = other.capacity_;
+  buffer_ = other.buffer_;
+  allocated_ = other.allocated_;
+  begin_ = other.begin_;
+  end_ = other.end_;
+  high_ = other.high_;
+  next_size_ = other.next_size_;
+
+  other.buffer_ = nullptr;
+  other.allocated_ = other.begin_ = other.end_ = other.high_ = 0;
+
+  return *this;
+}
+
+byte_buffer::~byte_buffer() {
+
+  if (buffer_) {
+    buffer_pool::release(buffer_, allocated_);
+  }
+
+}
+
+const unsigned char * byte_buffer::data() const {
+  return buffer_ + begin_;
+}
+
+size_t byte_buffer::size() const {
+  return end_ - begin_;
+}
+
+bool byte_buffer::empty() const {
+  return begin_ == end_;
+}
+
+unsigned char byte_buffer::operator[](const size_t i) const {
+  return buffer_[begin_ + i];
+}
+
+size_t byte_buffer::capacity() const {
+  return capacity_;
+}
+
+size_t byte_buffer::reserve() const {
+  return capacity_ - size();
+}
+
+size_t byte_buffer::allocated() const {
+  return allocated_;
+}
+
+unsigned char * byte_buffer::tail() {
+  return buffer_ + end_;
+}
+
+size_t byte_buffer::tail_size() const {
+  return allocated_ - end_;
+}
+
+void byte_buffer::prepare() {
+
+  if (!buffer_) {
+    grow(next_size_);
+    return;
+  }
+
+  // The bytes moved are paid by the ones consumed, unless there is no
+  // room left at all
+  if (begin_ > 0 && (begin_ >= size() || tail_size() == 0)) {
+    compact();
+  }
+
+  if (tail_size() == 0 && allocated_ < capacity_) {
+    grow(allocated_ * 2);
+  }
+
+}
+
+void byte_buffer::commit(const size_t n) {
+  CHECK(n <= tail_size()) << "commit past the end of the buffer";
+
+  // When recv() fills all the space there is likely more to read, the next
+  // time it gets twice as much
+  high_ = std::max(high_, n == tail_size() ? allocated_ * 2 : end_ + n);
+
+  end_ += n;
+}
+
+bool byte_buffer::append(const void * src, const size_t n) {
+
+  if (reserve() < n) {
+    return false;
+  }
+
+  if (tail_size() < n && begin_ > 0) {
+    compact();
+  }
+
+  if (tail_size() < n) {
+    grow(buffer_ ? size() + n : std::max(n, next_size_));
+  }
+
+  memcpy(tail(), src, n);
+  commit(n);
+
+  return true;
+}
+
+void byte_buffer::consume(const size_t n) {
+  CHECK(n <= size()) << "consume past the end of the data";
+
+  begin_ += n;
+
+  if (begin_ == end_) {
+    release();
+  }
+}
+
+void byte_buffer::compact() {
+
+  memmove(buffer_, data(), size());
+
+  end_ -= begin_;
+  begin_ = 0;
+}
+
+void byte_buffer::grow(const size_t min_size) {
+
+  const size_t size = round_size(std::max(min_size, allocated_ * 2),
+                                 capacity_);
+
+  auto buffer = buffer_pool::acquire(size);
+
+  if (buffer_) {
+    memcpy(buffer, data(), this->size());
+    buffer_pool::release(buffer_, allocated_);
+  }
+
+  buffer_ = buffer;
+  allocated_ = size;
+  end_ -= begin_;
+  begin_ = 0;
+}
+
+/* Idle connections give their memory back, and take what they needed this
+ * time when they are used again
+ */
+void byte_buffer::release() {
+
+  if (!buffer_) {
+    return;
+  }
+
+  next_size_ = round_size(high_, capacity_);
+
+  buffer_pool::release(buffer_, allocated_);
+
+  buffer_ = nullptr;
+  allocated_ = begin_ = end_ = high_ = 0;
+}
@@ -140,8 +140,7 @@ curl_pool::curl_pool(const size_t thread_num,
 
   for (size_t i = 0; i < thread_num; i++) {
 
-    auto queue = std::make_shared<event_queue_t>();
-    queue->set_capacity(k_queue_capacity);
+    auto queue = std::make_shared<event_queue_t>(k_queue_capacity);
 
     thread_event_queues_.push_back(queue);
 
@@ -198,7 +197,7 @@ void curl_pool::push_event(const Event & event, boost::any extra) {
 
   auto & queue = thread_event_queues_[next_thread_];
 
-  if (!queue->try_push({event, extra})) {
+  if (!queue->try_push(queued_event_t{event, extra})) {
 
     LOG(ERROR) << "queue of thread " << next_thread_ << " is full";
     return;
@@ -364,12 +363,9 @@ void curl_pool::async(async_loop & loop) {
 
   auto event_queue = thread_event_queues_[loop_id];
 
-  while (!event_queue->empty()) {
+  queued_event_t event;
 
-    queued_event_t event;
-    if (!event_queue->try_pop(event)) {
-      continue;
-    }
+  while (event_queue->try_pop(event)) {
 
     auto easy = curl_easy_init();
 
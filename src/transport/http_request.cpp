@@ -0,0 +1,466 @@
+#include <algorithm>
+#include <cstring>
+#include <strings.h>
+#include <transport/http_request.h>
+
+namespace {
+
+// Chunk sizes and their extensions
+const size_t k_max_chunk_line = 1024;
+
+// Bodies up to this keep their memory for the next request
+const size_t k_max_kept_body = 64 * 1024;
+
+inline bool is_ows(const char c) {
+  return c == ' ' || c == '\t';
+}
+
+inline int hex_value(const char c) {
+
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+
+  return -1;
+}
+
+template <size_t N>
+inline bool iequals(const char * s, const size_t size, const char (&other)[N])
+{
+  return size == N - 1 && strncasecmp(s, other, N - 1) == 0;
+}
+
+/* Whether the comma separated list in s has token, ignoring case */
+template <size_t N>
+bool has_token(const char * s, const size_t size, const char (&token)[N]) {
+
+  const char * end = s + size;
+
+  while (s < end) {
+
+    while (s < end && (is_ows(*s) || *s == ',')) {
+      s++;
+    }
+
+    const char * start = s;
+
+    while (s < end && *s != ',') {
+      s++;
+    }
+
+    const char * token_end = s;
+
+    while (token_end > start && is_ows(token_end[-1])) {
+      token_end--;
+    }
+
+    if (iequals(start, token_end - start, token)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}
+
+const size_t http_request::k_max_head_size;
+
+http_request::http_request(const size_t max_body_size)
+  :
+    max_body_size_(max_body_size),
+    state_(k_head),
+    method_(),
+    path_(),
+    keep_alive_(true),
+    expect_continue_(false),
+    chunked_(false),
+    has_length_(false),
+    remaining_(0),
+    trailer_size_(0),
+    body_(),
+    status_(0),
+    error_()
+{
+}
+
+size_t http_request::parse(const char * data, const size_t size) {
+
+  const char * p = data;
+  const char * end = data + size;
+
+  while (p < end) {
+
+    switch (state_) {
+
+      case k_head:
+      {
+        // Empty lines before a request are ignored
+        if (*p == '\r' || *p == '\n') {
+          p++;
+          break;
+        }
+
+        const size_t window = std::min<size_t>(end - p, k_max_head_size);
+        auto head_end = static_cast<const char *>(
+            memmem(p, window, "\r\n\r\n", 4));
+
+        if (!head_end) {
+          if (window == k_max_head_size) {
+            fail(431, "request head too large");
+          }
+          return p - data;
+        }
+
+        if (!parse_head(p, head_end + 2)) {
+          return p - data;
+        }
+
+        p = head_end + 4;
+        break;
+      }
+
+      case k_body:
+      case k_chunk_data:
+      {
+        const size_t n = std::min<size_t>(remaining_, end - p);
+
+        body_.append(p, n);
+        p += n;
+        remaining_ -= n;
+
+        if (remaining_ == 0) {
+          state_ = state_ == k_body ? k_done : k_chunk_end;
+        }
+
+        break;
+      }
+
+      case k_chunk_size:
+      {
+        const size_t n = parse_chunk_size(p, end);
+
+        if (n == 0) {
+          return p - data;
+        }
+
+        p += n;
+        break;
+      }
+
+      case k_chunk_end:
+      {
+        if (end - p < 2) {
+          return p - data;
+        }
+
+        if (p[0] != '\r' || p[1] != '\n') {
+          fail(400, "invalid chunk");
+          return p - data;
+        }
+
+        p += 2;
+        state_ = k_chunk_size;
+        break;
+      }
+
+      case k_trailers:
+      {
+        const size_t n = parse_trailer(p, end);
+
+        if (n == 0) {
+          return p - data;
+        }
+
+        p += n;
+        break;
+      }
+
+      case k_done:
+      case k_failed:
+        return p - data;
+    }
+  }
+
+  return p - data;
+}
+
+bool http_request::done() const {
+  return state_ == k_done;
+}
+
+bool http_request::failed() const {
+  return state_ == k_failed;
+}
+
+bool http_request::expect_continue() {
+  const bool expect = expect_continue_;
+  expect_continue_ = false;
+  return expect;
+}
+
+const std::string & http_request::method() const {
+  return method_;
+}
+
+const std::string & http_request::path() const {
+  return path_;
+}
+
+bool http_request::keep_alive() const {
+  return keep_alive_;
+}
+
+const std::string & http_request::body() const {
+  return body_;
+}
+
+int http_request::status() const {
+  return status_;
+}
+
+const std::string & http_request::error() const {
+  return error_;
+}
+
+void http_request::reset() {
+
+  state_ = k_head;
+  method_.clear();
+  path_.clear();
+  keep_alive_ = true;
+  expect_continue_ = false;
+  chunked_ = false;
+  has_length_ = false;
+  remaining_ = 0;
+  trailer_size_ = 0;
+  status_ = 0;
+  error_.clear();
+
+  if (body_.capacity() > k_max_kept_body) {
+    std::string().swap(body_);
+  } else {
+    body_.clear();
+  }
+
+}
+
+/* [p, end) holds the request line and the headers, each line ending with a
+ * newline */
+bool http_request::parse_head(const char * p, const char * end) {
+
+  auto eol = static_cast<const char *>(memchr(p, '\n', end - p));
+  const char * line_end = eol[-1] == '\r' ? eol - 1 : eol;
+
+  auto sp1 = static_cast<const char *>(memchr(p, ' ', line_end - p));
+  auto sp2 = sp1 ? static_cast<const char *>(
+                       memchr(sp1 + 1, ' ', line_end - sp1 - 1))
+                 : nullptr;
+
+  if (!sp2 || sp1 == p || sp2 == sp1 + 1) {
+    return fail(400, "invalid request line");
+  }
+
+  const char * version = sp2 + 1;
+
+  if (line_end - version != 8 || memcmp(version, "HTTP/1.", 7) != 0
+      || (version[7] != '0' && version[7] != '1'))
+  {
+    return fail(505, "unsupported http version");
+  }
+
+  // HTTP/1.0 connections are closed unless asked otherwise
+  keep_alive_ = version[7] == '1';
+
+  method_.assign(p, sp1 - p);
+
+  auto query = static_cast<const char *>(memchr(sp1 + 1, '?', sp2 - sp1 - 1));
+  path_.assign(sp1 + 1, (query ? query : sp2) - sp1 - 1);
+
+  for (p = eol + 1; p < end; p = eol + 1) {
+
+    eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    line_end = eol > p && eol[-1] == '\r' ? eol - 1 : eol;
+
+    auto colon = static_cast<const char *>(memchr(p, ':', line_end - p));
+
+    if (!colon || colon == p) {
+      return fail(400, "invalid header");
+    }
+
+    const char * value = colon + 1;
+
+    while (value < line_end && is_ows(*value)) {
+      value++;
+    }
+
+    const char * value_end = line_end;
+
+    while (value_end > value && is_ows(value_end[-1])) {
+      value_end--;
+    }
+
+    if (!parse_header(p, colon - p, value, value_end - value)) {
+      return false;
+    }
+  }
+
+  if (chunked_ && has_length_) {
+    return fail(400, "both content-length and chunked encoding");
+  }
+
+  if (chunked_) {
+    state_ = k_chunk_size;
+  } else if (remaining_ > 0) {
+    body_.reserve(remaining_);
+    state_ = k_body;
+  } else {
+    state_ = k_done;
+  }
+
+  expect_continue_ = expect_continue_ && state_ != k_done;
+
+  return true;
+}
+
+bool http_request::parse_header(const char * name, const size_t name_size,
+                                const char * value, const size_t value_size)
+{
+
+  if (iequals(name, name_size, "content-length")) {
+
+    size_t length = 0;
+
+    if (value_size == 0 || value_size > 18) {
+      return fail(400, "invalid content-length");
+    }
+
+    for (size_t i = 0; i < value_size; i++) {
+
+      if (value[i] < '0' || value[i] > '9') {
+        return fail(400, "invalid content-length");
+      }
+
+      length = length * 10 + (value[i] - '0');
+    }
+
+    if (has_length_ && length != remaining_) {
+      return fail(400, "conflicting content-length");
+    }
+
+    if (length > max_body_size_) {
+      return fail(413, "request body too large");
+    }
+
+    has_length_ = true;
+    remaining_ = length;
+
+  } else if (iequals(name, name_size, "transfer-encoding")) {
+
+    if (!iequals(value, value_size, "chunked")) {
+      return fail(501, "unsupported transfer encoding");
+    }
+
+    chunked_ = true;
+
+  } else if (iequals(name, name_size, "connection")) {
+
+    if (has_token(value, value_size, "close")) {
+      keep_alive_ = false;
+    } else if (has_token(value, value_size, "keep-alive")) {
+      keep_alive_ = true;
+    }
+
+  } else if (iequals(name, name_size, "expect")) {
+
+    if (!iequals(value, value_size, "100-continue")) {
+      return fail(417, "unsupported expectation");
+    }
+
+    expect_continue_ = true;
+  }
+
+  return true;
+}
+
+size_t http_request::parse_chunk_size(const char * p, const char * end) {
+
+  const size_t window = std::min<size_t>(end - p, k_max_chunk_line);
+  auto eol = static_cast<const char *>(memchr(p, '\n', window));
+
+  if (!eol) {
+    if (window == k_max_chunk_line) {
+      fail(400, "chunk size line too long");
+    }
+    return 0;
+  }
+
+  size_t size = 0;
+  const char * q = p;
+
+  for (int digit; q < eol && (digit = hex_value(*q)) >= 0; q++) {
+
+    if (q - p == 15) {
+      fail(400, "invalid chunk size");
+      return 0;
+    }
+
+    size = size * 16 + digit;
+  }
+
+  // Chunk extensions are ignored
+  if (q == p || eol[-1] != '\r'
+      || (q < eol - 1 && *q != ';' && !is_ows(*q)))
+  {
+    fail(400, "invalid chunk size");
+    return 0;
+  }
+
+  if (size == 0) {
+    state_ = k_trailers;
+  } else if (size > max_body_size_ - body_.size()) {
+    fail(413, "request body too large");
+    return 0;
+  } else {
+    remaining_ = size;
+    state_ = k_chunk_data;
+  }
+
+  return eol + 1 - p;
+}
+
+size_t http_request::parse_trailer(const char * p, const char * end) {
+
+  const size_t limit = k_max_head_size - trailer_size_;
+  const size_t window = std::min<size_t>(end - p, limit);
+  auto eol = static_cast<const char *>(memchr(p, '\n', window));
+
+  if (!eol) {
+    if (window == limit) {
+      fail(431, "request trailers too large");
+    }
+    return 0;
+  }
+
+  const size_t size = eol + 1 - p;
+
+  trailer_size_ += size;
+
+  // Trailer fields are ignored, an empty line ends the request
+  if (eol == p || (eol == p + 1 && *p == '\r')) {
+    state_ = k_done;
+  }
+
+  return size;
+}
+
+bool http_request::fail(const int status, const char * error) {
+  state_ = k_failed;
+  status_ = status;
+  error_ = error;
+  return false;
+}
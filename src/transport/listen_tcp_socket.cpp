@@ -2,12 +2,18 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <glog/logging.h>
+#include <thread>
+#include <transport/listen_tcp_socket.h>
 
 namespace {
 const uint32_t k_listen_backlog = 100;
 }
 
 int create_tcp_listen_socket(int port) {
+  return create_tcp_listen_socket(port, false);
+}
+
+int create_tcp_listen_socket(int port, bool reuse_port) {
 
   struct sockaddr_in addr;
 
@@ -21,6 +27,12 @@ int create_tcp_listen_socket(int port) {
     LOG(ERROR) << "failed to set SO_REUSEADDR in socket";
   }
 
+  if (reuse_port && setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT,
+                               &reuse_addr, sizeof(reuse_addr)) != 0)
+  {
+    LOG(FATAL) << "failed to set SO_REUSEPORT in socket";
+  }
+
   /*
   int recv_buf = 21299200;
 
@@ -55,3 +67,19 @@ int create_tcp_listen_socket(int port) {
 
   return socket_fd;
 }
+
+bool set_incoming_cpu(int fd, size_t cpu) {
+
+  const auto cores = std::thread::hardware_concurrency();
+  int incoming_cpu = cores ? cpu % cores : 0;
+
+  if (setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &incoming_cpu,
+                 sizeof(incoming_cpu)) != 0)
+  {
+    LOG(ERROR) << "failed to set SO_INCOMING_CPU in socket: "
+               << strerror(errno);
+    return false;
+  }
+
+  return true;
+}
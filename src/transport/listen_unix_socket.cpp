@@ -0,0 +1,39 @@
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <glog/logging.h>
+#include <transport/listen_unix_socket.h>
+
+namespace {
+const uint32_t k_listen_backlog = 100;
+}
+
+int create_unix_listen_socket(const std::string & path) {
+
+  struct sockaddr_un addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+
+  if (path.size() >= sizeof(addr.sun_path)) {
+    LOG(FATAL) << "unix socket path too long: " << path;
+  }
+
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  int socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  unlink(path.c_str());
+
+  if (bind(socket_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    LOG(FATAL) << "bind error: " << strerror(errno);
+    exit(1);
+  }
+
+  fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL, 0) | O_NONBLOCK);
+  listen(socket_fd, k_listen_backlog);
+
+  return socket_fd;
+}
@@ -0,0 +1,301 @@
+#include <glog/logging.h>
+#include <cstring>
+#include <functional>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <transport/listen_unix_socket.h>
+#include <transport/shm_pool.h>
+
+using namespace std::placeholders;
+
+namespace {
+
+// Frames read from a ring before other rings get their turn
+const size_t k_max_frames = 4096;
+
+// Interval to retry rings while paused
+const float k_paused_retry_interval = 0.01;
+
+/* Returns the fds sent along with one byte, or -1 on error and 0 when the
+ * peer closed the socket */
+ssize_t recv_fds(const int sock, int * fds, const size_t max_fds,
+                 size_t & nfds)
+{
+
+  char byte;
+  struct iovec iov = {&byte, 1};
+
+  char control[CMSG_SPACE(sizeof(int) * 4)];
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  const ssize_t n = recvmsg(sock, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+
+  nfds = 0;
+
+  if (n <= 0) {
+    return n;
+  }
+
+  for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+  {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+
+    const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    auto data = reinterpret_cast<const int *>(CMSG_DATA(cmsg));
+
+    for (size_t i = 0; i < count; i++) {
+
+      int fd;
+      memcpy(&fd, data + i, sizeof(fd));
+
+      if (nfds < max_fds) {
+        fds[nfds++] = fd;
+      } else {
+        close(fd);
+      }
+    }
+  }
+
+  return n;
+}
+
+}
+
+shm_pool::shm_pool(const std::string & path, shm_read_fn_t shm_read_fn,
+                   hook_fn_t run_fn)
+:
+  async_thread_pool_(1),
+  path_(path),
+  shm_read_fn_(shm_read_fn),
+  run_fn_(run_fn),
+  paused_fn_(),
+  connections_(),
+  event_fd_socks_()
+{
+  async_thread_pool_.set_run_hook(std::bind(&shm_pool::run_hook, this, _1));
+}
+
+void shm_pool::set_paused_fn(shm_paused_fn_t paused_fn) {
+  paused_fn_ = paused_fn;
+}
+
+void shm_pool::run_hook(async_loop & loop) {
+  VLOG(3) << "shm pool run_hook() tid: " << loop.id();
+
+  if (run_fn_) {
+    run_fn_(loop);
+  }
+
+  loop.add_fd(create_unix_listen_socket(path_), async_fd::read,
+              std::bind(&shm_pool::accept_callback, this, _1));
+}
+
+void shm_pool::accept_callback(async_fd & async) {
+
+  if (async.error()) {
+    VLOG(3) << "got invalid event: " << strerror(errno);
+    return;
+  }
+
+  while (true) {
+
+    const int fd = accept4(async.fd(), NULL, NULL,
+                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        VLOG(3) << "accept error: " << strerror(errno);
+      }
+      return;
+    }
+
+    connections_[fd].event_fd = -1;
+    connections_[fd].retry = false;
+
+    async.loop().add_fd(fd, async_fd::read,
+                        std::bind(&shm_pool::socket_callback, this, _1));
+  }
+
+}
+
+void shm_pool::socket_callback(async_fd & async) {
+
+  const int sock = async.fd();
+
+  auto it = connections_.find(sock);
+  CHECK(it != connections_.end()) << "fd not found";
+
+  if (it->second.event_fd < 0) {
+
+    if (!handshake(async, it->second)) {
+      close_connection(async.loop(), sock);
+    }
+
+    return;
+  }
+
+  // Nothing but the end of the stream is expected once the ring is set up
+  char buffer[64];
+  const ssize_t n = recv(sock, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+  if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) {
+    return;
+  }
+
+  VLOG(3) << "shm producer closed its socket: " << sock;
+
+  drain(async.loop(), sock);
+  close_connection(async.loop(), sock);
+}
+
+void shm_pool::ring_callback(async_fd & async) {
+
+  eventfd_t value;
+  eventfd_read(async.fd(), &value);
+
+  auto it = event_fd_socks_.find(async.fd());
+  CHECK(it != event_fd_socks_.end()) << "fd not found";
+
+  drain(async.loop(), it->second);
+}
+
+bool shm_pool::handshake(async_fd & async, shm_connection & conn) {
+
+  int fds[2];
+  size_t nfds;
+
+  const ssize_t n = recv_fds(async.fd(), fds, 2, nfds);
+
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return true;
+  }
+
+  const bool mapped = n == 1 && nfds == 2 && conn.ring.map(fds[0]);
+
+  if (nfds > 0) {
+    close(fds[0]);
+  }
+
+  if (!mapped) {
+    LOG(ERROR) << "invalid shm producer handshake";
+    if (nfds > 1) {
+      close(fds[1]);
+    }
+    return false;
+  }
+
+  const char ack = 'k';
+
+  if (send(async.fd(), &ack, 1, MSG_DONTWAIT | MSG_NOSIGNAL) != 1) {
+    close(fds[1]);
+    return false;
+  }
+
+  conn.event_fd = fds[1];
+  event_fd_socks_[conn.event_fd] = async.fd();
+
+  async.loop().add_fd(conn.event_fd, async_fd::read,
+                      std::bind(&shm_pool::ring_callback, this, _1));
+
+  VLOG(1) << "shm producer connected, ring capacity: "
+          << conn.ring.capacity();
+
+  drain(async.loop(), async.fd());
+
+  return true;
+}
+
+void shm_pool::drain(async_loop & loop, const int sock) {
+
+  auto it = connections_.find(sock);
+
+  if (it == connections_.end() || it->second.event_fd < 0) {
+    return;
+  }
+
+  auto & conn = it->second;
+
+  // The ring stays awake, and full, until the pool resumes
+  if (paused_fn_ && paused_fn_()) {
+
+    if (!conn.retry) {
+      conn.retry = true;
+      loop.add_once_task("", [=, &loop](size_t)
+                         {
+                           auto it = connections_.find(sock);
+                           if (it != connections_.end()) {
+                             it->second.retry = false;
+                             drain(loop, sock);
+                           }
+                         },
+                         k_paused_retry_interval);
+    }
+
+    return;
+  }
+
+  auto read_fn = [&](const unsigned char * data, const size_t size)
+  {
+    shm_read_fn_(std::vector<unsigned char>(data, data + size));
+  };
+
+  // Keeps reading what arrives while the ring is emptied, the producer
+  // only signals once the ring is asleep
+  size_t frames = 0;
+
+  do {
+
+    frames += conn.ring.read(read_fn, k_max_frames - frames);
+
+    if (conn.ring.corrupted()) {
+      LOG(ERROR) << "corrupted shm ring, closing it";
+      close_connection(loop, sock);
+      return;
+    }
+
+  } while (frames < k_max_frames && !conn.ring.sleep());
+
+  // Comes back after the other fds when there is more to read
+  if (frames == k_max_frames) {
+    eventfd_write(conn.event_fd, 1);
+  }
+
+}
+
+void shm_pool::close_connection(async_loop & loop, const int sock) {
+
+  auto it = connections_.find(sock);
+
+  if (it == connections_.end()) {
+    return;
+  }
+
+  if (it->second.event_fd >= 0) {
+    event_fd_socks_.erase(it->second.event_fd);
+    loop.remove_fd(it->second.event_fd);
+  }
+
+  connections_.erase(it);
+  loop.remove_fd(sock);
+}
+
+void shm_pool::start_threads() {
+  async_thread_pool_.start_threads();
+}
+
+void shm_pool::stop_threads() {
+  async_thread_pool_.stop_threads();
+}
+
+shm_pool::~shm_pool() {
+  async_thread_pool_.stop_threads();
+}
@@ -0,0 +1,106 @@
+#include <cstring>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <transport/shm_producer.h>
+
+shm_producer::shm_producer() : ring_(), sock_(-1), event_fd_(-1) {}
+
+shm_producer::~shm_producer() {
+  close();
+}
+
+bool shm_producer::connect(const std::string & path, const size_t capacity) {
+
+  close();
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+
+  if (path.size() >= sizeof(addr.sun_path)) {
+    return false;
+  }
+
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  const int memfd = shm_ring::create_memfd(capacity);
+
+  if (memfd < 0) {
+    return false;
+  }
+
+  event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  sock_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (event_fd_ < 0 || sock_ < 0 || !ring_.map(memfd)
+      || ::connect(sock_, reinterpret_cast<struct sockaddr *>(&addr),
+                   sizeof(addr)) != 0)
+  {
+    ::close(memfd);
+    close();
+    return false;
+  }
+
+  // Both fds go along with one byte
+  char byte = 'r';
+  struct iovec iov = {&byte, 1};
+
+  const int fds[2] = {memfd, event_fd_};
+  char control[CMSG_SPACE(sizeof(fds))];
+  memset(control, 0, sizeof(control));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  auto cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  const bool sent = sendmsg(sock_, &msg, MSG_NOSIGNAL) == 1;
+
+  ::close(memfd);
+
+  // Cavalieri answers once the ring is mapped
+  if (!sent || recv(sock_, &byte, 1, 0) != 1) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+bool shm_producer::send(const void * msg, const size_t size) {
+
+  if (sock_ < 0 || !ring_.write(msg, size)) {
+    return false;
+  }
+
+  if (ring_.wake_consumer()) {
+    eventfd_write(event_fd_, 1);
+  }
+
+  return true;
+}
+
+void shm_producer::close() {
+
+  ring_ = shm_ring();
+
+  if (sock_ >= 0) {
+    ::close(sock_);
+  }
+
+  if (event_fd_ >= 0) {
+    ::close(event_fd_);
+  }
+
+  sock_ = event_fd_ = -1;
+}
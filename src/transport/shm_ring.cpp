@@ -0,0 +1,282 @@
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <transport/shm_ring.h>
+
+namespace {
+
+const uint32_t k_magic = 0x63617672;
+const uint32_t k_version = 1;
+
+// The header takes a page, data starts page aligned
+const size_t k_header_size = 4096;
+
+const size_t k_min_capacity = 4096;
+const size_t k_max_capacity = 1ull << 32;
+
+const uint32_t k_wrap_marker = 0xffffffff;
+
+// The size can't change under the mappings, a shrink would fault on access
+const int k_seals = F_SEAL_SHRINK | F_SEAL_GROW;
+
+size_t frame_length(const size_t size) {
+  return (4 + size + 3) & ~size_t(3);
+}
+
+}
+
+static_assert(sizeof(shm_ring_header) <= k_header_size,
+              "shm ring header doesn't fit in its page");
+
+shm_ring::shm_ring()
+  :
+    header_(nullptr),
+    data_(nullptr),
+    capacity_(0),
+    mapped_(0),
+    corrupted_(false)
+{
+}
+
+shm_ring::shm_ring(shm_ring && other)
+  :
+    header_(other.header_),
+    data_(other.data_),
+    capacity_(other.capacity_),
+    mapped_(other.mapped_),
+    corrupted_(other.corrupted_)
+{
+  other.header_ = nullptr;
+  other.data_ = nullptr;
+  other.capacity_ = other.mapped_ = 0;
+}
+
+shm_ring & shm_ring::operator=(shm_ring && other) {
+
+  if (this == &other) {
+    return *this;
+  }
+
+  unmap();
+
+  header_ = other.header_;
+  data_ = other.data_;
+  capacity_ = other.capacity_;
+  mapped_ = other.mapped_;
+  corrupted_ = other.corrupted_;
+
+  other.header_ = nullptr;
+  other.data_ = nullptr;
+  other.capacity_ = other.mapped_ = 0;
+
+  return *this;
+}
+
+shm_ring::~shm_ring() {
+  unmap();
+}
+
+int shm_ring::create_memfd(const size_t capacity) {
+
+  size_t rounded = k_min_capacity;
+
+  while (rounded < capacity && rounded < k_max_capacity) {
+    rounded <<= 1;
+  }
+
+  const int fd = memfd_create("cavalieri_ring",
+                               MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (ftruncate(fd, k_header_size + rounded) != 0
+      || fcntl(fd, F_ADD_SEALS, k_seals) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+
+  void * p = mmap(nullptr, k_header_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  fd, 0);
+
+  if (p == MAP_FAILED) {
+    close(fd);
+    return -1;
+  }
+
+  // The memory is zeroed, which is the initial state of the counters
+  auto header = static_cast<shm_ring_header *>(p);
+  header->magic = k_magic;
+  header->version = k_version;
+  header->capacity = rounded;
+
+  munmap(p, k_header_size);
+
+  return fd;
+}
+
+bool shm_ring::map(const int memfd) {
+
+  unmap();
+
+  // Without the seal the producer could shrink the memory we read
+  const int seals = fcntl(memfd, F_GET_SEALS);
+
+  if (seals < 0 || !(seals & F_SEAL_SHRINK)) {
+    return false;
+  }
+
+  struct stat st;
+
+  if (fstat(memfd, &st) != 0 || st.st_size < off_t(k_header_size)) {
+    return false;
+  }
+
+  const size_t size = st.st_size;
+
+  void * p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+
+  if (p == MAP_FAILED) {
+    return false;
+  }
+
+  header_ = static_cast<shm_ring_header *>(p);
+  data_ = static_cast<unsigned char *>(p) + k_header_size;
+  mapped_ = size;
+
+  const size_t capacity = header_->capacity;
+
+  if (header_->magic != k_magic || header_->version != k_version
+      || capacity < k_min_capacity || (capacity & (capacity - 1)) != 0
+      || capacity != size - k_header_size)
+  {
+    unmap();
+    return false;
+  }
+
+  capacity_ = capacity;
+  corrupted_ = false;
+
+  return true;
+}
+
+size_t shm_ring::capacity() const {
+  return capacity_;
+}
+
+bool shm_ring::write(const void * data, const size_t size) {
+
+  const size_t length = frame_length(size);
+
+  const uint64_t head = header_->head.load(std::memory_order_relaxed);
+  const uint64_t tail = header_->tail.load(std::memory_order_acquire);
+
+  const size_t pos = head & (capacity_ - 1);
+  const size_t to_end = capacity_ - pos;
+
+  // Room for the wrap marker plus the frame at the start
+  const size_t needed = length <= to_end ? length : to_end + length;
+
+  if (length > capacity_ || needed > capacity_ - (head - tail)) {
+    return false;
+  }
+
+  size_t start = pos;
+
+  if (length > to_end) {
+    memcpy(data_ + pos, &k_wrap_marker, sizeof(k_wrap_marker));
+    start = 0;
+  }
+
+  const uint32_t header = htonl(size);
+  memcpy(data_ + start, &header, sizeof(header));
+  memcpy(data_ + start + 4, data, size);
+
+  // Pairs with sleep(), the consumer either sees the frame or is woken up
+  header_->head.store(head + needed, std::memory_order_seq_cst);
+
+  return true;
+}
+
+bool shm_ring::wake_consumer() {
+
+  if (!header_->sleeping.load(std::memory_order_seq_cst)) {
+    return false;
+  }
+
+  return header_->sleeping.exchange(0, std::memory_order_seq_cst) == 1;
+}
+
+bool shm_ring::empty() const {
+  return header_->head.load(std::memory_order_acquire)
+         == header_->tail.load(std::memory_order_relaxed);
+}
+
+bool shm_ring::sleep() {
+
+  header_->sleeping.store(1, std::memory_order_seq_cst);
+
+  if (header_->head.load(std::memory_order_seq_cst)
+      == header_->tail.load(std::memory_order_relaxed))
+  {
+    return true;
+  }
+
+  header_->sleeping.store(0, std::memory_order_relaxed);
+
+  return false;
+}
+
+bool shm_ring::corrupted() const {
+  return corrupted_;
+}
+
+/* The producer is not trusted, every length is checked against the ring */
+size_t shm_ring::frame_at(const uint64_t tail, const uint64_t head,
+                          const unsigned char * & data, size_t & size)
+{
+
+  const size_t available = head - tail;
+  const size_t pos = tail & (capacity_ - 1);
+  const size_t to_end = capacity_ - pos;
+
+  if (available > capacity_ || (pos & 3) || available < 4) {
+    return 0;
+  }
+
+  uint32_t header;
+  memcpy(&header, data_ + pos, sizeof(header));
+
+  if (header == k_wrap_marker) {
+    data = nullptr;
+    return to_end <= available ? to_end : 0;
+  }
+
+  size = ntohl(header);
+
+  const size_t length = frame_length(size);
+
+  if (length > to_end || length > available) {
+    return 0;
+  }
+
+  data = data_ + pos + 4;
+
+  return length;
+}
+
+void shm_ring::unmap() {
+
+  if (header_) {
+    munmap(header_, mapped_);
+  }
+
+  header_ = nullptr;
+  data_ = nullptr;
+  capacity_ = mapped_ = 0;
+}
@@ -133,8 +133,7 @@ tcp_client_pool::tcp_client_pool(size_t thread_num, const std::string host,
 
   for (size_t i = 0; i < thread_num; i++) {
 
-    auto queue = std::make_shared<event_queue_t>();
-    queue->set_capacity(k_queue_capacity);
+    auto queue = std::make_shared<event_queue_t>(k_queue_capacity);
 
     thread_event_queues_.push_back(queue);
 
@@ -166,7 +165,7 @@ void tcp_client_pool::push_event(const Event & event) {
     return;
   }
 
-  if (batched_ && queue->size() < static_cast<int>(batch_size_)) {
+  if (batched_ && queue->size() < batch_size_) {
     return;
   }
 
@@ -258,22 +257,13 @@ void tcp_client_pool::async(async_loop & loop) {
   if (batched_) {
 
     bool flush = flush_batch_[loop_id];
-    bool enough = event_queue->size() > static_cast<int>(batch_size_);
+    bool enough = event_queue->size() > batch_size_;
 
     if (flush || enough) {
 
       std::vector<Event> events;
 
-      while (!event_queue->empty()) {
-
-        Event event;
-        if (!event_queue->try_pop(event)) {
-          continue;
-        }
-
-        events.emplace_back(std::move(event));
-
-      }
+      event_queue->pop_batch(events, event_queue->capacity());
 
       if (events.empty()) {
         return;
@@ -302,15 +292,10 @@ void tcp_client_pool::async(async_loop & loop) {
 
   } else {
 
-    while (!event_queue->empty()) {
-
-      Event event;
-      if (!event_queue->try_pop(event)) {
-        continue;
-      }
+    Event event;
 
+    while (event_queue->try_pop(event)) {
       auto output = output_event_fn_(std::move(event));
-
     }
 
   }
@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <unistd.h>
 #include <iostream>
 #include <sys/types.h>
@@ -9,17 +11,22 @@
 
 namespace {
 
-const size_t k_default_buffer_size = 1024 * (1024 + 512);
+std::atomic<size_t> default_buffer_size(1024 * (1024 + 512));
 
-bool read_from_fd(boost::circular_buffer<unsigned char> & buffer,
-                  const int & fd)
+// Buffers handed to one sendmsg(), below IOV_MAX
+const size_t k_max_iov = 64;
+
+bool read_from_fd(byte_buffer & buffer, const int & fd, async_fd * async)
 {
 
-  VLOG(3) << "read_from_fd() free: " << buffer.reserve();
+  buffer.prepare();
 
-  unsigned char b[buffer.reserve()];
+  VLOG(3) << "read_from_fd() free: " << buffer.tail_size();
 
-  ssize_t nread = g_os_functions.recv(fd, &b[0], buffer.reserve(), 0);
+  ssize_t nread = async
+                  ? async->recv(buffer.tail(), buffer.tail_size())
+                  : g_os_functions.recv(fd, buffer.tail(), buffer.tail_size(),
+                                        0);
 
   VLOG(3) << "read bytes: " << nread;
 
@@ -39,26 +46,24 @@ bool read_from_fd(boost::circular_buffer<unsigned char> & buffer,
 
   }
 
-  buffer.insert(buffer.end(), &b[0], &b[0] + nread);
+  buffer.commit(nread);
 
   return true;
 
 }
 
-bool write_to_fd(boost::circular_buffer<unsigned char> & buffer,
-                 const int & fd)
+bool write_to_fd(byte_buffer & buffer, const int & fd)
 {
   VLOG(3) << "write() up to " << buffer.size() << " bytes";
 
-  auto p = buffer.linearize();
-  auto n = g_os_functions.write(fd, p, buffer.size());
+  auto n = g_os_functions.write(fd, buffer.data(), buffer.size());
 
   if (n < 0) {
     LOG(ERROR) << "write error: " << strerror(errno);
     return false;
   }
 
-  buffer.erase_begin(n);
+  buffer.consume(n);
 
   return true;
 
@@ -66,19 +71,19 @@ bool write_to_fd(boost::circular_buffer<unsigned char> & buffer,
 
 
 
+}
+
+void set_tcp_buffer_size(const size_t size) {
+  default_buffer_size = size;
 }
 
 tcp_connection::tcp_connection(int sfd) :
-  buff_size(k_default_buffer_size),
-  sfd(sfd),
-  close_connection(false),
-  r_buffer(k_default_buffer_size),
-  w_buffer(k_default_buffer_size)
+  tcp_connection(sfd, default_buffer_size)
 {
 }
 
 tcp_connection::tcp_connection(int sfd, size_t buff_size):
-  buff_size(k_default_buffer_size),
+  buff_size(buff_size),
   sfd(sfd),
   close_connection(false),
   r_buffer(buff_size),
@@ -95,7 +100,22 @@ bool tcp_connection::read() {
     return false;
   }
 
-  if (!read_from_fd(r_buffer, sfd)) {
+  if (!read_from_fd(r_buffer, sfd, nullptr)) {
+    close_connection = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool tcp_connection::read(async_fd & async) {
+
+  if ((r_buffer.reserve()) <= 0) {
+    LOG(ERROR) << "buffer is complete";
+    return false;
+  }
+
+  if (!read_from_fd(r_buffer, sfd, &async)) {
     close_connection = true;
     return false;
   }
@@ -107,13 +127,11 @@ bool tcp_connection::queue_write(const char *src, const size_t length) {
 
   VLOG(3) << "queue_write with size: " << length;
 
-  if (w_buffer.reserve() < length) {
+  if (!w_buffer.append(src, length)) {
     LOG(ERROR) << "error write buffer is full";
     return false;
   }
 
-  w_buffer.insert(w_buffer.end(), src, src + length);
-
   return true;
 }
 
@@ -131,6 +149,69 @@ bool tcp_connection::write() {
 
 }
 
+bool tcp_connection::write_vec(const struct iovec * iov, const size_t iovcnt)
+{
+  struct iovec vec[k_max_iov];
+  size_t n = 0;
+
+  if (!w_buffer.empty()) {
+    vec[n].iov_base = const_cast<unsigned char *>(w_buffer.data());
+    vec[n].iov_len = w_buffer.size();
+    n++;
+  }
+
+  for (size_t i = 0; i < iovcnt && n < k_max_iov; i++, n++) {
+    vec[n] = iov[i];
+  }
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = vec;
+  msg.msg_iovlen = n;
+
+  ssize_t nwritten = g_os_functions.sendmsg(sfd, &msg,
+                                            MSG_DONTWAIT | MSG_NOSIGNAL);
+
+  if (nwritten < 0) {
+
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      LOG(ERROR) << "write error: " << strerror(errno);
+      close_connection = true;
+      return false;
+    }
+
+    nwritten = 0;
+  }
+
+  size_t written = nwritten;
+
+  const size_t from_buffer = std::min(written, w_buffer.size());
+  w_buffer.consume(from_buffer);
+  written -= from_buffer;
+
+  // Queue what the socket didn't take, the socket becoming writable sends
+  // it with write()
+  for (size_t i = 0; i < iovcnt; i++) {
+
+    if (written >= iov[i].iov_len) {
+      written -= iov[i].iov_len;
+      continue;
+    }
+
+    auto base = static_cast<const char *>(iov[i].iov_base);
+
+    if (!w_buffer.append(base + written, iov[i].iov_len - written)) {
+      LOG(ERROR) << "error write buffer is full";
+      close_connection = true;
+      return false;
+    }
+
+    written = 0;
+  }
+
+  return true;
+}
+
 bool tcp_connection::pending_read() const {
   return true;
 }
@@ -1,11 +1,21 @@
 #include <glog/logging.h>
 #include <functional>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include <transport/tcp_pool.h>
 #include <transport/tcp_connection.h>
 #include <util/util.h>
 
 using namespace std::placeholders;
 
+namespace {
+
+// Accepts per callback, so a reconnect storm doesn't starve the connections
+// the thread already has. The listen socket stays readable for the rest.
+const size_t k_accept_batch = 64;
+
+}
+
 tcp_pool::tcp_pool(
     size_t thread_num,
     hook_fn_t run_fn,
@@ -15,6 +25,7 @@ tcp_pool::tcp_pool(
   async_thread_pool_(thread_num),
   mutexes_(thread_num),
   new_fds_(thread_num),
+  new_listen_fds_(thread_num),
   conn_maps_(thread_num),
   tcp_create_conn_fn_(tcp_create_conn_fn),
   tcp_ready_fn_(tcp_ready_fn),
@@ -34,6 +45,7 @@ tcp_pool::tcp_pool(
   async_thread_pool_(thread_num),
   mutexes_(thread_num),
   new_fds_(thread_num),
+  new_listen_fds_(thread_num),
   conn_maps_(thread_num),
   tcp_create_conn_fn_(tcp_create_conn_fn),
   tcp_ready_fn_(tcp_ready_fn),
@@ -65,6 +77,17 @@ void tcp_pool::add_client(const size_t loop_id, const int fd) {
   async_thread_pool_.signal_thread(loop_id);
 }
 
+void tcp_pool::add_listen_fd(const size_t loop_id, const int listen_fd) {
+  VLOG(3) << "add_listen_fd() sfd: " << listen_fd << " to loop_id: "
+          << loop_id;
+
+  mutexes_[loop_id].lock();
+  new_listen_fds_[loop_id].push(listen_fd);
+  mutexes_[loop_id].unlock();
+
+  async_thread_pool_.signal_thread(loop_id);
+}
+
 void tcp_pool::add_client_sync(const size_t loop_id, const int fd) {
 
   VLOG(3) << "add_client_sync() sfd: " << fd << " to loop_id: " << loop_id;
@@ -129,20 +152,65 @@ void tcp_pool::add_fds(async_loop & loop) {
 
   mutexes_[tid].lock();
   std::queue<int> new_fds(std::move(new_fds_[tid]));
+  std::queue<int> new_listen_fds(std::move(new_listen_fds_[tid]));
   mutexes_[tid].unlock();
 
   while (!new_fds.empty()) {
-    const int fd = new_fds.front();
+    add_fd(loop, new_fds.front());
     new_fds.pop();
-    auto socket_cb = std::bind(&tcp_pool::socket_callback, this, _1);
-    loop.add_fd(fd, async_fd::read, socket_cb);
-    auto insert = conn_maps_[tid].insert({fd, tcp_connection(fd)});
+  }
+
+  while (!new_listen_fds.empty()) {
+    const int fd = new_listen_fds.front();
+    new_listen_fds.pop();
+    loop.add_fd(fd, async_fd::read,
+                std::bind(&tcp_pool::accept_callback, this, _1));
+    VLOG(3) << "async_hook() tid: " << tid << " listening on fd: " << fd;
+  }
+
+}
+
+void tcp_pool::add_fd(async_loop & loop, const int fd) {
+
+  size_t tid = loop.id();
+
+  auto socket_cb = std::bind(&tcp_pool::socket_callback, this, _1);
+  loop.add_fd(fd, async_fd::read, socket_cb);
+  auto insert = conn_maps_[tid].insert({fd, tcp_connection(fd)});
+
+  if (tcp_create_conn_fn_) {
+   tcp_create_conn_fn_(fd, loop, insert.first->second);
+  }
+
+  VLOG(3) << "async_hook() tid: " << tid << " adding fd: " << fd;
+}
+
+void tcp_pool::accept_callback(async_fd & async) {
+
+  if (async.error()) {
+    VLOG(3) << "got invalid event: " << strerror(errno);
+    return;
+  }
+
+  // The listen socket is non blocking, accept until the backlog is empty or
+  // the batch is done
+  for (size_t i = 0; i < k_accept_batch; i++) {
+
+    struct sockaddr_in client_addr;
+    socklen_t client_addr_len = sizeof(client_addr);
+
+    int fd = accept4(async.fd(),
+                     reinterpret_cast<struct sockaddr *>(&client_addr),
+                     &client_addr_len, SOCK_CLOEXEC);
 
-    if (tcp_create_conn_fn_) {
-     tcp_create_conn_fn_(fd, loop, insert.first->second);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        VLOG(3) << "accept error: " << strerror(errno);
+      }
+      return;
     }
 
-    VLOG(3) << "async_hook() tid: " << tid << " adding fd: " << fd;
+    add_fd(async.loop(), fd);
   }
 
 }
@@ -1,5 +1,6 @@
 #include <glog/logging.h>
 #include <functional>
+#include <cstring>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <transport/udp_pool.h>
@@ -11,8 +12,29 @@ namespace {
 
 const size_t k_udp_buffer_size = 4096;
 
+// Datagrams received by one recvmmsg()
+const size_t k_batch_size = 64;
+// Batches read in one callback before going back to the loop, which
+// flushes what was read
+const size_t k_max_batches = 8;
+
 int create_listen_udp_socket(uint32_t port) {
-  int sd = socket(PF_INET, SOCK_DGRAM, 0);
+  int sd = socket(PF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+  int enable = 1;
+
+  if (setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, &enable,
+                 sizeof(enable)) != 0)
+  {
+    LOG(FATAL) << "failed to set SO_REUSEPORT in socket";
+  }
+
+  // Makes the kernel report how many datagrams it dropped
+  if (setsockopt(sd, SOL_SOCKET, SO_RXQ_OVFL, &enable,
+                 sizeof(enable)) != 0)
+  {
+    LOG(ERROR) << "failed to set SO_RXQ_OVFL in socket";
+  }
 
   struct sockaddr_in addr;
 
@@ -28,16 +50,80 @@ int create_listen_udp_socket(uint32_t port) {
 
   return sd;
 }
+
+const size_t k_control_size = CMSG_SPACE(sizeof(uint32_t));
+
 }
 
+/* The buffers a thread receives its datagrams into */
+struct udp_batch {
+  udp_batch(const size_t max_datagram_size)
+    :
+      buffers(k_batch_size * max_datagram_size),
+      controls(k_batch_size * k_control_size),
+      iovs(k_batch_size),
+      msgs(k_batch_size),
+      overflows(0)
+  {
+    for (size_t i = 0; i < k_batch_size; i++) {
+      iovs[i].iov_base = &buffers[i * max_datagram_size];
+      iovs[i].iov_len = max_datagram_size;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+  }
+
+  /* recvmmsg() overwrites the control length and flags */
+  void reset() {
+    for (size_t i = 0; i < k_batch_size; i++) {
+      msgs[i].msg_hdr.msg_control = &controls[i * k_control_size];
+      msgs[i].msg_hdr.msg_controllen = k_control_size;
+      msgs[i].msg_hdr.msg_flags = 0;
+    }
+  }
+
+  std::vector<unsigned char> buffers;
+  std::vector<unsigned char> controls;
+  std::vector<struct iovec> iovs;
+  std::vector<struct mmsghdr> msgs;
+  /* Datagrams the kernel had dropped as of the last one received */
+  uint32_t overflows;
+};
+
 udp_pool::udp_pool(
     size_t thread_num,
     uint32_t port,
     udp_read_fn_t udp_read_fn)
+:
+  udp_pool(thread_num, port, udp_read_fn, {})
+{
+}
+
+udp_pool::udp_pool(
+    size_t thread_num,
+    uint32_t port,
+    udp_read_fn_t udp_read_fn,
+    hook_fn_t run_fn)
+:
+  udp_pool(thread_num, port, k_udp_buffer_size, udp_read_fn, run_fn, {})
+{
+}
+
+udp_pool::udp_pool(
+    size_t thread_num,
+    uint32_t port,
+    size_t max_datagram_size,
+    udp_read_fn_t udp_read_fn,
+    hook_fn_t run_fn,
+    udp_drop_fn_t drop_fn)
 :
   async_thread_pool_(thread_num),
   port_(port),
-  udp_read_fn_(udp_read_fn)
+  max_datagram_size_(max_datagram_size),
+  udp_read_fn_(udp_read_fn),
+  run_fn_(run_fn),
+  drop_fn_(drop_fn),
+  batches_(thread_num)
 {
   VLOG(3) << "udp_pool() size: " << thread_num;
   async_thread_pool_.set_run_hook(std::bind(&udp_pool::run_hook, this, _1));
@@ -47,9 +133,17 @@ void udp_pool::run_hook(async_loop & loop) {
   size_t tid = loop.id();
   VLOG(3) << "udp pool run_hook() tid: " << tid;
 
+  if (run_fn_) {
+    run_fn_(loop);
+  }
+
+  batches_[tid].reset(new udp_batch(max_datagram_size_));
+
+  const int fd = create_listen_udp_socket(port_);
+
   auto socket_cb = std::bind(&udp_pool::socket_callback, this, _1);
-  loop.add_fd(create_listen_udp_socket(port_), async_fd::read,
-              socket_cb);
+  loop.add_fd(fd, async_fd::read, socket_cb);
+  loop.set_fd_recvmsg(fd, max_datagram_size_);
 }
 
 void udp_pool::socket_callback(async_fd & async) {
@@ -62,14 +156,69 @@ void udp_pool::socket_callback(async_fd & async) {
     return;
   }
 
-  std::vector<unsigned char> buffer(k_udp_buffer_size);
+  auto & batch = *batches_[tid];
+
+  size_t truncated = 0;
+  uint32_t overflows = batch.overflows;
+
+  for (size_t i = 0; i < k_max_batches; i++) {
+
+    batch.reset();
+
+    const int n = async.recvmmsg(&batch.msgs[0], k_batch_size);
+
+    if (n < 0) {
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        LOG(ERROR) << "recvmmsg error: " << strerror(errno);
+      }
 
-  size_t bytes = recvfrom(async.fd(), reinterpret_cast<char*>(&buffer[0]),
-                          buffer.size(), 0, NULL, NULL);
+      break;
+    }
 
-  buffer.resize(bytes);
+    for (int j = 0; j < n; j++) {
 
-  udp_read_fn_(buffer);
+      auto & hdr = batch.msgs[j].msg_hdr;
+
+      for (auto cmsg = CMSG_FIRSTHDR(&hdr); cmsg;
+           cmsg = CMSG_NXTHDR(&hdr, cmsg))
+      {
+        if (cmsg->cmsg_level == SOL_SOCKET
+            && cmsg->cmsg_type == SO_RXQ_OVFL)
+        {
+          memcpy(&overflows, CMSG_DATA(cmsg), sizeof(overflows));
+        }
+      }
+
+      if (hdr.msg_flags & MSG_TRUNC) {
+        truncated++;
+        continue;
+      }
+
+      const size_t bytes = batch.msgs[j].msg_len;
+
+      if (bytes == 0) {
+        continue;
+      }
+
+      auto p = static_cast<unsigned char *>(hdr.msg_iov->iov_base);
+
+      udp_read_fn_(udp_buffer_t(p, p + bytes));
+    }
+
+    if (static_cast<size_t>(n) < k_batch_size) {
+      break;
+    }
+
+  }
+
+  // The kernel counter wraps around
+  const size_t overflowed = overflows - batch.overflows;
+  batch.overflows = overflows;
+
+  if (drop_fn_ && (truncated || overflowed)) {
+    drop_fn_(truncated, overflowed);
+  }
 
   async.set_mode(async_fd::read);
 
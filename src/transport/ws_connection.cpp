@@ -18,13 +18,8 @@ const uint32_t max_header_size = 1024 * 2;
 
 std::string read_ws_header(tcp_connection & connection) {
 
-  std::vector<unsigned char> head_buff(connection.read_bytes());
-
-  std::copy(connection.r_buffer.begin(),
-            connection.r_buffer.begin() + head_buff.size(),
-            &head_buff[0]);
-
-  return {reinterpret_cast<char*>(&head_buff[0]), head_buff.size()};
+  return {reinterpret_cast<const char*>(connection.r_buffer.data()),
+          connection.read_bytes()};
 
 }
 
@@ -0,0 +1,158 @@
+#include <cstdlib>
+#include <cstring>
+#include <util/parse_number.h>
+
+namespace {
+
+inline bool is_digit(const char c) {
+  return c >= '0' && c <= '9';
+}
+
+const double k_pow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+  1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Integers up to this convert to double exactly
+const uint64_t k_max_exact = 1ull << 53;
+
+// Longest number handed to strtod()
+const size_t k_max_number = 64;
+
+bool parse_double_slow(const char * p, const size_t size, double & out) {
+
+  if (size >= k_max_number) {
+    return false;
+  }
+
+  char buffer[k_max_number];
+  memcpy(buffer, p, size);
+  buffer[size] = '\0';
+
+  char * end;
+  out = strtod(buffer, &end);
+
+  return end == buffer + size;
+}
+
+}
+
+bool parse_double(const char * p, const size_t size, double & out) {
+
+  const char * end = p + size;
+  const char * start = p;
+
+  bool negative = false;
+
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+
+  const char * digits_start = p;
+
+  for (; p < end && is_digit(*p); p++) {
+    mantissa = mantissa * 10 + (*p - '0');
+    digits++;
+  }
+
+  if (p < end && *p == '.') {
+    p++;
+    for (; p < end && is_digit(*p); p++) {
+      mantissa = mantissa * 10 + (*p - '0');
+      digits++;
+      exponent--;
+    }
+  }
+
+  if (p == digits_start || (p == digits_start + 1 && *digits_start == '.')) {
+    return parse_double_slow(start, size, out);
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+
+    p++;
+
+    bool negative_exp = false;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+      negative_exp = *p == '-';
+      p++;
+    }
+
+    if (p == end) {
+      return false;
+    }
+
+    int exp = 0;
+
+    for (; p < end && is_digit(*p) && exp < 10000; p++) {
+      exp = exp * 10 + (*p - '0');
+    }
+
+    exponent += negative_exp ? -exp : exp;
+  }
+
+  if (p != end) {
+    return false;
+  }
+
+  if (digits > 19 || mantissa > k_max_exact || exponent < -22
+      || exponent > 22)
+  {
+    return parse_double_slow(start, size, out);
+  }
+
+  double value = static_cast<double>(mantissa);
+
+  value = exponent < 0 ? value / k_pow10[-exponent]
+                       : value * k_pow10[exponent];
+
+  out = negative ? -value : value;
+
+  return true;
+}
+
+bool parse_int64(const char * p, const size_t size, int64_t & out) {
+
+  const char * end = p + size;
+
+  bool negative = false;
+
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+
+  if (p == end) {
+    return false;
+  }
+
+  // Up to 2^63, which only fits negated
+  const uint64_t limit = negative ? 1ull << 63 : (1ull << 63) - 1;
+
+  uint64_t value = 0;
+
+  for (; p < end; p++) {
+
+    if (!is_digit(*p)) {
+      return false;
+    }
+
+    const uint64_t digit = *p - '0';
+
+    if (value > (limit - digit) / 10) {
+      return false;
+    }
+
+    value = value * 10 + digit;
+  }
+
+  out = negative ? static_cast<int64_t>(0 - value) : value;
+
+  return true;
+}
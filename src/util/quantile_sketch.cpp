@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <util/quantile_sketch.h>
+
+namespace {
+
+// Smaller magnitudes count as zero
+const double k_min_value = 1e-9;
+
+}
+
+const size_t quantile_sketch::k_max_buckets;
+
+quantile_sketch::quantile_sketch(const double relative_accuracy)
+  :
+    gamma_((1 + relative_accuracy) / (1 - relative_accuracy)),
+    log_gamma_(std::log(gamma_)),
+    positive_{{}, 0},
+    negative_{{}, 0},
+    zero_count_(0),
+    count_(0),
+    sum_(0),
+    min_(0),
+    max_(0)
+{
+}
+
+void quantile_sketch::add(const double value, const uint64_t count) {
+
+  if (count == 0 || std::isnan(value)) {
+    return;
+  }
+
+  if (value >= k_min_value) {
+    positive_.add(index(value), count);
+  } else if (value <= -k_min_value) {
+    negative_.add(index(-value), count);
+  } else {
+    zero_count_ += count;
+  }
+
+  if (count_ == 0) {
+    min_ = max_ = value;
+  } else {
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  count_ += count;
+  sum_ += value * count;
+}
+
+void quantile_sketch::merge(const quantile_sketch & other) {
+
+  if (other.count_ == 0) {
+    return;
+  }
+
+  for (size_t i = 0; i < other.positive_.counts.size(); i++) {
+    if (other.positive_.counts[i]) {
+      positive_.add(other.positive_.offset + i, other.positive_.counts[i]);
+    }
+  }
+
+  for (size_t i = 0; i < other.negative_.counts.size(); i++) {
+    if (other.negative_.counts[i]) {
+      negative_.add(other.negative_.offset + i, other.negative_.counts[i]);
+    }
+  }
+
+  zero_count_ += other.zero_count_;
+
+  if (count_ == 0) {
+    min_ = other.min_;
+    max_ = other.max_;
+  } else {
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  count_ += other.count_;
+  sum_ += other.sum_;
+}
+
+double quantile_sketch::quantile(const double q) const {
+
+  if (count_ == 0) {
+    return 0;
+  }
+
+  if (q <= 0) {
+    return min_;
+  }
+
+  if (q >= 1) {
+    return max_;
+  }
+
+  const double rank = q * (count_ - 1);
+  uint64_t seen = 0;
+  double estimate = max_;
+  bool found = false;
+
+  // From the most negative value up
+  for (size_t i = negative_.counts.size(); i-- > 0 && !found; ) {
+    seen += negative_.counts[i];
+    if (seen > rank) {
+      estimate = -value(negative_.offset + i);
+      found = true;
+    }
+  }
+
+  if (!found) {
+    seen += zero_count_;
+    if (seen > rank) {
+      estimate = 0;
+      found = true;
+    }
+  }
+
+  for (size_t i = 0; i < positive_.counts.size() && !found; i++) {
+    seen += positive_.counts[i];
+    if (seen > rank) {
+      estimate = value(positive_.offset + i);
+      found = true;
+    }
+  }
+
+  return std::min(std::max(estimate, min_), max_);
+}
+
+uint64_t quantile_sketch::count() const {
+  return count_;
+}
+
+double quantile_sketch::sum() const {
+  return sum_;
+}
+
+double quantile_sketch::min() const {
+  return min_;
+}
+
+double quantile_sketch::max() const {
+  return max_;
+}
+
+bool quantile_sketch::empty() const {
+  return count_ == 0;
+}
+
+void quantile_sketch::clear() {
+  positive_.counts.clear();
+  negative_.counts.clear();
+  zero_count_ = count_ = 0;
+  sum_ = min_ = max_ = 0;
+}
+
+int quantile_sketch::index(const double value) const {
+  return static_cast<int>(std::ceil(std::log(value) / log_gamma_));
+}
+
+/* The middle of the bucket in relative terms */
+double quantile_sketch::value(const int index) const {
+  return 2 * std::pow(gamma_, index) / (gamma_ + 1);
+}
+
+void quantile_sketch::store::add(int index, const uint64_t count) {
+
+  if (counts.empty()) {
+    offset = index;
+    counts.assign(1, count);
+    return;
+  }
+
+  const int size = counts.size();
+
+  if (index < offset) {
+
+    // Past the cap, values closer to zero go to the lowest bucket
+    const int high = offset + size - 1;
+    index = std::max<int>(index, high - k_max_buckets + 1);
+
+    if (index < offset) {
+      counts.insert(counts.begin(), offset - index, 0);
+      offset = index;
+    }
+
+  } else if (index >= offset + size) {
+
+    const size_t new_size = index - offset + 1;
+
+    if (new_size > k_max_buckets) {
+
+      const size_t shift = new_size - k_max_buckets;
+      const size_t dropped = std::min<size_t>(shift, size);
+
+      const uint64_t collapsed = std::accumulate(
+          counts.begin(), counts.begin() + dropped, uint64_t(0));
+
+      counts.erase(counts.begin(), counts.begin() + dropped);
+      offset += shift;
+      counts.resize(k_max_buckets, 0);
+      counts[0] += collapsed;
+
+    } else {
+      counts.resize(new_size, 0);
+    }
+  }
+
+  counts[index - offset] += count;
+}
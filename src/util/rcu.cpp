@@ -0,0 +1,158 @@
+#include <glog/logging.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <util/rcu.h>
+
+namespace {
+
+const size_t k_cache_line = 64;
+const size_t k_spins_before_sleep = 1000;
+
+/* 0 means the reader is not in a read section, otherwise it holds the
+ * epoch that was current when the reader entered it.
+ */
+struct reader_t {
+  std::atomic<uint64_t> epoch{0};
+  char padding[k_cache_line - sizeof(std::atomic<uint64_t>)];
+};
+
+std::atomic<uint64_t> global_epoch(1);
+
+std::mutex readers_mutex;
+std::set<reader_t *> readers;
+
+/* Serializes writers */
+std::mutex sync_mutex;
+
+bool register_membarrier() {
+
+#ifdef __NR_membarrier
+
+  if (syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0)
+      == 0)
+  {
+    return true;
+  }
+
+#endif
+
+  VLOG(1) << "membarrier is not available, rcu readers will use fences";
+
+  return false;
+}
+
+const bool use_membarrier = register_membarrier();
+
+/* Orders the reader's slot store before its reads of shared data */
+inline void reader_barrier() {
+
+  if (use_membarrier) {
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+  } else {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+}
+
+/* Runs a full memory barrier in every thread of the process */
+void writer_barrier() {
+
+#ifdef __NR_membarrier
+
+  if (use_membarrier) {
+    syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+    return;
+  }
+
+#endif
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+}
+
+class thread_reader {
+public:
+
+  thread_reader() : nesting(0) {
+    std::lock_guard<std::mutex> lock(readers_mutex);
+    readers.insert(&reader);
+  }
+
+  ~thread_reader() {
+    std::lock_guard<std::mutex> lock(readers_mutex);
+    readers.erase(&reader);
+  }
+
+  reader_t reader;
+  size_t nesting;
+};
+
+thread_local thread_reader this_reader;
+
+}
+
+void rcu_read_lock() {
+
+  if (this_reader.nesting++ > 0) {
+    return;
+  }
+
+  this_reader.reader.epoch.store(global_epoch.load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+
+  reader_barrier();
+
+}
+
+void rcu_read_unlock() {
+
+  if (--this_reader.nesting > 0) {
+    return;
+  }
+
+  this_reader.reader.epoch.store(0, std::memory_order_release);
+
+}
+
+void rcu_synchronize() {
+
+  CHECK(this_reader.nesting == 0) << "rcu_synchronize() in a read section";
+
+  std::lock_guard<std::mutex> sync_lock(sync_mutex);
+
+  const uint64_t epoch = global_epoch.fetch_add(1) + 1;
+
+  writer_barrier();
+
+  std::lock_guard<std::mutex> lock(readers_mutex);
+
+  for (const auto & reader : readers) {
+
+    for (size_t spins = 0; ; spins++) {
+
+      const auto reader_epoch = reader->epoch.load(std::memory_order_acquire);
+
+      if (reader_epoch == 0 || reader_epoch >= epoch) {
+        break;
+      }
+
+      if (spins < k_spins_before_sleep) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+
+    }
+
+  }
+
+  writer_barrier();
+
+}
@@ -7,6 +7,7 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <regex>
 #include <curl/curl.h>
+#include <pthread.h>
 #include <util/util.h>
 
 bool match_regex(const std::string value, const std::string re) {
@@ -280,3 +281,33 @@ void ld_environment(char **argv, const std::string dir) {
     return;
   }
 }
+
+namespace {
+
+bool set_affinity(pthread_t thread, const size_t cpu) {
+
+  const auto cores = std::thread::hardware_concurrency();
+
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cores ? cpu % cores : 0, &cpuset);
+
+  auto rc = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
+
+  if (rc != 0) {
+    LOG(ERROR) << "failed to set thread affinity: " << strerror(rc);
+    return false;
+  }
+
+  return true;
+}
+
+}
+
+bool set_thread_affinity(std::thread & thread, const size_t cpu) {
+  return set_affinity(thread.native_handle(), cpu);
+}
+
+bool set_thread_affinity(const size_t cpu) {
+  return set_affinity(pthread_self(), cpu);
+}
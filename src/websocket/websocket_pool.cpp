@@ -65,13 +65,13 @@ websocket_pool::websocket_pool(size_t thread_num, pub_sub & pubsub,
             std::bind(&websocket_pool::on_fd_ready, this, _1, _2),
             std::bind(&websocket_pool::on_async_signal, this, _1)),
   fd_ctxes_(thread_num),
-  event_queues_(thread_num)
+  event_queues_()
 {
 
   pubsub.subscribe("index", [=](const Event & e){ worker_pool_.add_event(e); });
 
-  for (auto & queue: event_queues_) {
-    queue.set_capacity(k_max_ws_queue_size);
+  for (size_t i = 0; i < thread_num; i++) {
+    event_queues_.emplace_back(new event_queue_t(k_ws_ring_size));
   }
 
   tcp_pool_.start_threads();
@@ -81,6 +81,10 @@ void websocket_pool::add_client(const int fd) {
   tcp_pool_.add_client(fd);
 }
 
+void websocket_pool::add_listen_fd(const size_t loop_id, const int fd) {
+  tcp_pool_.add_listen_fd(loop_id, fd);
+}
+
 void websocket_pool::stop() {
   VLOG(3) << "stop()";
 
@@ -135,19 +139,16 @@ void websocket_pool::on_async_signal(async_loop & loop) {
 
   size_t loop_id =  loop.id();
 
-  auto & event_queue = event_queues_[loop_id];
+  auto & event_queue = *event_queues_[loop_id];
 
   std::unordered_set<int> available_fds;
   for (const auto & kv : fd_ctxes_[loop_id]) {
     available_fds.insert(kv.first);
   }
 
-  while (!event_queue.empty()) {
+  event_t e;
 
-    event_t e;
-    if (!event_queue.try_pop(e)) {
-      continue;
-    }
+  while (event_queue.try_pop(e)) {
 
     auto it = fd_ctxes_[loop_id].find(e.fd);
 
@@ -266,7 +267,7 @@ void websocket_pool::update_filters(const size_t loop_id) {
           return;
         }
 
-        if (!event_queues_[loop_id].try_push({event, fd, token})) {
+        if (!event_queues_[loop_id]->try_push(event_t{event, fd, token})) {
           return;
         }
 
@@ -6,61 +6,30 @@ namespace {
 
 const size_t k_worker_threads = 4;
 const long k_check_filter_ms = 2000;
+const size_t k_batch_size = 64;
+const size_t k_park_timeout_ms = 100;
 
-void process_events(worker_pool::filters_map_t & filters,
-                    std::mutex & filter_mutex,
-                    worker_pool::event_queue_t & queue)
-{
-
-  worker_pool::event_t e;
-  auto filter_fns(filters);
-
-  auto t1 = std::chrono::system_clock::now();
-
-  while (true) {
-
-    queue.pop(e);
-
-    if (e.stop) {
-      VLOG(3) << "finishing process_events";
-      return;
-    }
-
-    for (const auto & kv : filter_fns) {
-      for (const auto & fn : kv.second) {
-        fn (e.event);
-      }
-    }
-
-    auto t2 = std::chrono::system_clock::now();
-    auto dt = std::chrono::duration_cast<std::chrono::milliseconds>
-                (t2 - t1).count();
-
-    if (dt > k_check_filter_ms) {
-
-      t1 = t2;
+template <class T>
+std::vector<std::unique_ptr<T>> make_workers(const size_t n) {
 
-      std::lock_guard<std::mutex> lock(filter_mutex);
-
-      filter_fns = filters;
-
-    }
+  std::vector<std::unique_ptr<T>> workers;
 
+  for (size_t i = 0; i < n; i++) {
+    workers.emplace_back(new T());
   }
 
+  return workers;
 }
 
 }
 
 
 worker_pool::worker_pool() :
-  stop_(false), has_clients_(false), filters_(), event_queue_(), mutex_(),
+  stop_(false), has_clients_(false), filters_(), mutex_(), next_worker_(0),
+  workers_(make_workers<worker_t>(k_worker_threads)),
   worker_threads_(k_worker_threads,
-                  [&]() { process_events(filters_, mutex_, event_queue_); })
+                  [&](const size_t i) { process_events(i); })
 {
-
-  event_queue_.set_capacity(k_max_ws_queue_size);
-
 }
 
 void worker_pool::add_event(const Event & event) {
@@ -70,10 +39,15 @@ void worker_pool::add_event(const Event & event) {
     return;
   }
 
-  if (!event_queue_.try_push({event, false})) {
+  auto & worker = *workers_[next_worker_++ % workers_.size()];
+
+  if (!worker.queue.try_push(event)) {
     LOG(WARNING) << "ws worker_pool queue is full";
+    return;
   }
 
+  wake(worker);
+
 }
 
 void worker_pool::update_filters(const size_t id,
@@ -105,12 +79,90 @@ void worker_pool::stop() {
   VLOG(3) << "stopping ";
 
   stop_ = true;
-  event_queue_.clear();
 
-  for (size_t i = 0; i < k_worker_threads; i++) {
-    event_queue_.try_push({{}, true});
+  for (auto & worker : workers_) {
+    wake(*worker);
   }
 
   worker_threads_.stop();
 
 }
+
+void worker_pool::process_events(const size_t i) {
+
+  auto & worker = *workers_[i];
+
+  std::vector<Event> events;
+  events.reserve(k_batch_size);
+
+  filters_map_t filter_fns;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    filter_fns = filters_;
+  }
+
+  auto t1 = std::chrono::system_clock::now();
+
+  while (!stop_) {
+
+    events.clear();
+
+    if (worker.queue.pop_batch(events, k_batch_size) == 0) {
+      park(worker);
+      continue;
+    }
+
+    for (const auto & event : events) {
+      for (const auto & kv : filter_fns) {
+        for (const auto & fn : kv.second) {
+          fn(event);
+        }
+      }
+    }
+
+    auto t2 = std::chrono::system_clock::now();
+    auto dt = std::chrono::duration_cast<std::chrono::milliseconds>
+                (t2 - t1).count();
+
+    if (dt > k_check_filter_ms) {
+
+      t1 = t2;
+
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      filter_fns = filters_;
+
+    }
+
+  }
+
+  VLOG(3) << "finishing process_events";
+
+}
+
+void worker_pool::park(worker_t & worker) {
+
+  std::unique_lock<std::mutex> lock(worker.mutex);
+
+  worker.parked.store(true);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (worker.queue.empty() && !stop_) {
+    worker.cond.wait_for(lock, std::chrono::milliseconds(k_park_timeout_ms));
+  }
+
+  worker.parked.store(false);
+
+}
+
+void worker_pool::wake(worker_t & worker) {
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (worker.parked.load()) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.cond.notify_one();
+  }
+
+}
@@ -58,7 +58,7 @@ void worker_threads::run_tasks(const int i) {
 
   VLOG(3) << "starting worker thread " << i;
 
-  task_();
+  task_(i);
 
   finished_threads_[i] = 1;
 
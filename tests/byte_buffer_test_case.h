@@ -0,0 +1,99 @@
+#ifndef BYTE_BUFFER_TEST_CASE_H
+#define BYTE_BUFFER_TEST_CASE_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <transport/buffer_pool.h>
+#include <transport/byte_buffer.h>
+
+TEST(byte_buffer_test_case, test)
+{
+  byte_buffer buffer(8);
+
+  ASSERT_TRUE(buffer.empty());
+  ASSERT_EQ(8u, buffer.reserve());
+  ASSERT_EQ(0u, buffer.allocated());
+
+  ASSERT_TRUE(buffer.append("abcdef", 6));
+  ASSERT_FALSE(buffer.append("ghi", 3));
+  ASSERT_EQ(6u, buffer.size());
+  ASSERT_EQ('a', buffer[0]);
+
+  buffer.consume(2);
+  ASSERT_EQ("cdef", std::string(reinterpret_cast<const char *>(buffer.data()),
+                                buffer.size()));
+  ASSERT_EQ(4u, buffer.reserve());
+  ASSERT_EQ(2u, buffer.tail_size());
+
+  // Moving 4 bytes when only 2 were consumed isn't worth it
+  buffer.prepare();
+  ASSERT_EQ(2u, buffer.tail_size());
+
+  buffer.consume(1);
+  buffer.prepare();
+  ASSERT_EQ(5u, buffer.tail_size());
+  ASSERT_EQ('d', buffer[0]);
+
+  // Written in place, as recv() does
+  memcpy(buffer.tail(), "gh", 2);
+  buffer.commit(2);
+  ASSERT_EQ("defgh", std::string(reinterpret_cast<const char *>(buffer.data()),
+                                 buffer.size()));
+
+  // Doesn't fit after the data, it is moved to the front first
+  buffer.consume(1);
+  ASSERT_TRUE(buffer.append("ijkl", 4));
+  ASSERT_EQ("efghijkl", std::string(
+        reinterpret_cast<const char *>(buffer.data()), buffer.size()));
+  ASSERT_EQ(0u, buffer.reserve());
+
+  // Empty buffers give their memory back
+  buffer.consume(8);
+  ASSERT_TRUE(buffer.empty());
+  ASSERT_EQ(0u, buffer.allocated());
+  ASSERT_EQ(8u, buffer.reserve());
+}
+
+TEST(byte_buffer_grow_test_case, test)
+{
+  const size_t used = buffer_pool::used_bytes();
+
+  byte_buffer buffer(64 * 1024);
+
+  buffer.prepare();
+  ASSERT_EQ(4096u, buffer.allocated());
+  ASSERT_EQ(used + 4096, buffer_pool::used_bytes());
+
+  // Doubles when full, keeping the data
+  memset(buffer.tail(), 'a', buffer.tail_size());
+  buffer.commit(buffer.tail_size());
+  buffer.prepare();
+  ASSERT_EQ(8192u, buffer.allocated());
+  ASSERT_EQ(4096u, buffer.tail_size());
+  ASSERT_EQ('a', buffer[4095]);
+
+  buffer.commit(100);
+  buffer.consume(buffer.size());
+  ASSERT_EQ(0u, buffer.allocated());
+  ASSERT_EQ(used, buffer_pool::used_bytes());
+  ASSERT_LE(8192u, buffer_pool::pooled_bytes());
+
+  // Starts at the size it needed last time
+  const size_t pooled = buffer_pool::pooled_bytes();
+  buffer.prepare();
+  ASSERT_EQ(8192u, buffer.allocated());
+  ASSERT_EQ(pooled - 8192, buffer_pool::pooled_bytes());
+
+  // Grows to fit, up to capacity
+  std::vector<char> frame(40 * 1024, 'b');
+  ASSERT_TRUE(buffer.append(&frame[0], frame.size()));
+  ASSERT_EQ(64u * 1024, buffer.allocated());
+  ASSERT_FALSE(buffer.append(&frame[0], frame.size()));
+
+  byte_buffer moved(std::move(buffer));
+  ASSERT_EQ(0u, buffer.allocated());
+  ASSERT_EQ(frame.size(), moved.size());
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef CARBON_PARSER_TEST_CASE_H
+#define CARBON_PARSER_TEST_CASE_H
+
+#include <string>
+#include <carbon_parser.h>
+
+TEST(carbon_parser_line_test_case, test)
+{
+  carbon_line line;
+
+  std::string s("foo.bar 1.5 1400000000");
+  ASSERT_TRUE(parse_carbon_line(s.data(), s.size(), line));
+  ASSERT_EQ("foo.bar", std::string(line.path, line.path_size));
+  ASSERT_EQ(1.5, line.value);
+  ASSERT_EQ(1400000000, line.timestamp);
+
+  s = "  foo\t-2e3  1400000000.75  ";
+  ASSERT_TRUE(parse_carbon_line(s.data(), s.size(), line));
+  ASSERT_EQ("foo", std::string(line.path, line.path_size));
+  ASSERT_EQ(-2000, line.value);
+  ASSERT_EQ(1400000000, line.timestamp);
+
+  s = "foo 42 -1";
+  ASSERT_TRUE(parse_carbon_line(s.data(), s.size(), line));
+  ASSERT_EQ(42, line.value);
+  ASSERT_EQ(-1, line.timestamp);
+
+  // Left to strtod()
+  s = "foo 12345678901234567890.5 1";
+  ASSERT_TRUE(parse_carbon_line(s.data(), s.size(), line));
+  ASSERT_DOUBLE_EQ(12345678901234567890.5, line.value);
+
+  s = "foo 1.5e-300 1";
+  ASSERT_TRUE(parse_carbon_line(s.data(), s.size(), line));
+  ASSERT_DOUBLE_EQ(1.5e-300, line.value);
+
+  s = "foo 0.1 1";
+  ASSERT_TRUE(parse_carbon_line(s.data(), s.size(), line));
+  ASSERT_EQ(0.1, line.value);
+
+  for (const std::string invalid : {"foo", "foo 1", "foo bar 1", "foo 1 bar",
+                                    "foo 1 1 1", "foo nan 1", "foo inf 1",
+                                    "foo 1e 1", "foo . 1", "foo 1 1e3"})
+  {
+    ASSERT_FALSE(parse_carbon_line(invalid.data(), invalid.size(), line))
+      << invalid;
+  }
+}
+
+TEST(carbon_parser_test_case, test)
+{
+  carbon_parser parser(1);
+  riemann::Msg msg;
+
+  std::string data("host1.cpu.user 10 100\r\n"
+                   "\n"
+                   "bad line\n"
+                   "host2.mem 20 200\n"
+                   "single 30 300\n"
+                   "host3.disk 4");
+
+  // The last line waits for its newline
+  size_t used = parser.parse(data.data(), data.size(), false, msg);
+  ASSERT_EQ(data.size() - 12, used);
+  ASSERT_EQ(1u, parser.invalid_lines());
+  ASSERT_EQ(0u, parser.invalid_lines());
+
+  ASSERT_EQ(3, msg.events_size());
+
+  ASSERT_EQ("host1", msg.events(0).host());
+  ASSERT_EQ("cpu.user", msg.events(0).service());
+  ASSERT_EQ(10, msg.events(0).metric_d());
+  ASSERT_EQ(100, msg.events(0).time());
+
+  ASSERT_EQ("host2", msg.events(1).host());
+  ASSERT_EQ("mem", msg.events(1).service());
+
+  ASSERT_EQ("", msg.events(2).host());
+  ASSERT_EQ("single", msg.events(2).service());
+  ASSERT_EQ(300, msg.events(2).time());
+
+  msg.Clear();
+
+  data = data.substr(used) + "2 400";
+
+  used = parser.parse(data.data(), data.size(), true, msg);
+  ASSERT_EQ(data.size(), used);
+  ASSERT_EQ(1, msg.events_size());
+  ASSERT_EQ("host3", msg.events(0).host());
+  ASSERT_EQ("disk", msg.events(0).service());
+  ASSERT_EQ(42, msg.events(0).metric_d());
+  ASSERT_EQ(400, msg.events(0).time());
+
+  msg.Clear();
+
+  // Two host components, paths with no more keep their last one as service
+  carbon_parser parser2(2);
+
+  data = "dc.host.cpu 1 1\ndc.host 2 -1\n";
+
+  used = parser2.parse(data.data(), data.size(), false, msg);
+  ASSERT_EQ(data.size(), used);
+  ASSERT_EQ(2, msg.events_size());
+
+  ASSERT_EQ("dc.host", msg.events(0).host());
+  ASSERT_EQ("cpu", msg.events(0).service());
+
+  ASSERT_EQ("dc", msg.events(1).host());
+  ASSERT_EQ("host", msg.events(1).service());
+  ASSERT_GT(msg.events(1).time(), 0);
+}
+
+#endif
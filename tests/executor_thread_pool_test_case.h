@@ -0,0 +1,227 @@
+#ifndef EXECUTOR_THREAD_POOL_TEST_CASE_H
+#define EXECUTOR_THREAD_POOL_TEST_CASE_H
+
+#include <atomic>
+#include <thread>
+#include <pool/work_stealing_deque.h>
+#include <pool/executor_thread_pool.h>
+#include <instrumentation/instrumentation.h>
+
+TEST(work_stealing_deque_test_case, test)
+{
+  work_stealing_deque<int> deque(2);
+
+  int value;
+
+  ASSERT_FALSE(deque.pop(value));
+  ASSERT_FALSE(deque.steal(value));
+
+  for (int i = 0; i < 10; i++) {
+    deque.push(i);
+  }
+
+  ASSERT_EQ(10u, deque.size());
+
+  // Owner takes from the bottom, thieves from the top
+  ASSERT_TRUE(deque.pop(value));
+  ASSERT_EQ(9, value);
+
+  ASSERT_TRUE(deque.steal(value));
+  ASSERT_EQ(0, value);
+
+  ASSERT_EQ(8u, deque.size());
+
+  while (deque.pop(value)) {}
+
+  ASSERT_TRUE(deque.empty());
+}
+
+TEST(work_stealing_deque_concurrent_test_case, test)
+{
+  const int n = 100000;
+
+  work_stealing_deque<int> deque;
+
+  std::atomic<int> stolen(0);
+  std::atomic<bool> done(false);
+
+  std::vector<std::thread> thieves;
+
+  for (int i = 0; i < 3; i++) {
+    thieves.emplace_back([&]()
+    {
+      int value;
+      while (!done) {
+        if (deque.steal(value)) {
+          stolen++;
+        }
+      }
+    });
+  }
+
+  int popped = 0;
+  int value;
+
+  for (int i = 0; i < n; i++) {
+    deque.push(i);
+    if (i % 2 && deque.pop(value)) {
+      popped++;
+    }
+  }
+
+  while (!deque.empty()) {
+    if (deque.pop(value)) {
+      popped++;
+    }
+  }
+
+  done = true;
+
+  for (auto & t : thieves) {
+    t.join();
+  }
+
+  ASSERT_EQ(n, popped + stolen);
+}
+
+void run_executor_tasks(const bool work_stealing) {
+
+  config conf = config();
+  conf.executor_pool_size = 4;
+  conf.executor_partition = "none";
+  conf.executor_work_stealing = work_stealing;
+  conf.executor_pin_threads = false;
+  conf.executor_max_pool_size = 0;
+  conf.ingest_high_watermark_mb = 0;
+  conf.ingest_low_watermark_mb = 0;
+
+  instrumentation::instrumentation instr(conf);
+
+  executor_thread_pool pool(instr, conf);
+
+  const size_t n = 10000;
+  std::atomic<size_t> ran(0);
+
+  for (size_t i = 0; i < n; i++) {
+    pool.add_task([&]() { ran++; });
+  }
+
+  for (size_t attempts = 1000; attempts > 0 && ran != n; attempts--) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  ASSERT_EQ(n, ran.load());
+
+  if (!work_stealing) {
+
+    pool.add_task(0, [&]() { ran++; });
+    pool.sync();
+
+    ASSERT_EQ(n + 1, ran.load());
+
+  }
+
+  pool.stop();
+}
+
+TEST(executor_thread_pool_test_case, test)
+{
+  run_executor_tasks(false);
+  run_executor_tasks(true);
+}
+
+TEST(executor_thread_pool_backpressure_test_case, test)
+{
+  config conf = config();
+  conf.executor_pool_size = 1;
+  conf.executor_partition = "none";
+  conf.executor_work_stealing = false;
+  conf.executor_pin_threads = false;
+  conf.executor_max_pool_size = 0;
+  conf.ingest_high_watermark_mb = 2;
+  conf.ingest_low_watermark_mb = 1;
+
+  instrumentation::instrumentation instr(conf);
+
+  executor_thread_pool pool(instr, conf);
+
+  std::atomic<bool> release(false);
+  std::atomic<size_t> resumed(0);
+
+  pool.set_resume_fn([&]() { resumed++; });
+
+  const size_t mb = 1024 * 1024;
+
+  auto block = [&]() {
+    while (!release) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  };
+
+  pool.add_task(block, mb);
+  ASSERT_FALSE(pool.paused());
+
+  pool.add_task([]() {}, mb);
+  ASSERT_FALSE(pool.paused());
+
+  pool.add_task([]() {}, mb);
+  ASSERT_TRUE(pool.paused());
+
+  release = true;
+  pool.sync();
+
+  ASSERT_FALSE(pool.paused());
+  ASSERT_EQ(1, resumed.load());
+
+  pool.stop();
+}
+
+TEST(executor_thread_pool_autoscale_test_case, test)
+{
+  config conf = config();
+  conf.executor_pool_size = 1;
+  conf.executor_partition = "none";
+  conf.executor_work_stealing = false;
+  conf.executor_min_pool_size = 1;
+  conf.executor_max_pool_size = 3;
+  conf.executor_scale_up_wait_us = 100;
+  conf.executor_scale_down_wait_us = 10;
+  conf.executor_max_cpu_usage = 100;
+
+  instrumentation::instrumentation instr(conf);
+
+  executor_thread_pool pool(instr, conf);
+
+  ASSERT_TRUE(pool.autoscaling());
+  ASSERT_EQ(3, pool.size());
+  ASSERT_EQ(1, pool.active_threads());
+
+  std::atomic<size_t> ran(0);
+
+  auto slow_task = [&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    ran++;
+  };
+
+  for (size_t i = 0; i < 5; i++) {
+    pool.add_task(slow_task);
+  }
+
+  for (size_t attempts = 1000; attempts > 0 && ran != 5; attempts--) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  pool.autoscale();
+  ASSERT_EQ(2, pool.active_threads());
+
+  // No tasks since the last call
+  pool.autoscale();
+  ASSERT_EQ(1, pool.active_threads());
+
+  pool.autoscale();
+  ASSERT_EQ(1, pool.active_threads());
+
+  pool.stop();
+}
+
+#endif
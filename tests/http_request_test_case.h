@@ -0,0 +1,104 @@
+#ifndef HTTP_REQUEST_TEST_CASE_H
+#define HTTP_REQUEST_TEST_CASE_H
+
+#include <string>
+#include <transport/http_request.h>
+
+TEST(http_request_test_case, test)
+{
+  http_request request(64);
+
+  std::string data("POST /events?x=1 HTTP/1.1\r\n"
+                   "Host: localhost\r\n"
+                   "Content-Length: 5\r\n"
+                   "\r\n"
+                   "hel");
+
+  // The body arrives in two reads
+  ASSERT_EQ(data.size(), request.parse(data.data(), data.size()));
+  ASSERT_FALSE(request.done());
+
+  data = "loGET / HTTP/1.0\r\n\r\n";
+
+  ASSERT_EQ(2u, request.parse(data.data(), data.size()));
+  ASSERT_TRUE(request.done());
+  ASSERT_EQ("POST", request.method());
+  ASSERT_EQ("/events", request.path());
+  ASSERT_EQ("hello", request.body());
+  ASSERT_TRUE(request.keep_alive());
+  ASSERT_FALSE(request.expect_continue());
+
+  // Pipelined request
+  request.reset();
+  data = data.substr(2);
+
+  ASSERT_EQ(data.size(), request.parse(data.data(), data.size()));
+  ASSERT_TRUE(request.done());
+  ASSERT_EQ("GET", request.method());
+  ASSERT_EQ("", request.body());
+  ASSERT_FALSE(request.keep_alive());
+
+  // Chunked, with an extension and a trailer
+  request.reset();
+  data = "POST /events HTTP/1.1\r\n"
+         "Transfer-Encoding: chunked\r\n"
+         "Expect: 100-continue\r\n"
+         "Connection: close\r\n"
+         "\r\n"
+         "3;ext=1\r\nfoo\r\n"
+         "A\r\n0123456789\r\n"
+         "0\r\n"
+         "Trailer: x\r\n"
+         "\r\n";
+
+  size_t used = 0;
+
+  // Byte by byte, what is not used is given again
+  for (size_t end = 1; end <= data.size(); end++) {
+    used += request.parse(data.data() + used, end - used);
+  }
+
+  ASSERT_EQ(data.size(), used);
+  ASSERT_TRUE(request.done());
+  ASSERT_TRUE(request.expect_continue());
+  ASSERT_FALSE(request.expect_continue());
+  ASSERT_EQ("foo0123456789", request.body());
+  ASSERT_FALSE(request.keep_alive());
+}
+
+TEST(http_request_failed_test_case, test)
+{
+  http_request request(8);
+
+  const std::vector<std::pair<std::string, int>> requests = {
+    {"POST / HTTP/1.1\r\nContent-Length: 9\r\n\r\n", 413},
+    {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n9\r\n", 413},
+    {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+     "5\r\n12345\r\n5\r\n", 413},
+    {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", 400},
+    {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+     "1\r\nab\r\n", 400},
+    {"POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n", 501},
+    {"POST / HTTP/1.1\r\nContent-Length: 1\r\n"
+     "Transfer-Encoding: chunked\r\n\r\n", 400},
+    {"POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n",
+     400},
+    {"POST / HTTP/1.1\r\nContent-Length: x\r\n\r\n", 400},
+    {"POST / HTTP/1.1\r\nExpect: foo\r\n\r\n", 417},
+    {"POST / HTTP/2.0\r\n\r\n", 505},
+    {"POST /\r\n\r\n", 400},
+    {"POST / HTTP/1.1\r\nfoo\r\n\r\n", 400},
+    {"POST / HTTP/1.1\r\nX: " + std::string(http_request::k_max_head_size,
+                                           'x'), 431}
+  };
+
+  for (const auto & r : requests) {
+    request.reset();
+    request.parse(r.first.data(), r.first.size());
+    ASSERT_TRUE(request.failed()) << r.first;
+    ASSERT_EQ(r.second, request.status()) << r.first;
+  }
+
+}
+
+#endif
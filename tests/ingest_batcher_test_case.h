@@ -0,0 +1,188 @@
+#ifndef INGEST_BATCHER_TEST_CASE_H
+#define INGEST_BATCHER_TEST_CASE_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <core/ingest_batcher.h>
+
+namespace {
+
+const size_t k_ingest_test_mb = 1024 * 1024;
+
+class counting_streams : public streams {
+public:
+  counting_streams(const config & conf,
+                   instrumentation::instrumentation & instr)
+    : streams(conf, instr), messages(0), events(0) {}
+
+  void process_message(const riemann::Msg & message) override {
+    std::lock_guard<std::mutex> lock(mutex);
+    messages++;
+    for (int i = 0; i < message.events_size(); i++) {
+      events++;
+      threads[message.events(i).service()].push_back(
+          std::this_thread::get_id());
+    }
+  }
+
+  std::mutex mutex;
+  size_t messages;
+  size_t events;
+  std::map<std::string, std::vector<std::thread::id>> threads;
+};
+
+config ingest_batcher_test_config(const size_t pool_size) {
+  config conf = config();
+  conf.executor_pool_size = pool_size;
+  conf.executor_partition = "none";
+  conf.executor_work_stealing = false;
+  conf.executor_pin_threads = false;
+  conf.executor_max_pool_size = 0;
+  conf.ingest_high_watermark_mb = 2;
+  conf.ingest_low_watermark_mb = 1;
+  return conf;
+}
+
+std::vector<unsigned char> ingest_frame(const riemann::Msg & msg) {
+  const auto str = msg.SerializeAsString();
+  return std::vector<unsigned char>(str.begin(), str.end());
+}
+
+riemann::Msg ingest_events(const std::vector<std::string> & services) {
+  riemann::Msg msg;
+  for (const auto & service : services) {
+    auto event = msg.add_events();
+    event->set_host("foo");
+    event->set_service(service);
+  }
+  return msg;
+}
+
+riemann::Msg ingest_query() {
+  riemann::Msg msg;
+  msg.mutable_query()->set_string("true");
+  return msg;
+}
+
+}
+
+TEST(ingest_batcher_test_case, test)
+{
+  auto conf = ingest_batcher_test_config(1);
+  instrumentation::instrumentation instr(conf);
+  executor_thread_pool pool(instr, conf);
+  counting_streams streams(conf, instr);
+
+  std::vector<size_t> batches;
+  ingest_batcher batcher(3, streams, pool, nullptr,
+                         [&](size_t n) { batches.push_back(n); });
+
+  // Frames are flushed as one task once max_frames are added
+  batcher.add(ingest_frame(ingest_events({"a"})));
+  batcher.add(ingest_frame(ingest_events({"b", "c"})));
+  ASSERT_TRUE(batches.empty());
+
+  batcher.add(ingest_frame(ingest_events({"d"})));
+  ASSERT_EQ(std::vector<size_t>({3}), batches);
+
+  // Queries and garbage count as frames but reach no stream
+  batcher.add(ingest_frame(ingest_query()));
+  batcher.add({0xff, 0xff, 0xff});
+  batcher.add(ingest_frame(ingest_events({"e"})));
+  ASSERT_EQ(std::vector<size_t>({3, 3}), batches);
+
+  pool.sync();
+
+  ASSERT_EQ(2u, streams.messages);
+  ASSERT_EQ(5u, streams.events);
+  ASSERT_EQ(0u, streams.threads.count("true"));
+
+  // Parsed events are batched apart from frames
+  auto msg = ingest_events({"f", "g"});
+  batcher.add_events(msg, 10);
+  ASSERT_EQ(0, msg.events(0).service().size());
+
+  riemann::Msg empty;
+  batcher.add_events(empty, 10);
+
+  batcher.add(ingest_frame(ingest_events({"h"})));
+  ASSERT_EQ(std::vector<size_t>({3, 3}), batches);
+
+  batcher.flush();
+  ASSERT_EQ(std::vector<size_t>({3, 3, 1, 1}), batches);
+
+  batcher.flush();
+  ASSERT_EQ(4u, batches.size());
+
+  pool.sync();
+
+  ASSERT_EQ(4u, streams.messages);
+  ASSERT_EQ(8u, streams.events);
+  ASSERT_EQ(1u, streams.threads.count("g"));
+
+  pool.stop();
+}
+
+TEST(ingest_batcher_shard_test_case, test)
+{
+  auto conf = ingest_batcher_test_config(2);
+  instrumentation::instrumentation instr(conf);
+  executor_thread_pool pool(instr, conf);
+  counting_streams streams(conf, instr);
+
+  // Hold both workers so flushed bytes stay queued
+  std::atomic<bool> release(false);
+  auto block = [&]() { while (!release) { std::this_thread::yield(); } };
+  pool.add_task(0, block);
+  pool.add_task(1, block);
+
+  size_t partitions = 0;
+  auto partition_fn = [&](const std::string &, const std::string & service)
+  {
+    partitions++;
+    return service == "a" ? size_t(0) : size_t(1);
+  };
+
+  std::vector<size_t> batches;
+  ingest_batcher batcher(2, streams, pool, partition_fn,
+                         [&](size_t n) { batches.push_back(n); });
+
+  auto msg = ingest_events({"a", "b", "a"});
+  batcher.add_events(msg, 3 * k_ingest_test_mb);
+  ASSERT_EQ(3u, partitions);
+  ASSERT_TRUE(batches.empty());
+
+  // Queries are dropped before they are partitioned
+  batcher.add(ingest_frame(ingest_query()));
+  ASSERT_EQ(3u, partitions);
+
+  // Only the shard reaching max_frames is flushed, and with half the bytes
+  // of the first message, which alone stays under the high watermark
+  batcher.add(ingest_frame(ingest_events({"a"})));
+  ASSERT_EQ(4u, partitions);
+  ASSERT_EQ(std::vector<size_t>({2}), batches);
+  ASSERT_FALSE(pool.paused());
+
+  batcher.flush();
+  ASSERT_EQ(std::vector<size_t>({2, 1}), batches);
+  ASSERT_TRUE(pool.paused());
+
+  release = true;
+  pool.sync();
+
+  ASSERT_FALSE(pool.paused());
+  ASSERT_EQ(2u, streams.messages);
+  ASSERT_EQ(4u, streams.events);
+
+  // Each shard is processed by its own worker
+  ASSERT_EQ(3u, streams.threads["a"].size());
+  ASSERT_EQ(1u, streams.threads["b"].size());
+  ASSERT_EQ(streams.threads["a"][0], streams.threads["a"][2]);
+  ASSERT_NE(streams.threads["a"][0], streams.threads["b"][0]);
+
+  pool.stop();
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef INLINE_INGEST_TEST_CASE_H
+#define INLINE_INGEST_TEST_CASE_H
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <netinet/in.h>
+#include <core/inline_ingest.h>
+#include <riemann_tcp_connection.h>
+#include "mock_async_fd.h"
+#include <os/mock_os_functions.h>
+
+extern mock_os_functions mock_os;
+
+namespace {
+
+/* Takes longer than the budget for messages run by the loop thread */
+class slow_streams : public streams {
+public:
+  slow_streams(const config & conf, instrumentation::instrumentation & instr,
+               const std::thread::id loop_thread)
+    : streams(conf, instr), loop_thread_(loop_thread), inline_(0),
+      queued_(0) {}
+
+  void process_message(const riemann::Msg &) override {
+
+    if (std::this_thread::get_id() == loop_thread_) {
+      inline_++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_++;
+  }
+
+  size_t inline_messages() const { return inline_; }
+
+  size_t queued_messages() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_;
+  }
+
+private:
+  const std::thread::id loop_thread_;
+  size_t inline_;
+  std::mutex mutex_;
+  size_t queued_;
+};
+
+}
+
+TEST(inline_ingest_test_case, test)
+{
+  config conf = config();
+  conf.executor_pool_size = 1;
+  conf.executor_partition = "none";
+  conf.executor_work_stealing = false;
+  conf.executor_pin_threads = false;
+  conf.executor_max_pool_size = 0;
+  conf.ingest_high_watermark_mb = 0;
+  conf.ingest_low_watermark_mb = 0;
+
+  instrumentation::instrumentation instr(conf);
+  executor_thread_pool pool(instr, conf);
+  slow_streams streams(conf, instr, std::this_thread::get_id());
+
+  size_t overflows = 0;
+
+  inline_ingest ingest(std::chrono::microseconds(1000), streams, pool,
+                       [&](const unsigned int n) { overflows += n; });
+
+  // Reads like riemann_tcp_pool::data_ready
+  tcp_connection conn(0);
+  riemann_tcp_connection rconn(
+      conn, [&](std::vector<unsigned char> m) { ingest.add(m); });
+
+  mock_async_fd async_fd;
+  using ::testing::Return;
+
+  EXPECT_CALL(async_fd, ready_read()).WillRepeatedly(Return(true));
+  EXPECT_CALL(async_fd, ready_write()).WillRepeatedly(Return(true));
+
+  riemann::Msg msg;
+  msg.add_events()->set_host("foo");
+
+  auto read_frames = [&](const size_t n)
+  {
+    mock_os.buffer.clear();
+
+    for (size_t i = 0; i < n; i++) {
+      auto nsize = htonl(msg.ByteSize());
+      const size_t offset = mock_os.buffer.size();
+      mock_os.buffer.resize(offset + sizeof(nsize) + msg.ByteSize());
+      memcpy(&mock_os.buffer[offset], &nsize, sizeof(nsize));
+      msg.SerializeToArray(&mock_os.buffer[offset + sizeof(nsize)],
+                           msg.ByteSize());
+    }
+
+    rconn.callback(async_fd);
+    ingest.done();
+  };
+
+  // The first message uses the whole budget, the rest are queued
+  read_frames(4);
+
+  pool.sync();
+
+  ASSERT_EQ(1u, streams.inline_messages());
+  ASSERT_EQ(3u, streams.queued_messages());
+  ASSERT_EQ(3u, overflows);
+
+  // Every read callback starts with a new budget
+  read_frames(2);
+
+  pool.sync();
+
+  ASSERT_EQ(2u, streams.inline_messages());
+  ASSERT_EQ(4u, streams.queued_messages());
+  ASSERT_EQ(4u, overflows);
+
+  ASSERT_FALSE(conn.close_connection);
+
+  pool.stop();
+}
+
+#endif
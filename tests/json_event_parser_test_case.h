@@ -0,0 +1,85 @@
+#ifndef JSON_EVENT_PARSER_TEST_CASE_H
+#define JSON_EVENT_PARSER_TEST_CASE_H
+
+#include <string>
+#include <json_event_parser.h>
+
+TEST(json_event_parser_test_case, test)
+{
+  json_event_parser parser;
+  riemann::Msg msg;
+
+  std::string json(
+      "[{\"host\": \"foo\", \"service\": \"bar\", \"state\": \"ok\","
+      "  \"description\": \"desc\", \"time\": 1400000000, \"metric\": 1.5,"
+      "  \"ttl\": 30, \"tags\": [\"a\", \"b\"], \"region\": \"eu\","
+      "  \"count\": 42, \"up\": true, \"x\": null},"
+      " {\"service\": \"baz\", \"metric\": -7, \"time\": 1400000000.5}]");
+
+  ASSERT_TRUE(parser.parse(json.data(), json.size(), msg));
+  ASSERT_EQ(2, msg.events_size());
+
+  auto e = msg.events(0);
+  ASSERT_EQ("foo", e.host());
+  ASSERT_EQ("bar", e.service());
+  ASSERT_EQ("ok", e.state());
+  ASSERT_EQ("desc", e.description());
+  ASSERT_EQ(1400000000, e.time());
+  ASSERT_EQ(1.5, e.metric_d());
+  ASSERT_EQ(30, e.ttl());
+  ASSERT_EQ(2, e.tags_size());
+  ASSERT_EQ("b", e.tags(1));
+  ASSERT_EQ(3, e.attributes_size());
+  ASSERT_EQ("region", e.attributes(0).key());
+  ASSERT_EQ("eu", e.attributes(0).value());
+  ASSERT_EQ("42", e.attributes(1).value());
+  ASSERT_EQ("true", e.attributes(2).value());
+
+  e = msg.events(1);
+  ASSERT_FALSE(e.has_host());
+  ASSERT_EQ(-7, e.metric_sint64());
+  ASSERT_FALSE(e.has_metric_d());
+  ASSERT_EQ(1400000000, e.time());
+
+  msg.Clear();
+
+  // NDJSON, with escapes and long strings scanned by words
+  json = "{\"host\":\"a\\\"b\\\\c\\n\\u00e9\\ud83d\\ude00\"}\n"
+         "{\"service\":\"0123456789abcdef0123456789\\tend\"}\n"
+         "{}\n";
+
+  ASSERT_TRUE(parser.parse(json.data(), json.size(), msg));
+  ASSERT_EQ(3, msg.events_size());
+  ASSERT_EQ("a\"b\\c\n\xc3\xa9\xf0\x9f\x98\x80", msg.events(0).host());
+  ASSERT_EQ("0123456789abcdef0123456789\tend", msg.events(1).service());
+
+  msg.Clear();
+
+  // Escaped attribute keys keep their value apart
+  json = "{\"k\\u0065y\": \"v\\u0061lue\"}";
+
+  ASSERT_TRUE(parser.parse(json.data(), json.size(), msg));
+  ASSERT_EQ("key", msg.events(0).attributes(0).key());
+  ASSERT_EQ("value", msg.events(0).attributes(0).value());
+
+  msg.Clear();
+
+  json = "  ";
+  ASSERT_TRUE(parser.parse(json.data(), json.size(), msg));
+  ASSERT_EQ(0, msg.events_size());
+
+  for (const std::string invalid : {"{", "[{}", "{\"host\": 1}",
+                                    "{\"metric\": \"1\"}", "{\"host\" \"a\"}",
+                                    "{\"a\": [1]}", "{\"a\": {}}", "1",
+                                    "{\"tags\": [1]}", "{\"host\": \"a\nb\"}",
+                                    "{\"host\": \"\\x\"}", "{\"metric\": 1e999}",
+                                    "{\"host\": \"\\ud83d\"}", "[{},]",
+                                    "{\"host\": \"a\"", "{\"up\": tru}"})
+  {
+    ASSERT_FALSE(parser.parse(invalid.data(), invalid.size(), msg))
+      << invalid;
+    ASSERT_FALSE(parser.error().empty());
+  }
+}
+
+#endif
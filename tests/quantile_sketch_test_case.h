@@ -0,0 +1,77 @@
+#ifndef QUANTILE_SKETCH_TEST_CASE_H
+#define QUANTILE_SKETCH_TEST_CASE_H
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <util/quantile_sketch.h>
+
+TEST(quantile_sketch_test_case, test)
+{
+  quantile_sketch sketch(0.01);
+
+  ASSERT_TRUE(sketch.empty());
+  ASSERT_EQ(0, sketch.quantile(0.5));
+
+  std::mt19937 gen(42);
+  std::lognormal_distribution<double> dist(3, 1.5);
+
+  std::vector<double> values;
+
+  for (size_t i = 0; i < 100000; i++) {
+    values.push_back(dist(gen));
+    sketch.add(values.back());
+  }
+
+  std::sort(begin(values), end(values));
+
+  ASSERT_EQ(100000u, sketch.count());
+  ASSERT_EQ(values.front(), sketch.quantile(0));
+  ASSERT_EQ(values.back(), sketch.quantile(1));
+
+  for (const auto q : {0.01, 0.25, 0.5, 0.75, 0.95, 0.99, 0.999}) {
+    const double expected = values[q * (values.size() - 1)];
+    ASSERT_NEAR(expected, sketch.quantile(q), expected * 0.01 + 1e-9) << q;
+  }
+
+  // Merging gives the quantiles of all the values
+  quantile_sketch low;
+  quantile_sketch high;
+
+  for (const auto v : {-5.0, -1.0, 0.0}) {
+    low.add(v, 10);
+  }
+
+  for (const auto v : {1.0, 5.0, 100.0}) {
+    high.add(v, 10);
+  }
+
+  low.merge(high);
+
+  ASSERT_EQ(60u, low.count());
+  ASSERT_EQ(-5, low.min());
+  ASSERT_EQ(100, low.max());
+  ASSERT_NEAR(-5, low.quantile(0.1), 0.05);
+  ASSERT_EQ(0, low.quantile(0.45));
+  ASSERT_NEAR(5, low.quantile(0.7), 0.05);
+  ASSERT_NEAR(1000, low.sum(), 1e-9);
+
+  // Buckets are capped, about 17 decades keep their accuracy and the
+  // values closer to zero end up in the lowest bucket
+  quantile_sketch wide;
+
+  for (int e = -9; e <= 300; e++) {
+    wide.add(std::pow(10, e));
+  }
+
+  ASSERT_EQ(1e300, wide.quantile(1));
+  ASSERT_NEAR(1e290, wide.quantile(299.0 / 309), 1e290 * 0.01);
+  ASSERT_GT(wide.quantile(0.5), 1e280);
+  ASSERT_LT(wide.quantile(0.5), 1e284);
+
+  low.clear();
+  ASSERT_TRUE(low.empty());
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef RCU_TEST_CASE_H
+#define RCU_TEST_CASE_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <util/rcu.h>
+#include <streams/lib.h>
+
+TEST(rcu_test_case, test)
+{
+  std::atomic<bool> in_section(false);
+  std::atomic<bool> release(false);
+  std::atomic<bool> synchronized(false);
+
+  std::thread reader([&]() {
+
+    rcu_read_guard guard;
+
+    // Nested sections are allowed
+    rcu_read_lock();
+    rcu_read_unlock();
+
+    in_section = true;
+
+    while (!release) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ASSERT_FALSE(synchronized.load());
+
+  });
+
+  while (!in_section) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  std::thread writer([&]() {
+    rcu_synchronize();
+    synchronized = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(synchronized.load());
+
+  release = true;
+
+  reader.join();
+  writer.join();
+
+  ASSERT_TRUE(synchronized.load());
+
+  // Readers that are outside a read section are not waited for
+  rcu_synchronize();
+}
+
+TEST(thread_ns_test_case, test)
+{
+  ASSERT_EQ(k_global_ns, get_thread_ns());
+  ASSERT_EQ(k_global_ns_id, get_thread_ns_id());
+
+  const auto foo = intern_ns("foo.so");
+
+  ASSERT_NE(k_global_ns_id, foo);
+  ASSERT_EQ(foo, intern_ns("foo.so"));
+  ASSERT_NE(foo, intern_ns("bar.so"));
+
+  set_thread_ns_id(foo);
+  ASSERT_EQ("foo.so", get_thread_ns());
+
+  set_thread_ns("bar.so");
+  ASSERT_EQ(intern_ns("bar.so"), get_thread_ns_id());
+
+  set_thread_global_ns();
+  ASSERT_EQ(k_global_ns, get_thread_ns());
+}
+
+TEST(stream_libs_test_case, test)
+{
+  stream_libs libs;
+
+  ASSERT_TRUE(libs.load().empty());
+
+  loaded_lib foo{"foo.so", intern_ns("foo.so"), 0, nullptr, nullptr};
+  loaded_lib bar{"bar.so", intern_ns("bar.so"), 0, nullptr, nullptr};
+
+  delete libs.publish({&foo, &bar});
+
+  const lib_list_t * old_libs = nullptr;
+
+  {
+    rcu_read_guard guard;
+
+    const auto & current = libs.load();
+
+    ASSERT_EQ(2u, current.size());
+
+    // Readers keep the list they loaded when a new one is published
+    old_libs = libs.publish({&bar});
+
+    ASSERT_EQ(&current, old_libs);
+    ASSERT_EQ(&foo, current[0]);
+    ASSERT_EQ(1u, libs.load().size());
+  }
+
+  rcu_synchronize();
+  delete old_libs;
+
+  // Libraries can be added without a limit
+  lib_list_t many(100, &foo);
+  delete libs.publish(many);
+
+  ASSERT_EQ(100u, libs.load().size());
+}
+
+#endif
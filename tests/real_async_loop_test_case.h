@@ -0,0 +1,19 @@
+#ifndef REAL_ASYNC_LOOP_TEST_CASE_H
+#define REAL_ASYNC_LOOP_TEST_CASE_H
+
+#include <async/real_async_loop.h>
+
+TEST(real_async_loop_signal_test_case, test)
+{
+  real_async_loop loop;
+
+  // Only the first signal calls ev_async_send until the loop drains
+  for (size_t i = 0; i < 10; i++) {
+    loop.signal();
+  }
+
+  ASSERT_EQ(1u, loop.wakeups_sent());
+  ASSERT_EQ(9u, loop.wakeups_skipped());
+}
+
+#endif
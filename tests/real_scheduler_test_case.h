@@ -0,0 +1,269 @@
+#ifndef REAL_SCHEDULER_TEST_CASE_H
+#define REAL_SCHEDULER_TEST_CASE_H
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <async/async_loop.h>
+#include <scheduler/real_scheduler.h>
+#include <pool/executor_thread_pool.h>
+#include <instrumentation/instrumentation.h>
+#include <streams/lib.h>
+
+TEST(real_scheduler_shard_test_case, test)
+{
+  config conf = config();
+  instrumentation::instrumentation instr(conf);
+
+  set_async_loop_backend("io_uring");
+  set_stream_shards(4);
+
+  std::mutex mutex;
+  std::vector<uint64_t> shard_keys, free_keys;
+  std::atomic<size_t> once_runs(0);
+
+  // Key of the task the dispatch function is running
+  uint64_t dispatch_key = 0;
+
+  real_scheduler sched(instr,
+                       [&](const uint64_t key, const task_fn_t & task)
+                       {
+                         std::lock_guard<std::mutex> lock(mutex);
+                         dispatch_key = key;
+                         task();
+                       },
+                       []() {});
+
+  // Tasks added from a shard run back on it
+  set_thread_shard(3);
+
+  sched.add_periodic_task([&]() { shard_keys.push_back(dispatch_key); }, 0.01);
+
+  sched.add_once_task([&]()
+                      {
+                        shard_keys.push_back(dispatch_key);
+                        once_runs++;
+                      }, 0.01);
+
+  set_thread_shard(k_no_shard);
+
+  sched.add_periodic_task([&]() { free_keys.push_back(dispatch_key); }, 0.01);
+
+  for (size_t i = 0; i < 200; i++) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (once_runs && shard_keys.size() > 2 && free_keys.size() > 2) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  sched.stop();
+
+  set_stream_shards(0);
+  set_async_loop_backend("libev");
+
+  ASSERT_EQ(1u, once_runs.load());
+  ASSERT_LT(2u, shard_keys.size());
+  ASSERT_LT(2u, free_keys.size());
+
+  for (const auto key : shard_keys) {
+    ASSERT_EQ(3u, key);
+  }
+
+  // The other tasks don't stick to one key
+  ASSERT_NE(free_keys[0], free_keys[1]);
+}
+
+TEST(real_scheduler_join_group_test_case, test)
+{
+  config conf = config();
+  instrumentation::instrumentation instr(conf);
+
+  set_async_loop_backend("io_uring");
+
+  typedef std::chrono::steady_clock clock;
+
+  const auto interval = std::chrono::milliseconds(100);
+
+  std::mutex mutex;
+  std::vector<clock::time_point> first_runs, second_runs;
+
+  real_scheduler sched(instr,
+                       [&](const uint64_t, const task_fn_t & task)
+                       {
+                         task();
+                       },
+                       []() {});
+
+  sched.add_periodic_task([&]()
+                          {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            first_runs.push_back(clock::now());
+                          }, 0.1);
+
+  auto runs = [&](std::vector<clock::time_point> & v)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return v.size();
+  };
+
+  for (size_t i = 0; i < 200 && runs(first_runs) == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  // Halfway to the next tick of the group
+  std::this_thread::sleep_for(interval / 2);
+
+  const auto added = clock::now();
+
+  sched.add_periodic_task([&]()
+                          {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            second_runs.push_back(clock::now());
+                          }, 0.1);
+
+  for (size_t i = 0; i < 200 && runs(second_runs) == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  sched.stop();
+
+  set_async_loop_backend("libev");
+
+  ASSERT_LT(0u, second_runs.size());
+
+  // It waits a full interval instead of running at the next tick
+  ASSERT_LE(interval * 8 / 10, second_runs[0] - added);
+}
+
+TEST(real_scheduler_remove_ns_tasks_test_case, test)
+{
+  config conf = config();
+  instrumentation::instrumentation instr(conf);
+
+  set_async_loop_backend("io_uring");
+
+  real_scheduler sched(instr);
+
+  std::promise<void> started, release;
+  auto release_future = release.get_future().share();
+  std::atomic<size_t> runs(0);
+
+  set_thread_ns("lib");
+
+  sched.add_periodic_task([&, release_future]()
+                          {
+                            if (runs++ == 0) {
+                              started.set_value();
+                              release_future.wait();
+                            }
+                          }, 0.01);
+
+  set_thread_global_ns();
+
+  started.get_future().wait();
+
+  // The tick still running doesn't hold the scheduler loops
+  auto ns_future = sched.remove_ns_tasks("lib");
+  const auto ns_status = ns_future.wait_for(std::chrono::seconds(5));
+
+  release.set_value();
+  sched.sync_dispatched();
+
+  ASSERT_EQ(std::future_status::ready, ns_status);
+  ASSERT_TRUE(ns_future.get());
+
+  const size_t removed_runs = runs;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  sched.stop();
+
+  set_async_loop_backend("libev");
+
+  ASSERT_EQ(1u, removed_runs);
+  ASSERT_EQ(1u, runs.load());
+}
+
+TEST(real_scheduler_stop_test_case, test)
+{
+  config conf = config();
+  conf.executor_pool_size = 1;
+  conf.executor_partition = "none";
+  conf.executor_work_stealing = false;
+
+  instrumentation::instrumentation instr(conf);
+
+  set_async_loop_backend("io_uring");
+
+  executor_thread_pool pool(instr, conf);
+
+  real_scheduler sched(instr,
+                       [&](const uint64_t key, const task_fn_t & task)
+                       {
+                         pool.add_task(key, task);
+                       },
+                       [&]() { pool.sync(); });
+
+  std::promise<void> started;
+  std::atomic<bool> release(false);
+  std::atomic<size_t> runs(0);
+
+  set_thread_ns("lib");
+
+  sched.add_periodic_task([&]()
+                          {
+                            if (runs++ == 0) {
+                              started.set_value();
+                              while (!release) {
+                                std::this_thread::yield();
+                              }
+                            }
+                          }, 0.01);
+
+  set_thread_global_ns();
+
+  started.get_future().wait();
+
+  // A reload unloading the library, as close_library() does
+  std::promise<bool> removed;
+  auto reload_future = removed.get_future();
+
+  std::thread reload([&]()
+  {
+    const bool ok = sched.remove_ns_tasks("lib").get();
+    sched.sync_dispatched();
+    removed.set_value(ok);
+  });
+
+  // Shutdown while the reload waits for the running tick
+  std::thread releaser([&]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    release = true;
+  });
+
+  sched.stop();
+  pool.stop();
+  releaser.join();
+
+  const auto status = reload_future.wait_for(std::chrono::seconds(5));
+
+  if (status != std::future_status::ready) {
+    reload.detach();
+  } else {
+    reload.join();
+  }
+
+  set_async_loop_backend("libev");
+
+  ASSERT_EQ(std::future_status::ready, status);
+
+  // Stopped schedulers don't take removals
+  ASSERT_FALSE(sched.remove_ns_tasks("lib").get());
+}
+
+#endif
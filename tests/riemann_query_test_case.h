@@ -0,0 +1,157 @@
+#ifndef RIEMANN_QUERY_TEST_CASE_H
+#define RIEMANN_QUERY_TEST_CASE_H
+
+#include <netinet/in.h>
+#include <riemann_query.h>
+#include <query/query_cache.h>
+#include <instrumentation/instrumentation.h>
+#include <core/core.h>
+
+namespace {
+
+std::vector<unsigned char> raw_query(const std::string & query) {
+
+  riemann::Msg msg;
+  msg.mutable_query()->set_string(query);
+
+  std::vector<unsigned char> raw(msg.ByteSize());
+  msg.SerializeToArray(&raw[0], raw.size());
+
+  return raw;
+}
+
+riemann::Msg response_msg(const std::vector<char> & response) {
+
+  uint32_t size;
+  memcpy(&size, &response[0], sizeof(size));
+
+  EXPECT_EQ(response.size() - sizeof(size), ntohl(size));
+
+  riemann::Msg msg;
+  EXPECT_TRUE(msg.ParseFromArray(&response[sizeof(size)],
+                                 response.size() - sizeof(size)));
+
+  return msg;
+}
+
+}
+
+TEST(query_cache_test_case, test)
+{
+  query_cache cache(2);
+
+  Event e;
+  e.set_host("foo");
+  e.set_service("bar");
+
+  auto host_fn = cache.get("host = \"foo\"");
+  ASSERT_TRUE(static_cast<bool>(host_fn));
+  ASSERT_TRUE(host_fn(e));
+  ASSERT_EQ(1u, cache.size());
+
+  // Hits don't add queries
+  ASSERT_TRUE(cache.get("host = \"foo\"")(e));
+  ASSERT_EQ(1u, cache.size());
+
+  // Invalid queries are not kept
+  ASSERT_FALSE(static_cast<bool>(cache.get("host = = foo")));
+  ASSERT_EQ(1u, cache.size());
+
+  ASSERT_FALSE(cache.get("service = \"baz\"")(e));
+  ASSERT_EQ(2u, cache.size());
+
+  // Least recently used goes first, the compiled function outlives it
+  ASSERT_TRUE(cache.get("host = \"foo\"")(e));
+  ASSERT_TRUE(cache.get("metric = nil")(e));
+  ASSERT_EQ(2u, cache.size());
+  ASSERT_TRUE(host_fn(e));
+
+  // Long queries are compiled but not kept
+  std::string long_query("host = \"foo\"");
+  for (size_t i = 0; i < 500; i++) {
+    long_query += " or host = \"bar\"";
+  }
+
+  ASSERT_TRUE(cache.get(long_query)(e));
+  ASSERT_EQ(2u, cache.size());
+  ASSERT_TRUE(cache.get("metric = nil")(e));
+  ASSERT_TRUE(cache.get("host = \"foo\"")(e));
+  ASSERT_EQ(2u, cache.size());
+}
+
+TEST(riemann_query_response_test_case, test)
+{
+  pub_sub pubsub;
+  config conf;
+  instrumentation::instrumentation instr(conf);
+
+  real_index index(pubsub, [](const Event &) {}, 60, g_core->sched(), instr,
+                   [](std::function<void()> fn) { fn(); });
+
+  pubsub.subscribe("index", [](const Event &) {});
+
+  for (size_t i = 0; i < 10; i++) {
+    Event e;
+    e.set_host(i % 2 ? "odd" : "even");
+    e.set_service("service " + std::to_string(i));
+    e.set_time(1);
+    e.set_ttl(120);
+    index.add_event(e);
+  }
+
+  query_cache cache(10);
+
+  auto msg = response_msg(riemann_query_response(raw_query("host = \"odd\""),
+                                                 index, cache, 100, 1024));
+  ASSERT_TRUE(msg.ok());
+  ASSERT_EQ(5, msg.events_size());
+  for (const auto & e : msg.events()) {
+    ASSERT_EQ("odd", e.host());
+  }
+
+  // Capped by max_results
+  msg = response_msg(riemann_query_response(raw_query("true"), index, cache,
+                                            3, 1024));
+  ASSERT_TRUE(msg.ok());
+  ASSERT_EQ(3, msg.events_size());
+
+  // And by the frame size
+  auto response = riemann_query_response(raw_query("true"), index, cache, 100,
+                                         64);
+  ASSERT_LE(response.size(), 64u);
+  msg = response_msg(response);
+  ASSERT_TRUE(msg.ok());
+  ASSERT_LT(0, msg.events_size());
+  ASSERT_GT(10, msg.events_size());
+
+  msg = response_msg(riemann_query_response(raw_query("host = = foo"), index,
+                                            cache, 100, 1024));
+  ASSERT_FALSE(msg.ok());
+  ASSERT_EQ("parse error: host = = foo", msg.error());
+
+  // Attributes out of range don't match rather than throw
+  Event big;
+  big.set_host("big");
+  big.set_service("big");
+  big.set_time(1);
+  big.set_ttl(120);
+  big.set_attr("foo", "99999999999");
+  big.set_attr("bar", "1e999");
+  index.add_event(big);
+
+  msg = response_msg(riemann_query_response(raw_query("foo = 1"), index,
+                                            cache, 100, 1024));
+  ASSERT_TRUE(msg.ok());
+  ASSERT_EQ(0, msg.events_size());
+
+  msg = response_msg(riemann_query_response(raw_query("bar = 1.5"), index,
+                                            cache, 100, 1024));
+  ASSERT_TRUE(msg.ok());
+  ASSERT_EQ(0, msg.events_size());
+
+  // Empty frames are valid messages without a query
+  msg = response_msg(riemann_query_response({}, index, cache, 100, 1024));
+  ASSERT_FALSE(msg.ok());
+}
+
+#endif
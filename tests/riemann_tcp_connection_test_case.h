@@ -96,4 +96,179 @@ TEST(riemann_tcp_connection_broken_size_test_case, test)
   ASSERT_TRUE(conn.close_connection);
 }
 
+TEST(riemann_tcp_connection_query_test_case, test)
+{
+  tcp_connection conn(0);
+
+  std::vector<std::vector<unsigned char>> sink;
+  std::vector<uint64_t> queries;
+
+  riemann_tcp_connection rconn(
+      conn,
+      [&](std::vector<unsigned char> m) { sink.push_back(m); },
+      [&](std::vector<unsigned char>, const uint64_t id)
+      {
+        queries.push_back(id);
+      });
+
+  mock_async_fd async_fd;
+  using ::testing::Return;
+
+  EXPECT_CALL(async_fd, ready_read()).WillRepeatedly(Return(true));
+  EXPECT_CALL(async_fd, ready_write()).WillRepeatedly(Return(true));
+
+  riemann::Msg event_msg;
+  event_msg.add_events()->set_host("foo");
+
+  riemann::Msg query_msg;
+  query_msg.mutable_query()->set_string("true");
+
+  auto add_frame = [](std::vector<char> & buffer, const riemann::Msg & msg)
+  {
+    auto nsize = htonl(msg.ByteSize());
+    const size_t offset = buffer.size();
+    buffer.resize(offset + sizeof(nsize) + msg.ByteSize());
+    memcpy(&buffer[offset], &nsize, sizeof(nsize));
+    msg.SerializeToArray(&buffer[offset + sizeof(nsize)], msg.ByteSize());
+  };
+
+  // Events and queries pipelined in one read
+  std::vector<char> input;
+  for (const auto & msg : {event_msg, query_msg, event_msg, query_msg,
+                           event_msg})
+  {
+    add_frame(input, msg);
+  }
+
+  mock_os.buffer.assign(input.begin(), input.end());
+
+  rconn.callback(async_fd);
+
+  ASSERT_EQ(3u, sink.size());
+  ASSERT_EQ(std::vector<uint64_t>({0, 1}), queries);
+
+  auto read_response = [&](size_t & offset) {
+    uint32_t size;
+    memcpy(&size, &mock_os.buffer[offset], sizeof(size));
+    size = ntohl(size);
+    riemann::Msg msg;
+    msg.ParseFromArray(&mock_os.buffer[offset + sizeof(size)], size);
+    offset += sizeof(size) + size;
+    return msg;
+  };
+
+  // Only the first event is acked, the others wait for the queries
+  size_t offset = input.size();
+  ASSERT_TRUE(read_response(offset).ok());
+  ASSERT_EQ(mock_os.buffer.size(), offset);
+
+  auto response = [&](const std::string & host) {
+    riemann::Msg msg;
+    msg.set_ok(true);
+    msg.add_events()->set_host(host);
+    std::vector<char> frame;
+    add_frame(frame, msg);
+    return frame;
+  };
+
+  // The second query is answered first and waits for the first one
+  rconn.add_query_response(1, response("second"));
+  ASSERT_EQ(mock_os.buffer.size(), offset);
+
+  rconn.add_query_response(0, response("first"));
+
+  const std::vector<std::string> expected = {"first", "", "second", ""};
+
+  for (const auto & host : expected) {
+    auto msg = read_response(offset);
+    ASSERT_TRUE(msg.ok());
+    if (host.empty()) {
+      ASSERT_EQ(0, msg.events_size());
+    } else {
+      ASSERT_EQ(1, msg.events_size());
+      ASSERT_EQ(host, msg.events(0).host());
+    }
+  }
+
+  ASSERT_EQ(mock_os.buffer.size(), offset);
+  ASSERT_FALSE(conn.close_connection);
+}
+
+TEST(riemann_tcp_connection_query_truncate_test_case, test)
+{
+  const size_t buff_size = 4096;
+
+  tcp_connection conn(0, buff_size);
+
+  riemann_tcp_connection rconn(
+      conn,
+      [](std::vector<unsigned char>) {},
+      [](std::vector<unsigned char>, const uint64_t) {});
+
+  mock_async_fd async_fd;
+  using ::testing::Return;
+
+  EXPECT_CALL(async_fd, ready_read()).WillRepeatedly(Return(true));
+  EXPECT_CALL(async_fd, ready_write()).WillRepeatedly(Return(false));
+
+  riemann::Msg msg;
+  msg.mutable_query()->set_string("true");
+
+  auto frame = [](const riemann::Msg & msg)
+  {
+    auto nsize = htonl(msg.ByteSize());
+    std::vector<char> buffer(sizeof(nsize) + msg.ByteSize());
+    memcpy(&buffer[0], &nsize, sizeof(nsize));
+    msg.SerializeToArray(&buffer[sizeof(nsize)], msg.ByteSize());
+    return buffer;
+  };
+
+  const auto query = frame(msg);
+  mock_os.buffer.assign(query.begin(), query.end());
+
+  rconn.callback(async_fd);
+
+  // The write buffer is partly filled by a slow client
+  mock_os.buffer.clear();
+  mock_os.socket_full = true;
+
+  const std::string pending(3000, 'x');
+  ASSERT_TRUE(conn.queue_write(pending.c_str(), pending.size()));
+
+  // A response within the frame size but larger than what is left
+  msg.Clear();
+  msg.set_ok(true);
+  for (size_t i = 0; i < 20; i++) {
+    msg.add_events()->set_host(std::string(100, 'a'));
+  }
+
+  const auto response = frame(msg);
+  ASSERT_GT(buff_size, response.size());
+  ASSERT_LT(buff_size - pending.size(), response.size());
+
+  rconn.add_query_response(0, response);
+
+  ASSERT_FALSE(conn.close_connection);
+  ASSERT_GE(buff_size, conn.w_buffer.size());
+
+  mock_os.socket_full = false;
+  ASSERT_TRUE(conn.write_vec(nullptr, 0));
+  ASSERT_FALSE(conn.pending_write());
+
+  ASSERT_LT(pending.size() + sizeof(uint32_t), mock_os.buffer.size());
+
+  uint32_t size;
+  memcpy(&size, &mock_os.buffer[pending.size()], sizeof(size));
+  size = ntohl(size);
+
+  ASSERT_EQ(mock_os.buffer.size(), pending.size() + sizeof(size) + size);
+
+  msg.Clear();
+  ASSERT_TRUE(msg.ParseFromArray(&mock_os.buffer[pending.size() + sizeof(size)],
+                                 size));
+  ASSERT_TRUE(msg.ok());
+  ASSERT_LT(0, msg.events_size());
+  ASSERT_GT(20, msg.events_size());
+}
+
 #endif
@@ -0,0 +1,196 @@
+#ifndef RING_BUFFER_TEST_CASE_H
+#define RING_BUFFER_TEST_CASE_H
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pool/ring_buffer.h>
+
+TEST(spsc_ring_test_case, test)
+{
+  spsc_ring<std::string> ring(3);
+
+  ASSERT_EQ(4u, ring.capacity());
+  ASSERT_TRUE(ring.empty());
+
+  std::string value;
+  ASSERT_FALSE(ring.try_pop(value));
+
+  // Go around the ring a few times
+  for (int i = 0; i < 10; i++) {
+
+    const std::vector<std::string> batch = {"a" + std::to_string(i),
+                                            "b" + std::to_string(i),
+                                            "c" + std::to_string(i)};
+
+    ASSERT_TRUE(ring.try_push_batch(batch.begin(), batch.size()));
+    ASSERT_FALSE(ring.try_push_batch(batch.begin(), 2));
+
+    std::string d("d");
+    ASSERT_TRUE(ring.try_push(d));
+
+    std::string e("e");
+    ASSERT_FALSE(ring.try_push(std::move(e)));
+    ASSERT_EQ("e", e);
+
+    ASSERT_EQ(4u, ring.size());
+
+    ASSERT_TRUE(ring.try_pop(value));
+    ASSERT_EQ(batch[0], value);
+
+    std::vector<std::string> values;
+    ASSERT_EQ(3u, ring.pop_batch(values, 10));
+    ASSERT_EQ(std::vector<std::string>({batch[1], batch[2], "d"}), values);
+
+    ASSERT_TRUE(ring.empty());
+  }
+}
+
+TEST(mpsc_ring_test_case, test)
+{
+  mpsc_ring<std::shared_ptr<int>> ring(4);
+
+  auto p = std::make_shared<int>(1);
+
+  const std::vector<std::shared_ptr<int>> batch(3, p);
+
+  ASSERT_TRUE(ring.try_push_batch(batch.begin(), batch.size()));
+  ASSERT_FALSE(ring.try_push_batch(batch.begin(), 2));
+  ASSERT_TRUE(ring.try_push(p));
+  ASSERT_FALSE(ring.try_push(p));
+
+  ASSERT_EQ(8, p.use_count());
+
+  std::vector<std::shared_ptr<int>> values;
+  ASSERT_EQ(2u, ring.pop_batch(values, 2));
+  ASSERT_EQ(2u, ring.size());
+
+  values.clear();
+  ASSERT_EQ(6, p.use_count());
+
+  // Values left in the ring are destroyed with it
+  {
+    mpsc_ring<std::shared_ptr<int>> other(2);
+    ASSERT_TRUE(other.try_push(p));
+  }
+
+  ASSERT_EQ(6, p.use_count());
+}
+
+TEST(mpsc_ring_concurrent_test_case, test)
+{
+  const size_t producers = 4;
+  const size_t n = 100000;
+
+  mpsc_ring<std::pair<size_t, size_t>> ring(1024);
+
+  std::vector<std::thread> threads;
+
+  for (size_t p = 0; p < producers; p++) {
+    threads.emplace_back([&, p]()
+    {
+      for (size_t i = 0; i < n; i++) {
+
+        // Every other value goes in a batch of two
+        if (i % 2 == 0 && i + 1 < n) {
+
+          const std::vector<std::pair<size_t, size_t>> batch = {{p, i},
+                                                                {p, i + 1}};
+
+          while (!ring.try_push_batch(batch.begin(), batch.size())) {
+            std::this_thread::yield();
+          }
+          i++;
+
+        } else {
+          while (!ring.try_push(std::make_pair(p, i))) {
+            std::this_thread::yield();
+          }
+        }
+
+      }
+    });
+  }
+
+  // Values of each producer are popped in the order they were pushed
+  std::vector<size_t> next(producers, 0);
+  std::vector<std::pair<size_t, size_t>> values;
+
+  for (size_t popped = 0; popped < producers * n; ) {
+
+    values.clear();
+
+    if (ring.pop_batch(values, 64) == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    popped += values.size();
+
+    for (const auto & v : values) {
+      ASSERT_EQ(next[v.first], v.second);
+      next[v.first]++;
+    }
+
+  }
+
+  for (auto & t : threads) {
+    t.join();
+  }
+
+  ASSERT_TRUE(ring.empty());
+}
+
+TEST(mpsc_queue_test_case, test)
+{
+  const size_t producers = 4;
+  const size_t n = 100000;
+
+  // Small ring, most values go through the overflow list
+  mpsc_queue<std::pair<size_t, size_t>> queue(8);
+
+  std::vector<std::thread> threads;
+
+  for (size_t p = 0; p < producers; p++) {
+    threads.emplace_back([&, p]()
+    {
+      for (size_t i = 0; i < n; i++) {
+        queue.push(std::make_pair(p, i));
+      }
+    });
+  }
+
+  std::vector<size_t> next(producers, 0);
+  std::vector<std::pair<size_t, size_t>> values;
+  std::pair<size_t, size_t> value;
+
+  for (size_t popped = 0; popped < producers * n; ) {
+
+    values.clear();
+
+    if (popped % 3 == 0) {
+      if (queue.try_pop(value)) {
+        values.push_back(value);
+      }
+    } else {
+      queue.pop_batch(values, 32);
+    }
+
+    popped += values.size();
+
+    for (const auto & v : values) {
+      ASSERT_EQ(next[v.first], v.second);
+      next[v.first]++;
+    }
+
+  }
+
+  for (auto & t : threads) {
+    t.join();
+  }
+
+  ASSERT_TRUE(queue.empty());
+}
+
+#endif
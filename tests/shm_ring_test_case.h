@@ -0,0 +1,126 @@
+#ifndef SHM_RING_TEST_CASE_H
+#define SHM_RING_TEST_CASE_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <transport/shm_ring.h>
+
+TEST(shm_ring_test_case, test)
+{
+  const int memfd = shm_ring::create_memfd(100);
+  ASSERT_GE(memfd, 0);
+
+  // Producer and consumer map the same memory
+  shm_ring producer;
+  shm_ring consumer;
+  ASSERT_TRUE(producer.map(memfd));
+  ASSERT_TRUE(consumer.map(memfd));
+  close(memfd);
+
+  ASSERT_EQ(4096u, consumer.capacity());
+  ASSERT_TRUE(consumer.empty());
+
+  std::vector<std::string> frames;
+  auto read_fn = [&](const unsigned char * data, const size_t size)
+  {
+    frames.push_back(std::string(reinterpret_cast<const char *>(data), size));
+  };
+
+  // The consumer sleeps and the first write wakes it up, once
+  ASSERT_TRUE(consumer.sleep());
+  ASSERT_TRUE(producer.write("foo", 3));
+  ASSERT_TRUE(producer.wake_consumer());
+  ASSERT_FALSE(producer.wake_consumer());
+
+  ASSERT_TRUE(producer.write("barbaz", 6));
+  ASSERT_EQ(1u, consumer.read(read_fn, 1));
+  ASSERT_EQ(1u, consumer.read(read_fn, 10));
+  ASSERT_EQ(std::vector<std::string>({"foo", "barbaz"}), frames);
+  ASSERT_TRUE(consumer.empty());
+
+  // Frames that don't fit before the end go at the start
+  const std::string big(3000, 'x');
+  ASSERT_TRUE(producer.write(big.c_str(), big.size()));
+  ASSERT_FALSE(producer.write(big.c_str(), big.size()));
+  ASSERT_EQ(1u, consumer.read(read_fn, 10));
+  ASSERT_TRUE(producer.write(big.c_str(), big.size()));
+
+  // Frames written while going to sleep keep it awake
+  ASSERT_FALSE(consumer.sleep());
+  ASSERT_FALSE(producer.wake_consumer());
+
+  ASSERT_EQ(1u, consumer.read(read_fn, 10));
+  ASSERT_EQ(4u, frames.size());
+  ASSERT_EQ(big, frames[3]);
+
+  ASSERT_FALSE(producer.write(std::string(5000, 'x').c_str(), 5000));
+  ASSERT_FALSE(consumer.corrupted());
+}
+
+TEST(shm_ring_corrupted_test_case, test)
+{
+  const int memfd = shm_ring::create_memfd(4096);
+  ASSERT_GE(memfd, 0);
+
+  shm_ring consumer;
+  ASSERT_TRUE(consumer.map(memfd));
+
+  // A producer claiming a frame larger than what it wrote
+  auto p = static_cast<unsigned char *>(mmap(nullptr, 4096 * 2,
+                                             PROT_READ | PROT_WRITE,
+                                             MAP_SHARED, memfd, 0));
+  ASSERT_NE(MAP_FAILED, p);
+  close(memfd);
+
+  const uint32_t length = htonl(1000);
+  memcpy(p + 4096, &length, sizeof(length));
+  reinterpret_cast<shm_ring_header *>(p)->head = 8;
+
+  size_t calls = 0;
+  ASSERT_EQ(0u, consumer.read([&](const unsigned char *, size_t) { calls++; },
+                              10));
+  ASSERT_EQ(0u, calls);
+  ASSERT_TRUE(consumer.corrupted());
+
+  munmap(p, 4096 * 2);
+
+  // Memory that isn't a ring
+  shm_ring other;
+  const int fd = memfd_create("test", 0);
+  ASSERT_EQ(0, ftruncate(fd, 4096 * 2));
+  ASSERT_FALSE(other.map(fd));
+  close(fd);
+}
+
+TEST(shm_ring_unsealed_test_case, test)
+{
+  const int memfd = shm_ring::create_memfd(4096);
+  ASSERT_GE(memfd, 0);
+
+  // The ring can't be resized once created
+  ASSERT_NE(0, ftruncate(memfd, 4096));
+  close(memfd);
+
+  // A valid ring in memory the producer could still shrink
+  const int fd = memfd_create("test", 0);
+  ASSERT_EQ(0, ftruncate(fd, 4096 * 2));
+
+  auto p = mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ASSERT_NE(MAP_FAILED, p);
+
+  auto header = static_cast<shm_ring_header *>(p);
+  header->magic = 0x63617672;
+  header->version = 1;
+  header->capacity = 4096;
+  munmap(p, 4096);
+
+  shm_ring ring;
+  ASSERT_FALSE(ring.map(fd));
+  close(fd);
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef STATSD_TABLE_TEST_CASE_H
+#define STATSD_TABLE_TEST_CASE_H
+
+#include <map>
+#include <string>
+#include <statsd_table.h>
+
+namespace {
+
+std::map<std::string, double> statsd_events(const riemann::Msg & msg) {
+
+  std::map<std::string, double> events;
+
+  for (const auto & e : msg.events()) {
+    events[e.service()] = e.metric_d();
+  }
+
+  return events;
+}
+
+}
+
+TEST(statsd_parser_test_case, test)
+{
+  statsd_line line;
+
+  std::string s("foo.bar:1.5|c|@0.5|#env:prod,role:web");
+  ASSERT_TRUE(parse_statsd_line(s.data(), s.size(), line));
+  ASSERT_EQ("foo.bar", std::string(line.name, line.name_size));
+  ASSERT_EQ(statsd_line::counter, line.type);
+  ASSERT_EQ(1.5, line.number);
+  ASSERT_EQ(0.5, line.sample_rate);
+  ASSERT_EQ("env:prod,role:web", std::string(line.tags, line.tags_size));
+
+  s = "a:b:-3|g";
+  ASSERT_TRUE(parse_statsd_line(s.data(), s.size(), line));
+  ASSERT_EQ("a:b", std::string(line.name, line.name_size));
+  ASSERT_TRUE(line.delta);
+
+  s = "users:alice|s";
+  ASSERT_TRUE(parse_statsd_line(s.data(), s.size(), line));
+  ASSERT_EQ("alice", std::string(line.value, line.value_size));
+
+  for (const std::string type : {"ms", "h", "d"}) {
+    s = "t:12|" + type;
+    ASSERT_TRUE(parse_statsd_line(s.data(), s.size(), line));
+    ASSERT_EQ(statsd_line::timer, line.type);
+  }
+
+  for (const std::string invalid : {"foo", "foo:1", "foo:1|x", ":1|c",
+                                    "foo:|c", "foo:x|c", "foo:1|c|@2",
+                                    "foo:1|c|@0", "foo:nan|ms"})
+  {
+    ASSERT_FALSE(parse_statsd_line(invalid.data(), invalid.size(), line))
+      << invalid;
+  }
+}
+
+TEST(statsd_table_test_case, test)
+{
+  statsd_table table;
+  riemann::Msg msg;
+
+  std::string data("hits:1|c\n"
+                   "hits:2|c|@0.5\r\n"
+                   "hits:1|c|#a,b\n"
+                   "temp:20|g\n"
+                   "temp:+5|g\n"
+                   "users:alice|s\nusers:bob|s\nusers:alice|s\n"
+                   "bad line\n"
+                   "\n");
+
+  for (int i = 1; i <= 100; i++) {
+    data += "lat:" + std::to_string(i) + "|ms\n";
+  }
+
+  ASSERT_EQ(1u, table.add(data.data(), data.size()));
+
+  table.flush(msg, 100, 20, 10, {0.5, 1});
+
+  auto events = statsd_events(msg);
+
+  ASSERT_EQ(5, events["hits"]);
+  ASSERT_EQ(0.5, events["hits rate"]);
+  ASSERT_EQ(25, events["temp"]);
+  ASSERT_EQ(2, events["users"]);
+  ASSERT_EQ(100, events["lat count"]);
+  ASSERT_EQ(50.5, events["lat mean"]);
+  ASSERT_NEAR(50, events["lat 0.500000"], 0.5);
+  ASSERT_EQ(100, events["lat 1.000000"]);
+
+  for (const auto & e : msg.events()) {
+    ASSERT_EQ(100, e.time());
+    ASSERT_EQ(20, e.ttl());
+    if (e.tags_size() > 0) {
+      ASSERT_EQ("hits", e.service().substr(0, 4));
+      ASSERT_EQ(1, e.metric_d() * (e.service() == "hits" ? 1 : 10));
+      ASSERT_EQ("b", e.tags(1));
+    }
+  }
+
+  // Only gauges stay, and are only flushed again once updated
+  ASSERT_EQ(1u, table.size());
+
+  msg.Clear();
+  table.flush(msg, 110, 20, 10, {});
+  ASSERT_EQ(0, msg.events_size());
+
+  // Deltas from another thread change the value that was kept
+  statsd_table other;
+  data = "temp:-10|g\nhits:3|c\n";
+  other.add(data.data(), data.size());
+
+  table.merge(other);
+  ASSERT_EQ(0u, other.size());
+
+  table.flush(msg, 120, 20, 10, {});
+  events = statsd_events(msg);
+
+  ASSERT_EQ(15, events["temp"]);
+  ASSERT_EQ(3, events["hits"]);
+}
+
+#endif
@@ -7,6 +7,9 @@
 #include <scheduler/scheduler.h>
 #include <core/core.h>
 #include <util/util.h>
+#include <streams/lib.h>
+#include <streams/stream_functions_shard.h>
+#include <streams/named_state.h>
 
 streams_t create_c_stream(const std::string c) {
   return create_stream([=](const Event & e) -> next_events_t
@@ -983,6 +986,61 @@ TEST(moving_event_window_streams_test_case, test)
   v.clear();
 }
 
+TEST(named_streams_test_case, test)
+{
+  std::vector<Event> v;
+
+  auto rules = [&]() {
+    return named("window", by({"host"}, moving_event_window(3, msink(v))));
+  };
+
+  // What the rules loader does while initializing a library
+  auto load = [&]() {
+    set_state_lib("named_test.so");
+    auto s = std::make_shared<streams_t>(rules());
+    init_streams(*s);
+    set_state_lib("");
+    return s;
+  };
+
+  auto old_version = load();
+
+  Event e;
+  e.set_host("foo");
+
+  e.set_metric_sint64(0);
+  push_event(*old_version, e);
+  e.set_metric_sint64(1);
+  push_event(*old_version, e);
+  ASSERT_EQ(2u, v.size());
+  v.clear();
+
+  carry_named_state("named_test.so");
+  old_version.reset();
+
+  auto new_version = load();
+
+  e.set_metric_sint64(2);
+  push_event(*new_version, e);
+  ASSERT_EQ(3u, v.size());
+  ASSERT_EQ(0, v[0].metric_sint64());
+  v.clear();
+
+  // Other keys and unnamed streams start empty
+  e.set_host("bar");
+  push_event(*new_version, e);
+  ASSERT_EQ(1u, v.size());
+  v.clear();
+
+  auto unnamed = moving_event_window(3, msink(v));
+  set_state_lib("named_test.so");
+  init_streams(unnamed);
+  set_state_lib("");
+
+  push_event(unnamed, e);
+  ASSERT_EQ(1u, v.size());
+}
+
 TEST(fixed_event_window_streams_test_case, test)
 {
   std::vector<Event> v;
@@ -1325,6 +1383,97 @@ TEST(ddt_streams_test_case, test)
 
 }
 
+TEST(changed_state_shard_streams_test_case, test)
+{
+  std::vector<Event> v;
+
+  set_stream_shards(2);
+
+  auto changed_stream = changed_state_shard("a") >>  sink(v);
+  init_streams(changed_stream);
+
+  Event e;
+
+  e.set_host("foo");
+  e.set_service("bar");
+
+  set_thread_shard(0);
+
+  for (auto s : {"a", "b", "b"}) {
+    e.set_state(s);
+    push_event(changed_stream, e);
+  }
+
+  ASSERT_EQ(1u, v.size());
+  v.clear();
+
+  set_thread_shard(1);
+
+  push_event(changed_stream, e);
+
+  ASSERT_EQ(1u, v.size());
+  ASSERT_EQ("b", v[0].state());
+
+  set_thread_shard(k_no_shard);
+  set_stream_shards(0);
+
+}
+
+TEST(partitioned_streams_test_case, test)
+{
+  g_core->sched().clear();
+
+  /* Sizes of the last coalesce, the events throttle() lets through and
+   * the ones by() on the partition key does */
+  auto run = [&]()
+  {
+    std::vector<Event> coalesced, throttled, by_throttled;
+
+    auto coalesce_stream = coalesce(msink(coalesced));
+    init_streams(coalesce_stream);
+
+    auto throttle_stream = throttle(2, 5) >> sink(throttled);
+    init_streams(throttle_stream);
+
+    auto by_stream = by({"host"}, throttle(1, 5)) >> sink(by_throttled);
+    init_streams(by_stream);
+
+    for (const auto host : {"a", "b", "c", "d", "a", "b"}) {
+
+      // Events of each host are processed by the shard of the host
+      if (stream_shards()) {
+        set_thread_shard(host[0] % stream_shards());
+      }
+
+      Event e;
+      e.set_host(host);
+      e.set_service("foo");
+      e.set_time(1);
+
+      push_event(coalesce_stream, e);
+      push_event(throttle_stream, e);
+      push_event(by_stream, e);
+    }
+
+    set_thread_shard(k_no_shard);
+
+    return std::vector<size_t>{coalesced.size(), throttled.size(),
+                               by_throttled.size()};
+  };
+
+  const auto unpartitioned = run();
 
+  ASSERT_EQ(std::vector<size_t>({4, 2, 4}), unpartitioned);
+
+  set_stream_shards(2);
+  set_stream_partition({"host"});
+
+  const auto partitioned = run();
+
+  set_stream_partition({});
+  set_stream_shards(0);
+
+  ASSERT_EQ(unpartitioned, partitioned);
+}
 
 #endif
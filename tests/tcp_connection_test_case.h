@@ -69,4 +69,30 @@ TEST(tcp_connection_write_test_case, test)
 }
 
 */
+
+TEST(tcp_connection_write_vec_test_case, test)
+{
+  mock_os.buffer.clear();
+  tcp_connection conn(0);
+
+  std::string queued("foo");
+
+  ASSERT_TRUE(conn.queue_write(queued.c_str(), queued.size()));
+
+  char bar[] = "bar";
+  char baz[] = "baz";
+
+  struct iovec iov[2];
+  iov[0].iov_base = bar;
+  iov[0].iov_len = 3;
+  iov[1].iov_base = baz;
+  iov[1].iov_len = 3;
+
+  ASSERT_TRUE(conn.write_vec(iov, 2));
+  ASSERT_FALSE(conn.close_connection);
+  ASSERT_FALSE(conn.pending_write());
+  ASSERT_EQ("foobarbaz",
+            std::string(mock_os.buffer.begin(), mock_os.buffer.end()));
+}
+
 #endif
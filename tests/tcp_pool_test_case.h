@@ -0,0 +1,173 @@
+#ifndef TCP_POOL_TEST_CASE_H
+#define TCP_POOL_TEST_CASE_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <async/uring.h>
+#include <transport/tcp_pool.h>
+#include <transport/tcp_connection.h>
+#include <transport/listen_tcp_socket.h>
+
+namespace {
+
+/* A port nothing listens on */
+uint16_t free_tcp_port() {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  struct sockaddr_in addr;
+  bzero(&addr, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  socklen_t len = sizeof(addr);
+  bind(fd, (struct sockaddr*) &addr, sizeof(addr));
+  getsockname(fd, (struct sockaddr*) &addr, &len);
+  close(fd);
+
+  return ntohs(addr.sin_port);
+}
+
+}
+
+TEST(tcp_pool_reuseport_test_case, test)
+{
+  uring ring;
+
+  // Only the io_uring loop runs in this build, libev is a stub
+  if (!ring.init(4)) {
+    LOG(WARNING) << "io_uring is not available, skipping";
+    return;
+  }
+
+  const size_t threads = 2;
+  const size_t clients = 160;
+  // What accept_callback() accepts before going back to the loop
+  const size_t accept_batch = 64;
+
+  std::vector<std::atomic<size_t>> accepted(threads);
+  std::vector<size_t> iteration_accepts(threads, 0);
+  std::vector<size_t> max_iteration_accepts(threads, 0);
+
+  for (auto & n : accepted) {
+    n = 0;
+  }
+
+  // Counts the connections accepted by every loop iteration
+  auto run_fn = [&](async_loop & loop)
+  {
+    const size_t id = loop.id();
+    loop.set_iteration_fn([&, id]()
+    {
+      max_iteration_accepts[id] = std::max(max_iteration_accepts[id],
+                                           iteration_accepts[id]);
+      iteration_accepts[id] = 0;
+    });
+  };
+
+  auto create_conn_fn = [&](int, async_loop & loop, tcp_connection &)
+  {
+    accepted[loop.id()]++;
+    iteration_accepts[loop.id()]++;
+  };
+
+  auto ready_fn = [&](async_fd & async, tcp_connection & conn)
+  {
+    char buffer[16];
+
+    const ssize_t n = ::recv(async.fd(), buffer, sizeof(buffer), 0);
+
+    if (n <= 0) {
+      conn.close_connection = true;
+      return;
+    }
+
+    ASSERT_EQ(4, ::write(async.fd(), "pong", 4));
+  };
+
+  set_async_loop_backend("io_uring");
+
+  tcp_pool pool(threads, run_fn, create_conn_fn, ready_fn);
+
+  set_async_loop_backend("libev");
+
+  const uint16_t port = free_tcp_port();
+
+  listen_per_thread(pool, threads, port, false);
+
+  struct sockaddr_in addr;
+  bzero(&addr, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  // Queued before the loops start, so each listener has more connections
+  // pending than it accepts in one callback
+  std::vector<int> fds;
+
+  for (size_t i = 0; i < clients; i++) {
+
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_LE(0, fd);
+
+    struct timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    ASSERT_EQ(0, connect(fd, (struct sockaddr*) &addr, sizeof(addr)));
+
+    fds.push_back(fd);
+  }
+
+  pool.start_threads();
+
+  size_t served = 0;
+
+  for (const auto fd : fds) {
+
+    ASSERT_EQ(4, write(fd, "ping", 4));
+
+    char buffer[4];
+    ssize_t n;
+
+    // Signals handled by the test process can interrupt the wait
+    do {
+      n = recv(fd, buffer, sizeof(buffer), MSG_WAITALL);
+    } while (n < 0 && errno == EINTR);
+
+    if (n == 4 && std::string(buffer, 4) == "pong") {
+      served++;
+    }
+
+  }
+
+  pool.stop_threads();
+
+  for (const auto fd : fds) {
+    close(fd);
+  }
+
+  ASSERT_EQ(clients, served);
+
+  size_t total = 0;
+
+  for (size_t i = 0; i < threads; i++) {
+
+    // Both listeners get connections, the kernel spreads them
+    ASSERT_LT(0u, accepted[i].load());
+    ASSERT_GE(accept_batch, max_iteration_accepts[i]);
+
+    total += accepted[i];
+  }
+
+  ASSERT_EQ(clients, total);
+
+  // At least one listener needed more than one accept batch
+  ASSERT_TRUE(accepted[0] > accept_batch || accepted[1] > accept_batch);
+}
+
+#endif
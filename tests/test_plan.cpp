@@ -8,11 +8,30 @@
 #include "streams_test_case.h"
 #include "folds_test_case.h"
 #include "rules_common_test_case.h"
+#include "byte_buffer_test_case.h"
 #include "tcp_connection_test_case.h"
 #include "ws_connection_test_case.h"
 #include "riemann_tcp_connection_test_case.h"
 #include "pubsub_test_case.h"
 #include "index_test_case.h"
+#include "executor_thread_pool_test_case.h"
+#include "ingest_batcher_test_case.h"
+#include "inline_ingest_test_case.h"
+#include "real_scheduler_test_case.h"
+#include "ring_buffer_test_case.h"
+#include "rcu_test_case.h"
+#include "timer_wheel_test_case.h"
+#include "real_async_loop_test_case.h"
+#include "uring_async_loop_test_case.h"
+#include "udp_pool_test_case.h"
+#include "tcp_pool_test_case.h"
+#include "shm_ring_test_case.h"
+#include "carbon_parser_test_case.h"
+#include "json_event_parser_test_case.h"
+#include "http_request_test_case.h"
+#include "quantile_sketch_test_case.h"
+#include "statsd_table_test_case.h"
+#include "riemann_query_test_case.h"
 #include <scheduler/mock_scheduler.h>
 #include <core/mock_core.h>
 #include "os/os_functions.h"
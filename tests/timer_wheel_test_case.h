@@ -0,0 +1,138 @@
+#ifndef TIMER_WHEEL_TEST_CASE_H
+#define TIMER_WHEEL_TEST_CASE_H
+
+#include <random>
+#include <vector>
+#include <async/timer_wheel.h>
+
+TEST(timer_wheel_test_case, test)
+{
+  const uint64_t start = 1000000;
+
+  timer_wheel wheel(start);
+
+  ASSERT_TRUE(wheel.empty());
+
+  std::vector<uint64_t> once, periodic, hour;
+  uint64_t now = start;
+
+  wheel.add(1, "foo", [&]() { once.push_back(now); }, start, 10, 0);
+  wheel.add(2, "foo", [&]() { periodic.push_back(now); }, start, 100, 100);
+  wheel.add(3, "bar", [&]() { hour.push_back(now); }, start, 3600000, 0);
+
+  ASSERT_EQ(3u, wheel.size());
+  ASSERT_EQ(start + 10, wheel.next_expiration());
+
+  now = start + 9;
+  wheel.advance(now);
+  ASSERT_TRUE(once.empty());
+
+  now = start + 10;
+  wheel.advance(now);
+  ASSERT_EQ(std::vector<uint64_t>({start + 10}), once);
+
+  now = start + 350;
+  wheel.advance(now);
+  ASSERT_EQ(std::vector<uint64_t>({start + 350}), periodic);
+
+  // Periodic timers run again interval ms after they run
+  now = start + 449;
+  wheel.advance(now);
+  ASSERT_EQ(1u, periodic.size());
+
+  now = start + 450;
+  wheel.advance(now);
+  ASSERT_EQ(2u, periodic.size());
+
+  // The timer runs 20 ms from now and then every 20 ms
+  ASSERT_TRUE(wheel.set_interval(2, now, 20));
+
+  now = start + 470;
+  wheel.advance(now);
+  ASSERT_EQ(3u, periodic.size());
+
+  ASSERT_EQ(1u, wheel.remove_ns("foo"));
+  ASSERT_FALSE(wheel.remove(2));
+
+  now = start + 3599999;
+  wheel.advance(now);
+  ASSERT_TRUE(hour.empty());
+
+  now = start + 3600000;
+  wheel.advance(now);
+  ASSERT_EQ(std::vector<uint64_t>({start + 3600000}), hour);
+
+  ASSERT_TRUE(wheel.empty());
+  ASSERT_EQ(3u, periodic.size());
+}
+
+TEST(timer_wheel_running_test_case, test)
+{
+  timer_wheel wheel(0);
+
+  size_t runs = 0;
+
+  // Timers can remove themselves and change their own interval
+  wheel.add(1, "foo", [&]() {
+    if (++runs == 3) {
+      wheel.remove(1);
+    } else {
+      wheel.set_interval(1, 0, 5);
+    }
+  }, 0, 1, 1);
+
+  size_t ns_runs = 0;
+
+  wheel.add(2, "bar", [&]() { ns_runs++; wheel.remove_ns("bar"); }, 0, 1, 1);
+  wheel.add(3, "bar", [&]() { ns_runs++; }, 0, 2, 1);
+
+  for (uint64_t t = 1; t < 100; t++) {
+    wheel.advance(t);
+  }
+
+  ASSERT_EQ(3u, runs);
+  ASSERT_EQ(1u, ns_runs);
+  ASSERT_TRUE(wheel.empty());
+}
+
+TEST(timer_wheel_random_test_case, test)
+{
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<uint64_t> delay(0, 20000000);
+  std::uniform_int_distribution<uint64_t> step(1, 300000);
+
+  const uint64_t start = 123456789;
+  const size_t timers = 5000;
+
+  timer_wheel wheel(start);
+
+  std::vector<uint64_t> expires(timers), fired(timers, 0);
+  uint64_t now = start;
+
+  for (size_t i = 0; i < timers; i++) {
+    expires[i] = start + std::max<uint64_t>(delay(gen), 1);
+    wheel.add(i, "ns", [&, i]() { fired[i] = now; }, start,
+              expires[i] - start, 0);
+  }
+
+  std::vector<uint64_t> advances;
+
+  while (!wheel.empty()) {
+    const auto prev = now;
+    now += step(gen);
+    wheel.advance(now);
+
+    // Each timer runs in the first call that reaches its expiration
+    for (size_t i = 0; i < timers; i++) {
+      if (expires[i] > prev && expires[i] <= now) {
+        ASSERT_EQ(now, fired[i]);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < timers; i++) {
+    ASSERT_NE(0u, fired[i]);
+  }
+}
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef UDP_POOL_TEST_CASE_H
+#define UDP_POOL_TEST_CASE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <async/uring.h>
+#include <transport/udp_pool.h>
+
+namespace {
+
+/* A port nothing listens on */
+uint16_t free_udp_port() {
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  struct sockaddr_in addr;
+  bzero(&addr, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  socklen_t len = sizeof(addr);
+  bind(fd, (struct sockaddr*) &addr, sizeof(addr));
+  getsockname(fd, (struct sockaddr*) &addr, &len);
+  close(fd);
+
+  return ntohs(addr.sin_port);
+}
+
+}
+
+TEST(udp_pool_drop_test_case, test)
+{
+  uring ring;
+
+  // Only the io_uring loop runs in this build, libev is a stub
+  if (!ring.init(4)) {
+    LOG(WARNING) << "io_uring is not available, skipping";
+    return;
+  }
+
+  set_async_loop_backend("io_uring");
+
+  const uint16_t port = free_udp_port();
+  const size_t max_datagram_size = 512;
+  const size_t burst = 3000;
+
+  std::mutex mutex;
+  std::vector<std::string> received;
+  std::atomic<bool> blocked(false);
+  std::atomic<bool> release(false);
+  std::atomic<size_t> truncated(0);
+  std::atomic<size_t> overflowed(0);
+
+  auto read_fn = [&](udp_buffer_t buffer)
+  {
+    const std::string payload(buffer.begin(), buffer.end());
+
+    // Holds the loop so the burst fills the socket
+    if (payload == "block") {
+      blocked = true;
+      while (!release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    received.push_back(payload);
+  };
+
+  auto drop_fn = [&](const size_t t, const size_t o)
+  {
+    truncated += t;
+    overflowed += o;
+  };
+
+  udp_pool pool(1, port, max_datagram_size, read_fn, {}, drop_fn);
+
+  set_async_loop_backend("libev");
+
+  pool.start_threads();
+
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_LE(0, fd);
+
+  struct sockaddr_in addr;
+  bzero(&addr, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  auto send = [&](const std::string & payload)
+  {
+    sendto(fd, payload.data(), payload.size(), 0,
+           (struct sockaddr*) &addr, sizeof(addr));
+  };
+
+  auto received_size = [&]()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return received.size();
+  };
+
+  auto wait_for = [&](std::function<bool()> fn)
+  {
+    for (size_t i = 0; i < 500 && !fn(); i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  };
+
+  // The socket is bound once the loop thread runs
+  wait_for([&]() { send("ping"); return received_size() > 0; });
+  ASSERT_LT(0u, received_size());
+
+  send(std::string(max_datagram_size + 1, 't'));
+  send("block");
+
+  wait_for([&]() { return blocked.load(); });
+  ASSERT_TRUE(blocked);
+
+  for (size_t i = 0; i < burst; i++) {
+    auto payload = std::to_string(i);
+    payload.resize(100, 'x');
+    send(payload);
+  }
+
+  release = true;
+
+  // The kernel reports its drop count with the next datagram received
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  send("end");
+
+  wait_for([&]()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !received.empty() && received.back() == "end";
+  });
+
+  pool.stop_threads();
+  close(fd);
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  ASSERT_EQ("end", received.back());
+
+  auto it = std::find(received.begin(), received.end(), "block");
+  ASSERT_TRUE(it != received.end());
+
+  // What came before the block are pings, the truncated one is not passed
+  for (auto p = received.begin(); p != it; p++) {
+    ASSERT_EQ("ping", *p);
+  }
+
+  std::vector<std::string> delivered(it + 1, received.end() - 1);
+
+  ASSERT_EQ(1u, truncated.load());
+  ASSERT_LT(0u, overflowed.load());
+  ASSERT_LT(0u, delivered.size());
+  ASSERT_EQ(burst, delivered.size() + overflowed);
+
+  // The burst arrives in order and whole
+  size_t last = 0;
+  for (size_t i = 0; i < delivered.size(); i++) {
+    ASSERT_EQ(100u, delivered[i].size());
+    const size_t n = std::stoul(delivered[i]);
+    ASSERT_TRUE(i == 0 || n > last);
+    ASSERT_LT(n, burst);
+    last = n;
+  }
+}
+
+#endif
@@ -0,0 +1,339 @@
+#ifndef URING_ASYNC_LOOP_TEST_CASE_H
+#define URING_ASYNC_LOOP_TEST_CASE_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <async/uring.h>
+#include <async/uring_async_loop.h>
+
+TEST(uring_test_case, test)
+{
+  uring ring;
+
+  if (!ring.init(4)) {
+    LOG(WARNING) << "io_uring is not available, skipping";
+    return;
+  }
+
+  const uint64_t nops = 64;
+
+  auto nop = [&](const uint64_t id) {
+    auto sqe = ring.get_sqe();
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = id;
+  };
+
+  // Fills the completion queue, which has 32 entries
+  for (uint64_t i = 1; i <= nops; i++) {
+    nop(i);
+  }
+
+  ring.submit(0, 0);
+
+  // Every completion queues another one while the rest are reaped, as the
+  // polls that are armed again do
+  std::vector<uint64_t> ids;
+
+  auto complete = [&](const struct io_uring_cqe & cqe) {
+    ids.push_back(cqe.user_data);
+    if (cqe.user_data <= nops) {
+      nop(cqe.user_data + nops);
+    }
+  };
+
+  for (size_t i = 0; i < 100 && ids.size() < 2 * nops; i++) {
+    ring.reap(complete);
+    ring.submit(1, 10);
+  }
+
+  ASSERT_EQ(2 * nops, ids.size());
+
+  for (uint64_t i = 0; i < 2 * nops; i++) {
+    ASSERT_EQ(i + 1, ids[i]);
+  }
+}
+
+TEST(uring_async_loop_test_case, test)
+{
+  std::atomic<size_t> signals(0);
+
+  uring_async_events events(1, [&](async_loop &) { signals++; });
+
+  if (!events.init()) {
+    LOG(WARNING) << "io_uring is not available, skipping";
+    return;
+  }
+
+  int sv[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+  auto & loop = events.loop(0);
+
+  std::string received;
+  size_t callbacks = 0;
+  std::atomic<bool> done(false);
+
+  // Reads one byte per callback, the poll has to fire again for the rest
+  loop.add_fd(sv[0], async_fd::read, [&](async_fd & fd)
+  {
+    ASSERT_FALSE(fd.error());
+    ASSERT_TRUE(fd.ready_read());
+
+    callbacks++;
+
+    char c;
+    ASSERT_EQ(1, recv(fd.fd(), &c, 1, 0));
+    received += c;
+
+    if (received == "ping") {
+      fd.stop();
+      done = true;
+    }
+  });
+
+  size_t ticks = 0;
+  loop.add_periodic_task("test", [&](size_t) { ticks++; }, 0.01);
+
+  loop.add_once_task("test", [&](size_t loop_id)
+  {
+    ASSERT_EQ(0u, loop_id);
+    ASSERT_EQ(4, write(sv[1], "ping", 4));
+  }, 0.02);
+
+  std::thread thread([&]() { events.start_loop(0); });
+
+  for (size_t i = 0; i < 500 && !done; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  ASSERT_TRUE(done);
+
+  events.signal_loop(0);
+
+  for (size_t i = 0; i < 500 && signals == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  events.stop_all_loops();
+  thread.join();
+
+  close(sv[1]);
+
+  ASSERT_EQ("ping", received);
+  ASSERT_EQ(4u, callbacks);
+  ASSERT_LE(1u, signals.load());
+  ASSERT_LE(1u, ticks);
+}
+
+TEST(uring_async_loop_signal_test_case, test)
+{
+  std::atomic<size_t> drains(0);
+
+  uring_async_events events(1, [&](async_loop &) { drains++; });
+
+  if (!events.init()) {
+    LOG(WARNING) << "io_uring is not available, skipping";
+    return;
+  }
+
+  auto & loop = events.loop(0);
+
+  // Only the first signal writes to the eventfd until the loop drains
+  for (size_t i = 0; i < 10; i++) {
+    events.signal_loop(0);
+  }
+
+  ASSERT_EQ(1u, loop.wakeups_sent());
+  ASSERT_EQ(9u, loop.wakeups_skipped());
+
+  std::thread thread([&]() { events.start_loop(0); });
+
+  for (size_t i = 0; i < 500 && drains == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  ASSERT_EQ(1u, drains.load());
+
+  // After a drain the next signal wakes the loop up again
+  events.signal_loop(0);
+
+  for (size_t i = 0; i < 500 && drains == 1; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  events.stop_all_loops();
+  thread.join();
+
+  ASSERT_EQ(2u, drains.load());
+  ASSERT_EQ(2u, loop.wakeups_sent());
+  ASSERT_EQ(9u, loop.wakeups_skipped());
+}
+
+TEST(uring_async_loop_recv_test_case, test)
+{
+  uring_async_events events(1, [](async_loop &) {});
+
+  if (!events.init()) {
+    LOG(WARNING) << "io_uring is not available, skipping";
+    return;
+  }
+
+  int sv[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+  auto & loop = events.loop(0);
+
+  std::string received;
+  bool paused = false;
+  std::atomic<bool> done(false);
+
+  // Takes three bytes per callback, the callback runs again for the rest
+  loop.add_fd(sv[0], async_fd::read, [&](async_fd & fd)
+  {
+    ASSERT_FALSE(paused);
+    ASSERT_TRUE(fd.ready_read());
+
+    char buf[3];
+    const ssize_t n = fd.recv(buf, sizeof(buf));
+
+    ASSERT_LE(0, n);
+
+    if (n == 0) {
+      fd.stop();
+      done = true;
+      return;
+    }
+
+    received.append(buf, n);
+
+    if (received == "hel") {
+      paused = true;
+      fd.set_mode(async_fd::none);
+    }
+  });
+
+  if (!loop.set_fd_recv(sv[0])) {
+    LOG(WARNING) << "io_uring lacks provided buffers, skipping";
+    loop.remove_fd(sv[0]);
+    close(sv[1]);
+    return;
+  }
+
+  loop.add_once_task("test", [&](size_t)
+  {
+    ASSERT_EQ(11, write(sv[1], "hello world", 11));
+  }, 0.02);
+
+  // What comes while the connection is paused is read once it resumes
+  loop.add_once_task("test", [&](size_t)
+  {
+    ASSERT_EQ(2, write(sv[1], "!!", 2));
+    close(sv[1]);
+  }, 0.05);
+
+  loop.add_once_task("test", [&](size_t)
+  {
+    paused = false;
+    loop.set_fd_mode(sv[0], async_fd::read);
+  }, 0.1);
+
+  std::thread thread([&]() { events.start_loop(0); });
+
+  for (size_t i = 0; i < 500 && !done; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  events.stop_all_loops();
+  thread.join();
+
+  ASSERT_TRUE(done);
+  ASSERT_EQ("hello world!!", received);
+}
+
+TEST(uring_async_loop_recvmsg_test_case, test)
+{
+  uring_async_events events(1, [](async_loop &) {});
+
+  if (!events.init()) {
+    LOG(WARNING) << "io_uring is not available, skipping";
+    return;
+  }
+
+  int sv[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, sv));
+
+  auto & loop = events.loop(0);
+
+  const size_t max_size = 8;
+
+  std::vector<std::string> received;
+  std::vector<bool> truncated;
+  std::atomic<bool> done(false);
+
+  loop.add_fd(sv[0], async_fd::read, [&](async_fd & fd)
+  {
+    const size_t vlen = 2;
+
+    char buffers[vlen][max_size];
+    struct iovec iovs[vlen];
+    struct mmsghdr msgs[vlen];
+
+    memset(msgs, 0, sizeof(msgs));
+
+    for (size_t i = 0; i < vlen; i++) {
+      iovs[i].iov_base = buffers[i];
+      iovs[i].iov_len = max_size;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    const int n = fd.recvmmsg(msgs, vlen);
+
+    ASSERT_LT(0, n);
+
+    for (int i = 0; i < n; i++) {
+      received.emplace_back(buffers[i], msgs[i].msg_len);
+      truncated.push_back(msgs[i].msg_hdr.msg_flags & MSG_TRUNC);
+    }
+
+    if (received.size() == 3) {
+      fd.stop();
+      done = true;
+    }
+  });
+
+  ASSERT_FALSE(loop.set_fd_recvmsg(sv[0], 1 << 20));
+
+  if (!loop.set_fd_recvmsg(sv[0], max_size)) {
+    LOG(WARNING) << "io_uring lacks provided buffers, skipping";
+    loop.remove_fd(sv[0]);
+    close(sv[1]);
+    return;
+  }
+
+  ASSERT_EQ(4, send(sv[1], "ping", 4, 0));
+  ASSERT_EQ(13, send(sv[1], "0123456789abc", 13, 0));
+  ASSERT_EQ(4, send(sv[1], "pong", 4, 0));
+
+  std::thread thread([&]() { events.start_loop(0); });
+
+  for (size_t i = 0; i < 500 && !done; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  events.stop_all_loops();
+  thread.join();
+
+  close(sv[1]);
+
+  ASSERT_TRUE(done);
+  ASSERT_EQ(std::vector<std::string>({"ping", "01234567", "pong"}), received);
+  ASSERT_EQ(std::vector<bool>({false, true, false}), truncated);
+}
+
+#endif